@@ -20,59 +20,500 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include <c_lexer/LexFiles.h>
 #include <c_lexer/Lexer.h>
+#include <c_lexer/PerfCounters.h>
+#include <c_lexer/TokenCache.h>
 
+using c_lexer::FileTokens;
+using c_lexer::lex_files;
 using c_lexer::Lexeme;
 using c_lexer::Lexer;
+using c_lexer::LexerStats;
+using c_lexer::MappedSourceReader;
+using c_lexer::PerfCounters;
+using c_lexer::Percentiles;
 using c_lexer::SourceReader;
 using c_lexer::Token;
+using c_lexer::TokenCache;
+using c_lexer::ttos;
 
 #include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
+#include <iterator>
 #include <memory>
-#include <unordered_map>
+#include <string>
+#include <string_view>
 #include <vector>
 
-int main(int argc, char *argv[]) {
-  std::ifstream f;
-  if (argc > 1) {
-    f.open(argv[1]);
+// A tally of tokens indexed by Token, with no room spent on names.
+using Histogram = std::array<std::uint64_t, c_lexer::num_tokens>;
+
+// What to print while lexing: every token, or only counts of them.
+enum class Report { TOKENS, COUNT_ONLY, HISTOGRAM };
+
+// Output gathered into one large buffer and handed to stdio a buffer at a
+// time, instead of formatted piecewise through iostreams.
+class Writer {
+public:
+  explicit Writer(std::FILE *out, std::size_t capacity = 1 << 20)
+      : out_(out), capacity_(capacity) {
+    buf_.reserve(capacity_);
   }
+  ~Writer() { flush(); }
 
-  std::istream &in = f.is_open() ? f : std::cin;
+  Writer &operator<<(std::string_view s) {
+    if (buf_.size() + s.size() > capacity_)
+      flush();
+    buf_.append(s.data(), s.size());
+    return *this;
+  }
+  Writer &operator<<(char c) {
+    if (buf_.size() == capacity_)
+      flush();
+    buf_.push_back(c);
+    return *this;
+  }
+  Writer &operator<<(std::uint64_t n) {
+    char digits[20];
+    const auto res = std::to_chars(digits, digits + sizeof(digits), n);
+    return *this << std::string_view(digits, res.ptr - digits);
+  }
+  Writer &operator<<(std::uint32_t n) {
+    return *this << static_cast<std::uint64_t>(n);
+  }
+
+  void flush() {
+    std::fwrite(buf_.data(), 1, buf_.size(), out_);
+    buf_.clear();
+  }
+
+private:
+  std::FILE *out_;
+  std::size_t capacity_;
+  std::string buf_;
+};
+
+std::uint64_t total_of(const Histogram &counts) {
+  std::uint64_t total = 0;
+  for (std::uint64_t n : counts)
+    total += n;
+  return total;
+}
 
-  std::unique_ptr<SourceReader> reader = std::make_unique<SourceReader>(in);
+// The kinds in counts that were seen, busiest first.
+void print_counts(Writer &out, const Histogram &counts,
+                  std::string_view indent = {}) {
+  std::vector<std::pair<const char *, std::uint64_t>> v;
+  for (std::size_t i = 0; i < counts.size(); ++i)
+    if (counts[i])
+      v.emplace_back(ttos[i], counts[i]);
+  std::stable_sort(v.begin(), v.end(), [](auto &left, auto &right) {
+    return left.second > right.second;
+  });
 
-  Lexer lexer(std::move(reader));
+  for (const auto &pair : v)
+    out << indent << "Token::" << pair.first << ' ' << pair.second << '\n';
+}
+
+// One input's (or all inputs') line of a --count-only or --histogram
+// report, followed by its histogram for the latter.
+void print_report(Writer &out, std::string_view name, const Histogram &counts,
+                  Report report) {
+  out << name << ": " << total_of(counts) << " tokens\n";
+  if (report == Report::HISTOGRAM)
+    print_counts(out, counts, "  ");
+}
+
+// Print every token of one file, or of stdin when path is nullptr.
+int lex_one(const char *path) {
+  std::unique_ptr<SourceReader> reader;
+  std::ifstream f;
+
+  if (path) {
+    // Lex regular files straight from a read-only mapping, falling back to
+    // a stream for anything that cannot be mapped (pipes, devices, ...).
+    auto mapped = std::make_unique<MappedSourceReader>(path);
+    if (mapped->is_open())
+      reader = std::move(mapped);
+    else
+      f.open(path);
+  }
+
+  if (!reader) {
+    std::istream &in = f.is_open() ? f : std::cin;
+    reader = std::make_unique<SourceReader>(in);
+  }
+
+  Lexer lexer(std::move(reader), Lexer::ZERO_COPY);
   lexer.preload(3);
 
-  std::unordered_map<const char *, std::uint32_t> counts;
+  Histogram counts{};
+  Writer out(stdout);
 
   while (lexer.peek() != Token::END) {
     Lexeme lexeme = lexer.eat();
+    ++counts[static_cast<std::size_t>(lexeme.token_)];
+
+    out << lexeme.text() << " (" << lexeme.row_ << ',' << lexeme.col_
+        << ") : Token::" << lexeme.token_str() << '\n';
+  }
 
-    if (auto iter = counts.find(lexeme.token_str()); iter != counts.end()) {
-      iter->second++;
+  if (f.is_open())
+    f.close();
+
+  out << '\n';
+  print_counts(out, counts);
+
+  return 0;
+}
+
+// A reader over a mapping of path, a stream of it, or of stdin when path is
+// nullptr. Null when path cannot be opened.
+std::unique_ptr<SourceReader> open_reader(const char *path, std::ifstream &f) {
+  if (path) {
+    auto mapped = std::make_unique<MappedSourceReader>(path);
+    if (mapped->is_open())
+      return mapped;
+    f.open(path);
+    if (!f.is_open())
+      return nullptr;
+  }
+  return std::make_unique<SourceReader>(f.is_open() ? f : std::cin);
+}
+
+// Count the tokens of one file, or of stdin when path is nullptr, by kind
+// alone: the lexer hands over batches of Tokens and no Lexeme is built.
+int count_one(const char *path, Report report) {
+  std::ifstream f;
+  std::unique_ptr<SourceReader> reader = open_reader(path, f);
+  if (!reader) {
+    std::cerr << "c_lexview: cannot read " << path << '\n';
+    return 1;
+  }
+
+  Lexer lexer(std::move(reader), Lexer::ZERO_COPY | Lexer::LAZY_POSITIONS);
+  Histogram counts{};
+  Token batch[4096];
+
+  for (;;) {
+    const std::size_t n = lexer.next_batch(batch, std::size(batch));
+    for (std::size_t i = 0; i < n; ++i)
+      ++counts[static_cast<std::size_t>(batch[i])];
+    if (!n || batch[n - 1] == Token::END)
+      break;
+  }
+  --counts[static_cast<std::size_t>(Token::END)];
+
+  Writer out(stdout);
+  print_report(out, path ? path : "<stdin>", counts, report);
+  return 0;
+}
+
+// Lex many files in parallel, printing a token count per file followed by
+// the totals for all of them. With a cache, files lexed before are loaded
+// from it. A --count-only report ends with the grand total instead of the
+// totals of each kind, and a --histogram report gives both for every file
+// as well as for all of them.
+int lex_many(const std::vector<std::string> &paths, unsigned n_threads,
+             TokenCache *cache, Report report) {
+  std::vector<Histogram> counts(paths.size());
+  std::vector<char> ok(paths.size());
+
+  lex_files(
+      paths, n_threads,
+      [&](const FileTokens &file) {
+        if (!file.ok)
+          return;
+
+        // Each file is handed over once, so its own slots need no lock.
+        Histogram &mine = counts[file.index];
+        for (std::uint8_t kind : file.tokens.kinds())
+          ++mine[kind];
+        --mine[static_cast<std::size_t>(Token::END)];
+        ok[file.index] = true;
+      },
+      0, cache);
+
+  Writer out(stdout);
+  Histogram totals{};
+  std::size_t n_files = 0;
+  int res = 0;
+  for (std::size_t i = 0; i < paths.size(); ++i) {
+    if (ok[i]) {
+      print_report(out, paths[i], counts[i],
+                   report == Report::HISTOGRAM ? report : Report::COUNT_ONLY);
+      for (std::size_t k = 0; k < totals.size(); ++k)
+        totals[k] += counts[i][k];
+      ++n_files;
     } else {
-      counts.insert({lexeme.token_str(), 1});
+      out.flush();
+      std::cerr << "c_lexview: cannot read " << paths[i] << '\n';
+      res = 1;
     }
+  }
 
-    std::cout << lexeme.lexeme_ << " (" << lexeme.row_ << "," << lexeme.col_
-              << ") : Token::" << lexeme.token_str() << '\n';
+  if (report == Report::TOKENS) {
+    out << '\n';
+    print_counts(out, totals);
+  } else {
+    out << '\n';
+    print_report(out, "total", totals, report);
+    out << "files " << static_cast<std::uint64_t>(n_files) << '\n';
   }
 
-  if (f.is_open())
-    f.close();
+  return res;
+}
+
+// Lex each file, or stdin when there are none, and print what the lexers
+// counted in all of them, busiest first.
+int lex_stats(const std::vector<std::string> &paths) {
+  if (!c_lexer::lexer_stats_enabled()) {
+    std::cerr << "c_lexview: --stats needs the library configured with "
+                 "MYPROJ_LEXER_STATS\n";
+    return 1;
+  }
 
-  std::vector<std::pair<const char *, std::uint32_t>> v(counts.begin(),
-                                                        counts.end());
-  std::sort(v.begin(), v.end(),
+  LexerStats total;
+  int res = 0;
+  for (std::size_t i = 0; i < std::max<std::size_t>(paths.size(), 1); ++i) {
+    const char *path = paths.empty() ? nullptr : paths[i].c_str();
+    std::ifstream f;
+    std::unique_ptr<SourceReader> reader = open_reader(path, f);
+    if (!reader) {
+      std::cerr << "c_lexview: cannot read " << path << '\n';
+      res = 1;
+      continue;
+    }
+
+    Lexer lexer(std::move(reader), Lexer::ZERO_COPY);
+    while (lexer.peek() != Token::END)
+      lexer.eat();
+    total += lexer.stats();
+  }
+
+  std::vector<std::pair<const char *, std::uint64_t>> order;
+  for (std::size_t i = 0; i < c_lexer::num_tokens; ++i)
+    if (total.tokens[i])
+      order.emplace_back(ttos[i], i);
+  std::sort(order.begin(), order.end(), [&](auto &left, auto &right) {
+    return total.bytes[left.second] > total.bytes[right.second];
+  });
+
+  std::cout << "tokens bytes\n";
+  for (const auto &[name, i] : order)
+    std::cout << "Token::" << name << ' ' << total.tokens[i] << ' '
+              << total.bytes[i] << '\n';
+
+  std::cout << "\nbackups " << total.backups << "\nwhitespace "
+            << total.whitespace_bytes << " bytes " << total.whitespace_ns
+            << " ns\n";
+
+  std::vector<std::pair<const char *, std::uint64_t>> states;
+  for (std::uint32_t s = 0; s < LexerStats::num_states; ++s)
+    if (total.states[s])
+      states.emplace_back(c_lexer::lexer_state_name(s), total.states[s]);
+  std::sort(states.begin(), states.end(),
             [](auto &left, auto &right) { return left.second > right.second; });
 
-  std::cout << '\n';
-  for (const auto &pair : v) {
-    std::cout << "Token::" << pair.first << ' ' << pair.second << '\n';
+  std::cout << "\nstates\n";
+  for (const auto &[name, n] : states)
+    std::cout << name << ' ' << n << '\n';
+
+  return res;
+}
+
+// What --perf measured of one input, or of all of them.
+struct PerfReport {
+  std::uint64_t bytes = 0;
+  std::uint64_t tokens = 0;
+  std::array<std::uint64_t, PerfCounters::num_events> counts{};
+  std::vector<std::uint64_t> eat_ns; // of every eat()
+
+  PerfReport &operator+=(const PerfReport &other) {
+    bytes += other.bytes;
+    tokens += other.tokens;
+    for (std::size_t e = 0; e < counts.size(); ++e)
+      counts[e] += other.counts[e];
+    eat_ns.insert(eat_ns.end(), other.eat_ns.begin(), other.eat_ns.end());
+    return *this;
   }
+};
 
-  return 0;
+// Lex src twice: once whole under the counters, and once timing each eat()
+// on its own, so that the clock stays out of the counts. Errors are kept
+// aside with RECOVER rather than written to stderr along the way.
+void measure(std::string_view src, PerfCounters &counters, PerfReport &r) {
+  const std::uint32_t flags = Lexer::ZERO_COPY | Lexer::RECOVER;
+  r.bytes = src.size();
+  counters.start();
+  {
+    Lexer lexer(std::make_unique<SourceReader>(src), flags);
+    while (lexer.eat() != Token::END)
+      ++r.tokens;
+  }
+  counters.stop();
+  for (std::size_t e = 0; e < r.counts.size(); ++e)
+    r.counts[e] = counters.count(PerfCounters::Event(e));
+
+  Lexer lexer(std::make_unique<SourceReader>(src), flags);
+  r.eat_ns.reserve(r.tokens + 1);
+  for (;;) {
+    const auto t0 = std::chrono::steady_clock::now();
+    const Lexeme l = lexer.eat();
+    const auto t1 = std::chrono::steady_clock::now();
+    r.eat_ns.push_back(static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0)
+            .count()));
+    if (l.token() == Token::END)
+      break;
+  }
+}
+
+void print_perf(Writer &out, std::string_view name, PerfReport &r,
+                const PerfCounters &counters) {
+  char buf[160];
+  const auto per = [](std::uint64_t n, std::uint64_t d) {
+    return d ? static_cast<double>(n) / static_cast<double>(d) : 0.0;
+  };
+
+  out << name << ": " << r.bytes << " bytes, " << r.tokens << " tokens\n";
+  if (!counters.available())
+    out << "  hardware counters unavailable\n";
+  if (counters.has(PerfCounters::CYCLES)) {
+    std::snprintf(buf, sizeof(buf), "  cycles/byte %.2f\n",
+                  per(r.counts[PerfCounters::CYCLES], r.bytes));
+    out << buf;
+  }
+  if (counters.has(PerfCounters::INSTRUCTIONS)) {
+    std::snprintf(buf, sizeof(buf), "  instructions/byte %.2f\n",
+                  per(r.counts[PerfCounters::INSTRUCTIONS], r.bytes));
+    out << buf;
+    if (counters.has(PerfCounters::CYCLES)) {
+      std::snprintf(buf, sizeof(buf), "  instructions/cycle %.2f\n",
+                    per(r.counts[PerfCounters::INSTRUCTIONS],
+                        r.counts[PerfCounters::CYCLES]));
+      out << buf;
+    }
+  }
+  if (counters.has(PerfCounters::BRANCHES) &&
+      counters.has(PerfCounters::BRANCH_MISSES)) {
+    std::snprintf(buf, sizeof(buf), "  branch-miss rate %.2f%%\n",
+                  100 * per(r.counts[PerfCounters::BRANCH_MISSES],
+                            r.counts[PerfCounters::BRANCHES]));
+    out << buf;
+  }
+  if (counters.has(PerfCounters::L1I_MISSES)) {
+    std::snprintf(buf, sizeof(buf), "  L1-icache misses/KiB %.2f\n",
+                  1024 * per(r.counts[PerfCounters::L1I_MISSES], r.bytes));
+    out << buf;
+  }
+
+  const Percentiles p = c_lexer::percentiles(r.eat_ns);
+  out << "  eat() ns p50 " << p.p50 << " p99 " << p.p99 << " p999 " << p.p999
+      << '\n';
+}
+
+// Lex each file, or stdin when there are none, from memory, and print the
+// hardware counts and eat() latencies of each and then of all of them.
+int lex_perf(const std::vector<std::string> &paths) {
+  PerfCounters counters;
+  PerfReport total;
+  Writer out(stdout);
+  int res = 0;
+
+  for (std::size_t i = 0; i < std::max<std::size_t>(paths.size(), 1); ++i) {
+    const char *path = paths.empty() ? nullptr : paths[i].c_str();
+    std::ifstream f;
+    if (path) {
+      f.open(path, std::ios::binary);
+      if (!f.is_open()) {
+        out.flush();
+        std::cerr << "c_lexview: cannot read " << path << '\n';
+        res = 1;
+        continue;
+      }
+    }
+    std::istream &in = f.is_open() ? f : std::cin;
+    const std::string src(std::istreambuf_iterator<char>(in), {});
+
+    PerfReport r;
+    measure(src, counters, r);
+    print_perf(out, path ? path : "<stdin>", r, counters);
+    total += r;
+  }
+
+  if (paths.size() > 1) {
+    out << '\n';
+    print_perf(out, "total", total, counters);
+  }
+  return res;
+}
+
+int usage(const char *prog) {
+  std::cerr << "usage: " << prog
+            << " [-j N] [--cache-dir DIR] [--stats | --perf]"
+               " [--count-only | --histogram] [FILE...]\n";
+  return 1;
+}
+
+int main(int argc, char *argv[]) {
+  std::vector<std::string> paths;
+  unsigned n_threads = 1;
+  bool parallel = false;
+  std::unique_ptr<TokenCache> cache;
+  bool stats = false;
+  bool perf = false;
+  Report report = Report::TOKENS;
+
+  for (int i = 1; i < argc; ++i) {
+    const char *arg = argv[i];
+
+    if (!std::strncmp(arg, "-j", 2)) {
+      const char *n = arg[2] ? arg + 2 : (i + 1 < argc ? argv[++i] : nullptr);
+      char *end = nullptr;
+      const long val = n ? std::strtol(n, &end, 10) : -1;
+      if (!n || *end || val < 0)
+        return usage(argv[0]);
+
+      n_threads = static_cast<unsigned>(val);
+      parallel = true;
+    } else if (!std::strcmp(arg, "--cache-dir")) {
+      if (i + 1 == argc)
+        return usage(argv[0]);
+      cache = std::make_unique<TokenCache>(argv[++i]);
+      parallel = true;
+    } else if (!std::strcmp(arg, "--stats")) {
+      stats = true;
+    } else if (!std::strcmp(arg, "--perf")) {
+      perf = true;
+    } else if (!std::strcmp(arg, "--count-only")) {
+      report = Report::COUNT_ONLY;
+    } else if (!std::strcmp(arg, "--histogram")) {
+      report = Report::HISTOGRAM;
+    } else {
+      paths.push_back(arg);
+    }
+  }
+
+  if (stats)
+    return lex_stats(paths);
+  if (perf)
+    return lex_perf(paths);
+  if (report != Report::TOKENS && paths.size() <= 1 && !parallel)
+    return count_one(paths.empty() ? nullptr : paths[0].c_str(), report);
+  if (paths.empty() && !cache)
+    return lex_one(nullptr);
+  if (paths.size() == 1 && !parallel)
+    return lex_one(paths[0].c_str());
+
+  if (paths.empty())
+    return usage(argv[0]);
+  return lex_many(paths, n_threads, cache.get(), report);
 }
@@ -0,0 +1,98 @@
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <c_lexer/Lexer.h>
+#include <c_lexer/TokenStream.h>
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <string>
+
+using c_lexer::Lexer;
+using c_lexer::scan_tokens;
+using c_lexer::TokenStream;
+
+// Keyword recognition by the character-level DFA and by the generated table.
+
+const char *keyword_heavy = R"c(
+static inline unsigned long long
+hash_bytes(const unsigned char *restrict p, unsigned long n) {
+  register unsigned long long h = 14695981039346656037ull;
+  for (unsigned long i = 0; i < n; ++i) {
+    if (p[i] == 0)
+      continue;
+    else
+      h = (h ^ p[i]) * 1099511628211ull;
+  }
+  do {
+    switch (n & 3) {
+    case 0: break;
+    default: goto done;
+    }
+  } while (0);
+done:
+  return sizeof(h) == 8 ? h : (unsigned)h;
+}
+
+typedef struct node { struct node *next; const volatile int value; } node;
+extern _Thread_local _Bool initialized;
+_Static_assert(sizeof(node) > 0, "node");
+)c";
+
+const char *identifier_heavy = R"c(
+result = compute_checksum(input_buffer, buffer_length, seed_value);
+accumulator_total += scale_factor * element_count - offset_adjustment;
+status_code = validate_request(request_header, request_body, options);
+counter_variable = previous_counter_value + increment_amount;
+dispatch_table[handler_index](context_pointer, argument_vector);
+)c";
+
+std::string repeat(const char *s, std::size_t bytes) {
+  std::string src;
+  while (src.size() < bytes)
+    src += s;
+  return src;
+}
+
+void bench_lex(benchmark::State &state, const char *s, std::uint32_t flags) {
+  const std::string src = repeat(s, 1 << 20);
+  TokenStream ts;
+
+  for (auto _ : state) {
+    scan_tokens(src, ts, flags);
+    benchmark::DoNotOptimize(ts.kinds().data());
+  }
+
+  state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) *
+                          static_cast<std::int64_t>(src.size()));
+  state.counters["tokens"] = static_cast<double>(ts.size());
+}
+
+BENCHMARK_CAPTURE(bench_lex, keywords_dfa, keyword_heavy, 0);
+BENCHMARK_CAPTURE(bench_lex, keywords_table, keyword_heavy,
+                  Lexer::TABLE_KEYWORDS);
+BENCHMARK_CAPTURE(bench_lex, identifiers_dfa, identifier_heavy, 0);
+BENCHMARK_CAPTURE(bench_lex, identifiers_table, identifier_heavy,
+                  Lexer::TABLE_KEYWORDS);
+
+BENCHMARK_MAIN();
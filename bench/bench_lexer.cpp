@@ -0,0 +1,369 @@
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <c_lexer/Lexer.h>
+#include <c_lexer/PerfCounters.h>
+#include <c_lexer/PipelinedLexer.h>
+#include <c_lexer/SourceReader.h>
+#include <c_lexer/TokenStream.h>
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+using c_lexer::Lexer;
+using c_lexer::PerfCounters;
+using c_lexer::Percentiles;
+using c_lexer::PipelinedLexer;
+using c_lexer::scan_tokens;
+using c_lexer::scan_tokens_parallel;
+using c_lexer::SourceReader;
+using c_lexer::Token;
+using c_lexer::TokenStream;
+
+// Throughput of the lexer front ends over synthetic and real-world corpora.
+// Each benchmark reports bytes/s and a tokens/s counter; bench_counters and
+// bench_eat_latency add hardware counts and eat() percentiles per corpus.
+
+const char *punctuator_heavy =
+    "{ ( [ ] ) } ; , . ... -> ++ -- & * + - ~ ! / % << >> < > <= >= == !=\n"
+    "^ | && || ? : = *= /= %= += -= <<= >>= &= ^= |= a[b]->c.d(e, f);\n";
+
+const char *identifier_heavy =
+    "result = compute_checksum(input_buffer, buffer_length, seed_value);\n"
+    "accumulator_total += scale_factor * element_count - offset_value;\n"
+    "dispatch_table[handler_index](context_pointer, argument_vector);\n";
+
+const char *keyword_heavy =
+    "static inline unsigned long long f(const volatile int *restrict p) {\n"
+    "  register long i; for (;;) { if (i) continue; else break; }\n"
+    "  do { switch (i) { case 0: default: goto done; } } while (0);\n"
+    "done: return sizeof(struct s) + sizeof(union u) + (enum e)0; }\n"
+    "typedef signed char _Bool; extern _Thread_local float double;\n";
+
+const char *numeric_heavy =
+    "0x1.8p3 .5f 1e10 0777 42UL 0x7fffULL 3.14159L 1.0e-3f 123456789\n"
+    "0 1 2 3 4 5 6 7 8 9 10 100 1000 0xdeadbeef 0XCAFEul 6.02e23 1.\n";
+
+const char *string_heavy =
+    "\"hello, world\\n\" L\"wide\" u8\"utf-8\" U\"utf-32\" u\"utf-16\"\n"
+    "'c' '\\t' '\\'' L'w' \"a considerably longer string literal body\"\n"
+    "\"escapes \\\\ \\\" \\x7f \\177 \\a\\b\\f\\n\\r\\t\\v\" '\\0'\n";
+
+const char *comment_heavy =
+    "/*\n"
+    " * Returns the number of bytes in the buffer that are still unread,\n"
+    " * which is never more than the capacity given to buffer_init().\n"
+    " */\n"
+    "size_t buffer_unread(const struct buffer *b); // see buffer.c\n"
+    "int flags; /* one of the BUFFER_* values */ // and nothing else\n";
+
+std::string repeat(const char *s, std::size_t bytes) {
+  std::string src;
+  while (src.size() < bytes)
+    src += s;
+  return src;
+}
+
+// The real-world corpus is bench/corpus.c unless C_LEXER_BENCH_CORPUS names
+// another file. Either is repeated out to the same size as the synthetic
+// corpora so that the numbers are comparable.
+std::string real_world(std::size_t bytes) {
+  const char *path = std::getenv("C_LEXER_BENCH_CORPUS");
+  if (!path)
+    path = C_LEXER_BENCH_CORPUS_FILE;
+
+  std::ifstream in(path, std::ios::binary);
+  const std::string contents(std::istreambuf_iterator<char>(in), {});
+  if (contents.empty()) {
+    std::cerr << "bench_lexer: cannot read " << path << '\n';
+    std::exit(1);
+  }
+
+  return repeat(contents.c_str(), bytes);
+}
+
+// src with each newline made a space, as a minifier leaves it. Only for a
+// corpus with no line comments or directives, which a newline ends.
+std::string one_line(std::string src) {
+  std::replace(src.begin(), src.end(), '\n', ' ');
+  return src;
+}
+
+// Arbitrary bytes, as from a binary file given for a source. Only RECOVER
+// scans them without printing a message for each error.
+std::string garbage(std::size_t bytes) {
+  std::string src(bytes, '\0');
+  std::uint32_t x = 2463534242u;
+  for (char &c : src) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    c = static_cast<char>(x);
+  }
+  return src;
+}
+
+const std::size_t corpus_bytes = 1 << 20;
+
+void report(benchmark::State &state, std::size_t bytes, std::size_t tokens) {
+  state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) *
+                          static_cast<std::int64_t>(bytes));
+  state.counters["tokens"] =
+      benchmark::Counter(static_cast<double>(tokens),
+                         benchmark::Counter::kIsIterationInvariantRate);
+}
+
+// scan_tokens() into a reused TokenStream.
+void bench_stream(benchmark::State &state, const std::string &src,
+                  std::uint32_t flags) {
+  TokenStream ts;
+
+  for (auto _ : state) {
+    scan_tokens(src, ts, flags);
+    benchmark::DoNotOptimize(ts.kinds().data());
+  }
+
+  report(state, src.size(), ts.size());
+}
+
+// scan_tokens() into a std::vector<Lexeme>.
+void bench_lexemes(benchmark::State &state, const std::string &src,
+                   std::uint32_t flags) {
+  std::size_t tokens = 0;
+
+  for (auto _ : state) {
+    auto v = scan_tokens(src, flags);
+    tokens = v.size();
+    benchmark::DoNotOptimize(v.data());
+  }
+
+  report(state, src.size(), tokens);
+}
+
+// Lexer::eat() with preload(range(0)) ahead of every token.
+void bench_eat(benchmark::State &state, const std::string &src) {
+  const std::size_t depth = static_cast<std::size_t>(state.range(0));
+  std::size_t tokens = 0;
+
+  for (auto _ : state) {
+    Lexer lexer(std::make_unique<SourceReader>(src), Lexer::ZERO_COPY);
+    tokens = 0;
+    while (lexer.peek() != Token::END) {
+      if (depth)
+        lexer.preload(depth);
+      benchmark::DoNotOptimize(lexer.eat());
+      ++tokens;
+    }
+  }
+
+  report(state, src.size(), tokens);
+}
+
+// Lexer::next_batch() of range(0) Lexeme's at a time.
+void bench_batch(benchmark::State &state, const std::string &src) {
+  std::vector<c_lexer::Lexeme> batch(static_cast<std::size_t>(state.range(0)));
+  std::size_t tokens = 0;
+
+  for (auto _ : state) {
+    Lexer lexer(std::make_unique<SourceReader>(src), Lexer::ZERO_COPY);
+    tokens = 0;
+    for (;;) {
+      const std::size_t n = lexer.next_batch(batch.data(), batch.size());
+      benchmark::DoNotOptimize(batch.data());
+      tokens += n;
+      if (batch[n - 1] == Token::END)
+        break;
+    }
+  }
+
+  report(state, src.size(), tokens);
+}
+
+// PipelinedLexer::eat(), with scanning on a producer thread.
+void bench_pipelined(benchmark::State &state, const std::string &src) {
+  std::size_t tokens = 0;
+
+  for (auto _ : state) {
+    PipelinedLexer lexer(std::make_unique<SourceReader>(src), Lexer::ZERO_COPY,
+                         static_cast<std::size_t>(state.range(0)));
+    tokens = 0;
+    while (lexer.peek() != Token::END) {
+      benchmark::DoNotOptimize(lexer.eat());
+      ++tokens;
+    }
+  }
+
+  report(state, src.size(), tokens);
+}
+
+// scan_tokens() into a reused TokenStream under the hardware counters, for
+// whether a corpus is bound by the front end: cycles and instructions per
+// byte, the rate of branch misses, and L1-I misses per KiB. Counters that
+// perf_event_open() refuses here are left out.
+void bench_counters(benchmark::State &state, const std::string &src,
+                    std::uint32_t flags) {
+  PerfCounters counters;
+  std::array<double, PerfCounters::num_events> totals{};
+  TokenStream ts;
+
+  for (auto _ : state) {
+    counters.start();
+    scan_tokens(src, ts, flags);
+    counters.stop();
+    benchmark::DoNotOptimize(ts.kinds().data());
+    for (std::size_t e = 0; e < totals.size(); ++e)
+      totals[e] += static_cast<double>(counters.count(PerfCounters::Event(e)));
+  }
+
+  report(state, src.size(), ts.size());
+  const double bytes = static_cast<double>(state.iterations()) *
+                       static_cast<double>(src.size());
+  if (counters.has(PerfCounters::CYCLES))
+    state.counters["cycles/B"] = totals[PerfCounters::CYCLES] / bytes;
+  if (counters.has(PerfCounters::INSTRUCTIONS))
+    state.counters["instr/B"] = totals[PerfCounters::INSTRUCTIONS] / bytes;
+  if (counters.has(PerfCounters::BRANCHES) &&
+      counters.has(PerfCounters::BRANCH_MISSES) &&
+      totals[PerfCounters::BRANCHES])
+    state.counters["br_miss%"] = 100 * totals[PerfCounters::BRANCH_MISSES] /
+                                 totals[PerfCounters::BRANCHES];
+  if (counters.has(PerfCounters::L1I_MISSES))
+    state.counters["L1I_miss/KiB"] =
+        1024 * totals[PerfCounters::L1I_MISSES] / bytes;
+}
+
+// scan_tokens_parallel() on range(0) workers, for how it scales with them,
+// on a corpus large enough to cut into a few chunks per worker.
+void bench_parallel(benchmark::State &state, const std::string &src) {
+  TokenStream ts;
+
+  for (auto _ : state) {
+    scan_tokens_parallel(src, ts, static_cast<unsigned>(state.range(0)));
+    benchmark::DoNotOptimize(ts.kinds().data());
+  }
+
+  report(state, src.size(), ts.size());
+}
+
+// Lexer::eat() timed token by token, for the tail that the mean hides. The
+// percentiles are of the last iteration.
+void bench_eat_latency(benchmark::State &state, const std::string &src) {
+  std::vector<std::uint64_t> ns;
+  ns.reserve(src.size() / 2);
+
+  for (auto _ : state) {
+    Lexer lexer(std::make_unique<SourceReader>(src), Lexer::ZERO_COPY);
+    ns.clear();
+    for (;;) {
+      const auto t0 = std::chrono::steady_clock::now();
+      const c_lexer::Lexeme l = lexer.eat();
+      const auto t1 = std::chrono::steady_clock::now();
+      ns.push_back(static_cast<std::uint64_t>(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0)
+              .count()));
+      if (l == Token::END)
+        break;
+    }
+  }
+
+  report(state, src.size(), ns.size());
+  const Percentiles p = c_lexer::percentiles(ns);
+  state.counters["p50_ns"] = static_cast<double>(p.p50);
+  state.counters["p99_ns"] = static_cast<double>(p.p99);
+  state.counters["p999_ns"] = static_cast<double>(p.p999);
+}
+
+#define CORPUS(_name, _text)                                                   \
+  const std::string _name##_src = _text;                                       \
+  BENCHMARK_CAPTURE(bench_stream, _name, _name##_src, 0);                      \
+  BENCHMARK_CAPTURE(bench_stream, _name##_table_keywords, _name##_src,         \
+                    Lexer::TABLE_KEYWORDS);                                    \
+  BENCHMARK_CAPTURE(bench_lexemes, _name##_copy, _name##_src, 0);              \
+  BENCHMARK_CAPTURE(bench_lexemes, _name##_zero_copy, _name##_src,             \
+                    Lexer::ZERO_COPY);                                         \
+  BENCHMARK_CAPTURE(bench_counters, _name, _name##_src, 0);                    \
+  BENCHMARK_CAPTURE(bench_eat_latency, _name, _name##_src)
+
+CORPUS(punctuators, repeat(punctuator_heavy, corpus_bytes));
+CORPUS(identifiers, repeat(identifier_heavy, corpus_bytes));
+CORPUS(keywords, repeat(keyword_heavy, corpus_bytes));
+CORPUS(numerics, repeat(numeric_heavy, corpus_bytes));
+CORPUS(strings, repeat(string_heavy, corpus_bytes));
+CORPUS(comments, repeat(comment_heavy, corpus_bytes));
+CORPUS(real_world, real_world(corpus_bytes));
+
+BENCHMARK_CAPTURE(bench_stream, comments_kept, comments_src,
+                  Lexer::KEEP_COMMENTS);
+
+const std::string garbage_src = garbage(corpus_bytes);
+BENCHMARK_CAPTURE(bench_stream, garbage_recover, garbage_src, Lexer::RECOVER);
+BENCHMARK_CAPTURE(bench_lexemes, garbage_recover_zero_copy, garbage_src,
+                  Lexer::RECOVER | Lexer::ZERO_COPY);
+BENCHMARK_CAPTURE(bench_counters, garbage_recover, garbage_src,
+                  Lexer::RECOVER);
+
+BENCHMARK_CAPTURE(bench_eat, real_world, real_world_src)
+    ->Arg(0)
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(4)
+    ->Arg(Lexer::lookahead_capacity);
+
+BENCHMARK_CAPTURE(bench_batch, real_world, real_world_src)
+    ->Arg(1)
+    ->Arg(16)
+    ->Arg(256);
+
+BENCHMARK_CAPTURE(bench_pipelined, real_world, real_world_src)
+    ->Arg(Lexer::lookahead_capacity)
+    ->Arg(256)
+    ->UseRealTime();
+
+// Minified source is all one line, so that its chunks are cut at spaces.
+const std::string parallel_src = real_world(16 * corpus_bytes);
+const std::string minified_src =
+    one_line(repeat(identifier_heavy, 16 * corpus_bytes));
+BENCHMARK_CAPTURE(bench_parallel, real_world, parallel_src)
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(4)
+    ->Arg(8)
+    ->UseRealTime();
+BENCHMARK_CAPTURE(bench_parallel, minified, minified_src)
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(4)
+    ->Arg(8)
+    ->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,199 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Tim Whisonant
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+typedef unsigned long size_t;
+typedef unsigned int uint32_t;
+
+struct entry {
+  const char *key;
+  size_t key_len;
+  void *value;
+  uint32_t hash;
+  struct entry *next;
+};
+
+struct table {
+  struct entry **buckets;
+  size_t n_buckets;
+  size_t n_entries;
+  double max_load;
+};
+
+extern void *malloc(size_t size);
+extern void *calloc(size_t n, size_t size);
+extern void free(void *p);
+extern int memcmp(const void *a, const void *b, size_t n);
+
+// FNV-1a. 0 is reserved to mean an empty slot.
+static uint32_t hash_key(const char *key, size_t len) {
+  uint32_t h = 2166136261ul;
+  for (size_t i = 0; i < len; ++i) {
+    h ^= (unsigned char)key[i];
+    h *= 16777619ul;
+  }
+  return h ? h : 1;
+}
+
+static int table_init(struct table *t, size_t n_buckets) {
+  if (n_buckets == 0)
+    n_buckets = 16;
+  t->buckets = calloc(n_buckets, sizeof(*t->buckets));
+  if (!t->buckets)
+    return -1;
+  t->n_buckets = n_buckets;
+  t->n_entries = 0;
+  t->max_load = 0.75;
+  return 0;
+}
+
+static struct entry **table_slot(struct table *t, const char *key,
+                                 size_t len, uint32_t hash) {
+  struct entry **p = &t->buckets[hash % t->n_buckets];
+  while (*p && ((*p)->hash != hash || (*p)->key_len != len ||
+                memcmp((*p)->key, key, len) != 0))
+    p = &(*p)->next;
+  return p;
+}
+
+/*
+ * Double the number of buckets and move every entry to its new bucket.
+ * Returns -1, leaving the table as it was, when memory runs out.
+ */
+static int table_grow(struct table *t) {
+  size_t n = t->n_buckets << 1;
+  struct entry **buckets = calloc(n, sizeof(*buckets));
+  if (buckets == (void *)0)
+    return -1;
+  for (size_t i = 0; i < t->n_buckets; ++i) {
+    struct entry *e = t->buckets[i];
+    while (e) {
+      struct entry *next = e->next;
+      e->next = buckets[e->hash % n];
+      buckets[e->hash % n] = e;
+      e = next;
+    }
+  }
+  free(t->buckets);
+  t->buckets = buckets;
+  t->n_buckets = n;
+  return 0;
+}
+
+int table_put(struct table *t, const char *key, size_t len, void *value) {
+  uint32_t hash = hash_key(key, len);
+  struct entry **p = table_slot(t, key, len, hash);
+  if (*p) { /* replace */
+    (*p)->value = value;
+    return 0;
+  }
+  if ((double)(t->n_entries + 1) > t->max_load * (double)t->n_buckets) {
+    if (table_grow(t) < 0)
+      return -1;
+    p = table_slot(t, key, len, hash);
+  }
+  struct entry *e = malloc(sizeof(*e));
+  if (!e)
+    return -1;
+  e->key = key;
+  e->key_len = len;
+  e->value = value;
+  e->hash = hash;
+  e->next = (void *)0;
+  *p = e;
+  ++t->n_entries;
+  return 1;
+}
+
+void *table_get(struct table *t, const char *key, size_t len) {
+  struct entry **p = table_slot(t, key, len, hash_key(key, len));
+  return *p ? (*p)->value : (void *)0;
+}
+
+int table_remove(struct table *t, const char *key, size_t len) {
+  struct entry **p = table_slot(t, key, len, hash_key(key, len));
+  struct entry *e = *p;
+  if (!e)
+    return 0;
+  *p = e->next;
+  free(e);
+  t->n_entries -= 1;
+  return 1;
+}
+
+void table_destroy(struct table *t) {
+  for (size_t i = 0; i < t->n_buckets; i++) {
+    struct entry *e = t->buckets[i];
+    while (e != (void *)0) {
+      struct entry *next = e->next;
+      free(e);
+      e = next;
+    }
+  }
+  free(t->buckets);
+  t->buckets = (void *)0;
+  t->n_buckets = t->n_entries = 0;
+}
+
+static const char *const months[] = {
+    "January", "February", "March",     "April",   "May",      "June",
+    "July",    "August",   "September", "October", "November", "December",
+};
+
+int parse_month(const char *s, size_t len) {
+  switch (len) {
+  case 3:
+    if (s[0] == 'M' && s[1] == 'a' && s[2] == 'y')
+      return 5;
+    break;
+  default:
+    for (int i = 0; i < 12; ++i) {
+      const char *m = months[i];
+      size_t j = 0;
+      while (j < len && m[j] == s[j])
+        ++j;
+      if (j == len && m[j] == '\0')
+        return i + 1;
+    }
+  }
+  return -1;
+}
+
+double mean_and_variance(const double *x, size_t n, double *variance) {
+  double mean = 0.0, m2 = 0.0;
+  for (size_t i = 0; i < n; ++i) {
+    double delta = x[i] - mean;
+    mean += delta / (double)(i + 1);
+    m2 += delta * (x[i] - mean);
+  }
+  if (variance)
+    *variance = n > 1 ? m2 / (double)(n - 1) : 0.0;
+  return mean;
+}
+
+unsigned popcount64(unsigned long long x) {
+  x = x - ((x >> 1) & 0x5555555555555555ULL);
+  x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+  x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+  return (unsigned)((x * 0x0101010101010101ULL) >> 56);
+}
@@ -0,0 +1,73 @@
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <string_view>
+#include <vector>
+
+namespace c_lexer {
+
+// A bump allocator for token text, decoded payloads and interned names.
+// Allocations are carved out of large blocks and are only freed all at once,
+// by release() or the destructor, so the tokens of a whole translation unit
+// go in O(1) frees. As a std::pmr::memory_resource it can also back pmr
+// containers, whose deallocations it ignores.
+class Arena : public std::pmr::memory_resource {
+public:
+  static constexpr std::size_t default_block_size = 64 * 1024;
+
+  explicit Arena(std::size_t block_size = default_block_size);
+
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+
+  // A copy of s that lives as long as the arena.
+  std::string_view copy(std::string_view s);
+  // Give back the end of the last allocation, p of n bytes, past its first
+  // used bytes. Does nothing if p was not the last allocation.
+  void shrink(void *p, std::size_t n, std::size_t used);
+
+  // Free everything at once, keeping the first block for reuse.
+  void release();
+  // Bytes handed out since the last release().
+  std::size_t used() const { return used_; }
+
+protected:
+  void *do_allocate(std::size_t n, std::size_t align) override;
+  void do_deallocate(void *, std::size_t, std::size_t) override {}
+  bool do_is_equal(const std::pmr::memory_resource &other) const
+      noexcept override {
+    return this == &other;
+  }
+
+  std::size_t block_size_;
+  std::vector<std::unique_ptr<char[]>> blocks_;
+  std::size_t first_size_; // of blocks_.front(), kept by release()
+  char *free_;             // the unused part of the last block
+  std::size_t left_;       // bytes at free_
+  std::size_t used_;
+};
+
+} // namespace c_lexer
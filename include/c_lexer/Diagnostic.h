@@ -0,0 +1,52 @@
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace c_lexer {
+
+// An error that a Lexer scanning with RECOVER found, kept for the caller in
+// place of a message on std::cerr.
+struct Diagnostic {
+  enum Kind : std::uint8_t {
+    INVALID_CHARACTER,    // a run of characters that begin no token
+    UNTERMINATED_COMMENT, // a block comment open at end of input
+    UNTERMINATED_LITERAL, // a string, character constant or header name
+    EMPTY_CHARACTER,      // ''
+    BAD_ESCAPE,           // an escape sequence in a literal
+    BAD_NUMBER,           // missing digits, prefix digits or exponent
+    BAD_SUFFIX,           // of an integer or floating constant
+  };
+
+  Kind kind;
+  std::uint32_t row; // 0 with Lexer::LAZY_POSITIONS
+  std::uint32_t col;
+  std::size_t offset;  // of the token, comment or characters concerned
+  const char *message; // static, without a newline
+};
+
+// The name of kind, such as "BAD_ESCAPE".
+const char *diagnostic_kind_name(Diagnostic::Kind kind);
+
+} // namespace c_lexer
@@ -0,0 +1,79 @@
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#pragma once
+
+#include <c_lexer/Token.h>
+#include <c_lexer/TokenCache.h>
+#include <c_lexer/TokenStream.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace c_lexer {
+
+// The outcome of lexing one of the files given to lex_files().
+struct FileTokens {
+  std::size_t index;         // position of the file in paths
+  const std::string &path;   // paths[index]
+  bool ok;                   // false when the file could not be read
+  const TokenStream &tokens; // empty unless ok
+};
+
+// Called once per file, on the worker thread that lexed it. Calls for
+// different files run concurrently and in no particular order. tokens, and
+// the source text that it refers to, are only valid during the call.
+using FileCallback = std::function<void(const FileTokens &)>;
+
+// Lex each of paths with its own Lexer, on a work-stealing pool of n_threads
+// workers (0 means one per hardware thread). The calling thread keeps many
+// reads in flight, with io_uring where the kernel allows it and otherwise on
+// a pool of pread() threads, and hands each file to a worker as soon as it
+// has been read. Each worker reuses one TokenStream for all of the files that
+// it lexes. Returns the number of files that could not be read. Given a
+// cache, files whose contents were lexed before are loaded from it instead,
+// and the rest are stored in it.
+std::size_t lex_files(const std::vector<std::string> &paths,
+                      unsigned n_threads, const FileCallback &callback,
+                      std::uint32_t flags = 0, TokenCache *cache = nullptr);
+
+struct TokenCounts {
+  std::array<std::uint64_t, num_tokens> counts{}; // indexed by Token
+  std::size_t files = 0;  // files lexed
+  std::size_t failed = 0; // files that could not be read
+
+  std::uint64_t operator[](Token t) const {
+    return counts[static_cast<std::underlying_type_t<Token>>(t)];
+  }
+};
+
+// Lex paths as with lex_files(), and total the tokens of each kind across all
+// of the files. Token::END is counted once per file.
+TokenCounts count_tokens(const std::vector<std::string> &paths,
+                         unsigned n_threads, std::uint32_t flags = 0,
+                         TokenCache *cache = nullptr);
+
+} // namespace c_lexer
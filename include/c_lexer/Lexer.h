@@ -21,26 +21,60 @@
 // SOFTWARE.
 #pragma once
 
+#include <c_lexer/Diagnostic.h>
+#include <c_lexer/LexerStats.h>
+#include <c_lexer/NewlineIndex.h>
+#include <c_lexer/NumericValue.h>
+#include <c_lexer/SourceReader.h>
+#include <c_lexer/StringValue.h>
+#include <c_lexer/SymbolTable.h>
 #include <c_lexer/Token.h>
 
+#include <algorithm>
+#include <array>
 #include <iostream>
 #include <memory>
-#include <queue>
 #include <string>
+#include <string_view>
 #include <type_traits>
 #include <utility>
 #include <vector>
 
 namespace c_lexer {
 
+namespace simd {
+struct Kernels;
+} // namespace simd
+
+class TokenStream;
+
 class Lexeme {
 public:
+  // What a Lexeme's literal payload holds.
+  enum Value : std::uint8_t {
+    NO_VALUE,
+    NUMBER, // number_, with Lexer::DECODE_NUMBERS
+    STRING, // string_, with Lexer::DECODE_STRINGS
+  };
+
+  Lexeme()
+      : token_(Token::END), value_(NO_VALUE), row_(0), col_(0),
+        symbol_(no_symbol), offset_(0) {}
   Lexeme(std::string &&lexeme, Token token, std::uint32_t row,
-         std::uint32_t col)
-      : lexeme_(std::move(lexeme)), token_(token), row_(row), col_(col) {}
+         std::uint32_t col, std::size_t offset = 0)
+      : lexeme_(std::move(lexeme)), token_(token), value_(NO_VALUE), row_(row),
+        col_(col), symbol_(no_symbol), offset_(offset) {}
+
+  // A Lexeme whose text refers into the source buffer, or an Arena, rather
+  // than owning a copy of it. The buffer must outlive the Lexeme.
+  static Lexeme borrow(std::string_view text, Token token, std::uint32_t row,
+                       std::uint32_t col, std::size_t offset = 0) {
+    return Lexeme(borrowed_tag(), text, token, row, col, offset);
+  }
 
   Lexeme(const Lexeme &) = default;
   Lexeme(Lexeme &&) noexcept = default;
+  Lexeme &operator=(const Lexeme &) = default;
   Lexeme &operator=(Lexeme &&) noexcept = default;
   ~Lexeme() = default;
 
@@ -50,41 +84,295 @@ public:
     return ttos[static_cast<std::underlying_type_t<Token>>(token_)];
   }
 
-  std::string lexeme_;
+  // The spelling of the token, whether owned or borrowed.
+  std::string_view text() const {
+    return view_.data() ? view_ : std::string_view(lexeme_);
+  }
+  std::string str() const { return std::string(text()); }
+  bool borrowed() const { return view_.data() != nullptr; }
+
+  // The decoded value of an INTEGER_LIT or FLOAT_LIT, or one that is NONE.
+  const NumericValue &number() const {
+    static const NumericValue none;
+    return value_ == NUMBER ? number_ : none;
+  }
+  void set_number(const NumericValue &number) {
+    number_ = number;
+    value_ = NUMBER;
+  }
+  // The decoded payload of a STRING_LIT or character constant, or one that
+  // is NONE.
+  const StringValue &string() const {
+    static const StringValue none;
+    return value_ == STRING ? string_ : none;
+  }
+  void set_string(const StringValue &string) {
+    string_ = string;
+    value_ = STRING;
+  }
+
+  std::string lexeme_; // empty when borrowed()
+  std::string_view view_;
   Token token_;
-  std::uint32_t row_;
+  Value value_; // which member of the payload is set
+  std::uint32_t row_; // 0 with Lexer::LAZY_POSITIONS
   std::uint32_t col_;
-};
+  std::uint32_t symbol_; // id of an IDENTIFIER's name, or no_symbol
+  std::size_t offset_; // byte offset of the token in the source
+  // The payload of a literal, read through number() or string(). A token is
+  // never both a number and a string, so a Lexeme carries one decoded value
+  // at most, and no more bytes for it than the larger of the two.
+  union {
+    NumericValue number_;
+    StringValue string_;
+  };
 
-class SourceReader {
-public:
-  explicit SourceReader(std::istream &input) : input_(input) {}
-
-  char peek() { return input_.peek(); }
-  char get() { return input_.get(); }
-  void unget(char c) { input_.putback(c); }
-  bool eof() const { return input_.eof(); }
+private:
+  struct borrowed_tag {};
 
-protected:
-  std::istream &input_;
+  Lexeme(borrowed_tag, std::string_view view, Token token, std::uint32_t row,
+         std::uint32_t col, std::size_t offset)
+      : view_(view), token_(token), value_(NO_VALUE), row_(row), col_(col),
+        symbol_(no_symbol), offset_(offset) {}
 };
 
 class Lexer {
 public:
-  explicit Lexer(std::unique_ptr<SourceReader> &&sr);
+  enum Flags : std::uint32_t {
+    // When the SourceReader is contiguous(), produce Lexeme's that borrow
+    // their text from the source buffer instead of copying it.
+    ZERO_COPY = 1u << 0,
+    // Recognize keywords by scanning each identifier whole and looking it up
+    // in the table generated by scripts/keywords.py, instead of with the
+    // character-level DFA. Always set when the library was configured with
+    // MYPROJ_TABLE_KEYWORDS.
+    TABLE_KEYWORDS = 1u << 1,
+    // Return each comment as a Token::COMMENT, whose text is the whole
+    // comment including its delimiters. Otherwise comments are skipped as
+    // whitespace.
+    KEEP_COMMENTS = 1u << 2,
+    // The source is the beginning of a longer input, as for a reader that
+    // will be restarted once more input arrives. A block comment that is
+    // still open at its end is not diagnosed; with KEEP_COMMENTS it is
+    // returned as a Token::INVALID that begins with "/*".
+    OPEN_ENDED = 1u << 3,
+    // Decode the value of each INTEGER_LIT and FLOAT_LIT into its Lexeme's
+    // number_ as it is scanned, so that it is converted exactly once.
+    DECODE_NUMBERS = 1u << 4,
+    // Decode the payload of each STRING_LIT and character constant into its
+    // Lexeme's string_, in the Lexer's arena.
+    DECODE_STRINGS = 1u << 5,
+    // Follow only byte offsets while scanning: row_ and col_ of each Lexeme
+    // are left 0, no state counts columns, and whitespace is skipped a run
+    // at a time. position_of() finds the position of an offset when it is
+    // wanted, as print_error() does. Only for a contiguous SourceReader;
+    // ignored for one that refills.
+    LAZY_POSITIONS = 1u << 6,
+    // Scan C89 rather than C23, so that the words that later standards made
+    // keywords, such as inline, bool and _Bool, are identifiers.
+    C89 = 1u << 7,
+    // Also recognize the GNU keywords, such as asm and __attribute__, and
+    // the double-underscore spellings of standard ones, such as __inline__.
+    // With C89, inline and typeof are keywords as well, as for gnu89.
+    GNU = 1u << 8,
+    // Recover from damaged or binary input with bounded work: keep each
+    // error in diagnostics() rather than printing it on std::cerr, skip each
+    // run of stray characters at once, and make the rest of a literal with
+    // a bad escape, or of a malformed number, part of its Token::INVALID, so
+    // that scanning resumes at the next newline or delimiter.
+    RECOVER = 1u << 9,
+  };
+
+  // Where the scanner is with respect to preprocessing directives, which
+  // decides how '#', '<', '"' and newlines are scanned. A '#' that is the
+  // first token of a line begins a directive, which ends with a
+  // Token::NEWLINE at the end of its line.
+  enum LineState : std::uint8_t {
+    LINE_START,     // nothing but whitespace so far on this line
+    MID_LINE,       // past the first token of a line outside a directive
+    DIRECTIVE_NAME, // after the '#' that begins a directive
+    HEADER_NEXT,    // after #include, #include_next, #import or #embed
+    DIRECTIVE,      // in the rest of a directive
+  };
+
+  // row, col and line describe the first character of sr, for a reader over
+  // part of a larger source.
+  explicit Lexer(std::unique_ptr<SourceReader> &&sr, std::uint32_t flags = 0,
+                 std::uint32_t row = 1, std::uint32_t col = 1,
+                 LineState line = LINE_START);
   ~Lexer() = default;
 
+  // The most upcoming tokens that can be held at once. Must be a power of 2.
+  static constexpr std::size_t lookahead_capacity = 8;
+  static_assert((lookahead_capacity & (lookahead_capacity - 1)) == 0,
+                "lookahead_capacity must be a power of 2");
+
+  // How whitespace advances the row and column.
+  static constexpr std::uint32_t cols_per_htab = 1;
+  static constexpr std::uint32_t rows_per_vtab = 1;
+  static constexpr std::uint32_t rows_per_formfeed = 1;
+
+  // The scanner decides a token after looking at most this many characters
+  // past its end. A token that ends further than this before a change to the
+  // source is unaffected by it.
+  static constexpr std::size_t max_overscan = 4;
+
+  std::uint32_t flags() const { return flags_; }
+
+  // Intern the name of each IDENTIFIER not yet eaten into symbols,
+  // which must outlive the Lexer, and set its Lexeme's symbol_. Null stops.
+  void set_symbols(SymbolTable *symbols);
+  SymbolTable *symbols() const { return symbols_; }
+
+  // Put the text of each Lexeme that is not borrowed from the source, and
+  // the payloads of DECODE_STRINGS, in arena, so that the Lexemes own no
+  // memory. arena must outlive the Lexemes that refer into it. Without one,
+  // payloads go in an arena of the Lexer's own, which lives as long as the
+  // Lexer.
+  void set_arena(Arena *arena);
+  Arena *arena() const { return arena_; }
+
+  // What the Lexer has counted so far, when the library keeps LexerStats.
+  // The counters are only written by the thread that scans, so read them
+  // from that thread or once it is done.
+  const LexerStats &stats() const;
+  void reset_stats();
+
+  // The errors found so far with RECOVER, in source order. Like stats(),
+  // only written by the thread that scans.
+  const std::vector<Diagnostic> &diagnostics() const { return diagnostics_; }
+  void clear_diagnostics() { diagnostics_.clear(); }
+
+  // The line state after the last token scanned into the lookahead.
+  LineState line_state() const { return line_; }
+  bool in_directive() const { return line_ >= DIRECTIVE_NAME; }
+
+  // The line state after a token that was scanned in line. Comments and END
+  // leave it unchanged.
+  static LineState next_line_state(LineState line, Token token,
+                                   std::string_view text);
+
   const Lexeme &peek() const;
+  // The k'th upcoming token, where peek(0) is the same as peek(). Tokens are
+  // scanned as needed. Once END has been scanned, peeking past it yields END.
+  // A k of lookahead_capacity or more peeks at lookahead_capacity - 1.
+  const Lexeme &peek(std::size_t k);
   Lexeme eat();
-  void preload(std::size_t);
+  // Scan up to n more tokens into the lookahead, bounded by
+  // lookahead_capacity.
+  void preload(std::size_t n);
+
+  // Eat up to max tokens into out, as that many calls of eat() would, and
+  // return how many were eaten. The batch stops after END. Tokens beyond the
+  // lookahead are scanned straight into out.
+  std::size_t next_batch(Lexeme *out, std::size_t max);
+  // next_batch() for just the kind of each token.
+  std::size_t next_batch(Token *out, std::size_t max);
+  // Eat up to n tokens onto the end of ts, whose source must be the buffer
+  // of this Lexer's contiguous reader, and return how many were eaten. The
+  // batch stops after END. Rows and columns are left to ts, as scan_tokens()
+  // leaves them. For any other ts, none are eaten and an error is printed.
+  std::size_t fill(TokenStream &ts, std::size_t n);
+
+  // The row and column of the byte at offset of a contiguous reader's
+  // source, counted as Lexeme::offset_ is, from a NewlineIndex built on
+  // first use. {0, 0} for a reader that refills.
+  SourcePosition position_of(std::size_t offset) const;
 
   template <typename S, typename... Args>
   S &print_error(S &os, Args &&...args) {
-    return printer(os, "c_lexer[", row_, ',', col_, "]: ", args...);
+    const SourcePosition pos = error_position();
+    return printer(os, "c_lexer[", pos.row, ',', pos.col, "]: ", args...);
   }
 
 protected:
-  Lexeme scan_token();
+  // As the public constructor, but running kernels rather than the fastest
+  // ones for this CPU, so that a test can pit one set against another.
+  Lexer(const simd::Kernels *kernels, std::unique_ptr<SourceReader> &&sr,
+        std::uint32_t flags = 0, std::uint32_t row = 1, std::uint32_t col = 1,
+        LineState line = LINE_START);
+
+  Lexeme scan_token() { return (this->*scan_)(); }
+  // scan_token() for the keywords of a dialect policy from Keywords.inc,
+  // which decides them at compile time. Without Positions, for
+  // LAZY_POSITIONS, the states follow no row or column.
+  template <typename Dialect, bool Positions> Lexeme scan_dialect();
+  // Consume a comment whose opening '/' has been read and whose '/' or '*' is
+  // next, advancing row_ and col_ over all of it. The rest of its text is
+  // appended to lex unless lex is null. A line comment stops before its
+  // newline. Returns false for a block comment still open at end of input.
+  bool scan_comment(std::string *lex);
+  Lexeme make_lexeme(const std::string &lex, std::size_t start,
+                     Token token, std::uint32_t col);
+  // A Lexeme with a copy of text, in arena_ if there is one.
+  Lexeme copy_lexeme(std::string_view text, Token token, std::uint32_t col,
+                     std::size_t start);
+
+  Lexeme &lookahead(std::size_t k) {
+    return lookahead_[(head_ + k) & (lookahead_capacity - 1)];
+  }
+  const Lexeme &lookahead(std::size_t k) const {
+    return lookahead_[(head_ + k) & (lookahead_capacity - 1)];
+  }
+  bool lookahead_ended() const {
+    return lookahead(count_ - 1).token() == Token::END;
+  }
+  // The next token from the scanner, positioned and decoded as the flags
+  // ask.
+  Lexeme next_lexeme() {
+    Lexeme l = scan_token();
+    if (flags_ & LAZY_POSITIONS) {
+      l.row_ = l.col_ = 0;
+      switch (l.token()) {
+      case Token::INTEGER_LIT:
+      case Token::STRING_LIT:
+      case Token::HEADER_NAME:
+      case Token::INVALID:
+        note_literal_breaks(l);
+        break;
+      default:
+        break;
+      }
+    }
+    if (symbols_ || (flags_ & (DECODE_NUMBERS | DECODE_STRINGS)))
+      decode(l);
+    if (line_ != MID_LINE)
+      line_ = next_line_state(line_, l.token(), l.text());
+    return l;
+  }
+  void push_lookahead() {
+    lookahead(count_) = next_lexeme();
+    lookahead_lines_[(head_ + count_) & (lookahead_capacity - 1)] = line_;
+    ++count_;
+  }
+  // Move the front of the lookahead into l, leaving the lookahead empty
+  // when it was the last one held.
+  void pop_lookahead(Lexeme &l) {
+    l = std::move(lookahead(0));
+    head_ = (head_ + 1) & (lookahead_capacity - 1);
+    --count_;
+  }
+  // Intern or decode the value of l, as asked for.
+  void decode(Lexeme &l);
+  // Keep the offset of each raw '\v', '\f' and '\r' within the literal l,
+  // where they take a column rather than end a line, for position_of().
+  void note_literal_breaks(const Lexeme &l);
+  Arena &payload_arena() {
+    if (arena_)
+      return *arena_;
+    if (!own_arena_)
+      own_arena_ = std::make_unique<Arena>();
+    return *own_arena_;
+  }
+  // Where scanning is, for a diagnostic.
+  SourcePosition error_position() const;
+  // Keep a Diagnostic of an error at offset, row and col, for RECOVER.
+  void add_diagnostic(Diagnostic::Kind kind, const char *message,
+                      std::size_t offset, std::uint32_t row,
+                      std::uint32_t col);
+  // Bring row_ and col_ up to date with the splices that sr_ has stepped
+  // over, the last of them pending characters ago.
+  void sync_splices(std::size_t pending);
 
   template <typename S, typename T0, typename... Ts>
   S &printer(S &os, T0 &&t0, Ts &&...ts) {
@@ -97,11 +385,94 @@ protected:
   }
 
   std::unique_ptr<SourceReader> sr_;
-  std::uint32_t row_;
+  std::uint32_t flags_;
+  Lexeme (Lexer::*scan_)(); // scan_dialect() for the dialect of flags_
+  const simd::Kernels *simd_; // run kernels for this CPU
+  bool keep_lex_;   // accumulate each token's text as it is read
+  std::string lex_; // scratch buffer for the text of the current token
+  std::uint32_t row_; // not followed with LAZY_POSITIONS
   std::uint32_t col_;
-  std::queue<Lexeme> lookahead_;
+  std::uint32_t first_row_; // of the first byte of sr_
+  std::uint32_t first_col_;
+  mutable std::unique_ptr<NewlineIndex> lines_; // for position_of()
+  mutable std::vector<std::size_t> literal_breaks_; // not yet in lines_
+  std::uint32_t splices_; // sr_->splices() as of row_ and col_
+  LineState line_;
+  SymbolTable *symbols_; // null unless interning
+  Arena *arena_;         // null unless set_arena()
+  std::unique_ptr<Arena> own_arena_; // for payloads without arena_
+  std::unique_ptr<LexerStats> stats_; // null unless the library keeps them
+  std::vector<Diagnostic> diagnostics_; // with RECOVER
+  std::array<Lexeme, lookahead_capacity> lookahead_; // ring of upcoming tokens
+  std::array<LineState, lookahead_capacity> lookahead_lines_; // after each
+  std::size_t head_;  // index of the front of lookahead_
+  std::size_t count_; // tokens held in lookahead_, >= 1 between calls
 };
 
+// Whether a token scanned with KEEP_COMMENTS is a comment, including one that
+// is still open at the end of input.
+inline bool is_comment(Token token, std::string_view text) {
+  return token == Token::COMMENT ||
+         (token == Token::INVALID && text.substr(0, 2) == "/*");
+}
+
+// The end of the source range that the scanner may have examined in deciding
+// a token that ends at end of s: max_overscan characters past it, with any
+// splices among them, where the end of s counts as one more position.
+inline std::size_t overscan_end(std::string_view s, std::size_t end) {
+  const char *p = s.data() + end;
+  const char *const stop = s.data() + s.size();
+  const char *seen = p;
+
+  for (std::size_t n = 0; n < Lexer::max_overscan; ++n) {
+    while (p < stop && *p == '\\') {
+      seen = std::max(seen, std::min(p + 3, stop));
+      const std::size_t len = splice_length(p, stop);
+      if (!len)
+        break;
+      p += len;
+    }
+    if (p == stop)
+      return s.size() + 1;
+    seen = std::max(seen, ++p);
+  }
+
+  return static_cast<std::size_t>(seen - s.data());
+}
+
+// The length of the source range, from the start of the reader's source,
+// that a ZERO_COPY Lexer scanned l from. Only a token that was spliced
+// across lines has text that differs from that range.
+inline std::size_t source_length(const Lexeme &l, std::string_view source) {
+  if (l.text().data() == source.data() + l.offset_)
+    return l.text().size();
+
+  const char *const start = source.data() + l.offset_;
+  const char *const stop = source.data() + source.size();
+  const char *p = start;
+  for (std::size_t n = l.text().size(); n; --n) {
+    while (std::size_t len = splice_length(p, stop))
+      p += len;
+    ++p;
+  }
+
+  return static_cast<std::size_t>(p - start);
+}
+
+// How many tokens to reserve room for before scanning bytes of source.
+// Measured C sources run from about 4.5 bytes a token, in dense code, to
+// about 10, in heavily commented code. A token every 8 bytes leaves dense
+// code to grow its vector once or twice, which costs less than reserving
+// twice the room that sparse code needs, and never sizes a vector of large
+// Lexemes for more tokens than the source holds.
+inline std::size_t reserve_for_tokens(std::size_t bytes) {
+  return bytes / 8 + 1;
+}
+
 std::vector<Lexeme> scan_tokens(const char *s);
+// With an arena, copied text and DECODE_STRINGS payloads go in it, as for
+// Lexer::set_arena(). Without one, DECODE_STRINGS is ignored.
+std::vector<Lexeme> scan_tokens(std::string_view s, std::uint32_t flags = 0,
+                                Arena *arena = nullptr);
 
 } // namespace c_lexer
@@ -0,0 +1,64 @@
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#pragma once
+
+#include <c_lexer/Token.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace c_lexer {
+
+// Counters kept by a Lexer as it scans, for finding out which part of the
+// scanner a source spends its time in. They are only kept when the library
+// is configured with MYPROJ_LEXER_STATS; otherwise the scanner carries no
+// instrumentation at all, and every counter stays zero.
+struct LexerStats {
+  // One more than the largest of the scanner's state numbers.
+  static constexpr std::size_t num_states = 1001;
+
+  // The number of times that scan_token() dispatched on each state, which
+  // is about once per character except where a run kernel consumes many at
+  // once. Indexed by state number; see lexer_state_name().
+  std::array<std::uint64_t, num_states> states{};
+  // Characters read past the end of a token and put back.
+  std::uint64_t backups = 0;
+  // Tokens of each kind, and the bytes of source that they span, splices
+  // included. Indexed by Token.
+  std::array<std::uint64_t, num_tokens> tokens{};
+  std::array<std::uint64_t, num_tokens> bytes{};
+  // Bytes of whitespace and skipped comments, and the time taken by them.
+  std::uint64_t whitespace_bytes = 0;
+  std::uint64_t whitespace_ns = 0;
+
+  LexerStats &operator+=(const LexerStats &other);
+};
+
+// Whether the library keeps LexerStats.
+bool lexer_stats_enabled();
+
+// The name of a state of scan_token(), such as "GOT_GT", or null when state
+// is not one.
+const char *lexer_state_name(std::uint32_t state);
+
+} // namespace c_lexer
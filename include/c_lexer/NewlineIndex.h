@@ -0,0 +1,65 @@
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace c_lexer {
+
+struct SourcePosition {
+  std::uint32_t row;
+  std::uint32_t col;
+};
+
+// The offsets at which the lines of a source begin, found with one vector
+// scan, so that the row and column of any offset is a binary search away.
+// '\n', '\v' and '\f' each end a line and '\r' takes no column, as between
+// tokens in the Lexer. Within a literal the Lexer counts a raw '\v', '\f' or
+// '\r' as one column, which within_token() tells the index of. The source
+// must outlive the index.
+class NewlineIndex {
+public:
+  // row and col are those of the first byte of source.
+  explicit NewlineIndex(std::string_view source, std::uint32_t row = 1,
+                        std::uint32_t col = 1);
+
+  SourcePosition position_of(std::size_t offset) const;
+  // Count the '\v', '\f' or '\r' at offset as one column, as it is within a
+  // token, rather than as a line break or as no column. Offsets are given in
+  // increasing order.
+  void within_token(std::size_t offset);
+
+  // The number of lines, which is one more than the number of line breaks.
+  std::size_t lines() const { return starts_.size() + 1; }
+
+protected:
+  std::string_view source_;
+  std::uint32_t row_;
+  std::uint32_t col_;
+  std::vector<std::size_t> starts_; // of each line but the first
+  std::vector<std::size_t> returns_; // of each '\r' that takes a column
+};
+
+} // namespace c_lexer
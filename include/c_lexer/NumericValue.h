@@ -0,0 +1,64 @@
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+namespace c_lexer {
+
+// The value of an INTEGER_LIT or FLOAT_LIT, as decoded from its spelling.
+struct NumericValue {
+  enum Kind : std::uint8_t {
+    NONE,     // not decoded, as for a character constant
+    INTEGER,  // in integer
+    FLOATING, // in floating
+  };
+
+  enum Suffix : std::uint8_t {
+    SUFFIX_U = 1u << 0,  // u U
+    SUFFIX_L = 1u << 1,  // l L, and long double for a FLOATING
+    SUFFIX_LL = 1u << 2, // ll LL
+    SUFFIX_WB = 1u << 3, // wb WB (C23 _BitInt)
+    SUFFIX_F = 1u << 4,  // f F
+    SUFFIX_D = 1u << 5,  // df dd dl DF DD DL (C23 decimal floating)
+  };
+
+  Kind kind = NONE;
+  std::uint8_t radix = 10; // 2, 8, 10 or 16
+  std::uint8_t suffix = 0; // Suffix flags
+  // False when the value does not fit its type here (std::uint64_t or
+  // double), or a digit is out of range for the radix, as the 9 of 09.
+  bool ok = true;
+  union {
+    std::uint64_t integer;
+    double floating; // the nearest double, for long double and decimal too
+  };
+
+  NumericValue() : integer(0) {}
+};
+
+// Decode the spelling of an INTEGER_LIT or FLOAT_LIT, without any splices.
+// A character constant is left NONE. Returns value.ok.
+bool decode_number(std::string_view spelling, NumericValue &value);
+
+} // namespace c_lexer
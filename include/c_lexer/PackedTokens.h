@@ -0,0 +1,145 @@
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#pragma once
+
+#include <c_lexer/Lexer.h>
+#include <c_lexer/Token.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace c_lexer {
+
+// One token in 16 bytes, with nothing to construct or destroy, so that
+// arrays of them grow by memcpy. The text is the range [offset, offset +
+// length) of the source. The row is kept as the number of rows since the
+// previous token, which is almost always small.
+struct PackedToken {
+  // line_delta of a token that is this many or more rows after the previous
+  // one; PackedTokens records the exact delta on the side.
+  static constexpr std::uint16_t long_delta = 0xffff;
+
+  std::uint32_t offset;
+  std::uint32_t length;
+  std::uint32_t col;
+  std::uint16_t line_delta;
+  std::uint8_t kind; // a Token
+  std::uint8_t reserved;
+
+  Token token() const { return static_cast<Token>(kind); }
+};
+
+static_assert(sizeof(PackedToken) == 16, "PackedToken must stay 16 bytes");
+static_assert(std::is_trivially_copyable_v<PackedToken>,
+              "PackedToken must be trivially copyable");
+
+// The tokens of one source buffer as an array of PackedToken's, which must
+// not outlive the source. row(i) adds up line deltas from the nearest of
+// the rows recorded every rows_every tokens. Iterating yields each token as
+// a Lexeme that borrows its text, for code written against Lexeme's.
+class PackedTokens {
+public:
+  static constexpr std::size_t rows_every = 64;
+
+  PackedTokens() = default;
+
+  void reset(std::string_view source);
+  void reserve(std::size_t n);
+  void push_back(Token token, std::uint32_t offset, std::uint32_t length,
+                 std::uint32_t row, std::uint32_t col);
+
+  std::size_t size() const { return tokens_.size(); }
+  bool empty() const { return tokens_.empty(); }
+  std::string_view source() const { return source_; }
+  const PackedToken &operator[](std::size_t i) const { return tokens_[i]; }
+  const PackedToken *data() const { return tokens_.data(); }
+
+  Token token(std::size_t i) const { return tokens_[i].token(); }
+  std::string_view text(std::size_t i) const {
+    return source_.substr(tokens_[i].offset, tokens_[i].length);
+  }
+  std::uint32_t row(std::size_t i) const;
+  std::uint32_t col(std::size_t i) const { return tokens_[i].col; }
+  // The rows from token i - 1 to token i.
+  std::uint32_t line_delta(std::size_t i) const;
+
+  // Token i as scanned, but for its payloads: borrowed from the source, or
+  // without its splices.
+  Lexeme lexeme(std::size_t i) const { return lexeme(i, row(i)); }
+
+  class const_iterator {
+  public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = Lexeme;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = Lexeme;
+
+    const_iterator(const PackedTokens *tokens, std::size_t i)
+        : tokens_(tokens), i_(i),
+          row_(i < tokens->size() ? tokens->row(i) : 0) {}
+
+    Lexeme operator*() const { return tokens_->lexeme(i_, row_); }
+    const_iterator &operator++() {
+      if (++i_ < tokens_->size())
+        row_ += tokens_->line_delta(i_);
+      return *this;
+    }
+    bool operator==(const const_iterator &other) const {
+      return i_ == other.i_;
+    }
+    bool operator!=(const const_iterator &other) const {
+      return i_ != other.i_;
+    }
+
+  private:
+    const PackedTokens *tokens_;
+    std::size_t i_;
+    std::uint32_t row_;
+  };
+
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator end() const { return const_iterator(this, size()); }
+
+protected:
+  Lexeme lexeme(std::size_t i, std::uint32_t row) const;
+
+  std::string_view source_;
+  std::vector<PackedToken> tokens_;
+  std::vector<std::uint32_t> rows_; // of tokens 0, rows_every, ...
+  std::uint32_t last_row_ = 0;      // of the last token
+  // (index, delta) for each token whose line_delta is long_delta.
+  std::vector<std::pair<std::uint32_t, std::uint32_t>> long_deltas_;
+};
+
+// Scan all of s into tokens, replacing its contents, as scan_tokens() into a
+// TokenStream does. Returns the number of tokens, including END, or 0 when s
+// is too large for 32-bit offsets.
+std::size_t scan_tokens(std::string_view s, PackedTokens &tokens,
+                        std::uint32_t flags = 0);
+
+} // namespace c_lexer
@@ -0,0 +1,91 @@
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace c_lexer {
+
+// Hardware counters of the calling thread, in user space only, read with
+// perf_event_open() on Linux. Each event that the kernel, CPU or sandbox
+// refuses is left out, and counts zero; elsewhere than Linux they all are.
+// The events are opened as one group led by CYCLES, which the kernel counts
+// over the same intervals, so that ratios such as instructions per cycle hold
+// even when it takes turns with the CPU's counters. An event that the group
+// refuses, or every event when CYCLES is refused, is counted on its own
+// instead. Each count is scaled up from the time that it was running.
+class PerfCounters {
+public:
+  enum Event : std::uint8_t {
+    CYCLES,
+    INSTRUCTIONS,
+    BRANCHES,
+    BRANCH_MISSES,
+    L1I_MISSES, // reads that miss the level 1 instruction cache
+    num_events,
+  };
+
+  PerfCounters();
+  ~PerfCounters();
+  PerfCounters(const PerfCounters &) = delete;
+  PerfCounters &operator=(const PerfCounters &) = delete;
+
+  bool has(Event event) const { return fds_[event] >= 0; }
+  // Whether event is counted in the group led by CYCLES.
+  bool grouped(Event event) const { return grouped_[event]; }
+  // Whether any event is counted.
+  bool available() const;
+
+  // Zero the counts and begin counting.
+  void start();
+  // Stop counting, and read the counts since start().
+  void stop();
+  std::uint64_t count(Event event) const { return counts_[event]; }
+
+  // The name of event, such as "cycles".
+  static const char *event_name(Event event);
+
+private:
+  std::array<int, num_events> fds_;
+  std::array<bool, num_events> grouped_{};
+  // The grouped events, in the order that a read of the group returns them.
+  std::array<Event, num_events> group_order_{};
+  std::size_t group_size_ = 0;
+  std::array<std::uint64_t, num_events> counts_{};
+};
+
+// The 50th, 99th and 99.9th percentiles of a set of samples, such as the
+// nanoseconds taken by each of a run of calls.
+struct Percentiles {
+  std::uint64_t p50 = 0;
+  std::uint64_t p99 = 0;
+  std::uint64_t p999 = 0;
+};
+
+// The percentiles of samples, which are reordered. All 0 when there are
+// none.
+Percentiles percentiles(std::vector<std::uint64_t> &samples);
+
+} // namespace c_lexer
@@ -0,0 +1,109 @@
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <c_lexer/Lexer.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace c_lexer {
+
+// A Lexer whose scanning runs ahead on a thread of its own. The producer
+// thread eats tokens from a Lexer in batches, with Lexer::next_batch(), into
+// a fixed ring of batches; the consumer takes them from the ring with the
+// same peek() and eat() that Lexer has. When the ring is full the producer
+// waits for the consumer to free a batch, so that it runs at most the ring's
+// worth of tokens ahead.
+//
+// The ring is single-producer, single-consumer and lock-free: the producer
+// only writes head_ and the consumer only writes tail_, each on a cache line
+// of its own, so that the two threads share no line that both write. A
+// waiting side spins briefly and then yields.
+//
+// The reader and the Lexer belong to the producer thread until the
+// PipelinedLexer is destroyed. Lexemes that borrow their text, with
+// ZERO_COPY, or whose payloads are in the Lexer's arena, with
+// DECODE_STRINGS, are valid as long as the PipelinedLexer.
+class PipelinedLexer {
+public:
+  // The ring holds n_batches batches of batch_size tokens each. batch_size
+  // is at least lookahead_capacity, and n_batches at least 2.
+  explicit PipelinedLexer(std::unique_ptr<SourceReader> &&sr,
+                          std::uint32_t flags = 0,
+                          std::size_t batch_size = 256,
+                          std::size_t n_batches = 8);
+  // Stops the producer, should it still be scanning.
+  ~PipelinedLexer();
+
+  PipelinedLexer(const PipelinedLexer &) = delete;
+  PipelinedLexer &operator=(const PipelinedLexer &) = delete;
+
+  // The most upcoming tokens that can be peeked at, as for Lexer.
+  static constexpr std::size_t lookahead_capacity = Lexer::lookahead_capacity;
+
+  const Lexeme &peek() { return peek(0); }
+  // The k'th upcoming token, where k is less than lookahead_capacity. Once
+  // END has been reached, peeking past it yields END.
+  const Lexeme &peek(std::size_t k);
+  Lexeme eat();
+
+  std::size_t batch_size() const { return batch_size_; }
+  std::size_t n_batches() const { return batches_.size(); }
+
+protected:
+  // The ring's indices count batches from the start and are reduced modulo
+  // the ring's size when used.
+  static constexpr std::size_t cache_line = 64;
+
+  struct Batch {
+    std::vector<Lexeme> lexemes;
+    std::size_t size = 0; // how many of lexemes were scanned
+  };
+
+  Batch &batch(std::size_t i) { return batches_[i % batches_.size()]; }
+  // Wait for batch i to be published, and return it.
+  Batch &wait_for(std::size_t i);
+  void produce();
+
+  std::unique_ptr<Lexer> lexer_; // used only by the producer once started
+  std::size_t batch_size_;
+  std::vector<Batch> batches_;
+
+  // Batches published by the producer; written only by the producer.
+  alignas(cache_line) std::atomic<std::size_t> head_;
+  // Batches released by the consumer; written only by the consumer.
+  alignas(cache_line) std::atomic<std::size_t> tail_;
+  // Set by the destructor to stop a producer that is waiting for room.
+  alignas(cache_line) std::atomic<bool> stop_;
+
+  // The consumer's own state, after the shared indices.
+  alignas(cache_line) std::size_t pos_; // next token in batch(tail_)
+  std::thread producer_;
+};
+
+} // namespace c_lexer
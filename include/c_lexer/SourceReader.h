@@ -0,0 +1,191 @@
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace c_lexer {
+
+// SourceReader presents the lexer's input as a window of contiguous bytes
+// [cur_, end_). get(), peek() and unget() are pointer bumps within that
+// window; only when the window is exhausted does the reader call fill() to
+// obtain more input. A reader built over a caller-owned buffer never refills,
+// and a reader built over a std::istream refills in large blocks.
+//
+// The reader also performs line splicing: a backslash immediately followed by
+// a newline (or by "\r\n") is never returned by get() or peek(). The window
+// ends before each splice, so the kernels that scan [cur(), limit()) never
+// see one either, and fill() steps over it. offset() still counts the bytes
+// of the source, splices included.
+class SourceReader {
+public:
+  // Read the input from a stream. The stream must outlive the reader.
+  explicit SourceReader(std::istream &input);
+
+  // Read the input directly from size bytes at data. The buffer is not
+  // copied, and it must outlive the reader (and any borrowed Lexeme's).
+  SourceReader(const char *data, std::size_t size);
+  explicit SourceReader(std::string_view s)
+      : SourceReader(s.data(), s.size()) {}
+
+  SourceReader(const SourceReader &) = delete;
+  SourceReader &operator=(const SourceReader &) = delete;
+  virtual ~SourceReader() = default;
+
+  // The next character as an unsigned char, as getc() returns it, or EOF at
+  // the end of the input; a 0xff byte is not EOF.
+  int peek() {
+    return (cur_ < end_ || fill()) ? static_cast<unsigned char>(*cur_) : EOF;
+  }
+
+  int get() {
+    if (cur_ < end_ || fill())
+      return static_cast<unsigned char>(*cur_++);
+    eof_ = true;
+    return EOF;
+  }
+
+  // Only the most recently read character may be put back, even when a
+  // splice has been stepped over since.
+  void unget(int) {
+    if (cur_ == resume_)
+      restore_splice();
+    --cur_;
+    eof_ = false;
+  }
+
+  bool eof() const { return eof_; }
+
+  // Whether the entire input is a single buffer that never refills.
+  bool contiguous() const { return input_ == nullptr; }
+
+  // The number of characters consumed so far.
+  std::size_t offset() const { return base_ + (cur_ - begin_); }
+
+  // The start of a contiguous reader's buffer, so that data() + offset()
+  // addresses the next character to be read.
+  const char *data() const { return begin_; }
+  // All of a contiguous reader's buffer.
+  std::string_view buffer() const {
+    return std::string_view(begin_, static_cast<std::size_t>(stop_ - begin_));
+  }
+
+  // The unread part of the current window. A scanner may examine
+  // [cur(), limit()) directly and then consume a prefix of it with skip().
+  const char *cur() const { return cur_; }
+  const char *limit() const { return end_; }
+  void skip(std::size_t n) { cur_ += n; }
+
+  // The number of splices stepped over so far, and the offset() just past
+  // the last of them.
+  std::uint32_t splices() const { return splices_; }
+  std::size_t splice_end() const { return splice_end_; }
+
+protected:
+  SourceReader();
+
+  // Replenish [cur_, end_), stepping over a splice at end_ or reading the
+  // next block from input_. Returns false at end of input.
+  virtual bool fill();
+  bool read_block();
+  // Set end_ to the next splice at or after cur_, or to a search horizon.
+  void find_splice();
+  void restore_splice();
+
+  void set_buffer(const char *data, std::size_t size) {
+    begin_ = cur_ = data;
+    stop_ = data + size;
+    find_splice();
+  }
+
+  struct Splice {
+    std::size_t pos; // from begin_ of a stream reader's compacted block
+    std::size_t len; // of the spliced-out "\\\n" or "\\\r\n"
+  };
+
+  std::istream *input_;
+  std::unique_ptr<char[]> buf_;
+  std::size_t base_; // offset() of begin_
+  const char *begin_;
+  const char *cur_;
+  const char *end_;  // end of the window: stop_, a splice or a horizon
+  const char *stop_; // end of the characters in memory
+  std::size_t splice_len_; // of the splice at end_, or 0
+  // A stream reader removes splices from each block as it is read, and
+  // records them here; a contiguous reader finds them as it goes.
+  std::vector<Splice> block_splices_;
+  std::size_t next_splice_; // index into block_splices_
+  // Since the last character read: cur_ just past the splices stepped over,
+  // how many there were, the length of the first and of them all, and
+  // splice_end_ before them.
+  const char *resume_;
+  std::uint32_t resume_count_;
+  std::size_t resume_first_len_;
+  std::size_t resume_len_;
+  std::size_t resume_splice_end_;
+  std::uint32_t splices_;
+  std::size_t splice_end_;
+  bool eof_;
+};
+
+// The length of the splice at p, which is before end: 2 for "\\\n", 3 for
+// "\\\r\n" and 0 if there is none.
+inline std::size_t splice_length(const char *p, const char *end) {
+  if (*p != '\\' || end - p < 2)
+    return 0;
+  if (p[1] == '\n')
+    return 2;
+  return (end - p >= 3 && p[1] == '\r' && p[2] == '\n') ? 3 : 0;
+}
+
+// text without its splices.
+std::string unsplice(std::string_view text);
+
+// MappedSourceReader maps the named file into memory and reads it as a
+// single contiguous buffer. When the file cannot be mapped, is_open()
+// returns false and the reader behaves as an empty input.
+class MappedSourceReader : public SourceReader {
+public:
+  explicit MappedSourceReader(const char *path);
+  ~MappedSourceReader() override;
+
+  bool is_open() const { return is_open_; }
+  // The whole file. Unlike [data(), limit()), this runs past any splices.
+  std::string_view text() const {
+    return std::string_view(static_cast<const char *>(map_), map_size_);
+  }
+
+protected:
+  void *map_;
+  std::size_t map_size_;
+  bool is_open_;
+};
+
+} // namespace c_lexer
@@ -0,0 +1,82 @@
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <c_lexer/Lexer.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace c_lexer {
+
+// A push-style Lexer for source that arrives in pieces of any size, such as
+// reads from a socket. Each token is passed to the callback as soon as the
+// line that it ends on is complete, followed by Token::END from finish().
+// Lexeme offsets are from the start of the stream.
+//
+// No scanner state is kept between pieces, beyond the position and the line
+// state. Only a block comment or a splice spans a line break, so the bytes
+// after the last complete line, or from the start of a block comment still
+// open there, are held back and lexed again along with the piece that
+// completes them. So the memory used is bounded by the longest line or
+// comment rather than by the size of the source.
+//
+// With Lexer::ZERO_COPY, a Lexeme's text refers into a buffer that is only
+// valid during the callback.
+class StreamLexer {
+public:
+  using Callback = std::function<void(const Lexeme &)>;
+
+  explicit StreamLexer(Callback &&callback, std::uint32_t flags = 0);
+
+  // As for Lexer::set_symbols().
+  void set_symbols(SymbolTable *symbols) { symbols_ = symbols; }
+
+  void feed(const char *data, std::size_t n);
+  // Lex what remains, as though the source ended here, and then pass END.
+  void finish();
+
+protected:
+  // Lex s. When last, s ends the source and END is passed too. Otherwise
+  // s ends with a newline, and lexing stops early at a block comment that is
+  // still open. Returns the number of bytes of s that were lexed.
+  std::size_t lex(std::string_view s, bool last);
+  // Lex and drop the first n bytes of pending_, short of an open comment.
+  void lex_pending(std::size_t n);
+
+  Callback callback_;
+  std::uint32_t flags_;
+  std::string pending_; // the bytes held back
+  bool comment_;        // whether pending_ begins with an open block comment
+  std::size_t scan_;    // where in pending_ to look for the comment's end
+  std::size_t offset_;  // stream offset of pending_
+  std::uint32_t row_;   // position of pending_
+  std::uint32_t col_;
+  Lexer::LineState line_;
+  SymbolTable *symbols_; // null unless interning
+};
+
+} // namespace c_lexer
@@ -0,0 +1,79 @@
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#pragma once
+
+#include <c_lexer/Arena.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string_view>
+
+namespace c_lexer {
+
+// The decoded payload of a STRING_LIT or character constant: its code
+// units, with escapes and universal character names resolved and the source's
+// UTF-8 transcoded to the encoding of the literal's prefix. The units are
+// stored in an Arena in native byte order, without a terminator.
+struct StringValue {
+  enum Encoding : std::uint8_t {
+    NONE,  // not decoded
+    PLAIN, // no prefix: the execution character set, taken to be UTF-8
+    UTF8,  // u8
+    UTF16, // u
+    UTF32, // U
+    WIDE,  // L: wchar_t, as UTF-16 or UTF-32 by its size
+  };
+
+  Encoding encoding = NONE;
+  // False when an escape does not fit a code unit, a universal character
+  // name is not a code point, the source is not UTF-8, or there are 2^32
+  // units or more, of which size counts none.
+  bool ok = true;
+  std::uint32_t size = 0; // code units
+  const void *data = nullptr;
+
+  std::size_t unit_size() const {
+    switch (encoding) {
+    case UTF16:
+      return 2;
+    case UTF32:
+      return 4;
+    case WIDE:
+      return sizeof(wchar_t);
+    default:
+      return 1;
+    }
+  }
+
+  // The units as C, which must be unit_size() bytes.
+  template <typename C> std::basic_string_view<C> view() const {
+    return {static_cast<const C *>(data), size};
+  }
+};
+
+// Decode the spelling of a STRING_LIT or character constant, without any
+// splices, into arena. Anything else is left NONE. Returns value.ok.
+bool decode_string(std::string_view spelling, Arena &arena,
+                   StringValue &value);
+
+} // namespace c_lexer
@@ -0,0 +1,83 @@
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#pragma once
+
+#include <c_lexer/Arena.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+namespace c_lexer {
+
+// The symbol of a token that is not an IDENTIFIER, or of a Lexer that has no
+// SymbolTable.
+constexpr std::uint32_t no_symbol = 0xffffffffu;
+
+// Interns identifier names, handing out dense ids from 0 in the order that
+// names are first seen. Each name is hashed once, when it is interned; the
+// table keeps the hash, so growing the table never rehashes a string. Names
+// are copied into an Arena, the caller's or the table's own, so a name's
+// string_view lasts as long as that Arena.
+//
+// A shared table may be used by several threads at once, at the cost of a
+// lock per call. The ids it hands out then depend on which thread gets to a
+// name first.
+class SymbolTable {
+public:
+  // A shared table locks around its use of arena, which no one else may use
+  // concurrently.
+  explicit SymbolTable(bool shared = false, Arena *arena = nullptr);
+
+  SymbolTable(const SymbolTable &) = delete;
+  SymbolTable &operator=(const SymbolTable &) = delete;
+
+  // The id of name, adding it if it is new.
+  std::uint32_t intern(std::string_view name);
+  // The id of name, or no_symbol if it has not been interned.
+  std::uint32_t find(std::string_view name) const;
+  std::string_view name(std::uint32_t id) const;
+  std::size_t size() const;
+
+  static std::uint32_t hash(std::string_view name);
+
+protected:
+  std::unique_lock<std::mutex> lock() const {
+    return shared_ ? std::unique_lock<std::mutex>(mutex_)
+                   : std::unique_lock<std::mutex>();
+  }
+  // The slot that holds name, or the empty one where it would go.
+  std::size_t probe(std::string_view name, std::uint32_t h) const;
+  void grow();
+
+  const bool shared_;
+  mutable std::mutex mutex_;
+  std::vector<std::string_view> names_; // by id
+  std::vector<std::uint32_t> hashes_;   // by id
+  std::vector<std::uint32_t> slots_;    // open addressing; id + 1, or 0
+  Arena own_;
+  Arena &names_arena_; // holds names_
+};
+
+} // namespace c_lexer
@@ -21,12 +21,15 @@
 // SOFTWARE.
 
 #pragma once
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <type_traits>
 
 namespace c_lexer {
 
-enum class Token {
+// A byte, so that the tag of a Lexeme's payload packs beside it.
+enum class Token : std::uint8_t {
   PLUS,  // +
   MINUS, // -
   STAR,  // *
@@ -80,10 +83,14 @@ enum class Token {
   RSQUARE,  // ]
   SEMI,     // ;
 
+  HASH,      // #
+  HASH_HASH, // ##
+
   IDENTIFIER,
   INTEGER_LIT, // 123  0xbeef '\n'
   FLOAT_LIT,   // 3.14
   STRING_LIT,  // "abc"
+  HEADER_NAME, // <stdio.h> "local.h" (after #include)
 
   ALIGNAS,        // alignas (C23)
   ALIGNOF,        // alignof (C23)
@@ -144,12 +151,23 @@ enum class Token {
   _NORETURN,      // _Noreturn (C11)
   _STATIC_ASSERT, // _Static_assert (C11)
   _THREAD_LOCAL,  // _Thread_local (C11)
+  ASM,            // asm __asm __asm__ (GNU)
+  ATTRIBUTE,      // __attribute __attribute__ (GNU)
+  AUTO_TYPE,      // __auto_type (GNU)
+  EXTENSION,      // __extension__ (GNU)
+  INT128,         // __int128 (GNU)
+  LABEL,          // __label__ (GNU)
+
+  NEWLINE, // the end of a preprocessing directive
+  COMMENT, // with Lexer::KEEP_COMMENTS
 
   END,
   INVALID
 };
 
-extern const char
-    *ttos[static_cast<std::underlying_type_t<Token>>(Token::INVALID) + 1];
+constexpr std::size_t num_tokens =
+    static_cast<std::underlying_type_t<Token>>(Token::INVALID) + 1;
+
+extern const char *ttos[num_tokens];
 
 } // namespace c_lexer
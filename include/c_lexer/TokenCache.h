@@ -0,0 +1,93 @@
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#pragma once
+
+#include <c_lexer/TokenStream.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace c_lexer {
+
+// Changes whenever the serialized form or the layout of Token does, such as
+// when a keyword is added, so that caches written before then are ignored.
+std::uint64_t token_format_stamp();
+
+// A hash of source bytes, for keying cached streams by content.
+std::uint64_t hash_source(std::string_view s);
+// A second hash of source bytes, mixed with other constants than
+// hash_source(), so that a stream cached for a source whose hash_source()
+// collides with this one's is still not taken for it.
+std::uint64_t check_source(std::string_view s);
+
+// The tokens of ts, scanned from source with flags, in a compact binary form:
+// a header with the format stamp and both hashes of the source, the token
+// kinds and the line state after each token as bytes, a string table of the
+// distinct identifier names, then for each token the gap before it, its
+// length and, for an IDENTIFIER, the index of its name, as varints.
+std::string serialize_tokens(const TokenStream &ts, std::string_view source,
+                             std::uint32_t flags);
+
+// Replace the contents of ts with the tokens in data, which must have been
+// serialized from source with flags. When ts has a SymbolTable, each name in
+// the string table is interned once. Returns false, leaving ts empty, when
+// data is stale, damaged or for another source.
+bool deserialize_tokens(std::string_view data, std::string_view source,
+                        std::uint32_t flags, TokenStream &ts);
+
+// A directory of serialized token streams, one per distinct source and
+// flags, named by the hash of the source. A stream is read from a read-only
+// mapping of its file. May be used from several threads at once.
+class TokenCache {
+public:
+  // Creates dir when it does not exist.
+  explicit TokenCache(std::string dir);
+
+  // Load the tokens of source into ts, or scan them as scan_tokens() does
+  // and store them for next time. Returns the number of tokens.
+  std::size_t scan_tokens(std::string_view source, TokenStream &ts,
+                          std::uint32_t flags = 0);
+
+  bool load(std::string_view source, std::uint32_t flags,
+            TokenStream &ts) const;
+  // Whether ts could be written. The file is written under a temporary
+  // name and renamed into place, so readers never see part of one.
+  bool store(std::string_view source, std::uint32_t flags,
+             const TokenStream &ts);
+
+  std::string path(std::string_view source, std::uint32_t flags) const;
+  const std::string &dir() const { return dir_; }
+
+  std::size_t hits() const { return hits_; }
+  std::size_t misses() const { return misses_; }
+
+protected:
+  std::string dir_;
+  std::atomic<std::size_t> hits_;
+  std::atomic<std::size_t> misses_;
+  std::atomic<std::uint64_t> temp_; // counter for temporary file names
+};
+
+} // namespace c_lexer
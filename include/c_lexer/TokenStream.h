@@ -0,0 +1,225 @@
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#pragma once
+
+#include <c_lexer/Lexer.h>
+#include <c_lexer/SymbolTable.h>
+#include <c_lexer/Token.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace c_lexer {
+
+// A change to a source buffer: the removed bytes at offset were replaced by
+// inserted bytes.
+struct Edit {
+  std::size_t offset;
+  std::size_t removed;
+  std::size_t inserted;
+};
+
+// The tokens of one source buffer, stored column-wise. Passes that only look
+// at token kinds walk a dense array of bytes instead of an array of Lexeme's.
+// A token's text is the range [offset(i), offset(i) + length(i)) of the
+// source, which must outlive the TokenStream.
+//
+// Rows and columns are not recorded while scanning. They are computed for
+// every token on the first call to row() or col().
+//
+// A TokenStream given a SymbolTable also records the symbol of each token,
+// the id of an IDENTIFIER's name or no_symbol, as it is scanned or re-lexed.
+// The line state that the Lexer was in after each token is recorded too, so
+// that relex_tokens() can tell where a re-lex meets the old tokens again
+// without replaying any of them.
+//
+// relex_tokens() leaves a gap in the columns where it replaced tokens, as a
+// gap buffer does, and the offsets and rows of the tokens after the gap owe
+// a pending shift. So an edit moves only the tokens between it and the last
+// one. The first call to kinds(), offsets(), lengths(), symbol_ids(),
+// line_states(), row(), col() or push_back() after an edit closes the gap,
+// and so an edited stream is no safer than one with lazy positions to read
+// from several threads.
+class TokenStream {
+public:
+  TokenStream() = default;
+
+  // Keeps the SymbolTable.
+  void reset(std::string_view source);
+  void reserve(std::size_t n);
+  void push_back(Token token, std::uint32_t offset, std::uint32_t length,
+                 Lexer::LineState line, std::uint32_t symbol = no_symbol) {
+    if (gapped())
+      close_gap();
+    kinds_.push_back(static_cast<std::uint8_t>(token));
+    offsets_.push_back(offset);
+    lengths_.push_back(length);
+    lines_.push_back(line);
+    if (symbols_)
+      ids_.push_back(symbol);
+    ++gap_;
+  }
+  void pop_back() {
+    if (gapped())
+      close_gap();
+    kinds_.pop_back();
+    offsets_.pop_back();
+    lengths_.pop_back();
+    lines_.pop_back();
+    if (symbols_)
+      ids_.pop_back();
+    --gap_;
+  }
+
+  // Intern identifiers into symbols, which must outlive the TokenStream, from
+  // the next scan on. Null stops. Either way the stream is reset.
+  void set_symbols(SymbolTable *symbols) {
+    symbols_ = symbols;
+    reset(source_);
+  }
+  SymbolTable *symbols() const { return symbols_; }
+
+  std::size_t size() const { return kinds_.size() - gap_len_; }
+  bool empty() const { return size() == 0; }
+  std::string_view source() const { return source_; }
+
+  Token token(std::size_t i) const {
+    return static_cast<Token>(kinds_[slot(i)]);
+  }
+  std::uint32_t offset(std::size_t i) const {
+    const std::size_t k = slot(i);
+    return offsets_[k] + (k >= gap_ ? shift_ : 0);
+  }
+  std::uint32_t length(std::size_t i) const { return lengths_[slot(i)]; }
+  std::string_view text(std::size_t i) const {
+    return source_.substr(offset(i), length(i));
+  }
+  // Only with a SymbolTable.
+  std::uint32_t symbol(std::size_t i) const { return ids_[slot(i)]; }
+  // The line state after token i.
+  Lexer::LineState line_state(std::size_t i) const {
+    return static_cast<Lexer::LineState>(lines_[slot(i)]);
+  }
+
+  std::uint32_t row(std::size_t i) const {
+    if (!has_positions())
+      compute_positions();
+    const std::size_t k = slot(i);
+    return rows_[k] + (k >= gap_ ? row_shift_ : 0);
+  }
+  std::uint32_t col(std::size_t i) const {
+    if (!has_positions())
+      compute_positions();
+    return cols_[slot(i)];
+  }
+
+  const std::vector<std::uint8_t> &kinds() const {
+    close_gap();
+    return kinds_;
+  }
+  const std::vector<std::uint32_t> &offsets() const {
+    close_gap();
+    return offsets_;
+  }
+  const std::vector<std::uint32_t> &lengths() const {
+    close_gap();
+    return lengths_;
+  }
+  const std::vector<std::uint32_t> &symbol_ids() const {
+    close_gap();
+    return ids_;
+  }
+  // Each a Lexer::LineState.
+  const std::vector<std::uint8_t> &line_states() const {
+    close_gap();
+    return lines_;
+  }
+
+protected:
+  friend std::size_t relex_tokens(std::string_view s, const Edit &edit,
+                                  TokenStream &ts, std::uint32_t flags);
+
+  // Where token i is kept in the columns.
+  std::size_t slot(std::size_t i) const {
+    return i < gap_ ? i : i + gap_len_;
+  }
+  bool gapped() const { return gap_ != kinds_.size(); }
+  bool has_positions() const { return rows_.size() == kinds_.size(); }
+  // Move the gap to just before token i, settling the shift of the tokens
+  // that cross it.
+  void move_gap(std::size_t i) const;
+  void close_gap() const;
+  // Widen the gap to at least n slots.
+  void reserve_gap(std::size_t n);
+  void compute_positions() const;
+
+  std::string_view source_;
+  // Token i is in slot(i) of each column. The slots [gap_, gap_ + gap_len_)
+  // are free, and gap_ is the size of the columns when there is no gap.
+  mutable std::vector<std::uint8_t> kinds_;
+  mutable std::vector<std::uint32_t> offsets_; // less shift_ after the gap
+  mutable std::vector<std::uint32_t> lengths_;
+  mutable std::vector<std::uint8_t> lines_; // Lexer::LineState
+  SymbolTable *symbols_ = nullptr;
+  mutable std::vector<std::uint32_t> ids_; // with symbols_
+  mutable std::vector<std::uint32_t> rows_; // less row_shift_ after the gap
+  mutable std::vector<std::uint32_t> cols_;
+  mutable std::size_t gap_ = 0;
+  mutable std::size_t gap_len_ = 0;
+  mutable std::uint32_t shift_ = 0;     // mod 2^32
+  mutable std::uint32_t row_shift_ = 0; // mod 2^32
+};
+
+// Scan all of s into ts, replacing its contents. The last token is
+// Token::END. Returns the number of tokens, including END, or 0 when s is too
+// large for 32-bit offsets.
+std::size_t scan_tokens(std::string_view s, TokenStream &ts,
+                        std::uint32_t flags = 0);
+
+// Scan all of s into ts as scan_tokens() does, using n_threads workers (0
+// means one per hardware thread). s is cut into chunks just after newlines,
+// or, in a line longer than a chunk such as minified source has, just after
+// spaces, and the chunks are lexed concurrently, each as though it began at
+// a token boundary. Should a token run up to the end of its chunk, or a cut
+// fall within a literal or a comment, the seam is re-lexed from that token
+// until it lines up with the next chunk's tokens again. The result,
+// including row() and col(), is the same as from scan_tokens(). Small
+// sources are scanned on the calling thread.
+std::size_t scan_tokens_parallel(std::string_view s, TokenStream &ts,
+                                 unsigned n_threads, std::uint32_t flags = 0);
+
+// Bring ts, the tokens of some source, up to date with edit, where s is the
+// source after the edit. Scanning restarts at the last token that the edit
+// could have changed and stops at the first token that starts where one of
+// the old tokens now does; tokens from there on are kept, and their shift is
+// left pending behind the gap. So the cost of an edit depends on the tokens
+// re-lexed and on how far the gap moves from the last edit, not on the size
+// of s. Rows and columns are only followed once they have been computed.
+// flags must be those that ts was scanned with. The source before the edit
+// need not exist any more. Returns the number of tokens that were scanned, or
+// 0 when s is too large for 32-bit offsets.
+std::size_t relex_tokens(std::string_view s, const Edit &edit, TokenStream &ts,
+                         std::uint32_t flags = 0);
+
+} // namespace c_lexer
@@ -0,0 +1,81 @@
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include <c_lexer/Arena.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace c_lexer {
+
+Arena::Arena(std::size_t block_size)
+    : block_size_(block_size), first_size_(0), free_(nullptr), left_(0),
+      used_(0) {}
+
+void *Arena::do_allocate(std::size_t n, std::size_t align) {
+  std::size_t pad = -reinterpret_cast<std::uintptr_t>(free_) & (align - 1);
+  if (n + pad > left_) {
+    // One too large for a block gets a block of its own.
+    const std::size_t size = std::max(block_size_, n + align - 1);
+    blocks_.push_back(std::make_unique<char[]>(size));
+    if (blocks_.size() == 1)
+      first_size_ = size;
+    free_ = blocks_.back().get();
+    left_ = size;
+    pad = -reinterpret_cast<std::uintptr_t>(free_) & (align - 1);
+  }
+
+  char *const p = free_ + pad;
+  free_ = p + n;
+  left_ -= n + pad;
+  used_ += n;
+  return p;
+}
+
+std::string_view Arena::copy(std::string_view s) {
+  if (s.empty())
+    return {};
+
+  char *const p = static_cast<char *>(allocate(s.size(), 1));
+  std::memcpy(p, s.data(), s.size());
+  return {p, s.size()};
+}
+
+void Arena::shrink(void *p, std::size_t n, std::size_t used) {
+  if (static_cast<char *>(p) + n != free_)
+    return;
+
+  free_ -= n - used;
+  left_ += n - used;
+  used_ -= n - used;
+}
+
+void Arena::release() {
+  if (blocks_.size() > 1)
+    blocks_.erase(blocks_.begin() + 1, blocks_.end());
+
+  free_ = blocks_.empty() ? nullptr : blocks_.front().get();
+  left_ = blocks_.empty() ? 0 : first_size_;
+  used_ = 0;
+}
+
+} // namespace c_lexer
@@ -0,0 +1,439 @@
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "FileReads.h"
+#include "WorkStealingPool.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#define C_LEXER_HAVE_IO_URING 1
+#endif
+#endif
+
+namespace c_lexer {
+
+// Read all of fd, which need not be seekable, into data.
+static bool read_stream(int fd, std::string &data) {
+  char buf[64 * 1024];
+  for (;;) {
+    const ssize_t n = ::read(fd, buf, sizeof(buf));
+    if (n > 0)
+      data.append(buf, static_cast<std::size_t>(n));
+    else if (n == 0)
+      return true;
+    else if (errno != EINTR)
+      return false;
+  }
+}
+
+// Open path for b. Returns a descriptor to read all b.data.size() bytes of a
+// regular file from, or -1 once b is complete: failed, or read here because
+// the file is not regular or reports no size, such as files in /proc.
+static int open_file(const std::string &path, FileBuffer &b) {
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return -1;
+
+  struct stat st;
+  if (::fstat(fd, &st) || S_ISDIR(st.st_mode)) {
+    ::close(fd);
+    return -1;
+  }
+
+  if (S_ISREG(st.st_mode) && st.st_size > 0) {
+    b.data.resize(static_cast<std::size_t>(st.st_size));
+    return fd;
+  }
+
+  b.ok = read_stream(fd, b.data);
+  ::close(fd);
+  return -1;
+}
+
+// Read all of b from fd, and close fd. A file that has shrunk since it was
+// opened is cut short; one that has grown is read only as far as its size
+// then.
+static void pread_file(int fd, FileBuffer &b) {
+  std::size_t done = 0;
+  while (done < b.data.size()) {
+    const ssize_t n = ::pread(fd, &b.data[done], b.data.size() - done,
+                              static_cast<off_t>(done));
+    if (n > 0)
+      done += static_cast<std::size_t>(n);
+    else if (n == 0)
+      b.data.resize(done);
+    else if (errno != EINTR)
+      break;
+  }
+  b.ok = done == b.data.size();
+  ::close(fd);
+}
+
+// Keep up to depth of the files retry, then of paths[next, end), in flight
+// on a pool of as many threads, each reading its file with pread().
+static void read_with_pool(const std::vector<std::string> &paths,
+                           const std::vector<std::size_t> &retry,
+                           std::size_t next, std::size_t depth,
+                           const BufferCallback &done) {
+  WorkStealingPool pool(static_cast<unsigned>(depth));
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::deque<FileBuffer> finished; // guarded by mutex
+  std::size_t in_flight = 0;
+  std::size_t retried = 0;
+
+  while (retried < retry.size() || next < paths.size() || in_flight) {
+    while (in_flight < depth &&
+           (retried < retry.size() || next < paths.size())) {
+      const std::size_t i =
+          retried < retry.size() ? retry[retried++] : next++;
+      auto b = std::make_shared<FileBuffer>(FileBuffer{i, false, {}});
+      const int fd = open_file(paths[i], *b);
+      if (fd < 0) {
+        done(*b);
+        continue;
+      }
+
+      ++in_flight;
+      pool.submit([&, b, fd](unsigned) {
+        pread_file(fd, *b);
+        std::lock_guard<std::mutex> lock(mutex);
+        finished.push_back(std::move(*b));
+        cv.notify_one();
+      });
+    }
+    if (!in_flight)
+      continue;
+
+    FileBuffer b;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      cv.wait(lock, [&] { return !finished.empty(); });
+      b = std::move(finished.front());
+      finished.pop_front();
+    }
+    --in_flight;
+    done(b);
+  }
+
+  pool.wait();
+}
+
+#if defined(C_LEXER_HAVE_IO_URING)
+
+// Just enough of an io_uring, over the raw system calls, to queue READV
+// requests and reap their completions from one thread.
+class Uring {
+public:
+  Uring() = default;
+  ~Uring() {
+    if (sqes_)
+      ::munmap(sqes_, sqes_len_);
+    if (cq_ring_ && cq_ring_ != sq_ring_)
+      ::munmap(cq_ring_, cq_len_);
+    if (sq_ring_)
+      ::munmap(sq_ring_, sq_len_);
+    if (fd_ >= 0)
+      ::close(fd_);
+  }
+
+  Uring(const Uring &) = delete;
+  Uring &operator=(const Uring &) = delete;
+
+  // Set up a ring for at least entries requests in flight. False when the
+  // kernel, or a sandbox, does not allow io_uring.
+  bool open(unsigned entries) {
+    io_uring_params p;
+    std::memset(&p, 0, sizeof(p));
+    fd_ = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &p));
+    if (fd_ < 0)
+      return false;
+
+    sq_len_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    cq_len_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+    const bool single = p.features & IORING_FEAT_SINGLE_MMAP;
+    if (single)
+      sq_len_ = cq_len_ = std::max(sq_len_, cq_len_);
+
+    sq_ring_ = map(sq_len_, IORING_OFF_SQ_RING);
+    if (!sq_ring_)
+      return false;
+    cq_ring_ = single ? sq_ring_ : map(cq_len_, IORING_OFF_CQ_RING);
+    if (!cq_ring_)
+      return false;
+    sqes_len_ = p.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = static_cast<io_uring_sqe *>(map(sqes_len_, IORING_OFF_SQES));
+    if (!sqes_)
+      return false;
+
+    char *sq = static_cast<char *>(sq_ring_);
+    sq_tail_ = reinterpret_cast<unsigned *>(sq + p.sq_off.tail);
+    sq_mask_ = *reinterpret_cast<unsigned *>(sq + p.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned *>(sq + p.sq_off.array);
+
+    char *cq = static_cast<char *>(cq_ring_);
+    cq_head_ = reinterpret_cast<unsigned *>(cq + p.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned *>(cq + p.cq_off.tail);
+    cq_mask_ = *reinterpret_cast<unsigned *>(cq + p.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe *>(cq + p.cq_off.cqes);
+    return true;
+  }
+
+  // Queue a read of iov from fd at offset, to be submitted by the next
+  // wait(). The caller keeps no more requests in flight than the ring holds.
+  void queue_readv(int fd, const iovec *iov, std::size_t offset,
+                   std::uint64_t user_data) {
+    io_uring_sqe &sqe = next_sqe();
+    sqe.opcode = IORING_OP_READV;
+    sqe.fd = fd;
+    sqe.addr = reinterpret_cast<std::uint64_t>(iov);
+    sqe.len = 1;
+    sqe.off = offset;
+    sqe.user_data = user_data;
+    push_sqe();
+  }
+
+  // Queue a cancellation of the request queued with target, to be submitted
+  // by the next wait(). Its own completion carries user_data, and the
+  // request's completes it with -ECANCELED unless it had finished already.
+  void queue_cancel(std::uint64_t target, std::uint64_t user_data) {
+    io_uring_sqe &sqe = next_sqe();
+    sqe.opcode = IORING_OP_ASYNC_CANCEL;
+    sqe.fd = -1;
+    sqe.addr = target;
+    sqe.user_data = user_data;
+    push_sqe();
+  }
+
+  // Submit what has been queued, and wait for the next completion.
+  bool wait(io_uring_cqe &cqe) {
+    for (;;) {
+      const unsigned head = *cq_head_; // only this thread writes it
+      if (head != __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+        cqe = cqes_[head & cq_mask_];
+        __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+        return true;
+      }
+
+      const long n = ::syscall(__NR_io_uring_enter, fd_, queued_, 1,
+                               IORING_ENTER_GETEVENTS, nullptr, 0);
+      if (n >= 0)
+        queued_ -= static_cast<unsigned>(n);
+      else if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+        return false;
+    }
+  }
+
+protected:
+  io_uring_sqe &next_sqe() {
+    const unsigned i = *sq_tail_ & sq_mask_; // only this thread writes it
+    io_uring_sqe &sqe = sqes_[i];
+    std::memset(&sqe, 0, sizeof(sqe));
+    sq_array_[i] = i;
+    return sqe;
+  }
+
+  void push_sqe() {
+    __atomic_store_n(sq_tail_, *sq_tail_ + 1, __ATOMIC_RELEASE);
+    ++queued_;
+  }
+
+  void *map(std::size_t len, off_t offset) {
+    void *p = ::mmap(nullptr, len, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, fd_, offset);
+    return p == MAP_FAILED ? nullptr : p;
+  }
+
+  int fd_ = -1;
+  void *sq_ring_ = nullptr;
+  void *cq_ring_ = nullptr;
+  io_uring_sqe *sqes_ = nullptr;
+  std::size_t sq_len_ = 0;
+  std::size_t cq_len_ = 0;
+  std::size_t sqes_len_ = 0;
+  unsigned *sq_tail_ = nullptr;
+  unsigned sq_mask_ = 0;
+  unsigned *sq_array_ = nullptr;
+  unsigned *cq_head_ = nullptr;
+  unsigned *cq_tail_ = nullptr;
+  unsigned cq_mask_ = 0;
+  io_uring_cqe *cqes_ = nullptr;
+  unsigned queued_ = 0; // queued but not yet submitted
+};
+
+// A file being read on the ring.
+struct UringRead {
+  FileBuffer buf;
+  int fd;
+  std::size_t done; // bytes read so far
+  iovec iov;        // what is left to read, while a request is in flight
+};
+
+// The user_data of a cancellation's own completion; that of a read is its
+// slot.
+const std::uint64_t cancel_tag = ~std::uint64_t(0);
+
+// Keep up to depth files in flight on ring, each read with one READV and
+// further ones for what short reads leave. The ring holds 2 * depth requests,
+// so that there is room to cancel each read. Returns how many of paths were
+// started, which is fewer than all of them only should the ring fail. The
+// files in flight then are cancelled, and added to retry to be read another
+// way.
+static std::size_t read_with_uring(Uring &ring,
+                                   const std::vector<std::string> &paths,
+                                   std::size_t depth,
+                                   const BufferCallback &done,
+                                   std::vector<std::size_t> &retry) {
+  std::vector<UringRead> reads(depth);
+  std::vector<std::size_t> free_slots;
+  for (std::size_t i = depth; i--;)
+    free_slots.push_back(i);
+
+  const auto queue = [&](std::size_t slot) {
+    UringRead &r = reads[slot];
+    r.iov.iov_base = &r.buf.data[r.done];
+    r.iov.iov_len = r.buf.data.size() - r.done;
+    ring.queue_readv(r.fd, &r.iov, r.done, slot);
+  };
+
+  std::size_t next = 0;
+  while (next < paths.size() || free_slots.size() < depth) {
+    while (!free_slots.empty() && next < paths.size()) {
+      UringRead &r = reads[free_slots.back()];
+      r.buf = FileBuffer{next, false, {}};
+      r.fd = open_file(paths[next++], r.buf);
+      if (r.fd < 0) {
+        done(r.buf);
+        continue;
+      }
+      r.done = 0;
+      queue(free_slots.back());
+      free_slots.pop_back();
+    }
+    if (free_slots.size() == depth)
+      continue;
+
+    io_uring_cqe cqe;
+    if (!ring.wait(cqe)) {
+      // The kernel may still be reading into the buffers in flight, so
+      // cancel those reads and reap each one's completion before its buffer
+      // can go.
+      std::vector<bool> busy(depth, true);
+      for (std::size_t slot : free_slots)
+        busy[slot] = false;
+      std::size_t in_flight = 0;
+      for (std::size_t slot = 0; slot < depth; ++slot) {
+        if (busy[slot]) {
+          ring.queue_cancel(slot, cancel_tag);
+          retry.push_back(reads[slot].buf.index);
+          ++in_flight;
+        }
+      }
+      while (in_flight && ring.wait(cqe)) {
+        const std::size_t slot = static_cast<std::size_t>(cqe.user_data);
+        if (cqe.user_data != cancel_tag && busy[slot]) {
+          ::close(reads[slot].fd);
+          busy[slot] = false;
+          --in_flight;
+        }
+      }
+      // Should the ring not even drain, the buffers are never freed, so
+      // that no read still in flight can write into memory reused since.
+      if (in_flight) {
+        for (std::size_t slot = 0; slot < depth; ++slot)
+          if (busy[slot])
+            ::close(reads[slot].fd);
+        static_cast<void>(new std::vector<UringRead>(std::move(reads)));
+      }
+      return next;
+    }
+
+    const std::size_t slot = static_cast<std::size_t>(cqe.user_data);
+    UringRead &r = reads[slot];
+    if (cqe.res == -EINTR || cqe.res == -EAGAIN) {
+      queue(slot);
+      continue;
+    }
+    if (cqe.res > 0) {
+      r.done += static_cast<std::size_t>(cqe.res);
+      if (r.done < r.buf.data.size()) {
+        queue(slot);
+        continue;
+      }
+    } else if (cqe.res == 0) {
+      r.buf.data.resize(r.done); // the file has shrunk
+    }
+
+    r.buf.ok = r.done == r.buf.data.size();
+    ::close(r.fd);
+    free_slots.push_back(slot);
+    done(r.buf);
+  }
+
+  return next;
+}
+
+#endif // C_LEXER_HAVE_IO_URING
+
+ReadBackend read_files(const std::vector<std::string> &paths,
+                       std::size_t depth, const BufferCallback &done,
+                       ReadBackend backend) {
+  depth = std::max<std::size_t>(depth, 1);
+
+#if defined(C_LEXER_HAVE_IO_URING)
+  if (backend != ReadBackend::PREAD_POOL) {
+    Uring ring;
+    if (ring.open(static_cast<unsigned>(2 * depth))) {
+      std::vector<std::size_t> retry;
+      const std::size_t next =
+          read_with_uring(ring, paths, depth, done, retry);
+      if (!retry.empty() || next < paths.size())
+        read_with_pool(paths, retry, next, depth, done);
+      return ReadBackend::IO_URING;
+    }
+  }
+#else
+  static_cast<void>(backend);
+#endif
+
+  read_with_pool(paths, {}, 0, depth, done);
+  return ReadBackend::PREAD_POOL;
+}
+
+} // namespace c_lexer
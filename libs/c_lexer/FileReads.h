@@ -0,0 +1,61 @@
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace c_lexer {
+
+// How read_files() reads.
+enum class ReadBackend {
+  AUTO,       // IO_URING where the kernel allows it, otherwise PREAD_POOL
+  IO_URING,   // reads queued on an io_uring, on Linux
+  PREAD_POOL, // blocking pread() calls on a pool of threads
+};
+
+// A file read by read_files().
+struct FileBuffer {
+  std::size_t index; // position of the file in paths
+  bool ok;           // false when the file could not be read
+  std::string data;  // all of the file when ok, which done may move from
+};
+
+using BufferCallback = std::function<void(FileBuffer &)>;
+
+// Read each of paths whole, with up to depth reads in flight at once, and
+// pass each file to done as soon as all of it has been read. done runs on the
+// calling thread, in the order that the reads complete. While done runs no
+// further reads are started, so a done that blocks holds back the reads.
+//
+// Files are opened on the calling thread and read asynchronously. Pipes,
+// devices and files that report no size are read on the calling thread.
+// Returns the backend that was used: IO_URING falls back to PREAD_POOL when
+// it is unavailable.
+ReadBackend read_files(const std::vector<std::string> &paths,
+                       std::size_t depth, const BufferCallback &done,
+                       ReadBackend backend = ReadBackend::AUTO);
+
+} // namespace c_lexer
@@ -0,0 +1,111 @@
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <c_lexer/LexFiles.h>
+
+#include "FileReads.h"
+#include "WorkStealingPool.h"
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string_view>
+
+namespace c_lexer {
+
+// Reads in flight at once, enough to keep a disk's queue busy.
+static const std::size_t read_depth = 32;
+
+std::size_t lex_files(const std::vector<std::string> &paths,
+                      unsigned n_threads, const FileCallback &callback,
+                      std::uint32_t flags, TokenCache *cache) {
+  WorkStealingPool pool(n_threads);
+  // Each worker reuses one TokenStream from one file to the next.
+  std::vector<TokenStream> tokens(pool.size());
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::size_t queued = 0; // files read but not yet lexed, guarded by mutex
+  std::size_t failed = 0; // guarded by mutex
+
+  // Files are read on this thread, and each is lexed by a worker as soon as
+  // it has been read. While the workers are behind, reading waits, so that
+  // the files held in memory stay bounded.
+  const std::size_t max_queued = 2 * pool.size();
+
+  read_files(paths, read_depth, [&](FileBuffer &file) {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      cv.wait(lock, [&] { return queued < max_queued; });
+      ++queued;
+      if (!file.ok)
+        ++failed;
+    }
+
+    auto buf = std::make_shared<FileBuffer>(std::move(file));
+    pool.submit([&, buf](unsigned worker) {
+      TokenStream &ts = tokens[worker];
+      if (!buf->ok)
+        ts.reset(std::string_view());
+      else if (cache)
+        cache->scan_tokens(buf->data, ts, flags);
+      else
+        scan_tokens(buf->data, ts, flags);
+
+      callback(FileTokens{buf->index, paths[buf->index], buf->ok, ts});
+
+      std::lock_guard<std::mutex> lock(mutex);
+      --queued;
+      cv.notify_one();
+    });
+  });
+
+  pool.wait();
+  return failed;
+}
+
+TokenCounts count_tokens(const std::vector<std::string> &paths,
+                         unsigned n_threads, std::uint32_t flags,
+                         TokenCache *cache) {
+  TokenCounts total;
+  std::mutex mutex;
+
+  total.failed = lex_files(
+      paths, n_threads,
+      [&](const FileTokens &file) {
+        if (!file.ok)
+          return;
+
+        std::array<std::uint64_t, num_tokens> counts{};
+        for (std::uint8_t kind : file.tokens.kinds())
+          ++counts[kind];
+
+        std::lock_guard<std::mutex> lock(mutex);
+        ++total.files;
+        for (std::size_t i = 0; i < num_tokens; ++i)
+          total.counts[i] += counts[i];
+      },
+      flags, cache);
+
+  return total;
+}
+
+} // namespace c_lexer
@@ -21,54 +21,460 @@
 // SOFTWARE.
 
 #include <c_lexer/Lexer.h>
+#include <c_lexer/TokenStream.h>
 
+#include "Simd.h"
+
+#include <algorithm>
+#include <chrono>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
 #include <memory>
-#include <sstream>
-#include <stack>
 #include <utility>
 
 namespace c_lexer {
 
-Lexer::Lexer(std::unique_ptr<SourceReader> &&sr)
-    : sr_(std::move(sr)), row_(1), col_(1) {
-  lookahead_.push(scan_token());
+#if defined(C_LEXER_TABLE_KEYWORDS) && C_LEXER_TABLE_KEYWORDS
+const std::uint32_t build_flags = Lexer::TABLE_KEYWORDS;
+#else
+const std::uint32_t build_flags = 0;
+#endif
+
+#if defined(C_LEXER_STATS) && C_LEXER_STATS
+#define tally(_expr)                                                           \
+  do {                                                                         \
+    _expr;                                                                     \
+  } while (0)
+
+// Charges the whitespace skipped during its lifetime to stats.
+struct WhitespaceTimer {
+  WhitespaceTimer(LexerStats &stats, const SourceReader &sr)
+      : stats_(stats), sr_(sr), offset_(sr.offset()),
+        start_(std::chrono::steady_clock::now()) {}
+  ~WhitespaceTimer() {
+    stats_.whitespace_bytes += sr_.offset() - offset_;
+    const auto elapsed = std::chrono::steady_clock::now() - start_;
+    stats_.whitespace_ns +=
+        std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+  }
+
+  LexerStats &stats_;
+  const SourceReader &sr_;
+  std::size_t offset_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+#define time_whitespace() const WhitespaceTimer _ws_timer(*stats_, *sr_)
+
+bool lexer_stats_enabled() { return true; }
+#else
+#define tally(_expr)                                                           \
+  do {                                                                         \
+  } while (0)
+#define time_whitespace()                                                      \
+  do {                                                                         \
+  } while (0)
+
+bool lexer_stats_enabled() { return false; }
+#endif
+
+// The keyword policies of the dialects that scan_token() is specialized for.
+#include "Keywords.inc"
+
+LexerStats &LexerStats::operator+=(const LexerStats &other) {
+  for (std::size_t i = 0; i < num_states; ++i)
+    states[i] += other.states[i];
+  backups += other.backups;
+  for (std::size_t i = 0; i < num_tokens; ++i) {
+    tokens[i] += other.tokens[i];
+    bytes[i] += other.bytes[i];
+  }
+  whitespace_bytes += other.whitespace_bytes;
+  whitespace_ns += other.whitespace_ns;
+  return *this;
+}
+
+Lexer::Lexer(std::unique_ptr<SourceReader> &&sr, std::uint32_t flags,
+             std::uint32_t row, std::uint32_t col, LineState line)
+    : Lexer(&simd::kernels(), std::move(sr), flags, row, col, line) {}
+
+Lexer::Lexer(const simd::Kernels *kernels, std::unique_ptr<SourceReader> &&sr,
+             std::uint32_t flags, std::uint32_t row, std::uint32_t col,
+             LineState line)
+    : sr_(std::move(sr)), flags_(flags | build_flags), simd_(kernels),
+      keep_lex_(!sr_->contiguous()), row_(row), col_(col), first_row_(row),
+      first_col_(col), splices_(0), line_(line),
+      symbols_(nullptr), arena_(nullptr), head_(0), count_(0) {
+  if (lexer_stats_enabled())
+    stats_ = std::make_unique<LexerStats>();
+  // The text before the current window is only kept by a contiguous reader.
+  if (!sr_->contiguous())
+    flags_ &= ~LAZY_POSITIONS;
+  const bool positions = !(flags_ & LAZY_POSITIONS);
+  switch (flags_ & (C89 | GNU)) {
+  case C89:
+    scan_ = positions ? &Lexer::scan_dialect<C89Dialect, true>
+                      : &Lexer::scan_dialect<C89Dialect, false>;
+    break;
+  case GNU:
+    scan_ = positions ? &Lexer::scan_dialect<Gnu23Dialect, true>
+                      : &Lexer::scan_dialect<Gnu23Dialect, false>;
+    break;
+  case C89 | GNU:
+    scan_ = positions ? &Lexer::scan_dialect<Gnu89Dialect, true>
+                      : &Lexer::scan_dialect<Gnu89Dialect, false>;
+    break;
+  default:
+    scan_ = positions ? &Lexer::scan_dialect<C23Dialect, true>
+                      : &Lexer::scan_dialect<C23Dialect, false>;
+    break;
+  }
+  push_lookahead();
+}
+
+SourcePosition Lexer::position_of(std::size_t offset) const {
+  if (!sr_->contiguous())
+    return SourcePosition{0, 0};
+  if (!lines_)
+    lines_ = std::make_unique<NewlineIndex>(sr_->buffer(), first_row_,
+                                            first_col_);
+  for (const std::size_t at : literal_breaks_)
+    lines_->within_token(at);
+  literal_breaks_.clear();
+  return lines_->position_of(offset);
+}
+
+void Lexer::note_literal_breaks(const Lexeme &l) {
+  if (l.token() == Token::INTEGER_LIT ? l.text().back() != '\''
+                                      : is_comment(l.token(), l.text()))
+    return;
+
+  // The newline of a splice begins a row within a token too, so only the
+  // other breaks are noted.
+  const char *const source = sr_->buffer().data();
+  const char *p = source + l.offset_;
+  const char *const end = p + source_length(l, sr_->buffer());
+  for (; (p += simd_->plain_run(p, end)) < end; ++p)
+    if (*p == '\v' || *p == '\f' || *p == '\r')
+      literal_breaks_.push_back(static_cast<std::size_t>(p - source));
 }
 
-const Lexeme &Lexer::peek() const { return lookahead_.front(); }
+SourcePosition Lexer::error_position() const {
+  if (flags_ & LAZY_POSITIONS)
+    return position_of(sr_->offset());
+  return SourcePosition{row_, col_};
+}
+
+void Lexer::add_diagnostic(Diagnostic::Kind kind, const char *message,
+                           std::size_t offset, std::uint32_t row,
+                           std::uint32_t col) {
+  if (flags_ & LAZY_POSITIONS)
+    row = col = 0;
+  diagnostics_.push_back(Diagnostic{kind, row, col, offset, message});
+}
+
+const char *diagnostic_kind_name(Diagnostic::Kind kind) {
+  switch (kind) {
+  case Diagnostic::INVALID_CHARACTER:
+    return "INVALID_CHARACTER";
+  case Diagnostic::UNTERMINATED_COMMENT:
+    return "UNTERMINATED_COMMENT";
+  case Diagnostic::UNTERMINATED_LITERAL:
+    return "UNTERMINATED_LITERAL";
+  case Diagnostic::EMPTY_CHARACTER:
+    return "EMPTY_CHARACTER";
+  case Diagnostic::BAD_ESCAPE:
+    return "BAD_ESCAPE";
+  case Diagnostic::BAD_NUMBER:
+    return "BAD_NUMBER";
+  case Diagnostic::BAD_SUFFIX:
+    return "BAD_SUFFIX";
+  }
+  return "?";
+}
+
+const LexerStats &Lexer::stats() const {
+  static const LexerStats none;
+  return stats_ ? *stats_ : none;
+}
+
+void Lexer::reset_stats() {
+  if (stats_)
+    *stats_ = LexerStats();
+}
+
+void Lexer::decode(Lexeme &l) {
+  switch (l.token()) {
+  case Token::IDENTIFIER:
+    if (symbols_)
+      l.symbol_ = symbols_->intern(l.text());
+    break;
+  case Token::INTEGER_LIT:
+    // A character constant, which is not a number to decode, ends in '\''.
+    if (l.text().back() == '\'') {
+      if (flags_ & DECODE_STRINGS) {
+        StringValue string;
+        decode_string(l.text(), payload_arena(), string);
+        l.set_string(string);
+      }
+    } else if ((flags_ & DECODE_NUMBERS) && l.value_ != Lexeme::NUMBER) {
+      // The scanner decoded it already, unless it was scanned some other way.
+      NumericValue number;
+      decode_number(l.text(), number);
+      l.set_number(number);
+    }
+    break;
+  case Token::FLOAT_LIT:
+    if (flags_ & DECODE_NUMBERS) {
+      NumericValue number;
+      decode_number(l.text(), number);
+      l.set_number(number);
+    }
+    break;
+  case Token::STRING_LIT:
+    if (flags_ & DECODE_STRINGS) {
+      StringValue string;
+      decode_string(l.text(), payload_arena(), string);
+      l.set_string(string);
+    }
+    break;
+  default:
+    break;
+  }
+}
+
+void Lexer::set_arena(Arena *arena) {
+  arena_ = arena;
+  if (!arena)
+    return;
+
+  // Move the text and decoded strings of tokens already scanned into the
+  // arena, where they outlive the Lexer.
+  for (std::size_t k = 0; k < count_; ++k) {
+    Lexeme &l = lookahead(k);
+    if (!l.lexeme_.empty()) {
+      l.view_ = arena->copy(l.lexeme_);
+      std::string().swap(l.lexeme_);
+    }
+    if (l.value_ == Lexeme::STRING)
+      decode(l);
+  }
+}
+
+void Lexer::set_symbols(SymbolTable *symbols) {
+  symbols_ = symbols;
+  for (std::size_t k = 0; k < count_; ++k) {
+    Lexeme &l = lookahead(k);
+    if (l.token() == Token::IDENTIFIER)
+      l.symbol_ = symbols ? symbols->intern(l.text()) : no_symbol;
+  }
+}
+
+// The directives whose operand may be a header name.
+static bool is_header_directive(std::string_view name) {
+  return name == "include" || name == "include_next" || name == "import" ||
+         name == "embed";
+}
+
+Lexer::LineState Lexer::next_line_state(LineState line, Token token,
+                                        std::string_view text) {
+  if (token == Token::END || is_comment(token, text))
+    return line;
+
+  switch (line) {
+  case LINE_START:
+    return token == Token::HASH ? DIRECTIVE_NAME : MID_LINE;
+  case MID_LINE:
+    return MID_LINE;
+  default:
+    if (token == Token::NEWLINE)
+      return LINE_START;
+    if (line == DIRECTIVE_NAME && token == Token::IDENTIFIER &&
+        is_header_directive(text))
+      return HEADER_NEXT;
+    return DIRECTIVE;
+  }
+}
+
+// A splice moves the position as a newline does, so the next row begins
+// just past the last one.
+void Lexer::sync_splices(std::size_t pending) {
+  row_ += sr_->splices() - splices_;
+  splices_ = sr_->splices();
+  col_ = static_cast<std::uint32_t>(1 + sr_->offset() - pending -
+                                    sr_->splice_end());
+}
+
+const Lexeme &Lexer::peek() const { return lookahead(0); }
+
+const Lexeme &Lexer::peek(std::size_t k) {
+  // The ring holds no more than lookahead_capacity tokens, as for preload().
+  k = std::min(k, lookahead_capacity - 1);
+
+  while (count_ <= k && !lookahead_ended())
+    push_lookahead();
+
+  return lookahead(std::min(k, count_ - 1));
+}
 
 Lexeme Lexer::eat() {
-  Lexeme l(std::move(lookahead_.front()));
+  Lexeme l;
 
-  lookahead_.pop();
-  if (lookahead_.empty())
-    lookahead_.push(scan_token());
+  pop_lookahead(l);
+  if (!count_)
+    push_lookahead();
 
   return l;
 }
 
 void Lexer::preload(std::size_t n) {
-  if (lookahead_.back().token() == Token::END)
-    return;
-
   for (std::size_t i = 0; i < n; ++i) {
-    lookahead_.push(scan_token());
-    if (lookahead_.back().token() == Token::END)
+    if (count_ == lookahead_capacity || lookahead_ended())
       return;
+    push_lookahead();
   }
 }
 
-#define eat_whitespace()                                                       \
+std::size_t Lexer::next_batch(Lexeme *out, std::size_t max) {
+  std::size_t n = 0;
+
+  while (n < max) {
+    Lexeme &l = out[n++];
+    if (count_)
+      pop_lookahead(l);
+    else
+      l = next_lexeme();
+    if (l.token() == Token::END)
+      break;
+  }
+
+  if (!count_)
+    push_lookahead();
+  return n;
+}
+
+std::size_t Lexer::next_batch(Token *out, std::size_t max) {
+  std::size_t n = 0;
+  Lexeme l;
+
+  while (n < max) {
+    if (count_)
+      pop_lookahead(l);
+    else
+      l = next_lexeme();
+    out[n++] = l.token();
+    if (l.token() == Token::END)
+      break;
+  }
+
+  if (!count_)
+    push_lookahead();
+  return n;
+}
+
+std::size_t Lexer::fill(TokenStream &ts, std::size_t n) {
+  if (!sr_->contiguous() || sr_->buffer().data() != ts.source().data()) {
+    std::cerr << "c_lexer: Lexer::fill() needs a TokenStream of the source "
+                 "of its contiguous reader\n";
+    return 0;
+  }
+
+  const std::string_view s = ts.source();
+  std::size_t i = 0;
+  Lexeme l;
+
+  while (i < n) {
+    LineState line;
+    if (count_) {
+      line = lookahead_lines_[head_];
+      pop_lookahead(l);
+    } else {
+      l = next_lexeme();
+      line = line_;
+    }
+    ts.push_back(l.token(), static_cast<std::uint32_t>(l.offset_),
+                 static_cast<std::uint32_t>(source_length(l, s)), line,
+                 l.symbol_);
+    ++i;
+    if (l.token() == Token::END)
+      break;
+  }
+
+  if (!count_)
+    push_lookahead();
+  return i;
+}
+
+// Comments are whitespace unless KEEP_COMMENTS.
+#define at_comment() (skip_comments && is_comment_start(sr_->peek()))
+
+// Read the next character of whitespace, noting any splice before it and
+// where c ends, before at_comment() can peek over a splice after it.
+#define get_blank()                                                            \
   do {                                                                         \
     c = sr_->eof() ? EOF : sr_->get();                                         \
-    while (std::isspace(c)) {                                                  \
+    c_end = sr_->offset();                                                     \
+    if (sr_->splices() != splices_)                                            \
+      sync_splices(c != EOF);                                                  \
+  } while (0)
+
+// Report an error at _offset, _row and _col: as a Diagnostic with RECOVER,
+// and otherwise on std::cerr where scanning is. _msg is a string literal.
+#define diagnose_at(_kind, _msg, _offset, _row, _col)                          \
+  do {                                                                         \
+    if (flags_ & RECOVER)                                                      \
+      add_diagnostic(Diagnostic::_kind, _msg, _offset, _row, _col);            \
+    else                                                                       \
+      print_error(std::cerr, _msg "\n");                                       \
+  } while (0)
+
+// An error in the token that began at start.
+#define diagnose(_kind, _msg) diagnose_at(_kind, _msg, start, row_, col_)
+
+// With LAZY_POSITIONS nothing follows the row and column, so whitespace is
+// skipped a run at a time, newlines and all.
+#define skip_space_runs()                                                      \
+  do {                                                                         \
+    while ((std::isspace(c) && (c != '\n' || !in_directive())) ||              \
+           (c == '/' && at_comment())) {                                       \
+      if (c == '/') {                                                          \
+        const std::size_t _at = c_end - 1;                                     \
+        if (!scan_comment(nullptr) && !(flags_ & OPEN_ENDED))                  \
+          diagnose_at(UNTERMINATED_COMMENT, "Unterminated comment.", _at, 0,   \
+                      0);                                                      \
+      } else {                                                                 \
+        if (c == '\n')                                                         \
+          line_ = LINE_START;                                                  \
+        const char *_p = sr_->cur();                                           \
+        const std::size_t _n = in_directive()                                  \
+                                   ? simd_->blank_run(_p, sr_->limit())        \
+                                   : simd_->space_run(_p, sr_->limit());       \
+        if (line_ == MID_LINE && std::memchr(_p, '\n', _n))                    \
+          line_ = LINE_START;                                                  \
+        sr_->skip(_n);                                                         \
+      }                                                                        \
+      get_blank();                                                             \
+    }                                                                          \
+  } while (0)
+
+// A newline within a directive is left to be returned as Token::NEWLINE.
+#define eat_whitespace()                                                       \
+  do {                                                                         \
+    time_whitespace();                                                         \
+    get_blank();                                                               \
+    if constexpr (!Positions) {                                                \
+      skip_space_runs();                                                       \
+      break;                                                                   \
+    }                                                                          \
+    while ((std::isspace(c) && (c != '\n' || !in_directive())) ||              \
+           (c == '/' && at_comment())) {                                       \
       switch (c) {                                                             \
       case '\n':                                                               \
         ++row_;                                                                \
         col_ = 1;                                                              \
+        line_ = LINE_START;                                                    \
         break;                                                                 \
       case '\v':                                                               \
         row_ += rows_per_vtab;                                                 \
@@ -79,29 +485,189 @@ void Lexer::preload(std::size_t n) {
         col_ = 1;                                                              \
         break;                                                                 \
       case ' ':                                                                \
-        ++col_;                                                                \
-        break;                                                                 \
-      case '\t':                                                               \
-        col_ += cols_per_htab;                                                 \
-        break;                                                                 \
+      case '\t': {                                                             \
+        col_ += c == ' ' ? 1 : cols_per_htab;                                  \
+        const std::size_t _n = simd_->blank_run(sr_->cur(), sr_->limit());     \
+        sr_->skip(_n);                                                         \
+        col_ += _n;                                                            \
+      } break;                                                                 \
+      case '/': {                                                              \
+        const std::size_t _at = c_end - 1;                                     \
+        const std::uint32_t _row = row_;                                       \
+        const std::uint32_t _col = col_;                                       \
+        if (!scan_comment(nullptr) && !(flags_ & OPEN_ENDED))                  \
+          diagnose_at(UNTERMINATED_COMMENT, "Unterminated comment.", _at,      \
+                      _row, _col);                                             \
+      } break;                                                                 \
       }                                                                        \
-      c = sr_->eof() ? EOF : sr_->get();                                       \
+      get_blank();                                                             \
     }                                                                          \
   } while (0)
 
+// The text of the token being scanned is the source range [start, offset()).
+// Only a reader that refills needs that text accumulated as it is read; a
+// contiguous reader can hand the range out when the token is complete.
+#define keep(_ch)                                                              \
+  do {                                                                         \
+    if (keep_lex_ && (_ch) != EOF)                                             \
+      lex.push_back(_ch);                                                      \
+  } while (0)
+
+#define lexlen() (sr_->offset() - start)
+
+// Consume the next _n characters of the reader's window as part of the token.
+#define keep_run(_n)                                                           \
+  do {                                                                         \
+    const std::size_t _len = (_n);                                             \
+    if (keep_lex_)                                                             \
+      lex.append(sr_->cur(), _len);                                            \
+    sr_->skip(_len);                                                           \
+  } while (0)
+
 #define r(_tkn, _cols)                                                         \
   do {                                                                         \
-    col_ += (_cols);                                                           \
-    return Lexeme(std::move(lex), _tkn, row_, col_ - (_cols));                 \
+    if constexpr (Positions) {                                                 \
+      col_ += (_cols);                                                         \
+      return make_lexeme(lex, start, _tkn, col_ - (_cols));                    \
+    } else {                                                                   \
+      return make_lexeme(lex, start, _tkn, 0);                                 \
+    }                                                                          \
   } while (0)
 
-#define rinvalid() r(Token::INVALID, lex.length())
+#define rinvalid() r(Token::INVALID, lexlen())
+
+// With DECODE_NUMBERS an INTEGER_LIT is decoded as it is scanned, into num:
+// num_digit() adds digit _d in num.radix, num_suffix() a Suffix flag, and
+// rinteger() returns the token with num as its value. A splice or a refill
+// of the reader between digits changes nothing, since the digits are seen
+// one by one either way.
+#define num_digit(_d)                                                          \
+  do {                                                                         \
+    if (flags_ & DECODE_NUMBERS) {                                             \
+      const unsigned _dv = static_cast<unsigned>(_d);                          \
+      if (_dv >= num.radix ||                                                  \
+          num.integer > (UINT64_MAX - _dv) / num.radix)                        \
+        num.ok = false;                                                        \
+      num.integer = num.integer * num.radix + _dv;                             \
+    }                                                                          \
+  } while (0)
+
+#define num_suffix(_flag)                                                      \
+  do {                                                                         \
+    num.suffix |= (_flag);                                                     \
+  } while (0)
+
+#define rinteger()                                                             \
+  do {                                                                         \
+    if (flags_ & DECODE_NUMBERS) {                                             \
+      std::uint32_t _col = 0;                                                  \
+      if constexpr (Positions) {                                               \
+        const std::size_t _cols = lexlen();                                    \
+        col_ += _cols;                                                         \
+        _col = col_ - _cols;                                                   \
+      }                                                                        \
+      Lexeme _l = make_lexeme(lex, start, Token::INTEGER_LIT, _col);           \
+      _l.set_number(num);                                                      \
+      return _l;                                                               \
+    }                                                                          \
+    r(Token::INTEGER_LIT, lexlen());                                           \
+  } while (0)
+
+// Consume the rest of a literal that closes with _quote, c having been read,
+// up to and including its closing quote or up to the newline that ends its
+// line. Each window of the reader is searched with memchr() for the next
+// quote, newline or backslash, without stepping the DFA.
+#define keep_literal(_quote)                                                   \
+  do {                                                                         \
+    bool _esc = c == '\\';                                                     \
+    while (c != (_quote) && sr_->peek() != EOF) {                              \
+      const char *const _p = sr_->cur();                                       \
+      const char *const _end = sr_->limit();                                   \
+      const char *_q = _p;                                                     \
+      while (_q < _end) {                                                      \
+        if (_esc) {                                                            \
+          _esc = false;                                                        \
+          ++_q;                                                                \
+          continue;                                                            \
+        }                                                                      \
+        _q = literal_stop(_q, _end, _quote);                                   \
+        if (_q == _end || *_q != '\\')                                         \
+          break;                                                               \
+        _esc = true;                                                           \
+        ++_q;                                                                  \
+      }                                                                        \
+      if (_q < _end && *_q == '\n') {                                          \
+        keep_run(static_cast<std::size_t>(_q - _p));                           \
+        break;                                                                 \
+      }                                                                        \
+      if (_q < _end)                                                           \
+        c = static_cast<unsigned char>(*_q++);                                 \
+      keep_run(static_cast<std::size_t>(_q - _p));                             \
+    }                                                                          \
+  } while (0)
+
+// An escape sequence cut short by c. A newline there is left to end the line,
+// as it is for an unterminated literal. With RECOVER the rest of the literal
+// is part of the INVALID token too, so that its closing quote cannot open
+// another.
+#define rbad_escape()                                                          \
+  do {                                                                         \
+    if (c == '\n')                                                             \
+      backup(c);                                                               \
+    else if ((flags_ & RECOVER) && c != EOF)                                   \
+      keep_literal(states[depth - 1] == GOT_STRING_LIT_START ? '"' : '\'');    \
+    rinvalid();                                                                \
+  } while (0)
+
+// Consume the rest of a pp-number: identifier characters, '.', and a sign
+// after an exponent letter.
+#define keep_pp_number()                                                       \
+  do {                                                                         \
+    char _prev = 0;                                                            \
+    while (true) {                                                             \
+      const std::size_t _n = simd_->ident_run(sr_->cur(), sr_->limit());       \
+      if (_n) {                                                                \
+        _prev = sr_->cur()[_n - 1];                                            \
+        keep_run(_n);                                                          \
+      }                                                                        \
+      const int _ch = sr_->peek();                                             \
+      const bool _sign = (_ch == '+' || _ch == '-') &&                         \
+                         (_prev == 'e' || _prev == 'E' || _prev == 'p' ||      \
+                          _prev == 'P');                                       \
+      if (!is_ident_cont(_ch) && _ch != '.' && !_sign)                         \
+        break;                                                                 \
+      advance();                                                               \
+      _prev = _ch;                                                             \
+    }                                                                          \
+  } while (0)
+
+// A malformed number, which c was read past unless it was put back. With
+// RECOVER the rest of its pp-number is part of the INVALID token too, so that
+// none of it is scanned as tokens of its own.
+#define rbad_number()                                                          \
+  do {                                                                         \
+    if (flags_ & RECOVER)                                                      \
+      keep_pp_number();                                                        \
+    rinvalid();                                                                \
+  } while (0)
+
+// Return keyword _tkn if the dialect has it. Otherwise the word so far is the
+// start of an identifier, which GOT_IDENT ends.
+#define rkeyword(_tkn, _cols)                                                  \
+  do {                                                                         \
+    if constexpr (Dialect::is_keyword(_tkn))                                   \
+      r(_tkn, _cols);                                                          \
+    else                                                                       \
+      nextst(GOT_IDENT);                                                       \
+  } while (0)
 
 #define backup(_ch)                                                            \
   do {                                                                         \
     if ((_ch) != EOF) {                                                        \
+      tally(++stats_->backups);                                                \
       sr_->unget(_ch);                                                         \
-      lex.pop_back();                                                          \
+      if (keep_lex_)                                                           \
+        lex.pop_back();                                                        \
     }                                                                          \
   } while (0)
 
@@ -116,7 +682,11 @@ void Lexer::preload(std::size_t n) {
     nextst(_s);                                                                \
   } while (0)
 
-#define advance() lex.push_back(sr_->get())
+#define advance()                                                              \
+  do {                                                                         \
+    const int _adv = sr_->get();                                               \
+    keep(_adv);                                                                \
+  } while (0)
 
 #define advancest(_s)                                                          \
   do {                                                                         \
@@ -126,14 +696,13 @@ void Lexer::preload(std::size_t n) {
 
 #define pushst(_s)                                                             \
   do {                                                                         \
-    states.push(st);                                                           \
+    states[depth++] = st;                                                      \
     nextst(_s);                                                                \
   } while (0)
 
 #define popst()                                                                \
   do {                                                                         \
-    nextst(states.top());                                                      \
-    states.pop();                                                              \
+    nextst(states[--depth]);                                                   \
   } while (0)
 
 #define pop_holdst()                                                           \
@@ -143,17 +712,40 @@ void Lexer::preload(std::size_t n) {
   } while (0)
 
 // C identifier names start with [a-zA-Z_] and continue with [a-zA-Z_0-9]
-inline bool is_ident_start(char c) { return std::isalpha(c) || c == '_'; }
+inline bool is_ident_start(char c) { return simd::is_class(c, simd::ALPHA); }
+
+inline bool is_ident_cont(char c) { return simd::is_class(c, simd::IDENT); }
 
-inline bool is_ident_cont(char c) { return std::isalnum(c) || c == '_'; }
+// The character after the '/' that opens a comment.
+inline bool is_comment_start(char c) { return c == '/' || c == '*'; }
+
+// blank_run() and plain_run() count a tab as one column.
+static_assert(Lexer::cols_per_htab == 1, "blank_run() assumes 1 col per tab");
 
 inline bool is_int_suffix_start(char c) {
-  return std::strchr("uUlLwW", c) != NULL;
+  return c && std::strchr("uUlLwW", c) != NULL;
 }
 
 inline bool
 is_simple_escape_sequence(char c) { // c is the char after the backslash
-  return std::strchr("\'\"?\\abfnrtv", c) != NULL;
+  return c && std::strchr("\'\"?\\abfnrtv", c) != NULL;
+}
+
+// The first quote, newline or backslash in [p, end), or end.
+inline const char *literal_stop(const char *p, const char *end, char quote) {
+  const char stops[] = {quote, '\n', '\\'};
+  for (const char stop : stops) {
+    const void *q = std::memchr(p, stop, static_cast<std::size_t>(end - p));
+    if (q)
+      end = static_cast<const char *>(q);
+  }
+  return end;
+}
+
+// The value of hexadecimal digit c.
+inline unsigned xdigit_value(int c) {
+  return std::isdigit(c) ? static_cast<unsigned>(c - '0')
+                         : static_cast<unsigned>((c | 0x20) - 'a' + 10);
 }
 
 #define START 0
@@ -248,161 +840,162 @@ is_simple_escape_sequence(char c) { // c is the char after the backslash
 #define GOT_align 87
 #define GOT_aligna 88
 #define GOT_aligno 89
-#define GOT_au 90
-#define GOT_aut 91
-#define GOT_b 92
-#define GOT_bo 93
-#define GOT_boo 94
-#define GOT_br 95
-#define GOT_bre 96
-#define GOT_brea 97
-#define GOT_c 98
-#define GOT_ca 99
-#define GOT_cas 100
-#define GOT_ch 101
-#define GOT_cha 102
-#define GOT_co 103
-#define GOT_con 104
-#define GOT_cons 105
-#define GOT_conste 107
-#define GOT_constex 108
-#define GOT_constexp 109
-#define GOT_cont 110
-#define GOT_conti 111
-#define GOT_contin 112
-#define GOT_continu 113
-#define GOT_d 114
-#define GOT_de 115
-#define GOT_def 116
-#define GOT_defa 117
-#define GOT_defau 118
-#define GOT_defaul 119
-#define GOT_dou 121
-#define GOT_doub 122
-#define GOT_doubl 123
-#define GOT_e 124
-#define GOT_el 125
-#define GOT_els 126
-#define GOT_en 127
-#define GOT_enu 128
-#define GOT_ex 129
-#define GOT_ext 130
-#define GOT_exte 131
-#define GOT_exter 132
-#define GOT_f 133
-#define GOT_fa 134
-#define GOT_fal 135
-#define GOT_fals 136
-#define GOT_fl 137
-#define GOT_flo 138
-#define GOT_floa 139
-#define GOT_fo 140
-#define GOT_g 141
-#define GOT_go 142
-#define GOT_got 143
-#define GOT_i 144
-#define GOT_in 145
-#define GOT_inl 146
-#define GOT_inli 147
-#define GOT_inlin 148
-#define GOT_l 149
-#define GOT_lo 150
-#define GOT_lon 151
-#define GOT_n 152
-#define GOT_nu 153
-#define GOT_nul 154
-#define GOT_null 155
-#define GOT_nullp 156
-#define GOT_nullpt 157
-#define GOT_r 158
-#define GOT_re 159
-#define GOT_reg 160
-#define GOT_regi 161
-#define GOT_regis 162
-#define GOT_regist 163
-#define GOT_registe 164
-#define GOT_res 165
-#define GOT_rest 166
-#define GOT_restr 167
-#define GOT_restri 168
-#define GOT_restric 169
-#define GOT_ret 170
-#define GOT_retu 171
-#define GOT_retur 172
-#define GOT_s 173
-#define GOT_sh 174
-#define GOT_sho 175
-#define GOT_shor 176
-#define GOT_si 177
-#define GOT_sig 178
-#define GOT_sign 179
-#define GOT_signe 180
-#define GOT_siz 181
-#define GOT_size 182
-#define GOT_sizeo 183
-#define GOT_st 184
-#define GOT_sta 185
-#define GOT_stat 186
-#define GOT_stati 187
-#define GOT_static_ 189
-#define GOT_static_a 190
-#define GOT_static_as 191
-#define GOT_static_ass 192
-#define GOT_static_asse 193
-#define GOT_static_asser 194
-#define GOT_str 195
-#define GOT_stru 196
-#define GOT_struc 197
-#define GOT_sw 198
-#define GOT_swi 199
-#define GOT_swit 200
-#define GOT_switc 201
-#define GOT_t 202
-#define GOT_th 203
-#define GOT_thr 204
-#define GOT_thre 205
-#define GOT_threa 206
-#define GOT_thread 207
-#define GOT_thread_ 208
-#define GOT_thread_l 209
-#define GOT_thread_lo 210
-#define GOT_thread_loc 211
-#define GOT_thread_loca 212
-#define GOT_tr 213
-#define GOT_tru 214
-#define GOT_ty 215
-#define GOT_typ 216
-#define GOT_type 217
-#define GOT_typed 218
-#define GOT_typede 219
-#define GOT_typeo 220
-#define GOT_typeof_ 222
-#define GOT_typeof_u 223
-#define GOT_typeof_un 224
-#define GOT_typeof_unq 225
-#define GOT_typeof_unqu 226
-#define GOT_typeof_unqua 227
-#define GOT_u 228
-#define GOT_un 229
-#define GOT_uni 230
-#define GOT_unio 231
-#define GOT_uns 232
-#define GOT_unsi 233
-#define GOT_unsig 234
-#define GOT_unsign 235
-#define GOT_unsigne 236
-#define GOT_v 237
-#define GOT_vo 238
-#define GOT_voi 239
-#define GOT_vol 240
-#define GOT_vola 241
-#define GOT_volat 242
-#define GOT_volati 243
-#define GOT_volatil 244
-#define GOT_w 245
-#define GOT_wh 246
-#define GOT_whi 247
-#define GOT_whil 248
+#define GOT_as 90
+#define GOT_au 91
+#define GOT_aut 92
+#define GOT_b 93
+#define GOT_bo 94
+#define GOT_boo 95
+#define GOT_br 96
+#define GOT_bre 97
+#define GOT_brea 98
+#define GOT_c 99
+#define GOT_ca 100
+#define GOT_cas 101
+#define GOT_ch 102
+#define GOT_cha 103
+#define GOT_co 104
+#define GOT_con 105
+#define GOT_cons 106
+#define GOT_conste 108
+#define GOT_constex 109
+#define GOT_constexp 110
+#define GOT_cont 111
+#define GOT_conti 112
+#define GOT_contin 113
+#define GOT_continu 114
+#define GOT_d 115
+#define GOT_de 116
+#define GOT_def 117
+#define GOT_defa 118
+#define GOT_defau 119
+#define GOT_defaul 120
+#define GOT_dou 122
+#define GOT_doub 123
+#define GOT_doubl 124
+#define GOT_e 125
+#define GOT_el 126
+#define GOT_els 127
+#define GOT_en 128
+#define GOT_enu 129
+#define GOT_ex 130
+#define GOT_ext 131
+#define GOT_exte 132
+#define GOT_exter 133
+#define GOT_f 134
+#define GOT_fa 135
+#define GOT_fal 136
+#define GOT_fals 137
+#define GOT_fl 138
+#define GOT_flo 139
+#define GOT_floa 140
+#define GOT_fo 141
+#define GOT_g 142
+#define GOT_go 143
+#define GOT_got 144
+#define GOT_i 145
+#define GOT_in 146
+#define GOT_inl 147
+#define GOT_inli 148
+#define GOT_inlin 149
+#define GOT_l 150
+#define GOT_lo 151
+#define GOT_lon 152
+#define GOT_n 153
+#define GOT_nu 154
+#define GOT_nul 155
+#define GOT_null 156
+#define GOT_nullp 157
+#define GOT_nullpt 158
+#define GOT_r 159
+#define GOT_re 160
+#define GOT_reg 161
+#define GOT_regi 162
+#define GOT_regis 163
+#define GOT_regist 164
+#define GOT_registe 165
+#define GOT_res 166
+#define GOT_rest 167
+#define GOT_restr 168
+#define GOT_restri 169
+#define GOT_restric 170
+#define GOT_ret 171
+#define GOT_retu 172
+#define GOT_retur 173
+#define GOT_s 174
+#define GOT_sh 175
+#define GOT_sho 176
+#define GOT_shor 177
+#define GOT_si 178
+#define GOT_sig 179
+#define GOT_sign 180
+#define GOT_signe 181
+#define GOT_siz 182
+#define GOT_size 183
+#define GOT_sizeo 184
+#define GOT_st 185
+#define GOT_sta 186
+#define GOT_stat 187
+#define GOT_stati 188
+#define GOT_static_ 190
+#define GOT_static_a 191
+#define GOT_static_as 192
+#define GOT_static_ass 193
+#define GOT_static_asse 194
+#define GOT_static_asser 195
+#define GOT_str 196
+#define GOT_stru 197
+#define GOT_struc 198
+#define GOT_sw 199
+#define GOT_swi 200
+#define GOT_swit 201
+#define GOT_switc 202
+#define GOT_t 203
+#define GOT_th 204
+#define GOT_thr 205
+#define GOT_thre 206
+#define GOT_threa 207
+#define GOT_thread 208
+#define GOT_thread_ 209
+#define GOT_thread_l 210
+#define GOT_thread_lo 211
+#define GOT_thread_loc 212
+#define GOT_thread_loca 213
+#define GOT_tr 214
+#define GOT_tru 215
+#define GOT_ty 216
+#define GOT_typ 217
+#define GOT_type 218
+#define GOT_typed 219
+#define GOT_typede 220
+#define GOT_typeo 221
+#define GOT_typeof_ 223
+#define GOT_typeof_u 224
+#define GOT_typeof_un 225
+#define GOT_typeof_unq 226
+#define GOT_typeof_unqu 227
+#define GOT_typeof_unqua 228
+#define GOT_u 229
+#define GOT_un 230
+#define GOT_uni 231
+#define GOT_unio 232
+#define GOT_uns 233
+#define GOT_unsi 234
+#define GOT_unsig 235
+#define GOT_unsign 236
+#define GOT_unsigne 237
+#define GOT_v 238
+#define GOT_vo 239
+#define GOT_voi 240
+#define GOT_vol 241
+#define GOT_vola 242
+#define GOT_volat 243
+#define GOT_volati 244
+#define GOT_volatil 245
+#define GOT_w 246
+#define GOT_wh 247
+#define GOT_whi 248
+#define GOT_whil 249
 
 #define GOT_0x 300
 #define GOT_INT_LITERAL 301
@@ -462,42 +1055,165 @@ is_simple_escape_sequence(char c) { // c is the char after the backslash
 #define GOT_ESCAPE_SEQUENCE_BS_U6 346
 #define GOT_ESCAPE_SEQUENCE_BS_U7 347
 
+#define GOT_HEADER_NAME_H 996
+#define GOT_HEADER_NAME_Q 997
+
+#define GOT_KW_IDENT 998
 #define GOT_IDENT 999
 
 #define THE_END 1000
 
-const std::uint32_t cols_per_htab = 1;
-const std::uint32_t rows_per_vtab = 1;
-const std::uint32_t rows_per_formfeed = 1;
+static_assert(THE_END + 1 == LexerStats::num_states,
+              "LexerStats::num_states must cover every state");
+
+// lexer_state_name(), generated from the states above by scripts/states.py.
+#include "States.inc"
+
+// Escape sequences are the only sub-machine entered with pushst(), and they
+// do not nest, so the state stack never holds more than one return state.
+const std::size_t max_state_depth = 1;
+
+Lexeme Lexer::make_lexeme(const std::string &lex, std::size_t start,
+                          Token token, std::uint32_t col) {
+  const std::string_view text(sr_->data() + start, sr_->offset() - start);
+  tally(++stats_->tokens[static_cast<std::size_t>(token)];
+       stats_->bytes[static_cast<std::size_t>(token)] +=
+       sr_->offset() - start);
+
+  if (sr_->splice_end() <= start && sr_->splices() == splices_) {
+    // lex is the Lexer's scratch buffer, so leave its capacity in place.
+    if (keep_lex_)
+      return copy_lexeme(lex, token, col, start);
+    if (flags_ & ZERO_COPY)
+      return Lexeme::borrow(text, token, row_, col, start);
+    return copy_lexeme(text, token, col, start);
+  }
 
-Lexeme Lexer::scan_token() {
-  std::string lex;
-  std::stack<int> states;
+  // A token spliced across lines is spelled without its splices, so it can
+  // only be a copy.
+  Lexeme l = keep_lex_ ? copy_lexeme(lex, token, col, start)
+             : arena_  ? copy_lexeme(unsplice(text), token, col, start)
+                       : Lexeme(unsplice(text), token, row_, col, start);
+  if (sr_->splices() != splices_)
+    sync_splices(0);
+  return l;
+}
+
+Lexeme Lexer::copy_lexeme(std::string_view text, Token token,
+                          std::uint32_t col, std::size_t start) {
+  if (arena_)
+    return Lexeme::borrow(arena_->copy(text), token, row_, col, start);
+  return Lexeme(std::string(text), token, row_, col, start);
+}
+
+bool Lexer::scan_comment(std::string *lex) {
+  const bool block = sr_->get() == '*';
+  if (lex)
+    lex->push_back(block ? '*' : '/');
+  col_ += 2;
+  if (sr_->splices() != splices_)
+    sync_splices(0);
+
+  for (;;) {
+    // Skip to the next character that could end the comment or that moves
+    // the position other than by one column.
+    const char *p = sr_->cur();
+    const std::size_t n = simd_->plain_run(p, sr_->limit());
+    if (lex)
+      lex->append(p, n);
+    sr_->skip(n);
+    col_ += n;
+
+    sr_->peek(); // refill an exhausted window, or step over a splice
+    if (sr_->splices() != splices_)
+      sync_splices(0);
+    if (sr_->cur() == sr_->limit())
+      return !block;
+
+    const char c = *sr_->cur();
+    if (c == '\n' && !block)
+      return true;
+
+    sr_->skip(1);
+    if (lex)
+      lex->push_back(c);
+
+    switch (c) {
+    case '\n':
+      ++row_;
+      col_ = 1;
+      break;
+    case '\v':
+      row_ += rows_per_vtab;
+      col_ = 1;
+      break;
+    case '\f':
+      row_ += rows_per_formfeed;
+      col_ = 1;
+      break;
+    case '\r':
+      break;
+    case '*':
+      ++col_;
+      if (block && sr_->peek() == '/' && sr_->cur() != sr_->limit()) {
+        if (sr_->splices() != splices_)
+          sync_splices(0);
+        sr_->skip(1);
+        if (lex)
+          lex->push_back('/');
+        ++col_;
+        return true;
+      }
+      break;
+    default: // the window was refilled
+      ++col_;
+      break;
+    }
+  }
+}
+
+template <typename Dialect, bool Positions>
+Lexeme Lexer::scan_dialect() {
+  std::string &lex = lex_;
+  const bool skip_comments = !(flags_ & KEEP_COMMENTS);
+  int states[max_state_depth] = {START};
+  std::size_t depth = 0;
   int st = START;
-  char c;
+  int c; // an unsigned char, or EOF
+  NumericValue num; // the INTEGER_LIT so far, with DECODE_NUMBERS
+  num.kind = NumericValue::INTEGER;
+  std::size_t c_end; // offset just past c, as get_blank() read it
   bool _hold = true;
 
-  states.push(st);
+  lex.clear();
 
   eat_whitespace();
 
-  if (c != EOF)
-    lex.push_back(c);
+  std::size_t start = c_end - (c != EOF);
+  keep(c);
 
   while (true) {
     if (_hold) {
       _hold = false;
     } else {
       c = sr_->eof() ? EOF : sr_->get();
-      if (c != EOF)
-        lex.push_back(c);
+      keep(c);
     }
+    tally(++stats_->states[st]);
 
     switch (st) {
     case THE_END:
       r(Token::END, 0);
 
     case START:
+      // 'L', 'u' and 'U' may prefix a string or character constant, so they
+      // stay with the DFA.
+      if ((flags_ & TABLE_KEYWORDS) && is_ident_start(c) && c != 'L' &&
+          c != 'u' && c != 'U') {
+        holdst(GOT_KW_IDENT);
+        break;
+      }
+
       switch (c) {
       case EOF:
         holdst(THE_END);
@@ -524,6 +1240,21 @@ Lexeme Lexer::scan_token() {
         r(Token::RSQUARE, 1);
       case ';':
         r(Token::SEMI, 1);
+      case '#':
+        if (sr_->peek() == '#') {
+          advance();
+          r(Token::HASH_HASH, 2);
+        } else {
+          r(Token::HASH, 1);
+        }
+      case '\n': { // eat_whitespace() leaves only the end of a directive
+        Lexeme l = make_lexeme(lex, start, Token::NEWLINE, col_);
+        if constexpr (Positions) {
+          ++row_;
+          col_ = 1;
+        }
+        return l;
+      }
       case '%':
         if (sr_->peek() == '=') {
           advance();
@@ -531,13 +1262,28 @@ Lexeme Lexer::scan_token() {
         } else {
           r(Token::MOD, 1);
         }
-      case '/':
-        if (sr_->peek() == '=') {
+      case '/': {
+        const int peek = sr_->peek();
+        if (peek == '=') {
           advance();
           r(Token::DIV_ASSIGN, 2);
+        } else if (is_comment_start(peek)) { // KEEP_COMMENTS
+          const std::uint32_t row = row_;
+          const std::uint32_t col = col_;
+          Token token = Token::COMMENT;
+          if (!scan_comment(keep_lex_ ? &lex : nullptr)) {
+            if (!(flags_ & OPEN_ENDED))
+              diagnose_at(UNTERMINATED_COMMENT, "Unterminated comment.", start,
+                          row, col);
+            token = Token::INVALID;
+          }
+          Lexeme l = make_lexeme(lex, start, token, col);
+          l.row_ = row;
+          return l;
         } else {
           r(Token::DIV, 1);
         }
+      }
       case '*':
         if (sr_->peek() == '=') {
           advance();
@@ -583,7 +1329,7 @@ Lexeme Lexer::scan_token() {
         }
       } break;
       case '|': {
-        const char peek = sr_->peek();
+        const int peek = sr_->peek();
         if (peek == '|') {
           advance();
           r(Token::LOG_OR, 2);
@@ -595,7 +1341,7 @@ Lexeme Lexer::scan_token() {
         }
       }
       case '&': {
-        const char peek = sr_->peek();
+        const int peek = sr_->peek();
         if (peek == '&') {
           advance();
           r(Token::LOG_AND, 2);
@@ -607,7 +1353,7 @@ Lexeme Lexer::scan_token() {
         }
       }
       case '+': {
-        const char peek = sr_->peek();
+        const int peek = sr_->peek();
         if (peek == '+') {
           advance();
           r(Token::INCR, 2);
@@ -619,7 +1365,7 @@ Lexeme Lexer::scan_token() {
         }
       }
       case '-': {
-        const char peek = sr_->peek();
+        const int peek = sr_->peek();
         if (peek == '-') {
           advance();
           r(Token::DECR, 2);
@@ -637,19 +1383,22 @@ Lexeme Lexer::scan_token() {
         nextst(GOT_GT);
         break;
       case '<':
-        nextst(GOT_LT);
+        nextst(line_ == HEADER_NEXT ? GOT_HEADER_NAME_H : GOT_LT);
         break;
       case '\'':
         nextst(GOT_CHAR_CONST_START);
         break;
       case '\"':
-        nextst(GOT_STRING_LIT_START);
+        nextst(line_ == HEADER_NEXT ? GOT_HEADER_NAME_Q
+                                    : GOT_STRING_LIT_START);
         break;
       case '0': {
-        const char peek = sr_->peek();
+        const int peek = sr_->peek();
         if (peek == 'x' || peek == 'X') {
+          num.radix = 16;
           advancest(GOT_0x);
         } else if (peek == 'b' || peek == 'B') {
+          num.radix = 2;
           advancest(GOT_BIN_CONST_START);
         } else {
           nextst(GOT_OCT_LITERAL);
@@ -666,7 +1415,7 @@ Lexeme Lexer::scan_token() {
       case '9':
         holdst(GOT_INT_LITERAL);
         break;
-      case 'a': // alignas alignof auto
+      case 'a': // alignas alignof asm auto
         nextst(GOT_a);
         break;
       case 'b': // bool break
@@ -722,19 +1471,43 @@ Lexeme Lexer::scan_token() {
         break;
       case '_': // _Alignas _Alignof _Atomic _BitInt _Bool _Complex
                 // _Decimal128 _Decimal32 _Decimal64 _Generic _Imaginary
-                // _Noreturn _Static_assert _Thread_local
+                // _Noreturn _Static_assert _Thread_local, and __ (GNU)
         nextst(GOT__);
         break;
       default:
         if (is_ident_start(c)) {
           holdst(GOT_IDENT);
         } else {
-          print_error(std::cerr, "Skipped invalid character ",
-                      static_cast<int>(c), ' ', std::isprint(c) ? c : ' ',
-                      '\n');
+          if (flags_ & RECOVER) {
+            // The run of stray characters that c begins is one error.
+            diagnose(INVALID_CHARACTER, "Skipped invalid characters.");
+            while (true) {
+              const std::size_t n =
+                  simd_->stray_run(sr_->cur(), sr_->limit());
+              sr_->skip(n);
+              col_ += n;
+              // Go on into the next window unless a splice divides them.
+              const std::uint32_t splices = sr_->splices();
+              if (sr_->cur() != sr_->limit() || sr_->peek() == EOF ||
+                  sr_->splices() != splices ||
+                  !simd::is_class(sr_->peek(), simd::STRAY))
+                break;
+            }
+          } else {
+            print_error(std::cerr, "Skipped invalid character ", c, ' ',
+                        std::isprint(c) ? static_cast<char>(c) : ' ', '\n');
+          }
           ++col_;
+          if (line_ == LINE_START) // a stray character is still a token
+            line_ = MID_LINE;
 
           eat_whitespace();
+
+          // The token starts over at c.
+          lex.clear();
+          start = c_end - (c != EOF);
+          keep(c);
+
           holdst(START);
         }
       } // switch (c) for START
@@ -774,12 +1547,41 @@ Lexeme Lexer::scan_token() {
       } // switch (c) for GOT_LT
       break;
 
+    case GOT_KW_IDENT: {
+      // c starts an identifier. Eat all of it, continuing into the next
+      // window of a reader that refills, and then classify it at once.
+      do {
+        keep_run(simd_->ident_run(sr_->cur(), sr_->limit()));
+      } while (sr_->cur() == sr_->limit() && is_ident_cont(sr_->peek()));
+
+      const std::size_t n = lexlen();
+      if (keep_lex_)
+        r(Dialect::find_keyword(lex.data(), lex.size()), n);
+      if (sr_->splices() != splices_) {
+        const std::string word = unsplice({sr_->data() + start, n});
+        r(Dialect::find_keyword(word.data(), word.size()), n);
+      }
+      r(Dialect::find_keyword(sr_->data() + start, n), n);
+    }
+
+    case GOT_HEADER_NAME_H: // <h-char-sequence>
+    case GOT_HEADER_NAME_Q: // "q-char-sequence"
+      if (c == (st == GOT_HEADER_NAME_H ? '>' : '"'))
+        r(Token::HEADER_NAME, lexlen());
+      if (c == '\n' || c == EOF) {
+        diagnose(UNTERMINATED_LITERAL, "Unterminated header name.");
+        backup(c);
+        rinvalid();
+      }
+      break;
+
     case GOT_IDENT:
       if (is_ident_cont(c)) {
-        // Eat c and remain in this state.
+        // Eat c and the rest of the run, and remain in this state.
+        keep_run(simd_->ident_run(sr_->cur(), sr_->limit()));
       } else {
         backup(c);
-        r(Token::IDENTIFIER, lex.length());
+        r(Token::IDENTIFIER, lexlen());
       }
       break;
 
@@ -812,6 +1614,13 @@ Lexeme Lexer::scan_token() {
       case 'T':
         nextst(GOT__T);
         break;
+      case '_':
+        // The GNU spellings that begin with "__" are looked up whole.
+        if constexpr (Dialect::gnu)
+          holdst(GOT_KW_IDENT);
+        else
+          holdst(GOT_IDENT);
+        break;
       default:
         holdst(GOT_IDENT);
         break;
@@ -885,7 +1694,7 @@ Lexeme Lexer::scan_token() {
         if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::_ALIGNAS, 8);
+          rkeyword(Token::_ALIGNAS, 8);
         }
         break;
       default:
@@ -900,7 +1709,7 @@ Lexeme Lexer::scan_token() {
         if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::_ALIGNOF, 8);
+          rkeyword(Token::_ALIGNOF, 8);
         }
         break;
       default:
@@ -948,7 +1757,7 @@ Lexeme Lexer::scan_token() {
         if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::_ATOMIC, 7);
+          rkeyword(Token::_ATOMIC, 7);
         }
         break;
       default:
@@ -1010,7 +1819,7 @@ Lexeme Lexer::scan_token() {
         if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::_BITINT, 7);
+          rkeyword(Token::_BITINT, 7);
         }
         break;
       default:
@@ -1036,7 +1845,7 @@ Lexeme Lexer::scan_token() {
         if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::_BOOL, 5);
+          rkeyword(Token::_BOOL, 5);
         }
         break;
       default:
@@ -1106,7 +1915,7 @@ Lexeme Lexer::scan_token() {
         if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::_COMPLEX, 8);
+          rkeyword(Token::_COMPLEX, 8);
         }
         break;
       default:
@@ -1215,7 +2024,7 @@ Lexeme Lexer::scan_token() {
         if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::_DECIMAL128, 11);
+          rkeyword(Token::_DECIMAL128, 11);
         }
         break;
       default:
@@ -1230,7 +2039,7 @@ Lexeme Lexer::scan_token() {
         if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::_DECIMAL32, 10);
+          rkeyword(Token::_DECIMAL32, 10);
         }
         break;
       default:
@@ -1245,7 +2054,7 @@ Lexeme Lexer::scan_token() {
         if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::_DECIMAL64, 10);
+          rkeyword(Token::_DECIMAL64, 10);
         }
         break;
       default:
@@ -1315,7 +2124,7 @@ Lexeme Lexer::scan_token() {
         if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::_GENERIC, 8);
+          rkeyword(Token::_GENERIC, 8);
         }
         break;
       default:
@@ -1407,7 +2216,7 @@ Lexeme Lexer::scan_token() {
         if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::_IMAGINARY, 10);
+          rkeyword(Token::_IMAGINARY, 10);
         }
         break;
       default:
@@ -1488,7 +2297,7 @@ Lexeme Lexer::scan_token() {
         if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::_NORETURN, 9);
+          rkeyword(Token::_NORETURN, 9);
         }
         break;
       default:
@@ -1624,7 +2433,7 @@ Lexeme Lexer::scan_token() {
         if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::_STATIC_ASSERT, 14);
+          rkeyword(Token::_STATIC_ASSERT, 14);
         }
         break;
       default:
@@ -1749,7 +2558,7 @@ Lexeme Lexer::scan_token() {
         if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::_THREAD_LOCAL, 13);
+          rkeyword(Token::_THREAD_LOCAL, 13);
         }
         break;
       default:
@@ -1763,6 +2572,9 @@ Lexeme Lexer::scan_token() {
       case 'l':
         nextst(GOT_al);
         break;
+      case 's':
+        nextst(GOT_as);
+        break;
       case 'u':
         nextst(GOT_au);
         break;
@@ -1772,6 +2584,21 @@ Lexeme Lexer::scan_token() {
       } // switch (c) for GOT_a
       break;
 
+    case GOT_as:
+      switch (c) {
+      case 'm':
+        if (is_ident_cont(sr_->peek())) {
+          nextst(GOT_IDENT);
+        } else {
+          rkeyword(Token::ASM, 3);
+        }
+        break;
+      default:
+        holdst(GOT_IDENT);
+        break;
+      } // switch (c) for GOT_as
+      break;
+
     case GOT_al:
       switch (c) {
       case 'i':
@@ -1825,7 +2652,7 @@ Lexeme Lexer::scan_token() {
         if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::ALIGNAS, 7);
+          rkeyword(Token::ALIGNAS, 7);
         }
         break;
       default:
@@ -1840,7 +2667,7 @@ Lexeme Lexer::scan_token() {
         if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::ALIGNOF, 7);
+          rkeyword(Token::ALIGNOF, 7);
         }
         break;
       default:
@@ -1866,7 +2693,7 @@ Lexeme Lexer::scan_token() {
         if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::AUTO, 4);
+          rkeyword(Token::AUTO, 4);
         }
         break;
       default:
@@ -1906,7 +2733,7 @@ Lexeme Lexer::scan_token() {
         if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::BOOL, 4);
+          rkeyword(Token::BOOL, 4);
         }
         break;
       default:
@@ -1943,7 +2770,7 @@ Lexeme Lexer::scan_token() {
         if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::BREAK, 5);
+          rkeyword(Token::BREAK, 5);
         }
         break;
       default:
@@ -1986,7 +2813,7 @@ Lexeme Lexer::scan_token() {
         if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::CASE, 4);
+          rkeyword(Token::CASE, 4);
         }
         break;
       default:
@@ -2012,7 +2839,7 @@ Lexeme Lexer::scan_token() {
         if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::CHAR, 4);
+          rkeyword(Token::CHAR, 4);
         }
         break;
       default:
@@ -2054,7 +2881,7 @@ Lexeme Lexer::scan_token() {
         } else if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::CONST, 5);
+          rkeyword(Token::CONST, 5);
         }
         break;
       default:
@@ -2091,7 +2918,7 @@ Lexeme Lexer::scan_token() {
         if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::CONSTEXPR, 9);
+          rkeyword(Token::CONSTEXPR, 9);
         }
         break;
       default:
@@ -2139,7 +2966,7 @@ Lexeme Lexer::scan_token() {
         if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::CONTINUE, 8);
+          rkeyword(Token::CONTINUE, 8);
         }
         break;
       default:
@@ -2159,7 +2986,7 @@ Lexeme Lexer::scan_token() {
         } else if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::DO, 2);
+          rkeyword(Token::DO, 2);
         }
         break;
       default:
@@ -2218,7 +3045,7 @@ Lexeme Lexer::scan_token() {
         if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::DEFAULT, 7);
+          rkeyword(Token::DEFAULT, 7);
         }
         break;
       default:
@@ -2255,7 +3082,7 @@ Lexeme Lexer::scan_token() {
         if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::DOUBLE, 6);
+          rkeyword(Token::DOUBLE, 6);
         }
         break;
       default:
@@ -2298,7 +3125,7 @@ Lexeme Lexer::scan_token() {
         if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::ELSE, 4);
+          rkeyword(Token::ELSE, 4);
         }
         break;
       default:
@@ -2324,7 +3151,7 @@ Lexeme Lexer::scan_token() {
         if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::ENUM, 4);
+          rkeyword(Token::ENUM, 4);
         }
         break;
       default:
@@ -2372,7 +3199,7 @@ Lexeme Lexer::scan_token() {
         if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::EXTERN, 6);
+          rkeyword(Token::EXTERN, 6);
         }
         break;
       default:
@@ -2426,7 +3253,7 @@ Lexeme Lexer::scan_token() {
         if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::FALSE, 5);
+          rkeyword(Token::FALSE, 5);
         }
         break;
       default:
@@ -2463,7 +3290,7 @@ Lexeme Lexer::scan_token() {
         if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::FLOAT, 5);
+          rkeyword(Token::FLOAT, 5);
         }
         break;
       default:
@@ -2478,7 +3305,7 @@ Lexeme Lexer::scan_token() {
         if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::FOR, 3);
+          rkeyword(Token::FOR, 3);
         }
         break;
       default:
@@ -2515,7 +3342,7 @@ Lexeme Lexer::scan_token() {
         if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::GOTO, 4);
+          rkeyword(Token::GOTO, 4);
         }
         break;
       default:
@@ -2530,7 +3357,7 @@ Lexeme Lexer::scan_token() {
         if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::IF, 2);
+          rkeyword(Token::IF, 2);
         }
         break;
       case 'n':
@@ -2551,7 +3378,7 @@ Lexeme Lexer::scan_token() {
         if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::INT, 3);
+          rkeyword(Token::INT, 3);
         }
         break;
       default:
@@ -2588,7 +3415,7 @@ Lexeme Lexer::scan_token() {
         if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::INLINE, 6);
+          rkeyword(Token::INLINE, 6);
         }
         break;
       default:
@@ -2625,7 +3452,7 @@ Lexeme Lexer::scan_token() {
         if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::LONG, 4);
+          rkeyword(Token::LONG, 4);
         }
         break;
       default:
@@ -2695,7 +3522,7 @@ Lexeme Lexer::scan_token() {
         if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::NULLPTR, 7);
+          rkeyword(Token::NULLPTR, 7);
         }
         break;
       default:
@@ -2782,7 +3609,7 @@ Lexeme Lexer::scan_token() {
         if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::REGISTER, 8);
+          rkeyword(Token::REGISTER, 8);
         }
         break;
       default:
@@ -2841,7 +3668,7 @@ Lexeme Lexer::scan_token() {
         if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::RESTRICT, 8);
+          rkeyword(Token::RESTRICT, 8);
         }
         break;
       default:
@@ -2878,7 +3705,7 @@ Lexeme Lexer::scan_token() {
         if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::RETURN, 6);
+          rkeyword(Token::RETURN, 6);
         }
         break;
       default:
@@ -2935,7 +3762,7 @@ Lexeme Lexer::scan_token() {
         if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::SHORT, 5);
+          rkeyword(Token::SHORT, 5);
         }
         break;
       default:
@@ -2986,7 +3813,7 @@ Lexeme Lexer::scan_token() {
         if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::SIGNED, 6);
+          rkeyword(Token::SIGNED, 6);
         }
         break;
       default:
@@ -3023,7 +3850,7 @@ Lexeme Lexer::scan_token() {
         if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::SIZEOF, 6);
+          rkeyword(Token::SIZEOF, 6);
         }
         break;
       default:
@@ -3076,7 +3903,7 @@ Lexeme Lexer::scan_token() {
         } else if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::STATIC, 6);
+          rkeyword(Token::STATIC, 6);
         }
         break;
       default:
@@ -3146,7 +3973,7 @@ Lexeme Lexer::scan_token() {
         if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::STATIC_ASSERT, 13);
+          rkeyword(Token::STATIC_ASSERT, 13);
         }
         break;
       default:
@@ -3183,7 +4010,7 @@ Lexeme Lexer::scan_token() {
         if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::STRUCT, 6);
+          rkeyword(Token::STRUCT, 6);
         }
         break;
       default:
@@ -3231,7 +4058,7 @@ Lexeme Lexer::scan_token() {
         if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::SWITCH, 6);
+          rkeyword(Token::SWITCH, 6);
         }
         break;
       default:
@@ -3362,7 +4189,7 @@ Lexeme Lexer::scan_token() {
         if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::THREAD_LOCAL, 12);
+          rkeyword(Token::THREAD_LOCAL, 12);
         }
         break;
       default:
@@ -3388,7 +4215,7 @@ Lexeme Lexer::scan_token() {
         if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::TRUE, 4);
+          rkeyword(Token::TRUE, 4);
         }
         break;
       default:
@@ -3450,7 +4277,7 @@ Lexeme Lexer::scan_token() {
         if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::TYPEDEF, 7);
+          rkeyword(Token::TYPEDEF, 7);
         }
         break;
       default:
@@ -3467,7 +4294,7 @@ Lexeme Lexer::scan_token() {
         } else if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::TYPEOF, 6);
+          rkeyword(Token::TYPEOF, 6);
         }
         break;
       default:
@@ -3537,7 +4364,7 @@ Lexeme Lexer::scan_token() {
         if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::TYPEOF_UNQUAL, 13);
+          rkeyword(Token::TYPEOF_UNQUAL, 13);
         }
         break;
       default:
@@ -3632,7 +4459,7 @@ Lexeme Lexer::scan_token() {
         if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::UNION, 5);
+          rkeyword(Token::UNION, 5);
         }
         break;
       default:
@@ -3691,7 +4518,7 @@ Lexeme Lexer::scan_token() {
         if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::UNSIGNED, 8);
+          rkeyword(Token::UNSIGNED, 8);
         }
         break;
       default:
@@ -3731,7 +4558,7 @@ Lexeme Lexer::scan_token() {
         if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::VOID, 4);
+          rkeyword(Token::VOID, 4);
         }
         break;
       default:
@@ -3790,7 +4617,7 @@ Lexeme Lexer::scan_token() {
         if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::VOLATILE, 8);
+          rkeyword(Token::VOLATILE, 8);
         }
         break;
       default:
@@ -3838,7 +4665,7 @@ Lexeme Lexer::scan_token() {
         if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::WHILE, 5);
+          rkeyword(Token::WHILE, 5);
         }
         break;
       default:
@@ -3849,9 +4676,20 @@ Lexeme Lexer::scan_token() {
 
     case GOT_INT_LITERAL: {
       const int isdig = std::isdigit(c);
-      const char peek = sr_->peek();
+      const int peek = sr_->peek();
+      if (isdig)
+        num_digit(c - '0');
       if (isdig && std::isdigit(peek)) {
-        // Eat c and remain in this state.
+        // Eat c and all but the last digit of the run that follows, which
+        // must be examined along with the character after it. Remain in this
+        // state.
+        const std::size_t n = simd_->digit_run(sr_->cur(), sr_->limit());
+        if (n > 1) {
+          if (flags_ & DECODE_NUMBERS)
+            for (const char *p = sr_->cur(); p < sr_->cur() + n - 1; ++p)
+              num_digit(*p - '0');
+          keep_run(n - 1);
+        }
       } else if (isdig) {
         if (is_int_suffix_start(peek)) {
           nextst(GOT_INT_SUFFIX_START);
@@ -3863,7 +4701,7 @@ Lexeme Lexer::scan_token() {
           // Eat peek and remain in this state.
           advance();
         } else {
-          r(Token::INTEGER_LIT, lex.length());
+          rinteger();
         }
       } else if (is_int_suffix_start(c)) {
         holdst(GOT_INT_SUFFIX_START);
@@ -3875,13 +4713,17 @@ Lexeme Lexer::scan_token() {
         // Eat c and remain in this state.
       } else {
         backup(c);
-        r(Token::INTEGER_LIT, lex.length());
+        rinteger();
       }
     } break;
 
     case GOT_OCT_LITERAL: {
       const int isoct = c >= '0' && c <= '7';
-      const char peek = sr_->peek();
+      const int peek = sr_->peek();
+      if (isoct || c == '\'' || is_int_suffix_start(c))
+        num.radix = 8; // a lone 0 stays decimal
+      if (isoct)
+        num_digit(c - '0');
       if (c == '\'' || (isoct && (peek >= '0' && peek <= '7'))) {
         // Eat c and remain in this state.
       } else if (isoct) {
@@ -3896,7 +4738,7 @@ Lexeme Lexer::scan_token() {
         } else if (std::isdigit(peek)) {
           nextst(GOT_INT_LITERAL);
         } else {
-          r(Token::INTEGER_LIT, lex.length());
+          rinteger();
         }
       } else if (is_int_suffix_start(c)) {
         holdst(GOT_INT_SUFFIX_START);
@@ -3906,7 +4748,7 @@ Lexeme Lexer::scan_token() {
         nextst(GOT_FLOAT_CONST_DOT);
       } else {
         backup(c);
-        r(Token::INTEGER_LIT, lex.length());
+        rinteger();
       }
     } break;
 
@@ -3916,11 +4758,10 @@ Lexeme Lexer::scan_token() {
       } else if (c == '.') {
         nextst(GOT_0x_DOT);
       } else {
-        print_error(
-            std::cerr,
-            "Hexadecimal prefix must be followed by a hexadecimal digit.\n");
+        diagnose(BAD_NUMBER,
+                 "Hexadecimal prefix must be followed by a hexadecimal digit.");
         backup(c);
-        rinvalid();
+        rbad_number();
       }
       break;
 
@@ -3928,15 +4769,17 @@ Lexeme Lexer::scan_token() {
       if (std::isxdigit(c)) {
         nextst(GOT_HEX_CONST_DOT_XDIGIT);
       } else {
-        print_error(std::cerr, "Missing digits in hexadecimal constant.\n");
+        diagnose(BAD_NUMBER, "Missing digits in hexadecimal constant.");
         backup(c);
-        rinvalid();
+        rbad_number();
       }
       break;
 
     case GOT_HEX_LITERAL: {
       const int isxdig = std::isxdigit(c);
-      const char peek = sr_->peek();
+      const int peek = sr_->peek();
+      if (isxdig)
+        num_digit(xdigit_value(c));
       if (isxdig && std::isxdigit(peek)) {
         // Eat c and remain in this state.
       } else if (isxdig) {
@@ -3949,7 +4792,7 @@ Lexeme Lexer::scan_token() {
         } else if (peek == '\'') {
           advance();
         } else {
-          r(Token::INTEGER_LIT, lex.length());
+          rinteger();
         }
       } else if (is_int_suffix_start(c)) {
         holdst(GOT_INT_SUFFIX_START);
@@ -3961,7 +4804,7 @@ Lexeme Lexer::scan_token() {
         // Eat c and remain in this state.
       } else {
         backup(c);
-        r(Token::INTEGER_LIT, lex.length());
+        rinteger();
       }
     } break;
 
@@ -3970,10 +4813,11 @@ Lexeme Lexer::scan_token() {
       // and a '\''
       switch (c) {
       case '\'':
-        print_error(std::cerr, "Character constant cannot be empty.\n");
+        diagnose(EMPTY_CHARACTER, "Character constant cannot be empty.");
         rinvalid();
       case '\n':
-        print_error(std::cerr, "Unterminated character constant detected.\n");
+        diagnose(UNTERMINATED_LITERAL,
+                 "Unterminated character constant detected.");
         backup(c);
         rinvalid();
       case '\\':
@@ -3989,10 +4833,11 @@ Lexeme Lexer::scan_token() {
     case GOT_CHAR_CONST_CONT:
       switch (c) {
       case '\'':
-        r(Token::INTEGER_LIT, lex.length());
+        r(Token::INTEGER_LIT, lexlen());
       case EOF:
       case '\n':
-        print_error(std::cerr, "Unterminated character constant detected.\n");
+        diagnose(UNTERMINATED_LITERAL,
+                 "Unterminated character constant detected.");
         backup(c);
         rinvalid();
       case '\\':
@@ -4012,11 +4857,11 @@ Lexeme Lexer::scan_token() {
         nextst(GOT_FLOAT_CONST_DOT_DIGIT);
       } else if (c == 'e' || c == 'E') {
         nextst(GOT_FLOAT_CONST_e);
-      } else if (std::strchr(suffix, c)) {
+      } else if (c && std::strchr(suffix, c)) {
         holdst(GOT_FLOAT_CONST_e_SIGN_DIG);
       } else {
         backup(c);
-        r(Token::FLOAT_LIT, lex.length());
+        r(Token::FLOAT_LIT, lexlen());
       }
     } break;
 
@@ -4040,7 +4885,7 @@ Lexeme Lexer::scan_token() {
           // Eat c and remain in this state.
         } else {
           backup(c);
-          r(Token::FLOAT_LIT, lex.length());
+          r(Token::FLOAT_LIT, lexlen());
         }
         break;
       } // switch (c) for GOT_FLOAT_CONST_DOT_DIGIT
@@ -4056,10 +4901,10 @@ Lexeme Lexer::scan_token() {
         if (std::isdigit(c)) {
           nextst(GOT_FLOAT_CONST_e_SIGN_DIG);
         } else {
-          print_error(std::cerr,
-                      "Floating point constant missing exponent digit(s).\n");
+          diagnose(BAD_NUMBER,
+                   "Floating point constant missing exponent digit(s).");
           backup(c);
-          rinvalid();
+          rbad_number();
         }
         break;
       } // switch (c) for GOT_FLOAT_CONST_e
@@ -4069,10 +4914,10 @@ Lexeme Lexer::scan_token() {
       if (std::isdigit(c)) {
         nextst(GOT_FLOAT_CONST_e_SIGN_DIG);
       } else {
-        print_error(std::cerr,
-                    "Floating point constant missing exponent digit(s).\n");
+        diagnose(BAD_NUMBER,
+                 "Floating point constant missing exponent digit(s).");
         backup(c);
-        rinvalid();
+        rbad_number();
       }
       break;
 
@@ -4083,7 +4928,7 @@ Lexeme Lexer::scan_token() {
       case 'F':
       case 'l':
       case 'L':
-        r(Token::FLOAT_LIT, lex.length());
+        r(Token::FLOAT_LIT, lexlen());
       case 'd':
         nextst(GOT_FLOAT_CONST_e_SUFd);
         break;
@@ -4097,7 +4942,7 @@ Lexeme Lexer::scan_token() {
           // Eat c and remain in this state.
         } else {
           backup(c);
-          r(Token::FLOAT_LIT, lex.length());
+          r(Token::FLOAT_LIT, lexlen());
         }
         break;
       } // switch (c) for GOT_FLOAT_CONST_e
@@ -4108,13 +4953,13 @@ Lexeme Lexer::scan_token() {
       case 'f':
       case 'd':
       case 'l':
-        r(Token::FLOAT_LIT, lex.length());
+        r(Token::FLOAT_LIT, lexlen());
         break;
       default:
-        print_error(std::cerr,
-                    "Valid floating point constant suffixes are {df dd dl}.\n");
+        diagnose(BAD_SUFFIX,
+                 "Valid floating point constant suffixes are {df dd dl}.");
         backup(c);
-        rinvalid();
+        rbad_number();
         break;
       } // switch (c) for GOT_FLOAT_CONST_e_SUFd
       break;
@@ -4124,13 +4969,13 @@ Lexeme Lexer::scan_token() {
       case 'F':
       case 'D':
       case 'L':
-        r(Token::FLOAT_LIT, lex.length());
+        r(Token::FLOAT_LIT, lexlen());
         break;
       default:
-        print_error(std::cerr,
-                    "Valid floating point constant suffixes are {DF DD DL}.\n");
+        diagnose(BAD_SUFFIX,
+                 "Valid floating point constant suffixes are {DF DD DL}.");
         backup(c);
-        rinvalid();
+        rbad_number();
         break;
       } // switch (c) for GOT_FLOAT_CONST_e_SUFD
       break;
@@ -4143,11 +4988,10 @@ Lexeme Lexer::scan_token() {
       } else if (c == 'p' || c == 'P') {
         nextst(GOT_HEX_CONST_p);
       } else {
-        print_error(
-            std::cerr,
-            "Hexadecimal floating-point constant missing exponent field.\n");
+        diagnose(BAD_NUMBER,
+                 "Hexadecimal floating-point constant missing exponent field.");
         backup(c);
-        rinvalid();
+        rbad_number();
       }
     } break;
 
@@ -4164,11 +5008,11 @@ Lexeme Lexer::scan_token() {
         if (std::isxdigit(c)) {
           // Eat c and remain in this state.
         } else {
-          print_error(
-              std::cerr,
-              "Hexadecimal floating-point constant missing exponent field.\n");
+          diagnose(
+              BAD_NUMBER,
+              "Hexadecimal floating-point constant missing exponent field.");
           backup(c);
-          rinvalid();
+          rbad_number();
         }
         break;
       } // switch (c) for GOT_HEX_CONST_DOT_XDIGIT
@@ -4184,10 +5028,10 @@ Lexeme Lexer::scan_token() {
         if (std::isdigit(c)) {
           nextst(GOT_HEX_CONST_p_SIGN_DIG);
         } else {
-          print_error(std::cerr,
-                      "Floating point constant missing exponent digit(s).\n");
+          diagnose(BAD_NUMBER,
+                   "Floating point constant missing exponent digit(s).");
           backup(c);
-          rinvalid();
+          rbad_number();
         }
         break;
       } // switch (c) for GOT_HEX_CONST_p
@@ -4200,13 +5044,13 @@ Lexeme Lexer::scan_token() {
       case 'F':
       case 'l':
       case 'L':
-        r(Token::FLOAT_LIT, lex.length());
+        r(Token::FLOAT_LIT, lexlen());
       default:
         if (std::isdigit(c)) {
           // Eat c and remain in this state.
         } else {
           backup(c);
-          r(Token::FLOAT_LIT, lex.length());
+          r(Token::FLOAT_LIT, lexlen());
         }
         break;
       } // switch (c) for GOT_FLOAT_CONST_e
@@ -4216,10 +5060,10 @@ Lexeme Lexer::scan_token() {
       if (std::isdigit(c)) {
         nextst(GOT_HEX_CONST_p_SIGN_DIG);
       } else {
-        print_error(std::cerr,
-                    "Floating point constant missing exponent digit(s).\n");
+        diagnose(BAD_NUMBER,
+                 "Floating point constant missing exponent digit(s).");
         backup(c);
-        rinvalid();
+        rbad_number();
       }
       break;
 
@@ -4227,12 +5071,13 @@ Lexeme Lexer::scan_token() {
       switch (c) {
       case '0':
       case '1':
+        num_digit(c - '0');
         nextst(GOT_BIN_CONST_CONT);
         break;
       default:
-        print_error(std::cerr, "Binary constant must begin with a 0 or 1.\n");
+        diagnose(BAD_NUMBER, "Binary constant must begin with a 0 or 1.");
         backup(c);
-        rinvalid();
+        rbad_number();
         break;
       } // switch (c) for GOT_BIN_CONST
       break;
@@ -4242,24 +5087,30 @@ Lexeme Lexer::scan_token() {
         holdst(GOT_INT_SUFFIX_START);
       } else if (c == '0' || c == '1' || c == '\'') {
         // Eat c and remain in this state.
+        if (c != '\'')
+          num_digit(c - '0');
       } else {
         backup(c);
-        r(Token::INTEGER_LIT, lex.length());
+        rinteger();
       }
       break;
 
     case GOT_INT_SUFFIX_START:
       switch (c) {
       case 'u':
+        num_suffix(NumericValue::SUFFIX_U);
         nextst(GOT_INT_SUFFIX_u);
         break;
       case 'U':
+        num_suffix(NumericValue::SUFFIX_U);
         nextst(GOT_INT_SUFFIX_U);
         break;
       case 'l':
+        num_suffix(NumericValue::SUFFIX_L);
         nextst(GOT_INT_SUFFIX_l);
         break;
       case 'L':
+        num_suffix(NumericValue::SUFFIX_L);
         nextst(GOT_INT_SUFFIX_L);
         break;
       case 'w':
@@ -4275,71 +5126,102 @@ Lexeme Lexer::scan_token() {
       const int peek = sr_->peek();
       switch (c) {
       case 'l':
+        num_suffix(peek == 'l' ? NumericValue::SUFFIX_LL
+                               : NumericValue::SUFFIX_L);
         if (peek == 'l')
           advance();
-        r(Token::INTEGER_LIT, lex.length());
+        rinteger();
       case 'L':
+        num_suffix(peek == 'L' ? NumericValue::SUFFIX_LL
+                               : NumericValue::SUFFIX_L);
         if (peek == 'L')
           advance();
-        r(Token::INTEGER_LIT, lex.length());
+        rinteger();
       case 'w':
         if (peek == 'b') {
+          num_suffix(NumericValue::SUFFIX_WB);
           advance();
-          r(Token::INTEGER_LIT, lex.length());
+          rinteger();
         }
         break;
       case 'W':
         if (peek == 'B') {
+          num_suffix(NumericValue::SUFFIX_WB);
           advance();
-          r(Token::INTEGER_LIT, lex.length());
+          rinteger();
+        }
+        break;
+      default:
+        // The suffix ends here unless an identifier runs on from it.
+        if (!is_ident_cont(c)) {
+          backup(c);
+          rinteger();
         }
         break;
       } // switch (c) for GOT_INT_SUFFIX_u
-      print_error(std::cerr, "Invalid integer suffix after u.\n");
-      rinvalid();
+      diagnose(BAD_SUFFIX, "Invalid integer suffix after u.");
+      rbad_number();
     } break;
 
     case GOT_INT_SUFFIX_U: { // Ul Ull UL ULL Uwb UWB
       const int peek = sr_->peek();
       switch (c) {
       case 'l':
+        num_suffix(peek == 'l' ? NumericValue::SUFFIX_LL
+                               : NumericValue::SUFFIX_L);
         if (peek == 'l')
           advance();
-        r(Token::INTEGER_LIT, lex.length());
+        rinteger();
       case 'L':
+        num_suffix(peek == 'L' ? NumericValue::SUFFIX_LL
+                               : NumericValue::SUFFIX_L);
         if (peek == 'L')
           advance();
-        r(Token::INTEGER_LIT, lex.length());
+        rinteger();
       case 'w':
         if (peek == 'b') {
+          num_suffix(NumericValue::SUFFIX_WB);
           advance();
-          r(Token::INTEGER_LIT, lex.length());
+          rinteger();
         }
         break;
       case 'W':
         if (peek == 'B') {
+          num_suffix(NumericValue::SUFFIX_WB);
           advance();
-          r(Token::INTEGER_LIT, lex.length());
+          rinteger();
+        }
+        break;
+      default:
+        // The suffix ends here unless an identifier runs on from it.
+        if (!is_ident_cont(c)) {
+          backup(c);
+          rinteger();
         }
         break;
       } // switch (c) for GOT_INT_SUFFIX_U
-      print_error(std::cerr, "Invalid integer suffix after U.\n");
-      rinvalid();
+      diagnose(BAD_SUFFIX, "Invalid integer suffix after U.");
+      rbad_number();
     } break;
 
     case GOT_INT_SUFFIX_l: { // l lu lU ll llu llU
       const int peek = sr_->peek();
       switch (c) {
       case 'l':
-        if (peek == 'u' || peek == 'U')
+        num.suffix = (num.suffix & NumericValue::SUFFIX_U) |
+                     NumericValue::SUFFIX_LL;
+        if (peek == 'u' || peek == 'U') {
+          num_suffix(NumericValue::SUFFIX_U);
           advance();
-        r(Token::INTEGER_LIT, lex.length());
+        }
+        rinteger();
       case 'u':
       case 'U':
-        r(Token::INTEGER_LIT, lex.length());
+        num_suffix(NumericValue::SUFFIX_U);
+        rinteger();
       default:
         backup(c);
-        r(Token::INTEGER_LIT, lex.length());
+        rinteger();
       } // switch (c) for GOT_INT_SUFFIX_l
     } break;
 
@@ -4347,15 +5229,20 @@ Lexeme Lexer::scan_token() {
       const int peek = sr_->peek();
       switch (c) {
       case 'L':
-        if (peek == 'u' || peek == 'U')
+        num.suffix = (num.suffix & NumericValue::SUFFIX_U) |
+                     NumericValue::SUFFIX_LL;
+        if (peek == 'u' || peek == 'U') {
+          num_suffix(NumericValue::SUFFIX_U);
           advance();
-        r(Token::INTEGER_LIT, lex.length());
+        }
+        rinteger();
       case 'u':
       case 'U':
-        r(Token::INTEGER_LIT, lex.length());
+        num_suffix(NumericValue::SUFFIX_U);
+        rinteger();
       default:
         backup(c);
-        r(Token::INTEGER_LIT, lex.length());
+        rinteger();
       } // switch (c) for GOT_INT_SUFFIX_L
     } break;
 
@@ -4363,12 +5250,17 @@ Lexeme Lexer::scan_token() {
       const int peek = sr_->peek();
       switch (c) {
       case 'b':
-        if (peek == 'u' || peek == 'U')
+        num_suffix(NumericValue::SUFFIX_WB);
+        if (peek == 'u' || peek == 'U') {
+          num_suffix(NumericValue::SUFFIX_U);
           advance();
-        r(Token::INTEGER_LIT, lex.length());
+        }
+        rinteger();
       default:
-        print_error(std::cerr, "Invalid integer suffix after w.\n");
-        rinvalid();
+        diagnose(BAD_SUFFIX, "Invalid integer suffix after w.");
+        if (!is_ident_cont(c))
+          backup(c);
+        rbad_number();
       } // switch (c) for GOT_INT_SUFFIX_w
     } break;
 
@@ -4376,22 +5268,27 @@ Lexeme Lexer::scan_token() {
       const int peek = sr_->peek();
       switch (c) {
       case 'B':
-        if (peek == 'u' || peek == 'U')
+        num_suffix(NumericValue::SUFFIX_WB);
+        if (peek == 'u' || peek == 'U') {
+          num_suffix(NumericValue::SUFFIX_U);
           advance();
-        r(Token::INTEGER_LIT, lex.length());
+        }
+        rinteger();
       default:
-        print_error(std::cerr, "Invalid integer suffix after W.\n");
-        rinvalid();
+        diagnose(BAD_SUFFIX, "Invalid integer suffix after W.");
+        if (!is_ident_cont(c))
+          backup(c);
+        rbad_number();
       } // switch (c) for GOT_INT_SUFFIX_W
     } break;
 
     case GOT_STRING_LIT_START: // so far we have {encoding-prefix}?["]
       switch (c) {
       case '\"':
-        r(Token::STRING_LIT, lex.length());
+        r(Token::STRING_LIT, lexlen());
       case EOF:
       case '\n':
-        print_error(std::cerr, "Unterminated string literal detected.\n");
+        diagnose(UNTERMINATED_LITERAL, "Unterminated string literal detected.");
         backup(c);
         rinvalid();
       case '\\':
@@ -4415,8 +5312,8 @@ Lexeme Lexer::scan_token() {
       } else if (c == 'U') {
         nextst(GOT_ESCAPE_SEQUENCE_BS_U0);
       } else {
-        print_error(std::cerr, "Invalid escape sequence.\n");
-        rinvalid();
+        diagnose(BAD_ESCAPE, "Invalid escape sequence.");
+        rbad_escape();
       }
       break;
 
@@ -4440,9 +5337,8 @@ Lexeme Lexer::scan_token() {
       if (std::isxdigit(c)) {
         nextst(GOT_ESCAPE_SEQUENCE_BS_x_XDIGIT);
       } else {
-        print_error(std::cerr,
-                    "Missing digits in hexadecimal escape sequence.\n");
-        rinvalid();
+        diagnose(BAD_ESCAPE, "Missing digits in hexadecimal escape sequence.");
+        rbad_escape();
       }
       break;
 
@@ -4458,9 +5354,9 @@ Lexeme Lexer::scan_token() {
       if (std::isxdigit(c)) {
         nextst(GOT_ESCAPE_SEQUENCE_BS_u1);
       } else {
-        print_error(std::cerr,
-                    "universal character name must have the form \\uhhhh.\n");
-        rinvalid();
+        diagnose(BAD_ESCAPE,
+                 "universal character name must have the form \\uhhhh.");
+        rbad_escape();
       }
       break;
 
@@ -4468,9 +5364,9 @@ Lexeme Lexer::scan_token() {
       if (std::isxdigit(c)) {
         nextst(GOT_ESCAPE_SEQUENCE_BS_u2);
       } else {
-        print_error(std::cerr,
-                    "universal character name must have the form \\uhhhh.\n");
-        rinvalid();
+        diagnose(BAD_ESCAPE,
+                 "universal character name must have the form \\uhhhh.");
+        rbad_escape();
       }
       break;
 
@@ -4478,9 +5374,9 @@ Lexeme Lexer::scan_token() {
       if (std::isxdigit(c)) {
         nextst(GOT_ESCAPE_SEQUENCE_BS_u3);
       } else {
-        print_error(std::cerr,
-                    "universal character name must have the form \\uhhhh.\n");
-        rinvalid();
+        diagnose(BAD_ESCAPE,
+                 "universal character name must have the form \\uhhhh.");
+        rbad_escape();
       }
       break;
 
@@ -4488,9 +5384,9 @@ Lexeme Lexer::scan_token() {
       if (std::isxdigit(c)) {
         popst();
       } else {
-        print_error(std::cerr,
-                    "universal character name must have the form \\uhhhh.\n");
-        rinvalid();
+        diagnose(BAD_ESCAPE,
+                 "universal character name must have the form \\uhhhh.");
+        rbad_escape();
       }
       break;
 
@@ -4498,10 +5394,9 @@ Lexeme Lexer::scan_token() {
       if (std::isxdigit(c)) {
         nextst(GOT_ESCAPE_SEQUENCE_BS_U1);
       } else {
-        print_error(
-            std::cerr,
-            "Universal character name must have the form \\Uhhhhhhhh.\n");
-        rinvalid();
+        diagnose(BAD_ESCAPE,
+                 "Universal character name must have the form \\Uhhhhhhhh.");
+        rbad_escape();
       }
       break;
 
@@ -4509,10 +5404,9 @@ Lexeme Lexer::scan_token() {
       if (std::isxdigit(c)) {
         nextst(GOT_ESCAPE_SEQUENCE_BS_U2);
       } else {
-        print_error(
-            std::cerr,
-            "Universal character name must have the form \\Uhhhhhhhh.\n");
-        rinvalid();
+        diagnose(BAD_ESCAPE,
+                 "Universal character name must have the form \\Uhhhhhhhh.");
+        rbad_escape();
       }
       break;
 
@@ -4520,10 +5414,9 @@ Lexeme Lexer::scan_token() {
       if (std::isxdigit(c)) {
         nextst(GOT_ESCAPE_SEQUENCE_BS_U3);
       } else {
-        print_error(
-            std::cerr,
-            "Universal character name must have the form \\Uhhhhhhhh.\n");
-        rinvalid();
+        diagnose(BAD_ESCAPE,
+                 "Universal character name must have the form \\Uhhhhhhhh.");
+        rbad_escape();
       }
       break;
 
@@ -4531,10 +5424,9 @@ Lexeme Lexer::scan_token() {
       if (std::isxdigit(c)) {
         nextst(GOT_ESCAPE_SEQUENCE_BS_U4);
       } else {
-        print_error(
-            std::cerr,
-            "Universal character name must have the form \\Uhhhhhhhh.\n");
-        rinvalid();
+        diagnose(BAD_ESCAPE,
+                 "Universal character name must have the form \\Uhhhhhhhh.");
+        rbad_escape();
       }
       break;
 
@@ -4542,10 +5434,9 @@ Lexeme Lexer::scan_token() {
       if (std::isxdigit(c)) {
         nextst(GOT_ESCAPE_SEQUENCE_BS_U5);
       } else {
-        print_error(
-            std::cerr,
-            "Universal character name must have the form \\Uhhhhhhhh.\n");
-        rinvalid();
+        diagnose(BAD_ESCAPE,
+                 "Universal character name must have the form \\Uhhhhhhhh.");
+        rbad_escape();
       }
       break;
 
@@ -4553,10 +5444,9 @@ Lexeme Lexer::scan_token() {
       if (std::isxdigit(c)) {
         nextst(GOT_ESCAPE_SEQUENCE_BS_U6);
       } else {
-        print_error(
-            std::cerr,
-            "Universal character name must have the form \\Uhhhhhhhh.\n");
-        rinvalid();
+        diagnose(BAD_ESCAPE,
+                 "Universal character name must have the form \\Uhhhhhhhh.");
+        rbad_escape();
       }
       break;
 
@@ -4564,10 +5454,9 @@ Lexeme Lexer::scan_token() {
       if (std::isxdigit(c)) {
         nextst(GOT_ESCAPE_SEQUENCE_BS_U7);
       } else {
-        print_error(
-            std::cerr,
-            "Universal character name must have the form \\Uhhhhhhhh.\n");
-        rinvalid();
+        diagnose(BAD_ESCAPE,
+                 "Universal character name must have the form \\Uhhhhhhhh.");
+        rbad_escape();
       }
       break;
 
@@ -4575,10 +5464,9 @@ Lexeme Lexer::scan_token() {
       if (std::isxdigit(c)) {
         popst();
       } else {
-        print_error(
-            std::cerr,
-            "Universal character name must have the form \\Uhhhhhhhh.\n");
-        rinvalid();
+        diagnose(BAD_ESCAPE,
+                 "Universal character name must have the form \\Uhhhhhhhh.");
+        rbad_escape();
       }
       break;
 
@@ -4717,11 +5605,21 @@ Lexeme Lexer::scan_token() {
 }
 
 std::vector<Lexeme> scan_tokens(const char *s) {
-  std::stringstream stream(std::move(std::string(s)), std::ios_base::in);
-  std::unique_ptr<SourceReader> reader = std::make_unique<SourceReader>(stream);
-  Lexer lexer(std::move(reader));
+  return scan_tokens(std::string_view(s, std::strlen(s)));
+}
+
+std::vector<Lexeme> scan_tokens(std::string_view s, std::uint32_t flags,
+                                Arena *arena) {
+  // Payloads in the Lexer's own arena would not outlive it.
+  if (!arena)
+    flags &= ~Lexer::DECODE_STRINGS;
+
+  std::unique_ptr<SourceReader> reader = std::make_unique<SourceReader>(s);
+  Lexer lexer(std::move(reader), flags);
+  lexer.set_arena(arena);
 
   std::vector<Lexeme> v;
+  v.reserve(reserve_for_tokens(s.size()));
   while (lexer.peek() != Token::END) {
     v.push_back(lexer.eat());
   }
@@ -0,0 +1,81 @@
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <c_lexer/Lexer.h>
+#include <c_lexer/NewlineIndex.h>
+
+#include "Simd.h"
+
+#include <algorithm>
+
+namespace c_lexer {
+
+static_assert(Lexer::rows_per_vtab == 1 && Lexer::rows_per_formfeed == 1,
+              "NewlineIndex counts each line break as one row");
+static_assert(Lexer::cols_per_htab == 1,
+              "NewlineIndex counts a tab as one column");
+
+NewlineIndex::NewlineIndex(std::string_view source, std::uint32_t row,
+                           std::uint32_t col)
+    : source_(source), row_(row), col_(col) {
+  const simd::run_fn line_run = simd::kernels().line_run;
+  const char *const begin = source.data();
+  const char *const end = begin + source.size();
+
+  // Lines are about 30 bytes long in typical C.
+  starts_.reserve(source.size() / 32 + 1);
+  for (const char *p = begin; (p += line_run(p, end)) < end;)
+    starts_.push_back(static_cast<std::size_t>(++p - begin));
+}
+
+SourcePosition NewlineIndex::position_of(std::size_t offset) const {
+  offset = std::min(offset, source_.size());
+  const std::size_t line = static_cast<std::size_t>(
+      std::upper_bound(starts_.begin(), starts_.end(), offset) -
+      starts_.begin());
+  const std::size_t start = line ? starts_[line - 1] : 0;
+
+  const std::string_view prefix = source_.substr(start, offset - start);
+  const std::size_t returns = std::count(prefix.begin(), prefix.end(), '\r') -
+                              (std::lower_bound(returns_.begin(),
+                                                returns_.end(), offset) -
+                               std::lower_bound(returns_.begin(),
+                                                returns_.end(), start));
+  return SourcePosition{
+      static_cast<std::uint32_t>(row_ + line),
+      static_cast<std::uint32_t>((line ? 1 : col_) + prefix.size() - returns)};
+}
+
+void NewlineIndex::within_token(std::size_t offset) {
+  if (source_[offset] == '\r') {
+    returns_.push_back(offset);
+    return;
+  }
+
+  // The line that the break began is part of the one before it.
+  const auto it =
+      std::lower_bound(starts_.begin(), starts_.end(), offset + 1);
+  if (it != starts_.end() && *it == offset + 1)
+    starts_.erase(it);
+}
+
+} // namespace c_lexer
@@ -0,0 +1,194 @@
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include <c_lexer/NumericValue.h>
+
+#include <cctype>
+#include <charconv>
+#include <cstdlib>
+#include <limits>
+#include <string>
+
+namespace c_lexer {
+
+static std::uint8_t int_suffix(std::string_view s) {
+  std::uint8_t suffix = 0;
+
+  for (std::size_t i = 0; i < s.size(); ++i) {
+    switch (s[i]) {
+    case 'u':
+    case 'U':
+      suffix |= NumericValue::SUFFIX_U;
+      break;
+    case 'l':
+    case 'L':
+      if (i + 1 < s.size() && s[i + 1] == s[i]) {
+        suffix |= NumericValue::SUFFIX_LL;
+        ++i;
+      } else {
+        suffix |= NumericValue::SUFFIX_L;
+      }
+      break;
+    case 'w':
+    case 'W':
+      suffix |= NumericValue::SUFFIX_WB;
+      ++i; // b B
+      break;
+    }
+  }
+
+  return suffix;
+}
+
+static std::uint8_t float_suffix(std::string_view s) {
+  std::uint8_t suffix = 0;
+
+  for (const char c : s) {
+    switch (c) {
+    case 'f':
+    case 'F':
+      suffix |= NumericValue::SUFFIX_F;
+      break;
+    case 'l':
+    case 'L':
+      suffix |= NumericValue::SUFFIX_L;
+      break;
+    case 'd':
+    case 'D':
+      // df dd dl: the second letter of dd adds nothing.
+      if (suffix & NumericValue::SUFFIX_D)
+        return suffix;
+      suffix |= NumericValue::SUFFIX_D;
+      break;
+    }
+  }
+
+  return suffix;
+}
+
+static void decode_integer(std::string_view digits, NumericValue &value) {
+  const std::uint64_t max = std::numeric_limits<std::uint64_t>::max();
+  std::uint64_t n = 0;
+
+  for (const char c : digits) {
+    if (c == '\'')
+      continue;
+
+    const unsigned d = std::isdigit(static_cast<unsigned char>(c))
+                           ? static_cast<unsigned>(c - '0')
+                           : static_cast<unsigned>(std::tolower(c) - 'a' + 10);
+    if (d >= value.radix)
+      value.ok = false;
+    if (n > (max - d) / value.radix)
+      value.ok = false;
+    n = n * value.radix + d;
+  }
+
+  value.integer = n;
+}
+
+static void decode_floating(std::string_view digits, bool hex,
+                            NumericValue &value) {
+  // Digit separators are not understood by from_chars().
+  std::string copy;
+  if (digits.find('\'') != std::string_view::npos) {
+    for (const char c : digits)
+      if (c != '\'')
+        copy.push_back(c);
+    digits = copy;
+  }
+
+  const char *const first = digits.data();
+  const char *const last = first + digits.size();
+  const std::chars_format format =
+      hex ? std::chars_format::hex : std::chars_format::general;
+
+  double d = 0;
+  const auto [end, ec] = std::from_chars(first, last, d, format);
+  if (ec == std::errc() && end == last) {
+    value.floating = d;
+    return;
+  }
+
+  // Out of range: take the infinity or the underflowed value that the
+  // conversion rounds to.
+  value.ok = false;
+  const std::string terminated =
+      hex ? "0x" + std::string(digits) : std::string(digits);
+  value.floating = std::strtod(terminated.c_str(), nullptr);
+}
+
+bool decode_number(std::string_view spelling, NumericValue &value) {
+  value = NumericValue();
+
+  const std::size_t n = spelling.size();
+  if (!n || !(std::isdigit(static_cast<unsigned char>(spelling[0])) ||
+              spelling[0] == '.'))
+    return true;
+
+  std::size_t i = 0;
+  if (spelling[0] == '0' && n > 1) {
+    if (spelling[1] == 'x' || spelling[1] == 'X') {
+      value.radix = 16;
+      i = 2;
+    } else if (spelling[1] == 'b' || spelling[1] == 'B') {
+      value.radix = 2;
+      i = 2;
+    } else {
+      value.radix = 8;
+    }
+  }
+
+  // The digits run up to a suffix, or to what makes the literal floating.
+  const bool hex = value.radix == 16;
+  auto is_digit = [hex](char c) {
+    const unsigned char u = static_cast<unsigned char>(c);
+    return c == '\'' || (hex ? std::isxdigit(u) : std::isdigit(u));
+  };
+  std::size_t j = i;
+  while (j < n && is_digit(spelling[j]))
+    ++j;
+
+  const bool floating =
+      j < n && (spelling[j] == '.' ||
+                (hex ? spelling[j] == 'p' || spelling[j] == 'P'
+                     : spelling[j] == 'e' || spelling[j] == 'E'));
+  if (!floating) {
+    value.kind = NumericValue::INTEGER;
+    value.suffix = int_suffix(spelling.substr(j));
+    decode_integer(spelling.substr(i, j - i), value);
+    return value.ok;
+  }
+
+  // Every floating literal ends in a digit or '.', then its suffix.
+  std::size_t end = n;
+  while (end > j && std::isalpha(static_cast<unsigned char>(spelling[end - 1])))
+    --end;
+
+  value.kind = NumericValue::FLOATING;
+  if (!hex)
+    value.radix = 10;
+  value.suffix = float_suffix(spelling.substr(end));
+  decode_floating(spelling.substr(i, end - i), hex, value);
+  return value.ok;
+}
+
+} // namespace c_lexer
@@ -0,0 +1,118 @@
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <c_lexer/PackedTokens.h>
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <memory>
+
+namespace c_lexer {
+
+void PackedTokens::reset(std::string_view source) {
+  source_ = source;
+  tokens_.clear();
+  rows_.clear();
+  last_row_ = 0;
+  long_deltas_.clear();
+}
+
+void PackedTokens::reserve(std::size_t n) {
+  tokens_.reserve(n);
+  rows_.reserve(n / rows_every + 1);
+}
+
+void PackedTokens::push_back(Token token, std::uint32_t offset,
+                             std::uint32_t length, std::uint32_t row,
+                             std::uint32_t col) {
+  const std::uint32_t i = static_cast<std::uint32_t>(tokens_.size());
+  const std::uint32_t delta = i ? row - last_row_ : 0;
+  if (i % rows_every == 0)
+    rows_.push_back(row);
+  if (delta >= PackedToken::long_delta)
+    long_deltas_.emplace_back(i, delta);
+  last_row_ = row;
+
+  tokens_.push_back(PackedToken{
+      offset, length, col,
+      static_cast<std::uint16_t>(std::min<std::uint32_t>(
+          delta, PackedToken::long_delta)),
+      static_cast<std::uint8_t>(token), 0});
+}
+
+std::uint32_t PackedTokens::line_delta(std::size_t i) const {
+  const std::uint16_t delta = tokens_[i].line_delta;
+  if (delta != PackedToken::long_delta)
+    return delta;
+  const auto pos = std::lower_bound(
+      long_deltas_.begin(), long_deltas_.end(),
+      std::make_pair(static_cast<std::uint32_t>(i), std::uint32_t(0)));
+  return pos->second;
+}
+
+std::uint32_t PackedTokens::row(std::size_t i) const {
+  std::size_t k = i / rows_every;
+  std::uint32_t row = rows_[k];
+  for (k = k * rows_every + 1; k <= i; ++k)
+    row += line_delta(k);
+  return row;
+}
+
+Lexeme PackedTokens::lexeme(std::size_t i, std::uint32_t row) const {
+  const PackedToken &t = tokens_[i];
+  const std::string_view text = this->text(i);
+  if (text.find('\\') != std::string_view::npos) {
+    std::string spelling = unsplice(text);
+    if (spelling.size() != text.size())
+      return Lexeme(std::move(spelling), t.token(), row, t.col, t.offset);
+  }
+  return Lexeme::borrow(text, t.token(), row, t.col, t.offset);
+}
+
+std::size_t scan_tokens(std::string_view s, PackedTokens &tokens,
+                        std::uint32_t flags) {
+  tokens.reset(s);
+
+  if (s.size() > std::numeric_limits<std::uint32_t>::max()) {
+    std::cerr << "c_lexer: source of " << s.size()
+              << " bytes is too large for PackedTokens\n";
+    return 0;
+  }
+
+  tokens.reserve(reserve_for_tokens(s.size()));
+
+  Lexer lexer(std::make_unique<SourceReader>(s), flags | Lexer::ZERO_COPY);
+  for (;;) {
+    const Lexeme &l = lexer.peek();
+    tokens.push_back(l.token(), static_cast<std::uint32_t>(l.offset_),
+                     static_cast<std::uint32_t>(source_length(l, s)), l.row_,
+                     l.col_);
+    if (l.token() == Token::END)
+      break;
+    lexer.eat();
+  }
+
+  return tokens.size();
+}
+
+} // namespace c_lexer
@@ -0,0 +1,217 @@
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <c_lexer/PerfCounters.h>
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/perf_event.h>)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define C_LEXER_HAVE_PERF_EVENTS 1
+#endif
+#endif
+
+namespace c_lexer {
+
+#if defined(C_LEXER_HAVE_PERF_EVENTS)
+namespace {
+
+struct EventSpec {
+  std::uint32_t type;
+  std::uint64_t config;
+};
+
+const EventSpec event_specs[PerfCounters::num_events] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1I |
+                             (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                             (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+};
+
+const std::uint64_t time_format =
+    PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+// A counter of spec for the calling thread on any CPU, or -1. With a group -1
+// it is disabled and on its own. Otherwise it joins the group led by
+// group_fd, which enables and disables it, and is read along with it.
+int open_event(const EventSpec &spec, int group_fd, std::uint64_t format) {
+  perf_event_attr attr;
+  std::memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = spec.type;
+  attr.config = spec.config;
+  attr.disabled = group_fd < 0;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = format;
+  return static_cast<int>(
+      syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0));
+}
+
+// count scaled up to the time enabled from the time running, when the kernel
+// took turns with the counters.
+std::uint64_t scaled(std::uint64_t count, std::uint64_t enabled,
+                     std::uint64_t running) {
+  return enabled == running ? count
+                            : static_cast<std::uint64_t>(
+                                  static_cast<double>(count) * enabled /
+                                  running);
+}
+
+} // namespace
+#endif // C_LEXER_HAVE_PERF_EVENTS
+
+PerfCounters::PerfCounters() {
+  fds_.fill(-1);
+#if defined(C_LEXER_HAVE_PERF_EVENTS)
+  const int leader =
+      open_event(event_specs[CYCLES], -1, time_format | PERF_FORMAT_GROUP);
+  if (leader >= 0) {
+    fds_[CYCLES] = leader;
+    grouped_[CYCLES] = true;
+    group_order_[group_size_++] = CYCLES;
+  }
+
+  for (std::size_t i = 0; i < num_events; ++i) {
+    if (i == CYCLES && leader >= 0)
+      continue;
+    int fd = leader >= 0 ? open_event(event_specs[i], leader, time_format) : -1;
+    if (fd >= 0) {
+      grouped_[i] = true;
+      group_order_[group_size_++] = static_cast<Event>(i);
+    } else {
+      fd = open_event(event_specs[i], -1, time_format);
+    }
+    fds_[i] = fd;
+  }
+#endif
+}
+
+PerfCounters::~PerfCounters() {
+#if defined(C_LEXER_HAVE_PERF_EVENTS)
+  for (int fd : fds_)
+    if (fd >= 0)
+      close(fd);
+#endif
+}
+
+bool PerfCounters::available() const {
+  return std::any_of(fds_.begin(), fds_.end(), [](int fd) { return fd >= 0; });
+}
+
+void PerfCounters::start() {
+  counts_.fill(0);
+#if defined(C_LEXER_HAVE_PERF_EVENTS)
+  for (std::size_t i = 0; i < num_events; ++i) {
+    if (fds_[i] < 0 || (grouped_[i] && i != CYCLES))
+      continue;
+    const int flags = grouped_[i] ? PERF_IOC_FLAG_GROUP : 0;
+    ioctl(fds_[i], PERF_EVENT_IOC_RESET, flags);
+    ioctl(fds_[i], PERF_EVENT_IOC_ENABLE, flags);
+  }
+#endif
+}
+
+void PerfCounters::stop() {
+#if defined(C_LEXER_HAVE_PERF_EVENTS)
+  for (std::size_t i = 0; i < num_events; ++i)
+    if (fds_[i] >= 0 && (!grouped_[i] || i == CYCLES))
+      ioctl(fds_[i], PERF_EVENT_IOC_DISABLE,
+            grouped_[i] ? PERF_IOC_FLAG_GROUP : 0);
+
+  if (group_size_) {
+    // The number of events, the time for which the group was enabled and
+    // running, and the count of each event in group_order_.
+    std::uint64_t v[3 + num_events];
+    const ssize_t want =
+        static_cast<ssize_t>((3 + group_size_) * sizeof(std::uint64_t));
+    if (read(fds_[CYCLES], v, sizeof(v)) == want && v[0] == group_size_ &&
+        v[2])
+      for (std::size_t k = 0; k < group_size_; ++k)
+        counts_[group_order_[k]] = scaled(v[3 + k], v[1], v[2]);
+  }
+
+  for (std::size_t i = 0; i < num_events; ++i) {
+    // The count, and the time for which it was enabled and running.
+    std::uint64_t v[3];
+    if (fds_[i] < 0 || grouped_[i] ||
+        read(fds_[i], v, sizeof(v)) != sizeof(v) || !v[2])
+      continue;
+    counts_[i] = scaled(v[0], v[1], v[2]);
+  }
+#endif
+}
+
+const char *PerfCounters::event_name(Event event) {
+  switch (event) {
+  case CYCLES:
+    return "cycles";
+  case INSTRUCTIONS:
+    return "instructions";
+  case BRANCHES:
+    return "branches";
+  case BRANCH_MISSES:
+    return "branch-misses";
+  case L1I_MISSES:
+    return "L1-icache-misses";
+  case num_events:
+    break;
+  }
+  return "?";
+}
+
+Percentiles percentiles(std::vector<std::uint64_t> &samples) {
+  Percentiles p;
+  const std::size_t n = samples.size();
+  if (!n)
+    return p;
+
+  // The nearest rank of each, found in turn within what is left above the
+  // one before.
+  const auto rank = [n](std::size_t per_mille) {
+    return (n * per_mille + 999) / 1000 - 1;
+  };
+  auto at = [&](std::size_t from, std::size_t k) {
+    std::nth_element(samples.begin() + static_cast<std::ptrdiff_t>(from),
+                     samples.begin() + static_cast<std::ptrdiff_t>(k),
+                     samples.end());
+    return samples[k];
+  };
+
+  const std::size_t r50 = rank(500);
+  const std::size_t r99 = rank(990);
+  const std::size_t r999 = rank(999);
+  p.p50 = at(0, r50);
+  p.p99 = at(r50, r99);
+  p.p999 = at(r99, r999);
+  return p;
+}
+
+} // namespace c_lexer
@@ -0,0 +1,116 @@
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <c_lexer/PipelinedLexer.h>
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+namespace c_lexer {
+
+// Spin on ready() for a while, and then yield between tries, so that a side
+// kept waiting does not hold its core.
+template <typename Ready> static void wait_until(Ready ready) {
+  for (unsigned spins = 0; !ready(); ++spins)
+    if (spins >= 64)
+      std::this_thread::yield();
+}
+
+PipelinedLexer::PipelinedLexer(std::unique_ptr<SourceReader> &&sr,
+                               std::uint32_t flags, std::size_t batch_size,
+                               std::size_t n_batches)
+    : lexer_(std::make_unique<Lexer>(std::move(sr), flags)),
+      batch_size_(std::max(batch_size, lookahead_capacity)),
+      batches_(std::max<std::size_t>(n_batches, 2)), head_(0), tail_(0),
+      stop_(false), pos_(0) {
+  for (Batch &b : batches_)
+    b.lexemes.resize(batch_size_);
+  producer_ = std::thread(&PipelinedLexer::produce, this);
+}
+
+PipelinedLexer::~PipelinedLexer() {
+  stop_.store(true, std::memory_order_relaxed);
+  producer_.join();
+}
+
+void PipelinedLexer::produce() {
+  for (std::size_t h = 0;; ++h) {
+    // Wait for the consumer to release the batch that h reuses.
+    wait_until([&] {
+      return h - tail_.load(std::memory_order_acquire) < batches_.size() ||
+             stop_.load(std::memory_order_relaxed);
+    });
+    if (stop_.load(std::memory_order_relaxed))
+      return;
+
+    Batch &b = batch(h);
+    b.size = lexer_->next_batch(b.lexemes.data(), batch_size_);
+    const bool ended = b.lexemes[b.size - 1].token() == Token::END;
+    head_.store(h + 1, std::memory_order_release);
+    if (ended)
+      return;
+  }
+}
+
+PipelinedLexer::Batch &PipelinedLexer::wait_for(std::size_t i) {
+  wait_until([&] { return head_.load(std::memory_order_acquire) > i; });
+  return batch(i);
+}
+
+const Lexeme &PipelinedLexer::peek(std::size_t k) {
+  assert(k < lookahead_capacity);
+
+  // k is less than a batch, so this looks no further than the next batch,
+  // which the consumer may read once it is published while still holding
+  // this one.
+  std::size_t i = tail_.load(std::memory_order_relaxed);
+  std::size_t pos = pos_ + k;
+  for (;;) {
+    const Batch &b = wait_for(i);
+    if (pos < b.size)
+      return b.lexemes[pos];
+    if (b.lexemes[b.size - 1].token() == Token::END)
+      return b.lexemes[b.size - 1];
+    pos -= b.size;
+    ++i;
+  }
+}
+
+Lexeme PipelinedLexer::eat() {
+  const std::size_t i = tail_.load(std::memory_order_relaxed);
+  Batch &b = wait_for(i);
+
+  // END stays at the front once reached, as it does for a Lexer.
+  Lexeme &front = b.lexemes[pos_];
+  if (front.token() == Token::END)
+    return front;
+
+  Lexeme l(std::move(front));
+  if (++pos_ == b.size) {
+    pos_ = 0;
+    tail_.store(i + 1, std::memory_order_release);
+  }
+  return l;
+}
+
+} // namespace c_lexer
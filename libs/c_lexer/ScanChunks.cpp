@@ -0,0 +1,328 @@
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <c_lexer/Lexer.h>
+#include <c_lexer/TokenStream.h>
+
+#include "ScanChunks.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <memory>
+
+namespace c_lexer {
+
+// Chunks of about this many bytes per worker, with a few chunks per worker so
+// that one slow chunk can be balanced by stealing.
+const std::size_t min_chunk_size = 256 * 1024;
+const std::size_t chunks_per_worker = 4;
+
+struct Chunk {
+  std::size_t begin;
+  std::size_t end;
+  std::uint32_t row; // row number of begin, for diagnostics
+  Lexer::LineState line; // assumed at begin
+  TokenStream tokens;    // offsets are into all of s
+};
+
+// The rows advanced by the line breaks of [p, end). Line breaks within
+// tokens are counted too, so this is only exact for the seams chosen by
+// scan_tokens_parallel(), and is used only for diagnostics.
+static std::uint32_t count_rows(const char *p, const char *end) {
+  std::uint32_t rows = 0;
+
+  for (; p < end; ++p) {
+    switch (*p) {
+    case '\n':
+      ++rows;
+      break;
+    case '\v':
+      rows += Lexer::rows_per_vtab;
+      break;
+    case '\f':
+      rows += Lexer::rows_per_formfeed;
+      break;
+    }
+  }
+
+  return rows;
+}
+
+// Lex s from begin to end, as though begin were outside any token, in line
+// state line, and pass each token, with the line state after it, to f
+// until f returns false or END has been passed.
+template <typename F>
+void lex_range(std::string_view s, std::size_t begin, std::size_t end,
+               std::uint32_t row, Lexer::LineState line, std::uint32_t flags,
+               F &&f) {
+  const std::string_view range = s.substr(begin, end - begin);
+  Lexer lexer(std::make_unique<SourceReader>(range),
+              flags | Lexer::ZERO_COPY | Lexer::LAZY_POSITIONS, row, 1, line);
+
+  for (;;) {
+    const Lexeme &l = lexer.peek();
+    if (!f(l.token(), static_cast<std::uint32_t>(begin + l.offset_),
+           static_cast<std::uint32_t>(source_length(l, range)),
+           lexer.line_state()) ||
+        l.token() == Token::END)
+      return;
+    lexer.eat();
+  }
+}
+
+// Whether the character before pos of s is a newline that ends a line,
+// rather than one of a splice.
+static bool at_line_start(std::string_view s, std::size_t pos) {
+  if (pos == 0)
+    return true;
+  if (s[pos - 1] != '\n')
+    return false;
+  const std::size_t bs = pos >= 3 && s[pos - 2] == '\r' ? pos - 3 : pos - 2;
+  return pos < 2 || s[bs] != '\\';
+}
+
+std::size_t scan_chunks(std::string_view s,
+                        const std::vector<std::size_t> &cuts, TokenStream &ts,
+                        WorkStealingPool &pool, std::uint32_t flags) {
+  ts.reset(s);
+
+  if (s.size() > std::numeric_limits<std::uint32_t>::max()) {
+    std::cerr << "c_lexer: source of " << s.size()
+              << " bytes is too large for a TokenStream\n";
+    return 0;
+  }
+
+  std::vector<Chunk> chunks(cuts.size() - 1);
+  for (std::size_t i = 0; i < chunks.size(); ++i) {
+    chunks[i].begin = cuts[i];
+    chunks[i].end = cuts[i + 1];
+    chunks[i].line =
+        at_line_start(s, cuts[i]) ? Lexer::LINE_START : Lexer::MID_LINE;
+    chunks[i].tokens.reset(s);
+  }
+
+  // Find the row that each chunk starts on, then lex every chunk as though
+  // it started at a token boundary.
+  std::vector<std::uint32_t> rows(chunks.size());
+  for (std::size_t i = 0; i < chunks.size(); ++i)
+    pool.submit([&, i](unsigned) {
+      const Chunk &c = chunks[i];
+      rows[i] = count_rows(s.data() + c.begin, s.data() + c.end);
+    });
+  pool.wait();
+
+  std::uint32_t row = 1;
+  for (std::size_t i = 0; i < chunks.size(); ++i) {
+    chunks[i].row = row;
+    row += rows[i];
+  }
+
+  // Comments are lexed as tokens, so that one near a seam is repaired like
+  // any other token, and one left open at the end of a chunk comes out as a
+  // token that runs up to the seam. They are dropped while stitching unless
+  // the caller asked for them.
+  const std::uint32_t chunk_flags = flags | Lexer::KEEP_COMMENTS;
+  for (Chunk &c : chunks)
+    pool.submit([&](unsigned) {
+      c.tokens.reserve(reserve_for_tokens(c.end - c.begin));
+      lex_range(s, c.begin, c.end, c.row, c.line,
+                c.end == s.size() ? chunk_flags
+                                  : chunk_flags | Lexer::OPEN_ENDED,
+                [&c](Token token, std::uint32_t offset, std::uint32_t len,
+                     Lexer::LineState line) {
+                  c.tokens.push_back(token, offset, len, line);
+                  return true;
+                });
+    });
+  pool.wait();
+
+  // Identifiers are interned here, in source order, rather than by the
+  // chunks, so that they get the same ids as from a serial scan.
+  const bool keep_comments = flags & Lexer::KEEP_COMMENTS;
+  SymbolTable *const symbols = ts.symbols();
+  auto take = [&](Token token, std::uint32_t offset, std::uint32_t len,
+                  Lexer::LineState line) {
+    const std::string_view text = s.substr(offset, len);
+    if (symbols && token == Token::IDENTIFIER)
+      ts.push_back(token, offset, len, line,
+                   text.find('\\') == std::string_view::npos
+                       ? symbols->intern(text)
+                       : symbols->intern(unsplice(text)));
+    else if (keep_comments || !is_comment(token, text))
+      ts.push_back(token, offset, len, line);
+  };
+
+  // Stitch the chunks together. A token that ends near a seam may have been
+  // decided by what its chunk lacked (a token cut off at the seam, or the
+  // third '.' of a '...'), and the next chunk may have started mid-token.
+  // Re-lex from the end of the last token before the first such one until a
+  // token ends where some later chunk also has one end, in the same line
+  // state; from there on the two lexes agree, since both are in START at the
+  // same place in the same input and line state. A chunk that began within a
+  // directive or a spliced line is wrong about the line state, and so is
+  // repaired just as one that began within a token.
+  std::size_t total = 0;
+  for (const Chunk &c : chunks)
+    total += c.tokens.size();
+  ts.reserve(total);
+
+  std::size_t j = 0; // the chunk whose tokens are being taken
+  std::size_t k = 0; // the next of its tokens to take
+  for (;;) {
+    const Chunk &c = chunks[j];
+    const TokenStream &t = c.tokens;
+    const std::size_t n = t.size() - 1; // all but END
+
+    if (j + 1 == chunks.size()) {
+      for (; k < n; ++k)
+        take(t.token(k), t.offset(k), t.length(k), t.line_state(k));
+      ts.push_back(Token::END, t.offset(n), 0, t.line_state(n));
+      break;
+    }
+
+    // Leave out the tokens whose scanning may have looked past the seam.
+    std::size_t m = n;
+    while (m > k && overscan_end(s, t.offset(m - 1) + t.length(m - 1)) > c.end)
+      --m;
+    for (; k < m; ++k)
+      take(t.token(k), t.offset(k), t.length(k), t.line_state(k));
+
+    if (m == n && t.line_state(n) == chunks[j + 1].line) {
+      ++j;
+      k = 0;
+      continue;
+    }
+
+    // The token before m was taken, or was the one re-lexed to sync with
+    // this chunk, so the line state after it is right.
+    const std::size_t from =
+        m > 0 ? t.offset(m - 1) + t.length(m - 1) : c.begin;
+    std::size_t next = j + 1;
+    bool synced = false;
+    lex_range(s, from, s.size(),
+              c.row + count_rows(s.data() + c.begin, s.data() + from),
+              m > 0 ? t.line_state(m - 1) : c.line, chunk_flags,
+              [&](Token token, std::uint32_t offset, std::uint32_t len,
+                  Lexer::LineState line) {
+                while (next < chunks.size() && offset >= chunks[next].end)
+                  ++next;
+
+                if (next < chunks.size() && offset >= chunks[next].begin) {
+                  const TokenStream &u = chunks[next].tokens;
+                  const auto first = u.offsets().begin();
+                  const auto last = u.offsets().end() - 1; // not END
+                  const auto it = std::lower_bound(first, last, offset);
+                  const auto i = static_cast<std::size_t>(it - first);
+                  if (it != last && *it == offset && u.length(i) == len &&
+                      u.line_state(i) == line) {
+                    take(token, offset, len, line);
+                    j = next;
+                    k = i + 1;
+                    synced = true;
+                    return false;
+                  }
+                }
+
+                if (token == Token::END)
+                  ts.push_back(token, offset, len, line);
+                else
+                  take(token, offset, len, line);
+                return true;
+              });
+
+    if (!synced) // the re-lex ran through END
+      break;
+  }
+
+  return ts.size();
+}
+
+// The offset just past a space in [from, to), preferring one after a ';',
+// '{' or '}', which is least likely to be within a literal or a comment, or
+// 0 for none.
+static std::size_t space_cut(std::string_view s, std::size_t from,
+                             std::size_t to) {
+  const char *p = s.data() + from;
+  const char *const end = s.data() + to;
+  std::size_t any = 0;
+  while ((p = static_cast<const char *>(
+              std::memchr(p, ' ', static_cast<std::size_t>(end - p))))) {
+    const std::size_t cut = static_cast<std::size_t>(p - s.data()) + 1;
+    if (p > s.data() && (p[-1] == ';' || p[-1] == '{' || p[-1] == '}'))
+      return cut;
+    if (!any)
+      any = cut;
+    ++p;
+  }
+  return any;
+}
+
+std::vector<std::size_t> chunk_cuts(std::string_view s, std::size_t target) {
+  // Cut just after a newline that is not spliced, where no token can be in
+  // progress. A line that runs on for a whole chunk, as in minified source,
+  // is cut after a space instead, which the seam repair makes good should it
+  // fall within a literal or a comment after all.
+  std::vector<std::size_t> cuts{0};
+  for (std::size_t pos = target; pos < s.size();) {
+    const std::size_t window = std::min(target, s.size() - pos);
+    const void *nl = std::memchr(s.data() + pos, '\n', window);
+
+    std::size_t cut;
+    if (nl) {
+      cut = static_cast<std::size_t>(static_cast<const char *>(nl) -
+                                     s.data()) +
+            1;
+      if (!at_line_start(s, cut)) {
+        pos = cut;
+        continue;
+      }
+    } else {
+      cut = space_cut(s, pos, pos + window);
+      if (!cut) {
+        pos += window;
+        continue;
+      }
+    }
+    if (cut >= s.size())
+      break;
+
+    cuts.push_back(cut);
+    pos = cut + target;
+  }
+  cuts.push_back(s.size());
+  return cuts;
+}
+
+std::size_t scan_tokens_parallel(std::string_view s, TokenStream &ts,
+                                 unsigned n_threads, std::uint32_t flags) {
+  if (n_threads == 1 || s.size() < 2 * min_chunk_size)
+    return scan_tokens(s, ts, flags);
+
+  WorkStealingPool pool(n_threads);
+  const std::size_t target = std::max(
+      min_chunk_size, s.size() / (pool.size() * chunks_per_worker) + 1);
+  return scan_chunks(s, chunk_cuts(s, target), ts, pool, flags);
+}
+
+} // namespace c_lexer
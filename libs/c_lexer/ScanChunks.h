@@ -0,0 +1,47 @@
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#pragma once
+
+#include <c_lexer/TokenStream.h>
+
+#include "WorkStealingPool.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace c_lexer {
+
+// Lex s into ts as the chunks [cuts[i], cuts[i + 1]), concurrently on pool.
+// cuts must begin with 0, end with s.size() and increase. A cut need not fall
+// on a token boundary: the seams are repaired, just more slowly.
+std::size_t scan_chunks(std::string_view s,
+                        const std::vector<std::size_t> &cuts, TokenStream &ts,
+                        WorkStealingPool &pool, std::uint32_t flags);
+
+// The cuts of s into chunks of at least target bytes that
+// scan_tokens_parallel() lexes: just after an unspliced newline, or, in a
+// line with none for target bytes, just after a space.
+std::vector<std::size_t> chunk_cuts(std::string_view s, std::size_t target);
+
+} // namespace c_lexer
@@ -0,0 +1,417 @@
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "Simd.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// AVX2 is chosen at run time, so it needs the GCC/Clang target attribute.
+#if defined(__SSE2__) && defined(__GNUC__)
+#define C_LEXER_HAVE_AVX2 1
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace c_lexer {
+namespace simd {
+
+constexpr std::array<std::uint8_t, 256> make_char_class() {
+  std::array<std::uint8_t, 256> t{};
+
+  for (int c = 0; c < 256; ++c)
+    if (c != '*' && (c < '\n' || c > '\r'))
+      t[c] = PLAIN;
+
+  for (int c = 0; c < 256; ++c)
+    if (c < '\n' || c > '\f')
+      t[c] |= LINE;
+
+  t[' '] |= BLANK | SPACE;
+  t['\t'] |= BLANK | SPACE;
+  for (int c = '\n'; c <= '\r'; ++c)
+    t[c] |= SPACE;
+  for (int c = '0'; c <= '9'; ++c)
+    t[c] |= DIGIT | IDENT;
+  for (int c = 'a'; c <= 'z'; ++c) {
+    t[c] |= IDENT | ALPHA;
+    t[c - 'a' + 'A'] |= IDENT | ALPHA;
+  }
+  t['_'] |= IDENT | ALPHA;
+
+  for (int c = 0; c < 256; ++c)
+    if (!(t[c] & (IDENT | SPACE)))
+      t[c] |= STRAY;
+  for (const char *p = "!\"#%&'()*+,-./:;<=>?[]^{|}~"; *p; ++p)
+    t[static_cast<unsigned char>(*p)] &= ~STRAY;
+
+  return t;
+}
+
+const std::array<std::uint8_t, 256> char_class = make_char_class();
+
+template <std::uint8_t Cls>
+std::size_t scalar_run(const char *p, const char *end) {
+  const char *q = p;
+  while (q < end && is_class(*q, Cls))
+    ++q;
+  return static_cast<std::size_t>(q - p);
+}
+
+const Kernels scalar_kernels = {Isa::SCALAR,      "scalar",
+                                scalar_run<BLANK>, scalar_run<IDENT>,
+                                scalar_run<DIGIT>, scalar_run<PLAIN>,
+                                scalar_run<SPACE>, scalar_run<LINE>,
+                                scalar_run<STRAY>};
+
+#if defined(__SSE2__)
+
+// Signed compares are enough, because bytes >= 0x80 are negative and so never
+// fall within an ASCII range.
+inline __m128i sse2_in_range(__m128i v, char lo, char hi) {
+  return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(lo - 1)),
+                       _mm_cmplt_epi8(v, _mm_set1_epi8(hi + 1)));
+}
+
+struct Sse2Blank {
+  static constexpr std::uint8_t cls = BLANK;
+  static __m128i match(__m128i v) {
+    return _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                        _mm_cmpeq_epi8(v, _mm_set1_epi8('\t')));
+  }
+};
+
+struct Sse2Ident {
+  static constexpr std::uint8_t cls = IDENT;
+  static __m128i match(__m128i v) {
+    const __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+    return _mm_or_si128(
+        _mm_or_si128(sse2_in_range(v, '0', '9'),
+                     sse2_in_range(lower, 'a', 'z')),
+        _mm_cmpeq_epi8(v, _mm_set1_epi8('_')));
+  }
+};
+
+struct Sse2Digit {
+  static constexpr std::uint8_t cls = DIGIT;
+  static __m128i match(__m128i v) { return sse2_in_range(v, '0', '9'); }
+};
+
+// '\n' '\v' '\f' '\r' are the consecutive codes 0x0a to 0x0d.
+struct Sse2Plain {
+  static constexpr std::uint8_t cls = PLAIN;
+  static __m128i match(__m128i v) {
+    const __m128i stop = _mm_or_si128(sse2_in_range(v, '\n', '\r'),
+                                      _mm_cmpeq_epi8(v, _mm_set1_epi8('*')));
+    return _mm_xor_si128(stop, _mm_set1_epi8(-1));
+  }
+};
+
+// '\t' '\n' '\v' '\f' '\r' are the consecutive codes 0x09 to 0x0d.
+struct Sse2Space {
+  static constexpr std::uint8_t cls = SPACE;
+  static __m128i match(__m128i v) {
+    return _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                        sse2_in_range(v, '\t', '\r'));
+  }
+};
+
+struct Sse2Line {
+  static constexpr std::uint8_t cls = LINE;
+  static __m128i match(__m128i v) {
+    return _mm_xor_si128(sse2_in_range(v, '\n', '\f'), _mm_set1_epi8(-1));
+  }
+};
+
+// The bytes outside '!' to '~' and the blanks, and the four printable ones
+// that no token uses.
+struct Sse2Stray {
+  static constexpr std::uint8_t cls = STRAY;
+  static __m128i match(__m128i v) {
+    const __m128i used = _mm_or_si128(sse2_in_range(v, '!', '~'),
+                                      Sse2Space::match(v));
+    const __m128i odd =
+        _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('$')),
+                                  _mm_cmpeq_epi8(v, _mm_set1_epi8('@'))),
+                     _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\\')),
+                                  _mm_cmpeq_epi8(v, _mm_set1_epi8('`'))));
+    return _mm_or_si128(_mm_andnot_si128(used, _mm_set1_epi8(-1)), odd);
+  }
+};
+
+template <typename M> std::size_t sse2_run(const char *p, const char *end) {
+  const char *q = p;
+
+  while (end - q >= 16) {
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(q));
+    const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(M::match(v)));
+    if (mask != 0xffff)
+      return static_cast<std::size_t>(q - p) + __builtin_ctz(~mask);
+    q += 16;
+  }
+
+  return static_cast<std::size_t>(q - p) + scalar_run<M::cls>(q, end);
+}
+
+const Kernels sse2_kernels = {Isa::SSE2,          "sse2",
+                              sse2_run<Sse2Blank>, sse2_run<Sse2Ident>,
+                              sse2_run<Sse2Digit>, sse2_run<Sse2Plain>,
+                              sse2_run<Sse2Space>, sse2_run<Sse2Line>,
+                              sse2_run<Sse2Stray>};
+
+#endif // __SSE2__
+
+#if defined(C_LEXER_HAVE_AVX2)
+
+#define C_LEXER_AVX2 __attribute__((target("avx2")))
+
+C_LEXER_AVX2 inline __m256i avx2_in_range(__m256i v, char lo, char hi) {
+  return _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8(lo - 1)),
+                          _mm256_cmpgt_epi8(_mm256_set1_epi8(hi + 1), v));
+}
+
+struct Avx2Blank {
+  using tail = Sse2Blank;
+  C_LEXER_AVX2 static __m256i match(__m256i v) {
+    return _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                           _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t')));
+  }
+};
+
+struct Avx2Ident {
+  using tail = Sse2Ident;
+  C_LEXER_AVX2 static __m256i match(__m256i v) {
+    const __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+    return _mm256_or_si256(
+        _mm256_or_si256(avx2_in_range(v, '0', '9'),
+                        avx2_in_range(lower, 'a', 'z')),
+        _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_')));
+  }
+};
+
+struct Avx2Digit {
+  using tail = Sse2Digit;
+  C_LEXER_AVX2 static __m256i match(__m256i v) {
+    return avx2_in_range(v, '0', '9');
+  }
+};
+
+struct Avx2Plain {
+  using tail = Sse2Plain;
+  C_LEXER_AVX2 static __m256i match(__m256i v) {
+    const __m256i stop =
+        _mm256_or_si256(avx2_in_range(v, '\n', '\r'),
+                        _mm256_cmpeq_epi8(v, _mm256_set1_epi8('*')));
+    return _mm256_xor_si256(stop, _mm256_set1_epi8(-1));
+  }
+};
+
+struct Avx2Space {
+  using tail = Sse2Space;
+  C_LEXER_AVX2 static __m256i match(__m256i v) {
+    return _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                           avx2_in_range(v, '\t', '\r'));
+  }
+};
+
+struct Avx2Line {
+  using tail = Sse2Line;
+  C_LEXER_AVX2 static __m256i match(__m256i v) {
+    return _mm256_xor_si256(avx2_in_range(v, '\n', '\f'),
+                            _mm256_set1_epi8(-1));
+  }
+};
+
+struct Avx2Stray {
+  using tail = Sse2Stray;
+  C_LEXER_AVX2 static __m256i match(__m256i v) {
+    const __m256i used = _mm256_or_si256(avx2_in_range(v, '!', '~'),
+                                         Avx2Space::match(v));
+    const __m256i odd = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('$')),
+                        _mm256_cmpeq_epi8(v, _mm256_set1_epi8('@'))),
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\')),
+                        _mm256_cmpeq_epi8(v, _mm256_set1_epi8('`'))));
+    return _mm256_or_si256(_mm256_andnot_si256(used, _mm256_set1_epi8(-1)),
+                           odd);
+  }
+};
+
+template <typename M>
+C_LEXER_AVX2 std::size_t avx2_run(const char *p, const char *end) {
+  const char *q = p;
+
+  while (end - q >= 32) {
+    const __m256i v =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(q));
+    const unsigned mask =
+        static_cast<unsigned>(_mm256_movemask_epi8(M::match(v)));
+    if (mask != 0xffffffffu)
+      return static_cast<std::size_t>(q - p) + __builtin_ctz(~mask);
+    q += 32;
+  }
+
+  return static_cast<std::size_t>(q - p) + sse2_run<typename M::tail>(q, end);
+}
+
+const Kernels avx2_kernels = {Isa::AVX2,          "avx2",
+                              avx2_run<Avx2Blank>, avx2_run<Avx2Ident>,
+                              avx2_run<Avx2Digit>, avx2_run<Avx2Plain>,
+                              avx2_run<Avx2Space>, avx2_run<Avx2Line>,
+                              avx2_run<Avx2Stray>};
+
+#endif // C_LEXER_HAVE_AVX2
+
+#if defined(__ARM_NEON)
+
+inline uint8x16_t neon_in_range(uint8x16_t v, char lo, char hi) {
+  return vcleq_u8(vsubq_u8(v, vdupq_n_u8(static_cast<std::uint8_t>(lo))),
+                  vdupq_n_u8(static_cast<std::uint8_t>(hi - lo)));
+}
+
+struct NeonBlank {
+  static constexpr std::uint8_t cls = BLANK;
+  static uint8x16_t match(uint8x16_t v) {
+    return vorrq_u8(vceqq_u8(v, vdupq_n_u8(' ')),
+                    vceqq_u8(v, vdupq_n_u8('\t')));
+  }
+};
+
+struct NeonIdent {
+  static constexpr std::uint8_t cls = IDENT;
+  static uint8x16_t match(uint8x16_t v) {
+    const uint8x16_t lower = vorrq_u8(v, vdupq_n_u8(0x20));
+    return vorrq_u8(vorrq_u8(neon_in_range(v, '0', '9'),
+                             neon_in_range(lower, 'a', 'z')),
+                    vceqq_u8(v, vdupq_n_u8('_')));
+  }
+};
+
+struct NeonDigit {
+  static constexpr std::uint8_t cls = DIGIT;
+  static uint8x16_t match(uint8x16_t v) { return neon_in_range(v, '0', '9'); }
+};
+
+struct NeonPlain {
+  static constexpr std::uint8_t cls = PLAIN;
+  static uint8x16_t match(uint8x16_t v) {
+    return vmvnq_u8(vorrq_u8(neon_in_range(v, '\n', '\r'),
+                             vceqq_u8(v, vdupq_n_u8('*'))));
+  }
+};
+
+struct NeonSpace {
+  static constexpr std::uint8_t cls = SPACE;
+  static uint8x16_t match(uint8x16_t v) {
+    return vorrq_u8(vceqq_u8(v, vdupq_n_u8(' ')),
+                    neon_in_range(v, '\t', '\r'));
+  }
+};
+
+struct NeonLine {
+  static constexpr std::uint8_t cls = LINE;
+  static uint8x16_t match(uint8x16_t v) {
+    return vmvnq_u8(neon_in_range(v, '\n', '\f'));
+  }
+};
+
+struct NeonStray {
+  static constexpr std::uint8_t cls = STRAY;
+  static uint8x16_t match(uint8x16_t v) {
+    const uint8x16_t used =
+        vorrq_u8(neon_in_range(v, '!', '~'), NeonSpace::match(v));
+    const uint8x16_t odd =
+        vorrq_u8(vorrq_u8(vceqq_u8(v, vdupq_n_u8('$')),
+                          vceqq_u8(v, vdupq_n_u8('@'))),
+                 vorrq_u8(vceqq_u8(v, vdupq_n_u8('\\')),
+                          vceqq_u8(v, vdupq_n_u8('`'))));
+    return vorrq_u8(vmvnq_u8(used), odd);
+  }
+};
+
+template <typename M> std::size_t neon_run(const char *p, const char *end) {
+  const char *q = p;
+
+  while (end - q >= 16) {
+    const uint8x16_t m =
+        M::match(vld1q_u8(reinterpret_cast<const std::uint8_t *>(q)));
+    // Narrow each byte of the match to a nibble of a 64-bit mask.
+    const std::uint64_t mask = vget_lane_u64(
+        vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(m), 4)), 0);
+    if (mask != ~std::uint64_t(0))
+      return static_cast<std::size_t>(q - p) + (__builtin_ctzll(~mask) >> 2);
+    q += 16;
+  }
+
+  return static_cast<std::size_t>(q - p) + scalar_run<M::cls>(q, end);
+}
+
+const Kernels neon_kernels = {Isa::NEON,          "neon",
+                              neon_run<NeonBlank>, neon_run<NeonIdent>,
+                              neon_run<NeonDigit>, neon_run<NeonPlain>,
+                              neon_run<NeonSpace>, neon_run<NeonLine>,
+                              neon_run<NeonStray>};
+
+#endif // __ARM_NEON
+
+const Kernels *kernels_for(Isa isa) {
+  switch (isa) {
+  case Isa::SCALAR:
+    return &scalar_kernels;
+  case Isa::SSE2:
+#if defined(__SSE2__)
+    return &sse2_kernels;
+#else
+    return nullptr;
+#endif
+  case Isa::AVX2:
+#if defined(C_LEXER_HAVE_AVX2)
+    return __builtin_cpu_supports("avx2") ? &avx2_kernels : nullptr;
+#else
+    return nullptr;
+#endif
+  case Isa::NEON:
+#if defined(__ARM_NEON)
+    return &neon_kernels;
+#else
+    return nullptr;
+#endif
+  }
+  return nullptr;
+}
+
+const Kernels &kernels() {
+  static const Kernels &best = []() -> const Kernels & {
+    for (Isa isa : {Isa::AVX2, Isa::SSE2, Isa::NEON})
+      if (const Kernels *k = kernels_for(isa))
+        return *k;
+    return scalar_kernels;
+  }();
+  return best;
+}
+
+} // namespace simd
+} // namespace c_lexer
@@ -0,0 +1,75 @@
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace c_lexer {
+namespace simd {
+
+// Character classes shared by the scalar scanner and the run kernels, so that
+// the two can never disagree. They are plain ASCII, independent of locale.
+enum : std::uint8_t {
+  BLANK = 1 << 0, // ' ' '\t'
+  DIGIT = 1 << 1, // [0-9]
+  IDENT = 1 << 2, // [A-Za-z0-9_]
+  ALPHA = 1 << 3, // [A-Za-z_]
+  PLAIN = 1 << 4, // anything but '*' and [\n\v\f\r], within a comment
+  SPACE = 1 << 5, // ' ' [\t\n\v\f\r]
+  LINE = 1 << 6,  // anything but the line breaks [\n\v\f]
+  STRAY = 1 << 7, // begins no token: controls, $ @ \\ ` and 0x7f-0xff
+};
+
+extern const std::array<std::uint8_t, 256> char_class;
+
+inline bool is_class(char c, std::uint8_t cls) {
+  return (char_class[static_cast<unsigned char>(c)] & cls) != 0;
+}
+
+// A run kernel returns the number of leading characters of [p, end) that
+// belong to its class. It never reads at or beyond end.
+using run_fn = std::size_t (*)(const char *p, const char *end);
+
+enum class Isa { SCALAR, SSE2, AVX2, NEON };
+
+struct Kernels {
+  Isa isa;
+  const char *name;
+  run_fn blank_run;
+  run_fn ident_run;
+  run_fn digit_run;
+  run_fn plain_run;
+  run_fn space_run;
+  run_fn line_run;
+  run_fn stray_run;
+};
+
+// The fastest kernels that this build and CPU support, chosen on first use.
+const Kernels &kernels();
+
+// The kernels for isa, or nullptr when this build or CPU lacks them.
+const Kernels *kernels_for(Isa isa);
+
+} // namespace simd
+} // namespace c_lexer
@@ -0,0 +1,261 @@
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <c_lexer/SourceReader.h>
+
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace c_lexer {
+
+// The size of the block read from a std::istream by each fill().
+const std::size_t stream_block_size = 64 * 1024;
+
+// How far ahead of cur_ a contiguous reader looks for the next splice. The
+// window ends there when there is none, and fill() resumes the search.
+const std::size_t splice_horizon = 64 * 1024;
+
+SourceReader::SourceReader()
+    : input_(nullptr), base_(0), begin_(nullptr), cur_(nullptr),
+      end_(nullptr), stop_(nullptr), splice_len_(0), next_splice_(0),
+      resume_(nullptr), resume_count_(0), resume_first_len_(0),
+      resume_len_(0), resume_splice_end_(0), splices_(0), splice_end_(0),
+      eof_(false) {}
+
+// A block, plus the putback character and the two characters that may be
+// read past it to complete a splice.
+SourceReader::SourceReader(std::istream &input)
+    : input_(&input), buf_(new char[stream_block_size + 3]), base_(0),
+      begin_(buf_.get()), cur_(buf_.get()), end_(buf_.get()),
+      stop_(buf_.get()), splice_len_(0), next_splice_(0), resume_(nullptr),
+      resume_count_(0), resume_first_len_(0), resume_len_(0),
+      resume_splice_end_(0), splices_(0), splice_end_(0), eof_(false) {}
+
+SourceReader::SourceReader(const char *data, std::size_t size)
+    : input_(nullptr), base_(0), begin_(data), cur_(data), end_(data),
+      stop_(data + size), splice_len_(0), next_splice_(0), resume_(nullptr),
+      resume_count_(0), resume_first_len_(0), resume_len_(0),
+      resume_splice_end_(0), splices_(0), splice_end_(0), eof_(false) {
+  find_splice();
+}
+
+bool SourceReader::fill() {
+  while (cur_ == end_) {
+    if (splice_len_) {
+      // A contiguous reader steps over the splice's characters; a stream
+      // reader has already removed them from the block.
+      if (cur_ != resume_) {
+        resume_count_ = 0;
+        resume_first_len_ = splice_len_;
+        resume_len_ = 0;
+        resume_splice_end_ = splice_end_;
+      }
+      if (input_)
+        base_ += splice_len_;
+      else
+        cur_ += splice_len_;
+      ++splices_;
+      splice_end_ = offset();
+      resume_ = cur_;
+      ++resume_count_;
+      resume_len_ += splice_len_;
+      ++next_splice_;
+      find_splice();
+    } else if (end_ != stop_) {
+      find_splice(); // the search horizon
+    } else if (!input_ || !read_block()) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void SourceReader::find_splice() {
+  if (input_) {
+    if (next_splice_ < block_splices_.size()) {
+      end_ = begin_ + block_splices_[next_splice_].pos;
+      splice_len_ = block_splices_[next_splice_].len;
+    } else {
+      end_ = stop_;
+      splice_len_ = 0;
+    }
+    return;
+  }
+
+  const char *horizon =
+      static_cast<std::size_t>(stop_ - cur_) > splice_horizon
+          ? cur_ + splice_horizon
+          : stop_;
+  for (const char *p = cur_; p < horizon; ++p) {
+    p = static_cast<const char *>(std::memchr(p, '\\', horizon - p));
+    if (!p)
+      break;
+    if ((splice_len_ = splice_length(p, stop_))) {
+      end_ = p;
+      return;
+    }
+  }
+
+  end_ = horizon;
+  splice_len_ = 0;
+}
+
+// Put the splices just stepped over back in front of cur_, so that the
+// character before them can be read again.
+void SourceReader::restore_splice() {
+  if (input_)
+    base_ -= resume_len_;
+  else
+    cur_ -= resume_len_;
+  splices_ -= resume_count_;
+  splice_end_ = resume_splice_end_;
+  next_splice_ -= resume_count_;
+  end_ = cur_;
+  splice_len_ = resume_first_len_;
+  resume_ = nullptr;
+}
+
+bool SourceReader::read_block() {
+  if (input_->peek() == std::char_traits<char>::eof())
+    return false;
+
+  // Splices at the very end of the last block go to the front of this one,
+  // so that the character before them can still be put back.
+  std::size_t carried = 0;
+  if (cur_ == resume_) {
+    carried = resume_count_;
+    restore_splice();
+  }
+
+  char *buf = buf_.get();
+  const std::size_t consumed = offset();
+  std::size_t keep = 0;
+
+  // Preserve the most recently read character so that unget() remains valid
+  // across the boundary between two blocks.
+  if (cur_ > buf) {
+    buf[0] = cur_[-1];
+    keep = 1;
+  }
+
+  input_->read(buf + keep, stream_block_size);
+  char *end = buf + keep + input_->gcount();
+
+  // Read on to settle whether a backslash ending the block begins a splice.
+  if (end[-1] == '\\' && input_->peek() == '\r')
+    *end++ = static_cast<char>(input_->get());
+  if ((end[-1] == '\\' ||
+       (end[-1] == '\r' && end - buf >= 2 && end[-2] == '\\')) &&
+      input_->peek() == '\n')
+    *end++ = static_cast<char>(input_->get());
+
+  block_splices_.erase(block_splices_.begin(),
+                       block_splices_.begin() + next_splice_);
+  block_splices_.resize(carried);
+  for (Splice &splice : block_splices_)
+    splice.pos = keep;
+  next_splice_ = 0;
+
+  // Remove the block's splices, remembering where each one was.
+  char *out = buf + keep;
+  const char *in = out;
+  for (const char *p = in; p < end; ++p) {
+    p = static_cast<const char *>(std::memchr(p, '\\', end - p));
+    if (!p)
+      break;
+    const std::size_t len = splice_length(p, end);
+    if (len) {
+      std::memmove(out, in, p - in);
+      out += p - in;
+      block_splices_.push_back({static_cast<std::size_t>(out - buf), len});
+      in = p + len;
+      p = in - 1;
+    }
+  }
+  std::memmove(out, in, end - in);
+  out += end - in;
+
+  base_ = consumed - keep;
+  begin_ = buf;
+  cur_ = buf + keep;
+  stop_ = out;
+  resume_ = nullptr;
+  find_splice();
+
+  return true;
+}
+
+std::string unsplice(std::string_view text) {
+  std::string s;
+  s.reserve(text.size());
+
+  const char *p = text.data();
+  const char *end = p + text.size();
+  while (p < end) {
+    const std::size_t len = splice_length(p, end);
+    if (len)
+      p += len;
+    else
+      s.push_back(*p++);
+  }
+
+  return s;
+}
+
+MappedSourceReader::MappedSourceReader(const char *path)
+    : map_(nullptr), map_size_(0), is_open_(false) {
+  const int fd = ::open(path, O_RDONLY);
+  if (fd < 0)
+    return;
+
+  struct stat st;
+  if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+    map_size_ = static_cast<std::size_t>(st.st_size);
+    if (!map_size_) {
+      is_open_ = true;
+    } else {
+      void *p = ::mmap(nullptr, map_size_, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (p != MAP_FAILED) {
+        ::madvise(p, map_size_, MADV_SEQUENTIAL);
+        map_ = p;
+        is_open_ = true;
+        set_buffer(static_cast<const char *>(map_), map_size_);
+      } else {
+        map_size_ = 0;
+      }
+    }
+  }
+
+  ::close(fd);
+}
+
+MappedSourceReader::~MappedSourceReader() {
+  if (map_)
+    ::munmap(map_, map_size_);
+}
+
+} // namespace c_lexer
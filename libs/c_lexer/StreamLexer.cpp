@@ -0,0 +1,145 @@
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <c_lexer/StreamLexer.h>
+
+#include <algorithm>
+#include <memory>
+
+namespace c_lexer {
+
+StreamLexer::StreamLexer(Callback &&callback, std::uint32_t flags)
+    : callback_(std::move(callback)), flags_(flags), comment_(false),
+      scan_(0), offset_(0), row_(1), col_(1), line_(Lexer::LINE_START),
+      symbols_(nullptr) {}
+
+// The last newline of piece that ends a line, rather than being spliced to
+// the next one, where before holds what came ahead of piece.
+static std::size_t last_line_end(std::string_view piece,
+                                 std::string_view before) {
+  // The character back places ahead of piece[i].
+  auto ahead = [&](std::size_t i, std::size_t back) {
+    if (back <= i)
+      return piece[i - back];
+    back -= i;
+    return back <= before.size() ? before[before.size() - back] : '\0';
+  };
+
+  for (std::size_t nl = piece.rfind('\n'); nl != std::string_view::npos;
+       nl = nl ? piece.rfind('\n', nl - 1) : std::string_view::npos) {
+    const char prev = ahead(nl, 1);
+    if (prev != '\\' && (prev != '\r' || ahead(nl, 2) != '\\'))
+      return nl;
+  }
+  return std::string_view::npos;
+}
+
+void StreamLexer::feed(const char *data, std::size_t n) {
+  // While a comment is open, only its end is looked for.
+  if (comment_) {
+    pending_.append(data, n);
+
+    const std::size_t close = pending_.find("*/", scan_);
+    if (close == std::string::npos) {
+      scan_ = pending_.size() - 1; // the '*' of a "*/" split between pieces
+      return;
+    }
+
+    comment_ = false;
+    const std::size_t nl = last_line_end(pending_, {});
+    if (nl != std::string::npos && nl > close)
+      lex_pending(nl + 1);
+    return;
+  }
+
+  const std::string_view piece(data, n);
+  const std::size_t nl = last_line_end(piece, pending_);
+
+  if (nl == std::string_view::npos) {
+    pending_.append(data, n);
+    return;
+  }
+
+  // Lex straight from the caller's buffer when nothing is held back.
+  if (pending_.empty()) {
+    const std::size_t done = lex(piece.substr(0, nl + 1), false);
+    pending_.assign(data + done, n - done);
+  } else {
+    pending_.append(data, n);
+    lex_pending(pending_.size() - (n - nl - 1));
+  }
+}
+
+void StreamLexer::finish() {
+  lex(pending_, true);
+  pending_.clear();
+  comment_ = false;
+}
+
+void StreamLexer::lex_pending(std::size_t n) {
+  const std::size_t done = lex(std::string_view(pending_).substr(0, n), false);
+  pending_.erase(0, done);
+}
+
+// Comments are always scanned as tokens, so that an open one is seen, and are
+// dropped here unless the caller asked for them.
+std::size_t StreamLexer::lex(std::string_view s, bool last) {
+  std::uint32_t flags = flags_ | Lexer::KEEP_COMMENTS;
+  if (!last)
+    flags |= Lexer::OPEN_ENDED;
+
+  Lexer lexer(std::make_unique<SourceReader>(s), flags, row_, col_, line_);
+  lexer.set_symbols(symbols_);
+  const bool keep_comments = flags_ & Lexer::KEEP_COMMENTS;
+
+  for (;;) {
+    Lexeme l = lexer.eat();
+    const bool open_comment =
+        l.token() == Token::INVALID && is_comment(l.token(), l.text());
+
+    if (!last && (l.token() == Token::END || open_comment)) {
+      const std::size_t done = l.offset_;
+      row_ = l.row_;
+      col_ = l.col_;
+      line_ = lexer.line_state();
+      offset_ += done;
+      if (open_comment) {
+        comment_ = true;
+        scan_ = std::max<std::size_t>(s.size() - done - 1, 2);
+      }
+      return done;
+    }
+
+    if (keep_comments || !is_comment(l.token(), l.text())) {
+      l.offset_ += offset_;
+      callback_(l);
+    }
+
+    if (l.token() == Token::END)
+      break;
+  }
+
+  offset_ += s.size();
+  return s.size();
+}
+
+} // namespace c_lexer
@@ -0,0 +1,261 @@
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include <c_lexer/StringValue.h>
+
+#include <cctype>
+#include <cstring>
+
+namespace c_lexer {
+
+static unsigned hex_value(char c) {
+  return std::isdigit(static_cast<unsigned char>(c))
+             ? static_cast<unsigned>(c - '0')
+             : static_cast<unsigned>(std::tolower(c) - 'a' + 10);
+}
+
+static bool is_code_point(std::uint32_t cp) {
+  return cp <= 0x10ffff && (cp < 0xd800 || cp > 0xdfff);
+}
+
+// Decodes into units of type U, which are UTF-8, UTF-16 or UTF-32 code units
+// by their size.
+template <typename U> class Decoder {
+public:
+  Decoder(U *out, StringValue &value) : out_(out), begin_(out), value_(value) {}
+
+  std::size_t size() const { return static_cast<std::size_t>(out_ - begin_); }
+
+  void decode(const char *p, const char *end) {
+    while (p < end) {
+      if (*p == '\\') {
+        p = escape(p + 1, end);
+        continue;
+      }
+
+      const char *stop = p;
+      if constexpr (sizeof(U) == 1) {
+        // Unescaped text is already UTF-8.
+        stop = static_cast<const char *>(std::memchr(p, '\\', end - p));
+        if (!stop)
+          stop = end;
+        std::memcpy(out_, p, stop - p);
+        out_ += stop - p;
+      } else {
+        while (stop < end && *stop != '\\' &&
+               static_cast<unsigned char>(*stop) < 0x80)
+          *out_++ = static_cast<U>(*stop++);
+        if (stop < end && *stop != '\\')
+          stop = utf8(stop, end);
+      }
+      p = stop;
+    }
+  }
+
+protected:
+  // A code unit from an octal or hex escape.
+  void unit(std::uint32_t u) {
+    if constexpr (sizeof(U) < 4) {
+      if (u >> (8 * sizeof(U)))
+        value_.ok = false;
+    }
+    *out_++ = static_cast<U>(u);
+  }
+
+  void code_point(std::uint32_t cp) {
+    if (!is_code_point(cp))
+      value_.ok = false;
+
+    if constexpr (sizeof(U) == 1) {
+      if (cp < 0x80) {
+        *out_++ = static_cast<U>(cp);
+      } else if (cp < 0x800) {
+        *out_++ = static_cast<U>(0xc0 | cp >> 6);
+        *out_++ = static_cast<U>(0x80 | (cp & 0x3f));
+      } else if (cp < 0x10000) {
+        *out_++ = static_cast<U>(0xe0 | cp >> 12);
+        *out_++ = static_cast<U>(0x80 | (cp >> 6 & 0x3f));
+        *out_++ = static_cast<U>(0x80 | (cp & 0x3f));
+      } else {
+        *out_++ = static_cast<U>(0xf0 | (cp >> 18 & 0x07));
+        *out_++ = static_cast<U>(0x80 | (cp >> 12 & 0x3f));
+        *out_++ = static_cast<U>(0x80 | (cp >> 6 & 0x3f));
+        *out_++ = static_cast<U>(0x80 | (cp & 0x3f));
+      }
+    } else if constexpr (sizeof(U) == 2) {
+      if (cp < 0x10000 || cp > 0x10ffff) {
+        *out_++ = static_cast<U>(cp);
+      } else {
+        cp -= 0x10000;
+        *out_++ = static_cast<U>(0xd800 | cp >> 10);
+        *out_++ = static_cast<U>(0xdc00 | (cp & 0x3ff));
+      }
+    } else {
+      *out_++ = static_cast<U>(cp);
+    }
+  }
+
+  // Transcode the UTF-8 sequence at p. A byte that does not begin a valid
+  // sequence is passed through as a unit of its own.
+  const char *utf8(const char *p, const char *end) {
+    static const std::uint32_t min_cp[] = {0, 0, 0x80, 0x800, 0x10000};
+    const unsigned char lead = static_cast<unsigned char>(*p);
+    const std::size_t n = lead >= 0xf8   ? 0
+                          : lead >= 0xf0 ? 4
+                          : lead >= 0xe0 ? 3
+                          : lead >= 0xc0 ? 2
+                                         : 0;
+    std::uint32_t cp = lead & (0x7f >> n);
+
+    bool valid = n && static_cast<std::size_t>(end - p) >= n;
+    for (std::size_t i = 1; valid && i < n; ++i) {
+      const unsigned char c = static_cast<unsigned char>(p[i]);
+      valid = (c & 0xc0) == 0x80;
+      cp = cp << 6 | (c & 0x3f);
+    }
+
+    if (!valid || cp < min_cp[n] || !is_code_point(cp)) {
+      value_.ok = false;
+      *out_++ = static_cast<U>(lead);
+      return p + 1;
+    }
+
+    code_point(cp);
+    return p + n;
+  }
+
+  // Decode the escape whose backslash came before p.
+  const char *escape(const char *p, const char *end) {
+    const char c = *p++;
+    switch (c) {
+    case 'a':
+      unit('\a');
+      return p;
+    case 'b':
+      unit('\b');
+      return p;
+    case 'f':
+      unit('\f');
+      return p;
+    case 'n':
+      unit('\n');
+      return p;
+    case 'r':
+      unit('\r');
+      return p;
+    case 't':
+      unit('\t');
+      return p;
+    case 'v':
+      unit('\v');
+      return p;
+    case 'x': {
+      std::uint32_t u = 0;
+      for (; p < end && std::isxdigit(static_cast<unsigned char>(*p)); ++p) {
+        if (u >> 28)
+          value_.ok = false;
+        u = u << 4 | hex_value(*p);
+      }
+      unit(u);
+      return p;
+    }
+    case 'u':
+    case 'U': {
+      std::uint32_t cp = 0;
+      for (int i = c == 'u' ? 4 : 8; i && p < end; --i)
+        cp = cp << 4 | hex_value(*p++);
+      code_point(cp);
+      return p;
+    }
+    default:
+      if (c >= '0' && c <= '7') {
+        std::uint32_t u = static_cast<std::uint32_t>(c - '0');
+        for (int i = 0; i < 2 && p < end && *p >= '0' && *p <= '7'; ++i)
+          u = u << 3 | static_cast<std::uint32_t>(*p++ - '0');
+        unit(u);
+        return p;
+      }
+      unit(static_cast<unsigned char>(c)); // ' " ? and backslash
+      return p;
+    }
+  }
+
+  U *out_;
+  U *const begin_;
+  StringValue &value_;
+};
+
+template <typename U>
+static void decode_units(const char *p, const char *end, Arena &arena,
+                         StringValue &value) {
+  // No escape or UTF-8 sequence makes more units than it has bytes.
+  const std::size_t capacity = static_cast<std::size_t>(end - p) * sizeof(U);
+  U *const out = static_cast<U *>(arena.allocate(capacity, alignof(U)));
+
+  Decoder<U> decoder(out, value);
+  decoder.decode(p, end);
+
+  arena.shrink(out, capacity, decoder.size() * sizeof(U));
+  value.data = out;
+  if (decoder.size() <= std::numeric_limits<std::uint32_t>::max())
+    value.size = static_cast<std::uint32_t>(decoder.size());
+  else
+    value.ok = false;
+}
+
+bool decode_string(std::string_view spelling, Arena &arena,
+                   StringValue &value) {
+  value = StringValue();
+
+  std::size_t i = 0;
+  StringValue::Encoding encoding = StringValue::PLAIN;
+  if (spelling.substr(0, 2) == "u8") {
+    encoding = StringValue::UTF8;
+    i = 2;
+  } else if (!spelling.empty() && std::strchr("uUL", spelling[0])) {
+    encoding = spelling[0] == 'u'   ? StringValue::UTF16
+               : spelling[0] == 'U' ? StringValue::UTF32
+                                    : StringValue::WIDE;
+    i = 1;
+  }
+
+  if (spelling.size() < i + 2 || (spelling[i] != '"' && spelling[i] != '\''))
+    return true;
+
+  value.encoding = encoding;
+  const char *const p = spelling.data() + i + 1;
+  const char *const end = spelling.data() + spelling.size() - 1;
+  switch (value.unit_size()) {
+  case 1:
+    decode_units<char>(p, end, arena, value);
+    break;
+  case 2:
+    decode_units<char16_t>(p, end, arena, value);
+    break;
+  default:
+    decode_units<char32_t>(p, end, arena, value);
+    break;
+  }
+
+  return value.ok;
+}
+
+} // namespace c_lexer
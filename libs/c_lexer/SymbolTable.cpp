@@ -0,0 +1,100 @@
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include <c_lexer/SymbolTable.h>
+
+namespace c_lexer {
+
+SymbolTable::SymbolTable(bool shared, Arena *arena)
+    : shared_(shared), slots_(1024, 0), names_arena_(arena ? *arena : own_) {}
+
+std::uint32_t SymbolTable::intern(std::string_view name) {
+  const std::uint32_t h = hash(name);
+  const auto guard = lock();
+
+  std::size_t slot = probe(name, h);
+  if (slots_[slot])
+    return slots_[slot] - 1;
+
+  // Keep the load at most one half, so that probes stay short.
+  if (2 * (names_.size() + 1) > slots_.size()) {
+    grow();
+    slot = probe(name, h);
+  }
+
+  const std::uint32_t id = static_cast<std::uint32_t>(names_.size());
+  names_.push_back(names_arena_.copy(name));
+  hashes_.push_back(h);
+  slots_[slot] = id + 1;
+  return id;
+}
+
+std::uint32_t SymbolTable::find(std::string_view name) const {
+  const std::uint32_t h = hash(name);
+  const auto guard = lock();
+  const std::uint32_t id = slots_[probe(name, h)];
+  return id ? id - 1 : no_symbol;
+}
+
+std::string_view SymbolTable::name(std::uint32_t id) const {
+  const auto guard = lock();
+  return names_[id];
+}
+
+std::size_t SymbolTable::size() const {
+  const auto guard = lock();
+  return names_.size();
+}
+
+// FNV-1a.
+std::uint32_t SymbolTable::hash(std::string_view name) {
+  std::uint32_t h = 2166136261u;
+  for (const char c : name) {
+    h ^= static_cast<unsigned char>(c);
+    h *= 16777619u;
+  }
+  return h;
+}
+
+std::size_t SymbolTable::probe(std::string_view name, std::uint32_t h) const {
+  const std::size_t mask = slots_.size() - 1;
+  for (std::size_t slot = h & mask;; slot = (slot + 1) & mask) {
+    const std::uint32_t id = slots_[slot];
+    if (!id || (hashes_[id - 1] == h && names_[id - 1] == name))
+      return slot;
+  }
+}
+
+void SymbolTable::grow() {
+  std::vector<std::uint32_t> slots(2 * slots_.size(), 0);
+  const std::size_t mask = slots.size() - 1;
+
+  for (std::uint32_t id = 0; id < names_.size(); ++id) {
+    std::size_t slot = hashes_[id] & mask;
+    while (slots[slot])
+      slot = (slot + 1) & mask;
+    slots[slot] = id + 1;
+  }
+
+  slots_.swap(slots);
+}
+
+} // namespace c_lexer
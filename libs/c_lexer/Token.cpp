@@ -80,10 +80,14 @@ const char *ttos[static_cast<std::underlying_type_t<Token>>(Token::INVALID) +
                        "RSQUARE",  // ]
                        "SEMI",     // ;
 
+                       "HASH",      // #
+                       "HASH_HASH", // ##
+
                        "IDENTIFIER",
                        "INTEGER_LIT", // 123  0xbeef '\n'
                        "FLOAT_LIT",   // 3.14
                        "STRING_LIT",  // "abc"
+                       "HEADER_NAME", // <stdio.h> "local.h" (after #include)
 
                        "ALIGNAS",        // alignas (C23)
                        "ALIGNOF",        // alignof (C23)
@@ -144,6 +148,15 @@ const char *ttos[static_cast<std::underlying_type_t<Token>>(Token::INVALID) +
                        "_NORETURN",      // _Noreturn (C11)
                        "_STATIC_ASSERT", // _Static_assert (C11)
                        "_THREAD_LOCAL",  // _Thread_local (C11)
+                       "ASM",            // asm __asm __asm__ (GNU)
+                       "ATTRIBUTE",      // __attribute __attribute__ (GNU)
+                       "AUTO_TYPE",      // __auto_type (GNU)
+                       "EXTENSION",      // __extension__ (GNU)
+                       "INT128",         // __int128 (GNU)
+                       "LABEL",          // __label__ (GNU)
+
+                       "NEWLINE", // the end of a preprocessing directive
+                       "COMMENT",
 
                        "END",
                        "INVALID"};
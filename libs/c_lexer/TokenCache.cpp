@@ -0,0 +1,340 @@
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <c_lexer/SourceReader.h>
+#include <c_lexer/TokenCache.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+#include <unordered_map>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace c_lexer {
+
+// Bump when the layout written by serialize_tokens() changes.
+static constexpr std::uint64_t format_version = 3;
+static constexpr char magic[4] = {'C', 'L', 'X', 'T'};
+static constexpr std::size_t num_kinds =
+    static_cast<std::underlying_type_t<Token>>(Token::INVALID) + 1;
+
+std::uint64_t token_format_stamp() {
+  // FNV-1a over the version and the name of every Token, in order. Adding,
+  // removing or reordering tokens changes the value of some kind byte.
+  std::uint64_t h = 0xcbf29ce484222325ull;
+  const auto mix = [&h](unsigned char c) {
+    h ^= c;
+    h *= 0x100000001b3ull;
+  };
+  for (int i = 0; i < 8; ++i)
+    mix(static_cast<unsigned char>(format_version >> (8 * i)));
+  for (std::size_t i = 0; i < num_kinds; ++i) {
+    for (const char *p = ttos[i]; *p; ++p)
+      mix(static_cast<unsigned char>(*p));
+    mix(0);
+  }
+  return h;
+}
+
+static std::uint64_t rotl(std::uint64_t x, int r) {
+  return (x << r) | (x >> (64 - r));
+}
+
+static std::uint64_t fmix(std::uint64_t k) {
+  k ^= k >> 33;
+  k *= 0xff51afd7ed558ccdull;
+  k ^= k >> 33;
+  k *= 0xc4ceb9fe1a85ec53ull;
+  k ^= k >> 33;
+  return k;
+}
+
+// One lane of MurmurHash3, a word at a time, with the constants of lane 1 or
+// lane 2 of its 128-bit form.
+template <std::uint64_t c1, std::uint64_t c2, int r1, int r2, std::uint64_t add>
+static std::uint64_t murmur_lane(std::string_view s) {
+  const char *p = s.data();
+  const char *const end = p + s.size();
+  std::uint64_t h = s.size();
+
+  for (; end - p >= 8; p += 8) {
+    std::uint64_t k;
+    std::memcpy(&k, p, 8);
+    h ^= rotl(k * c1, r1) * c2;
+    h = rotl(h, r2) * 5 + add;
+  }
+
+  std::uint64_t k = 0;
+  for (int i = 0; p < end; ++p, i += 8)
+    k |= std::uint64_t(static_cast<unsigned char>(*p)) << i;
+  h ^= rotl(k * c1, r1) * c2;
+  return fmix(h);
+}
+
+std::uint64_t hash_source(std::string_view s) {
+  return murmur_lane<0x87c37b91114253d5ull, 0x4cf5ad432745937full, 31, 27,
+                     0x52dce729>(s);
+}
+
+std::uint64_t check_source(std::string_view s) {
+  return murmur_lane<0x4cf5ad432745937full, 0x87c37b91114253d5ull, 33, 31,
+                     0x38495ab5>(s);
+}
+
+static void put_varint(std::string &out, std::uint64_t v) {
+  for (; v >= 0x80; v >>= 7)
+    out.push_back(static_cast<char>(v | 0x80));
+  out.push_back(static_cast<char>(v));
+}
+
+static void put_fixed(std::string &out, std::uint64_t v) {
+  for (int i = 0; i < 8; ++i)
+    out.push_back(static_cast<char>(v >> (8 * i)));
+}
+
+// Reads what put_varint() and put_fixed() wrote, failing at the end of the
+// data rather than reading past it.
+struct CacheReader {
+  const unsigned char *p;
+  const unsigned char *end;
+  bool ok = true;
+
+  std::uint64_t varint() {
+    std::uint64_t v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      if (p == end)
+        break;
+      const unsigned char c = *p++;
+      v |= std::uint64_t(c & 0x7f) << shift;
+      if (!(c & 0x80))
+        return v;
+    }
+    ok = false;
+    return 0;
+  }
+
+  std::uint64_t fixed() {
+    if (end - p < 8) {
+      ok = false;
+      return 0;
+    }
+    std::uint64_t v = 0;
+    for (int i = 0; i < 8; ++i)
+      v |= std::uint64_t(*p++) << (8 * i);
+    return v;
+  }
+
+  const unsigned char *bytes(std::uint64_t n) {
+    if (std::uint64_t(end - p) < n) {
+      ok = false;
+      return nullptr;
+    }
+    const unsigned char *b = p;
+    p += n;
+    return b;
+  }
+};
+
+static std::string identifier_name(std::string_view text) {
+  return text.find('\\') == std::string_view::npos ? std::string(text)
+                                                   : unsplice(text);
+}
+
+std::string serialize_tokens(const TokenStream &ts, std::string_view source,
+                             std::uint32_t flags) {
+  const std::size_t n = ts.size();
+  std::string out;
+  out.reserve(32 + 4 * n);
+
+  out.append(magic, sizeof(magic));
+  put_fixed(out, token_format_stamp());
+  put_fixed(out, hash_source(source));
+  put_fixed(out, check_source(source));
+  put_varint(out, source.size());
+  put_varint(out, flags);
+
+  std::unordered_map<std::string, std::uint32_t> index;
+  std::vector<const std::string *> names;
+  std::vector<std::uint32_t> refs;
+  for (std::size_t i = 0; i < n; ++i) {
+    if (ts.token(i) != Token::IDENTIFIER)
+      continue;
+    const auto r = index.emplace(identifier_name(source.substr(
+                                     ts.offset(i), ts.length(i))),
+                                 std::uint32_t(names.size()));
+    if (r.second)
+      names.push_back(&r.first->first);
+    refs.push_back(r.first->second);
+  }
+
+  put_varint(out, n);
+  out.append(reinterpret_cast<const char *>(ts.kinds().data()), n);
+  out.append(reinterpret_cast<const char *>(ts.line_states().data()), n);
+
+  put_varint(out, names.size());
+  for (const std::string *name : names) {
+    put_varint(out, name->size());
+    out.append(*name);
+  }
+
+  std::uint32_t prev_end = 0;
+  auto ref = refs.begin();
+  for (std::size_t i = 0; i < n; ++i) {
+    put_varint(out, ts.offset(i) - prev_end);
+    put_varint(out, ts.length(i));
+    if (ts.token(i) == Token::IDENTIFIER)
+      put_varint(out, *ref++);
+    prev_end = ts.offset(i) + ts.length(i);
+  }
+  return out;
+}
+
+static bool read_tokens(CacheReader &r, std::string_view source,
+                        std::uint32_t flags, TokenStream &ts) {
+  const unsigned char *m = r.bytes(sizeof(magic));
+  if (!r.ok || std::memcmp(m, magic, sizeof(magic)) ||
+      r.fixed() != token_format_stamp() ||
+      r.fixed() != hash_source(source) || r.fixed() != check_source(source) ||
+      r.varint() != source.size() ||
+      r.varint() != flags)
+    return false;
+
+  const std::uint64_t n = r.varint();
+  const unsigned char *kinds = r.bytes(n);
+  const unsigned char *lines = r.bytes(n);
+  if (!r.ok || !n ||
+      kinds[n - 1] != static_cast<std::uint8_t>(Token::END))
+    return false;
+
+  const std::uint64_t num_names = r.varint();
+  if (!r.ok || num_names > n)
+    return false;
+  SymbolTable *const symbols = ts.symbols();
+  std::vector<std::uint32_t> ids;
+  if (symbols)
+    ids.reserve(num_names);
+  for (std::uint64_t i = 0; i < num_names; ++i) {
+    const std::uint64_t size = r.varint();
+    const char *name = reinterpret_cast<const char *>(r.bytes(size));
+    if (!r.ok)
+      return false;
+    if (symbols)
+      ids.push_back(symbols->intern(std::string_view(name, size)));
+  }
+
+  ts.reserve(n);
+  std::uint64_t prev_end = 0;
+  for (std::uint64_t i = 0; i < n; ++i) {
+    const Token token = static_cast<Token>(kinds[i]);
+    const std::uint64_t offset = prev_end + r.varint();
+    const std::uint64_t length = r.varint();
+    std::uint32_t symbol = no_symbol;
+    if (token == Token::IDENTIFIER) {
+      const std::uint64_t ref = r.varint();
+      if (ref >= num_names)
+        return false;
+      if (symbols)
+        symbol = ids[ref];
+    }
+    if (!r.ok || kinds[i] >= num_kinds || lines[i] > Lexer::DIRECTIVE ||
+        offset + length > source.size())
+      return false;
+    ts.push_back(token, std::uint32_t(offset), std::uint32_t(length),
+                 static_cast<Lexer::LineState>(lines[i]), symbol);
+    prev_end = offset + length;
+  }
+  return r.p == r.end;
+}
+
+bool deserialize_tokens(std::string_view data, std::string_view source,
+                        std::uint32_t flags, TokenStream &ts) {
+  ts.reset(source);
+  CacheReader r{reinterpret_cast<const unsigned char *>(data.data()),
+                reinterpret_cast<const unsigned char *>(data.data()) +
+                    data.size()};
+  if (read_tokens(r, source, flags, ts))
+    return true;
+  ts.reset(source);
+  return false;
+}
+
+TokenCache::TokenCache(std::string dir)
+    : dir_(std::move(dir)), hits_(0), misses_(0), temp_(0) {
+  if (!dir_.empty())
+    ::mkdir(dir_.c_str(), 0777);
+}
+
+std::string TokenCache::path(std::string_view source,
+                             std::uint32_t flags) const {
+  char name[48];
+  std::snprintf(name, sizeof(name), "/%016llx-%x.ctok",
+                static_cast<unsigned long long>(hash_source(source)),
+                static_cast<unsigned>(flags));
+  return dir_ + name;
+}
+
+bool TokenCache::load(std::string_view source, std::uint32_t flags,
+                      TokenStream &ts) const {
+  MappedSourceReader map(path(source, flags).c_str());
+  if (!map.is_open()) {
+    ts.reset(source);
+    return false;
+  }
+  return deserialize_tokens(map.text(), source, flags, ts);
+}
+
+bool TokenCache::store(std::string_view source, std::uint32_t flags,
+                       const TokenStream &ts) {
+  const std::string data = serialize_tokens(ts, source, flags);
+  const std::string dest = path(source, flags);
+  const std::string temp = dest + ".tmp" + std::to_string(getpid()) + "-" +
+                           std::to_string(temp_++);
+
+  std::ofstream f(temp, std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!f.is_open())
+    return false;
+  f.write(data.data(), static_cast<std::streamsize>(data.size()));
+  f.close();
+  if (!f || std::rename(temp.c_str(), dest.c_str())) {
+    std::remove(temp.c_str());
+    return false;
+  }
+  return true;
+}
+
+std::size_t TokenCache::scan_tokens(std::string_view source, TokenStream &ts,
+                                    std::uint32_t flags) {
+  if (source.size() <= 0xffffffffu && load(source, flags, ts)) {
+    ++hits_;
+    return ts.size();
+  }
+  ++misses_;
+  const std::size_t n = c_lexer::scan_tokens(source, ts, flags);
+  if (n)
+    store(source, flags, ts);
+  return n;
+}
+
+} // namespace c_lexer
@@ -0,0 +1,382 @@
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <c_lexer/Lexer.h>
+#include <c_lexer/TokenStream.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <memory>
+
+namespace c_lexer {
+
+static_assert(static_cast<int>(Token::INVALID) <=
+                  std::numeric_limits<std::uint8_t>::max(),
+              "TokenStream stores each Token in a byte");
+
+void TokenStream::reset(std::string_view source) {
+  source_ = source;
+  kinds_.clear();
+  offsets_.clear();
+  lengths_.clear();
+  lines_.clear();
+  ids_.clear();
+  rows_.clear();
+  cols_.clear();
+  gap_ = gap_len_ = 0;
+  shift_ = row_shift_ = 0;
+}
+
+void TokenStream::reserve(std::size_t n) {
+  close_gap();
+  kinds_.reserve(n);
+  offsets_.reserve(n);
+  lengths_.reserve(n);
+  lines_.reserve(n);
+  if (symbols_)
+    ids_.reserve(n);
+}
+
+// Move the n slots of v at from to, which overlap unless the gap is wider,
+// adding add to each one of a column that is shifted behind the gap.
+template <typename T>
+static void move_slots(std::vector<T> &v, std::size_t from, std::size_t to,
+                       std::size_t n, T add = 0) {
+  if (v.empty())
+    return;
+  T *const p = v.data();
+  if (to < from)
+    std::copy(p + from, p + from + n, p + to);
+  else
+    std::copy_backward(p + from, p + from + n, p + to + n);
+  if (add)
+    for (T *q = p + to; q < p + to + n; ++q)
+      *q += add;
+}
+
+void TokenStream::move_gap(std::size_t i) const {
+  const bool positions = has_positions();
+  if (i < gap_) { // tokens [i, gap_) go behind the gap
+    const std::size_t n = gap_ - i;
+    const std::size_t to = i + gap_len_;
+    move_slots(kinds_, i, to, n);
+    move_slots(offsets_, i, to, n, std::uint32_t(0) - shift_);
+    move_slots(lengths_, i, to, n);
+    move_slots(lines_, i, to, n);
+    move_slots(ids_, i, to, n);
+    if (positions) {
+      move_slots(rows_, i, to, n, std::uint32_t(0) - row_shift_);
+      move_slots(cols_, i, to, n);
+    }
+  } else if (i > gap_) { // tokens [gap_, i) come out in front of it
+    const std::size_t n = i - gap_;
+    const std::size_t from = gap_ + gap_len_;
+    move_slots(kinds_, from, gap_, n);
+    move_slots(offsets_, from, gap_, n, shift_);
+    move_slots(lengths_, from, gap_, n);
+    move_slots(lines_, from, gap_, n);
+    move_slots(ids_, from, gap_, n);
+    if (positions) {
+      move_slots(rows_, from, gap_, n, row_shift_);
+      move_slots(cols_, from, gap_, n);
+    }
+  }
+  gap_ = i;
+}
+
+void TokenStream::close_gap() const {
+  if (!gapped())
+    return;
+  const bool positions = has_positions();
+  move_gap(size());
+  kinds_.resize(gap_);
+  offsets_.resize(gap_);
+  lengths_.resize(gap_);
+  lines_.resize(gap_);
+  if (symbols_)
+    ids_.resize(gap_);
+  if (positions) {
+    rows_.resize(gap_);
+    cols_.resize(gap_);
+  }
+  gap_len_ = 0;
+  shift_ = row_shift_ = 0;
+}
+
+// The gap grows by at least an eighth of the stream, so that a run of edits
+// that each add tokens moves the tokens after it only now and then.
+void TokenStream::reserve_gap(std::size_t n) {
+  if (gap_len_ >= n)
+    return;
+  const bool positions = has_positions();
+  const std::size_t add = std::max(n - gap_len_, size() / 8 + 64);
+  const std::size_t at = gap_ + gap_len_;
+  kinds_.insert(kinds_.begin() + at, add, 0);
+  offsets_.insert(offsets_.begin() + at, add, 0);
+  lengths_.insert(lengths_.begin() + at, add, 0);
+  lines_.insert(lines_.begin() + at, add, 0);
+  if (symbols_)
+    ids_.insert(ids_.begin() + at, add, 0);
+  if (positions) {
+    rows_.insert(rows_.begin() + at, add, 0);
+    cols_.insert(cols_.begin() + at, add, 0);
+  }
+  gap_len_ += add;
+}
+
+// Move row and col over the bytes [p, end) that lie between tokens, as
+// eat_whitespace() does. Anything else that was skipped, such as a comment,
+// is one column per byte.
+static void advance(const char *p, const char *end, std::uint32_t &row,
+                    std::uint32_t &col) {
+  for (; p < end; ++p) {
+    switch (*p) {
+    case '\n':
+      ++row;
+      col = 1;
+      break;
+    case '\v':
+      row += Lexer::rows_per_vtab;
+      col = 1;
+      break;
+    case '\f':
+      row += Lexer::rows_per_formfeed;
+      col = 1;
+      break;
+    case '\t':
+      col += Lexer::cols_per_htab;
+      break;
+    case '\r':
+      break;
+    default:
+      ++col;
+      break;
+    }
+  }
+}
+
+// Move row and col over the token [p, p + len). Only the text of a comment
+// moves the position other than one column per byte, except that the newline
+// of a splice, or of a Token::NEWLINE, begins the next row.
+static void pass_token(const char *p, std::uint32_t len, std::uint32_t &row,
+                       std::uint32_t &col) {
+  if (len > 1 && p[0] == '/' && (p[1] == '*' || p[1] == '/')) {
+    advance(p, p + len, row, col);
+  } else if (std::memchr(p, '\n', len)) {
+    for (const char *end = p + len; p < end; ++p) {
+      if (*p == '\n') {
+        ++row;
+        col = 1;
+      } else {
+        ++col;
+      }
+    }
+  } else {
+    col += len;
+  }
+}
+
+// Replay the Lexer's position rules over the gaps between tokens.
+void TokenStream::compute_positions() const {
+  close_gap();
+  rows_.resize(kinds_.size());
+  cols_.resize(kinds_.size());
+
+  std::uint32_t row = 1;
+  std::uint32_t col = 1;
+  std::size_t pos = 0;
+
+  for (std::size_t i = 0; i < kinds_.size(); ++i) {
+    advance(source_.data() + pos, source_.data() + offsets_[i], row, col);
+    rows_[i] = row;
+    cols_[i] = col;
+    pass_token(source_.data() + offsets_[i], lengths_[i], row, col);
+    pos = offsets_[i] + lengths_[i];
+  }
+}
+
+std::size_t scan_tokens(std::string_view s, TokenStream &ts,
+                        std::uint32_t flags) {
+  ts.reset(s);
+
+  if (s.size() > std::numeric_limits<std::uint32_t>::max()) {
+    std::cerr << "c_lexer: source of " << s.size()
+              << " bytes is too large for a TokenStream\n";
+    return 0;
+  }
+
+  ts.reserve(reserve_for_tokens(s.size()));
+
+  // Rows and columns are computed by the TokenStream, when they are wanted.
+  Lexer lexer(std::make_unique<SourceReader>(s),
+              flags | Lexer::ZERO_COPY | Lexer::LAZY_POSITIONS);
+  lexer.set_symbols(ts.symbols());
+  lexer.fill(ts, std::numeric_limits<std::size_t>::max());
+
+  return ts.size();
+}
+
+std::size_t relex_tokens(std::string_view s, const Edit &edit, TokenStream &ts,
+                         std::uint32_t flags) {
+  if (s.size() > std::numeric_limits<std::uint32_t>::max()) {
+    ts.reset(s);
+    std::cerr << "c_lexer: source of " << s.size()
+              << " bytes is too large for a TokenStream\n";
+    return 0;
+  }
+
+  if (ts.empty())
+    return scan_tokens(s, ts, flags);
+
+  // Positions that have been computed are kept up to date along with the
+  // offsets. Otherwise they stay lazy, and nothing before the edit is
+  // replayed: the old source may no longer exist to compute them from.
+  const bool positions = ts.has_positions();
+
+  const std::size_t n = ts.size();
+  const std::uint32_t delta =
+      static_cast<std::uint32_t>(edit.inserted - edit.removed); // mod 2^32
+
+  // The first token that the edit may have changed: any token whose
+  // overscan reaches it was decided by looking at edited text. Scanning
+  // resumes in START at the end of the token before it, in the line state
+  // that the token left, which the stream recorded.
+  std::size_t first = 0;
+  for (std::size_t hi = n; first < hi;) {
+    const std::size_t mid = first + (hi - first) / 2;
+    if (ts.offset(mid) <= edit.offset)
+      first = mid + 1;
+    else
+      hi = mid;
+  }
+  while (first > 0 &&
+         overscan_end(s, ts.offset(first - 1) + ts.length(first - 1)) >
+             edit.offset)
+    --first;
+
+  std::size_t from = 0;
+  std::uint32_t row = 1;
+  std::uint32_t col = 1;
+  Lexer::LineState line = Lexer::LINE_START;
+  if (first > 0) {
+    from = ts.offset(first - 1) + ts.length(first - 1);
+    line = ts.line_state(first - 1);
+    if (positions) {
+      row = ts.row(first - 1);
+      col = ts.col(first - 1);
+      pass_token(s.data() + ts.offset(first - 1), ts.length(first - 1), row,
+                 col);
+    }
+  }
+
+  // Scan until a token, beyond the edit, is the same as an old token at the
+  // same place and leaves the same line state. Both scans are in START after
+  // it, with the same input ahead, so they agree from there on. At worst the
+  // two ENDs line up. Without positions the scan does not follow rows either, so its
+  // error messages count them from where it resumed.
+  TokenStream fresh;
+  fresh.symbols_ = ts.symbols_;
+  std::size_t last = first; // the old token that the scans agree on
+  std::size_t scanned = 0;
+
+  const std::string_view rest = s.substr(from);
+  Lexer lexer(std::make_unique<SourceReader>(rest),
+              flags | Lexer::ZERO_COPY |
+                  (positions ? 0 : std::uint32_t(Lexer::LAZY_POSITIONS)),
+              row, col, line);
+  lexer.set_symbols(ts.symbols_);
+  for (std::size_t pos = from;; lexer.eat()) {
+    const Lexeme &l = lexer.peek();
+    const std::uint32_t offset = static_cast<std::uint32_t>(from + l.offset_);
+    const std::uint32_t len =
+        static_cast<std::uint32_t>(source_length(l, rest));
+    ++scanned;
+
+    if (positions)
+      advance(s.data() + pos, s.data() + offset, row, col);
+
+    if (offset >= edit.offset + edit.inserted) {
+      const std::uint32_t old_offset = offset - delta;
+      while (last < n && ts.offset(last) < old_offset)
+        ++last;
+      if (last < n && ts.offset(last) == old_offset &&
+          ts.token(last) == l.token() && ts.length(last) == len &&
+          ts.line_state(last) == lexer.line_state())
+        break;
+    }
+
+    fresh.push_back(l.token(), offset, len, lexer.line_state(), l.symbol_);
+    if (positions) {
+      fresh.rows_.push_back(row);
+      fresh.cols_.push_back(col);
+      pass_token(s.data() + offset, len, row, col);
+    }
+    pos = offset + len;
+
+    if (l.token() == Token::END) { // only if edit does not describe s
+      last = n;
+      break;
+    }
+  }
+
+  // Tokens on the row of the first kept token move by the change in its
+  // column. The rest of the kept tokens only owe shifts.
+  std::uint32_t row_delta = 0;
+  if (positions && last < n) {
+    const std::uint32_t old_row = ts.row(last);
+    const std::uint32_t col_delta = col - ts.col(last);
+    row_delta = row - old_row;
+    for (std::size_t i = last; i < n && ts.row(i) == old_row; ++i)
+      ts.cols_[ts.slot(i)] += col_delta;
+  }
+
+  // Drop the tokens [first, last) into the gap, and fill it from its start
+  // with the fresh ones. The kept tokens after it take on the edit's shift.
+  const std::size_t m = fresh.size();
+  ts.move_gap(first);
+  ts.gap_len_ += last - first;
+  ts.reserve_gap(m);
+  const std::size_t at = ts.gap_;
+  std::copy(fresh.kinds_.begin(), fresh.kinds_.end(), ts.kinds_.begin() + at);
+  std::copy(fresh.offsets_.begin(), fresh.offsets_.end(),
+            ts.offsets_.begin() + at);
+  std::copy(fresh.lengths_.begin(), fresh.lengths_.end(),
+            ts.lengths_.begin() + at);
+  std::copy(fresh.lines_.begin(), fresh.lines_.end(), ts.lines_.begin() + at);
+  if (ts.symbols_)
+    std::copy(fresh.ids_.begin(), fresh.ids_.end(), ts.ids_.begin() + at);
+  if (positions) {
+    std::copy(fresh.rows_.begin(), fresh.rows_.end(), ts.rows_.begin() + at);
+    std::copy(fresh.cols_.begin(), fresh.cols_.end(), ts.cols_.begin() + at);
+  }
+  ts.gap_ += m;
+  ts.gap_len_ -= m;
+  ts.shift_ += delta;
+  ts.row_shift_ += row_delta;
+  ts.source_ = s;
+
+  return scanned;
+}
+
+} // namespace c_lexer
@@ -0,0 +1,121 @@
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "WorkStealingPool.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace c_lexer {
+
+WorkStealingPool::WorkStealingPool(unsigned n_threads)
+    : next_(0), queued_(0), unfinished_(0), stop_(false) {
+  if (!n_threads)
+    n_threads = std::max(1u, std::thread::hardware_concurrency());
+
+  for (unsigned i = 0; i < n_threads; ++i)
+    queues_.push_back(std::make_unique<Queue>());
+
+  for (unsigned i = 0; i < n_threads; ++i)
+    workers_.emplace_back([this, i] { run(i); });
+}
+
+WorkStealingPool::~WorkStealingPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  work_cv_.notify_all();
+
+  for (std::thread &t : workers_)
+    t.join();
+}
+
+void WorkStealingPool::submit(Task &&task) {
+  Queue &q = *queues_[next_];
+  next_ = (next_ + 1) % queues_.size();
+
+  {
+    // Count the task before it is visible, so that queued_ never drops below
+    // zero. A worker that wakes between the two may briefly find nothing.
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++unfinished_;
+    ++queued_;
+  }
+  {
+    std::lock_guard<std::mutex> lock(q.mutex);
+    q.tasks.push_back(std::move(task));
+  }
+  work_cv_.notify_one();
+}
+
+void WorkStealingPool::wait() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  idle_cv_.wait(lock, [this] { return unfinished_ == 0; });
+}
+
+bool WorkStealingPool::pop(unsigned worker, Task &task) {
+  const std::size_t n = queues_.size();
+
+  for (std::size_t i = 0; i < n; ++i) {
+    Queue &q = *queues_[(worker + i) % n];
+    std::lock_guard<std::mutex> lock(q.mutex);
+
+    if (q.tasks.empty())
+      continue;
+
+    if (!i) { // our own queue: newest first
+      task = std::move(q.tasks.back());
+      q.tasks.pop_back();
+    } else { // steal the oldest
+      task = std::move(q.tasks.front());
+      q.tasks.pop_front();
+    }
+
+    --queued_;
+    return true;
+  }
+
+  return false;
+}
+
+void WorkStealingPool::run(unsigned worker) {
+  for (;;) {
+    Task task;
+
+    if (pop(worker, task)) {
+      task(worker);
+
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!--unfinished_)
+        idle_cv_.notify_all();
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    work_cv_.wait(lock, [this] { return stop_ || queued_ > 0; });
+    if (stop_ && !queued_)
+      return;
+  }
+}
+
+} // namespace c_lexer
@@ -0,0 +1,81 @@
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace c_lexer {
+
+// A fixed set of worker threads, each with its own deque of tasks. A worker
+// runs tasks from the back of its own deque, and when that is empty it steals
+// from the front of the others', so that a few expensive tasks do not leave
+// the remaining workers idle. A task is passed the index of the worker that
+// runs it, for per-worker scratch state.
+class WorkStealingPool {
+public:
+  using Task = std::function<void(unsigned worker)>;
+
+  // n_threads of 0 means one worker per hardware thread.
+  explicit WorkStealingPool(unsigned n_threads);
+  ~WorkStealingPool();
+
+  WorkStealingPool(const WorkStealingPool &) = delete;
+  WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+  unsigned size() const { return static_cast<unsigned>(workers_.size()); }
+
+  // Queue task on the workers in turn.
+  void submit(Task &&task);
+
+  // Block until every submitted task has finished.
+  void wait();
+
+protected:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  bool pop(unsigned worker, Task &task);
+  void run(unsigned worker);
+
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::vector<std::thread> workers_;
+  std::size_t next_; // queue for the next submit()
+
+  std::mutex mutex_;
+  std::condition_variable work_cv_; // signaled when tasks are queued
+  std::condition_variable idle_cv_; // signaled when unfinished_ drops to 0
+  std::atomic<std::size_t> queued_;
+  std::size_t unfinished_; // guarded by mutex_
+  bool stop_;              // guarded by mutex_
+};
+
+} // namespace c_lexer
@@ -26,9 +26,10 @@ This script generates the keyword portion of the C lexer.
 """
 
 import argparse
+import random
 import sys
 from collections import defaultdict
-from typing import Dict, Set, Tuple
+from typing import Dict, List, Set, Tuple
 
 keys = [
     'alignas',
@@ -154,10 +155,115 @@ tokens = [
     '_THREAD_LOCAL',
 ]
 
-tknfor = {}
+LICENSE = '''\
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.'''
+
+# The keywords of C89. C23 keeps all of them.
+c89_keys = [
+    'auto',
+    'break',
+    'case',
+    'char',
+    'const',
+    'continue',
+    'default',
+    'do',
+    'double',
+    'else',
+    'enum',
+    'extern',
+    'float',
+    'for',
+    'goto',
+    'if',
+    'int',
+    'long',
+    'register',
+    'return',
+    'short',
+    'signed',
+    'sizeof',
+    'static',
+    'struct',
+    'switch',
+    'typedef',
+    'union',
+    'unsigned',
+    'void',
+    'volatile',
+    'while',
+]
+
+# The GNU extensions, and the token of each. The double-underscore spellings
+# of standard keywords stand for those keywords.
+gnu_keys = {
+    'asm': 'ASM',
+    'inline': 'INLINE',
+    'typeof': 'TYPEOF',
+    '__alignof': 'ALIGNOF',
+    '__alignof__': 'ALIGNOF',
+    '__asm': 'ASM',
+    '__asm__': 'ASM',
+    '__attribute': 'ATTRIBUTE',
+    '__attribute__': 'ATTRIBUTE',
+    '__auto_type': 'AUTO_TYPE',
+    '__const': 'CONST',
+    '__const__': 'CONST',
+    '__extension__': 'EXTENSION',
+    '__inline': 'INLINE',
+    '__inline__': 'INLINE',
+    '__int128': 'INT128',
+    '__label__': 'LABEL',
+    '__restrict': 'RESTRICT',
+    '__restrict__': 'RESTRICT',
+    '__signed': 'SIGNED',
+    '__signed__': 'SIGNED',
+    '__typeof': 'TYPEOF',
+    '__typeof__': 'TYPEOF',
+    '__volatile': 'VOLATILE',
+    '__volatile__': 'VOLATILE',
+}
+
+# The keyword policy of each dialect that scan_token() is specialized for.
+dialects = {
+    'C23Dialect': (keys, False),
+    'C89Dialect': (c89_keys, False),
+    'Gnu23Dialect': (keys + [k for k in gnu_keys if k not in keys], True),
+    'Gnu89Dialect': (c89_keys + [k for k in gnu_keys if k not in c89_keys],
+                     True),
+}
+
+tknfor = dict(gnu_keys)
 for i, k in enumerate(keys):
     tknfor[k] = tokens[i]
 
+# The character-level DFA scans the keywords of every dialect, and leaves
+# it to the dialect policy whether each is returned. The double-underscore
+# GNU spellings are instead classified whole by find_keyword(), by way of
+# GOT_KW_IDENT.
+dfa_keys = keys + [k for k in gnu_keys
+                   if not k.startswith('__') and k not in keys]
+
 def substrings(s: str):
     """
     For a given keyword string, eg 'while', produce all the incrementing
@@ -195,7 +301,7 @@ def find_collisions(key: str, data: Dict, already: Set, collisions: Dict):
         if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::IF, 2);
+          rkeyword(Token::IF, 2);
         }
         break;
       default:
@@ -216,7 +322,7 @@ def find_collisions(key: str, data: Dict, already: Set, collisions: Dict):
         } else if (is_ident_cont(sr_->peek())) {
           nextst(GOT_IDENT);
         } else {
-          r(Token::DO, 2);
+          rkeyword(Token::DO, 2);
         }
         break;
 
@@ -249,17 +355,17 @@ def find_collisions(key: str, data: Dict, already: Set, collisions: Dict):
             continue
         already.add(s)
 
-        for k in keys:
+        for k in dfa_keys:
             if k != s and k.find(s) == 0:
                 fragment = k[:len(s)+1]
 
-                if fragment in keys:
+                if fragment in dfa_keys:
                     fragment = '*' + fragment
 
                 if fragment not in data[s]:
                     data[s].append(fragment)
 
-    for k in keys:
+    for k in dfa_keys:
         if k in data:
             fragment = '*' + k # change the * to a !
             index = k[:-1]
@@ -282,7 +388,7 @@ def generate_case_1(nxt: str):
     print('      if (is_ident_cont(sr_->peek())) {')
     print('        nextst(GOT_IDENT);')
     print('      } else {')
-    print(f'        r(Token::{tknfor[nxt]}, {len(nxt)});')
+    print(f'        rkeyword(Token::{tknfor[nxt]}, {len(nxt)});')
     print('      }')
 
 
@@ -292,7 +398,7 @@ def generate_case_2(collisions: Dict, nxt: str):
     print('      } else if (is_ident_cont(sr_->peek())) {')
     print('        nextst(GOT_IDENT);')
     print('      } else {')
-    print(f'        r(Token::{tknfor[nxt]}, {len(nxt)});')
+    print(f'        rkeyword(Token::{tknfor[nxt]}, {len(nxt)});')
     print('      }')
 
 
@@ -331,6 +437,125 @@ def generate_source(data: Dict, collisions: Dict):
         print()
 
 
+def find_perfect_hash(words: List[str]) -> Tuple:
+    """
+    Search for a table size and multipliers (a, b, c, d, e) such that
+
+      (s[0] * a + s[1] * b + s[n / 2] * c + s[n - 1] * d + n * e) % size
+
+    is distinct for every keyword s of length n. The search is seeded, so
+    that the generated table is reproducible, and tries the smallest tables
+    first.
+    """
+    size = 256
+    while True:
+        rng = random.Random(1)
+        for _ in range(100000):
+            mult = tuple(rng.randrange(1, 256) for _ in range(5))
+            slots = {perfect_hash(k, mult, size) for k in words}
+            if len(slots) == len(words):
+                return (size, mult)
+        size *= 2
+
+
+def perfect_hash(key: str, mult: Tuple, size: int) -> int:
+    a, b, c, d, e = mult
+    n = len(key)
+    return (ord(key[0]) * a + ord(key[1]) * b + ord(key[n // 2]) * c +
+            ord(key[-1]) * d + n * e) % size
+
+
+def generate_dialect(name: str, words: List[str], gnu: bool):
+    size, mult = find_perfect_hash(words)
+    ordered = sorted(words, key=lambda k: perfect_hash(k, mult, size))
+
+    slots = [0] * size
+    for i, k in enumerate(ordered):
+        slots[perfect_hash(k, mult, size)] = i + 1
+
+    prefix = name[:-len('Dialect')].lower()
+    a, b, c, d, e = mult
+    print(f'const Keyword {prefix}_keywords[] = {{')
+    for k in ordered:
+        print(f'    {{"{k}", {len(k)}, Token::{tknfor[k]}}},')
+    print('};')
+    print()
+    print('// 1 + the index in the keywords of the keyword in each hash slot, or 0.')
+    print(f'const std::uint8_t {prefix}_keyword_slots[{size}] = {{')
+    for i in range(0, size, 16):
+        row = ', '.join(f'{v:2}' for v in slots[i:i + 16])
+        print(f'    {row},')
+    print('};')
+    print()
+    print(f'struct {name} {{')
+    print(f'  static constexpr bool gnu = {"true" if gnu else "false"};')
+    print()
+    print('  static constexpr bool is_keyword(Token token) {')
+    print('    switch (token) {')
+    # The double-underscore spellings never reach rkeyword().
+    dfa_tokens = set(tknfor[k] for k in words if not k.startswith('__'))
+    for t in sorted(dfa_tokens, key=tokens_order):
+        print(f'    case Token::{t}:')
+    print('      return true;')
+    print('    default:')
+    print('      return false;')
+    print('    }')
+    print('  }')
+    print()
+    print('  static Token find_keyword(const char *s, std::size_t n) {')
+    print(f'    if (n < {min(map(len, words))} || n > {max(map(len, words))})')
+    print('      return Token::IDENTIFIER;')
+    print()
+    print('    const unsigned char *u = reinterpret_cast<const unsigned char *>(s);')
+    print(f'    const std::size_t h = (u[0] * {a}u + u[1] * {b}u + u[n / 2] * {c}u +')
+    print(f'                           u[n - 1] * {d}u + n * {e}u) %')
+    print(f'                          {size};')
+    print(f'    const std::uint8_t slot = {prefix}_keyword_slots[h];')
+    print('    if (!slot)')
+    print('      return Token::IDENTIFIER;')
+    print()
+    print(f'    const Keyword &k = {prefix}_keywords[slot - 1];')
+    print('    if (k.len != n || std::memcmp(k.text, s, n))')
+    print('      return Token::IDENTIFIER;')
+    print()
+    print('    return k.token;')
+    print('  }')
+    print('};')
+
+
+def tokens_order(token: str) -> int:
+    """
+    Order tokens as Token.h declares them: the standard keywords, and then
+    the GNU ones.
+    """
+    if token in tokens:
+        return tokens.index(token)
+    gnu_tokens = sorted(set(gnu_keys.values()) - set(tokens))
+    return len(tokens) + gnu_tokens.index(token)
+
+
+def generate_table():
+    print(LICENSE)
+    print()
+    print('// Generated by scripts/keywords.py table. Do not edit.')
+    print('//')
+    print('// The keyword policy of each dialect. is_keyword() decides, at compile')
+    print('// time, which of the keywords scanned by the DFA in scan_token() the')
+    print('// dialect returns. find_keyword() classifies a complete identifier. A')
+    print('// perfect hash of its first, second, middle and last characters and its')
+    print('// length selects the only keyword that it could be, which is then')
+    print('// compared in full.')
+    print()
+    print('struct Keyword {')
+    print('  const char *text;')
+    print('  std::size_t len;')
+    print('  Token token;')
+    print('};')
+    for name, (words, gnu) in dialects.items():
+        print()
+        generate_dialect(name, words, gnu)
+
+
 def parse_args() -> Tuple:
     parser = argparse.ArgumentParser()
 
@@ -346,6 +571,7 @@ def parse_args() -> Tuple:
 
     subparser.add_parser('code')
     subparser.add_parser('tests')
+    subparser.add_parser('table')
 
     return (parser, parser.parse_args())
 
@@ -362,7 +588,7 @@ def main():
     already = set()
     collisions = {}
 
-    for k in keys:
+    for k in dfa_keys:
         find_collisions(k, data, already, collisions)
 
     #print(f'collisions: {collisions}')
@@ -386,6 +612,8 @@ def main():
             generate_source(data, collisions)
         case 'tests':
             generate_tests(data)
+        case 'table':
+            generate_table()
 
 if __name__ == '__main__':
     main()
@@ -0,0 +1,406 @@
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "Differential.h"
+
+#include <c_lexer/Lexer.h>
+#include <c_lexer/PackedTokens.h>
+#include <c_lexer/PipelinedLexer.h>
+#include <c_lexer/StreamLexer.h>
+#include <c_lexer/TokenStream.h>
+
+#include "Simd.h"
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <sstream>
+
+namespace c_lexer {
+namespace fuzz {
+
+namespace {
+
+// A Lexer that runs the given kernels instead of the fastest ones.
+class KernelLexer : public Lexer {
+public:
+  KernelLexer(const simd::Kernels *kernels, std::unique_ptr<SourceReader> &&sr,
+              std::uint32_t flags)
+      : Lexer(kernels, std::move(sr), flags) {}
+};
+
+// The length of raw, a token's spelling in the source, once its splices are
+// gone, as in the text of a Lexeme that copies it.
+std::size_t spliced_length(std::string_view raw) {
+  std::size_t n = raw.size();
+  for (std::size_t i = 0; i + 1 < raw.size(); ++i) {
+    if (raw[i] != '\\')
+      continue;
+    if (raw[i + 1] == '\n')
+      n -= 2;
+    else if (raw[i + 1] == '\r' && i + 2 < raw.size() && raw[i + 2] == '\n')
+      n -= 3;
+  }
+  return n;
+}
+
+// Where a backend's tokens go: recorded as Tok's to be compared, or only
+// counted, for timing the backend alone.
+class Record {
+public:
+  static constexpr bool positions = true;
+
+  Record(std::string_view src, std::vector<Tok> &out) : src_(src), out_(out) {}
+
+  void operator()(const Lexeme &l) {
+    out_.push_back(Tok{l.token(), l.offset_, l.text().size(), l.row_, l.col_});
+  }
+  void operator()(const TokenStream &ts) {
+    for (std::size_t i = 0; i < ts.size(); ++i)
+      out_.push_back(Tok{static_cast<Token>(ts.kinds()[i]), ts.offsets()[i],
+                         spliced_length(
+                             src_.substr(ts.offsets()[i], ts.lengths()[i])),
+                         ts.row(i), ts.col(i)});
+  }
+  void operator()(const PackedTokens &tokens) {
+    for (std::size_t i = 0; i < tokens.size(); ++i)
+      out_.push_back(Tok{tokens.token(i), tokens[i].offset,
+                         spliced_length(tokens.text(i)), tokens.row(i),
+                         tokens.col(i)});
+  }
+
+private:
+  std::string_view src_;
+  std::vector<Tok> &out_;
+};
+
+class Count {
+public:
+  static constexpr bool positions = false;
+
+  void operator()(const Lexeme &) { ++n_; }
+  void operator()(const TokenStream &ts) { n_ += ts.size(); }
+  void operator()(const PackedTokens &tokens) { n_ += tokens.size(); }
+
+  std::size_t n() const { return n_; }
+
+private:
+  std::size_t n_ = 0;
+};
+
+template <typename L, typename Sink> void eat_all(L &lexer, Sink &sink) {
+  for (;;) {
+    const Lexeme l = lexer.eat();
+    sink(l);
+    if (l.token() == Token::END)
+      break;
+  }
+}
+
+// Each backend lexes src with the Lexer flags mode into a Sink.
+
+struct Reference {
+  template <typename Sink>
+  static void lex(std::string_view src, std::uint32_t mode, Sink &sink) {
+    std::istringstream in{std::string(src)};
+    KernelLexer lexer(simd::kernels_for(simd::Isa::SCALAR),
+                      std::make_unique<SourceReader>(in), mode);
+    eat_all(lexer, sink);
+  }
+};
+
+template <std::uint32_t flags> struct Contiguous {
+  template <typename Sink>
+  static void lex(std::string_view src, std::uint32_t mode, Sink &sink) {
+    Lexer lexer(std::make_unique<SourceReader>(src), mode | flags);
+    eat_all(lexer, sink);
+  }
+};
+
+struct LazyPositions {
+  template <typename Sink>
+  static void lex(std::string_view src, std::uint32_t mode, Sink &sink) {
+    Lexer lexer(std::make_unique<SourceReader>(src),
+                mode | Lexer::ZERO_COPY | Lexer::LAZY_POSITIONS);
+    for (;;) {
+      Lexeme l = lexer.eat();
+      if constexpr (Sink::positions) {
+        const SourcePosition pos = lexer.position_of(l.offset_);
+        l.row_ = pos.row;
+        l.col_ = pos.col;
+      }
+      sink(l);
+      if (l.token() == Token::END)
+        break;
+    }
+  }
+};
+
+template <simd::Isa isa> struct Kernels {
+  template <typename Sink>
+  static void lex(std::string_view src, std::uint32_t mode, Sink &sink) {
+    KernelLexer lexer(simd::kernels_for(isa),
+                      std::make_unique<SourceReader>(src),
+                      mode | Lexer::ZERO_COPY);
+    eat_all(lexer, sink);
+  }
+};
+
+struct Batch {
+  template <typename Sink>
+  static void lex(std::string_view src, std::uint32_t mode, Sink &sink) {
+    Lexer lexer(std::make_unique<SourceReader>(src), mode | Lexer::ZERO_COPY);
+    // An odd size, so that batches end at every kind of token.
+    Lexeme batch[7];
+    for (;;) {
+      const std::size_t n = lexer.next_batch(batch, std::size(batch));
+      for (std::size_t i = 0; i < n; ++i)
+        sink(batch[i]);
+      if (!n || batch[n - 1].token() == Token::END)
+        break;
+    }
+  }
+};
+
+struct Pipelined {
+  template <typename Sink>
+  static void lex(std::string_view src, std::uint32_t mode, Sink &sink) {
+    PipelinedLexer lexer(std::make_unique<SourceReader>(src),
+                         mode | Lexer::ZERO_COPY, 16, 4);
+    eat_all(lexer, sink);
+  }
+};
+
+struct Stream {
+  template <typename Sink>
+  static void lex(std::string_view src, std::uint32_t mode, Sink &sink) {
+    TokenStream ts;
+    scan_tokens(src, ts, mode);
+    sink(ts);
+  }
+};
+
+struct Parallel {
+  template <typename Sink>
+  static void lex(std::string_view src, std::uint32_t mode, Sink &sink) {
+    TokenStream ts;
+    scan_tokens_parallel(src, ts, 4, mode);
+    sink(ts);
+  }
+};
+
+struct Packed {
+  template <typename Sink>
+  static void lex(std::string_view src, std::uint32_t mode, Sink &sink) {
+    PackedTokens tokens;
+    scan_tokens(src, tokens, mode);
+    sink(tokens);
+  }
+};
+
+struct Fed {
+  template <typename Sink>
+  static void lex(std::string_view src, std::uint32_t mode, Sink &sink) {
+    StreamLexer lexer([&](const Lexeme &l) { sink(l); }, mode);
+    // Pieces of an odd size, so that they split every kind of token.
+    for (std::size_t i = 0; i < src.size(); i += 13)
+      lexer.feed(src.data() + i, std::min<std::size_t>(13, src.size() - i));
+    lexer.finish();
+  }
+};
+
+template <typename B>
+void record(std::string_view src, std::uint32_t mode, std::vector<Tok> &out) {
+  Record sink(src, out);
+  B::lex(src, mode, sink);
+}
+
+template <typename B> std::size_t count(std::string_view src, std::uint32_t mode) {
+  Count sink;
+  B::lex(src, mode, sink);
+  return sink.n();
+}
+
+template <typename B> Backend backend(const char *name) {
+  return Backend{name, record<B>, count<B>};
+}
+
+std::string quote(std::string_view src, std::size_t offset) {
+  static const char hex[] = "0123456789abcdef";
+  const std::size_t begin = offset < 16 ? 0 : offset - 16;
+  const std::size_t end = std::min(src.size(), offset + 16);
+  std::string s = "\"";
+  for (std::size_t i = begin; i < end; ++i) {
+    const unsigned char c = static_cast<unsigned char>(src[i]);
+    if (c == '\\' || c == '"')
+      s += {'\\', static_cast<char>(c)};
+    else if (c >= ' ' && c < 0x7f)
+      s += static_cast<char>(c);
+    else
+      s += {'\\', 'x', hex[c >> 4], hex[c & 0xf]};
+  }
+  return s + '"';
+}
+
+std::string tok_str(const Tok &t) {
+  if (t.offset == ~std::size_t(0))
+    return "nothing";
+  char buf[96];
+  std::snprintf(buf, sizeof(buf), "Token::%s @%zu+%zu (%u,%u)",
+                ttos[static_cast<std::size_t>(t.token)], t.offset, t.length,
+                t.row, t.col);
+  return buf;
+}
+
+} // namespace
+
+const std::vector<Backend> &backends() {
+  static const std::vector<Backend> v = [] {
+    std::vector<Backend> b = {
+        backend<Reference>("reference"),
+        backend<Contiguous<Lexer::ZERO_COPY>>("zero-copy"),
+        backend<Contiguous<Lexer::ZERO_COPY | Lexer::TABLE_KEYWORDS>>("table"),
+        backend<LazyPositions>("lazy-positions"),
+    };
+    if (simd::kernels_for(simd::Isa::SSE2))
+      b.push_back(backend<Kernels<simd::Isa::SSE2>>("sse2"));
+    if (simd::kernels_for(simd::Isa::AVX2))
+      b.push_back(backend<Kernels<simd::Isa::AVX2>>("avx2"));
+    if (simd::kernels_for(simd::Isa::NEON))
+      b.push_back(backend<Kernels<simd::Isa::NEON>>("neon"));
+    b.push_back(backend<Batch>("batch"));
+    b.push_back(backend<Pipelined>("pipelined"));
+    b.push_back(backend<Stream>("token-stream"));
+    b.push_back(backend<Parallel>("parallel"));
+    b.push_back(backend<Packed>("packed"));
+    b.push_back(backend<Fed>("stream"));
+    return b;
+  }();
+  return v;
+}
+
+const std::vector<std::uint32_t> &modes() {
+  static const std::vector<std::uint32_t> v = {
+      0,          Lexer::KEEP_COMMENTS,    Lexer::C89,
+      Lexer::GNU, Lexer::C89 | Lexer::GNU, Lexer::RECOVER};
+  return v;
+}
+
+std::string mode_name(std::uint32_t mode) {
+  std::string s;
+  if (mode & Lexer::KEEP_COMMENTS)
+    s += "comments,";
+  if (mode & Lexer::C89)
+    s += "c89,";
+  if (mode & Lexer::GNU)
+    s += "gnu,";
+  if (mode & Lexer::RECOVER)
+    s += "recover,";
+  if (s.empty())
+    return "c23";
+  s.pop_back();
+  return s;
+}
+
+std::vector<Mismatch> compare(std::string_view src) {
+  const std::vector<Backend> &all = backends();
+  const Tok none{Token::END, ~std::size_t(0), 0, 0, 0};
+  std::vector<Mismatch> mismatches;
+  std::vector<Tok> expected;
+  std::vector<Tok> actual;
+
+  for (std::uint32_t mode : modes()) {
+    expected.clear();
+    all[0].lex(src, mode, expected);
+
+    for (std::size_t b = 1; b < all.size(); ++b) {
+      actual.clear();
+      all[b].lex(src, mode, actual);
+
+      const std::size_t n = std::max(expected.size(), actual.size());
+      for (std::size_t i = 0; i < n; ++i) {
+        const Tok &e = i < expected.size() ? expected[i] : none;
+        const Tok &a = i < actual.size() ? actual[i] : none;
+        if (e != a) {
+          mismatches.push_back(Mismatch{all[b].name, mode, i, e, a});
+          break;
+        }
+      }
+    }
+  }
+  return mismatches;
+}
+
+std::string describe(const Mismatch &m, std::string_view src) {
+  const std::size_t at =
+      m.expected.offset != ~std::size_t(0) ? m.expected.offset
+                                            : m.actual.offset;
+  return std::string(m.backend) + " (" + mode_name(m.mode) + ") token " +
+         std::to_string(m.index) + ": expected " + tok_str(m.expected) +
+         ", got " + tok_str(m.actual) + "\n  near " + quote(src, at);
+}
+
+bool read_corpus(const std::vector<std::string> &paths,
+                 std::vector<std::pair<std::string, std::string>> &corpus) {
+  bool ok = true;
+  for (const std::string &path : paths) {
+    struct stat st;
+    if (stat(path.c_str(), &st)) {
+      ok = false;
+      continue;
+    }
+
+    if (S_ISDIR(st.st_mode)) {
+      DIR *d = opendir(path.c_str());
+      if (!d) {
+        ok = false;
+        continue;
+      }
+      std::vector<std::string> names;
+      while (const dirent *e = readdir(d))
+        if (e->d_name[0] != '.')
+          names.push_back(path + '/' + e->d_name);
+      closedir(d);
+
+      std::sort(names.begin(), names.end());
+      ok = read_corpus(names, corpus) && ok;
+      continue;
+    }
+
+    std::ifstream f(path, std::ios::binary);
+    if (!f) {
+      ok = false;
+      continue;
+    }
+    corpus.emplace_back(path,
+                        std::string(std::istreambuf_iterator<char>(f), {}));
+  }
+  return ok;
+}
+
+} // namespace fuzz
+} // namespace c_lexer
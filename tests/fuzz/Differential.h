@@ -0,0 +1,98 @@
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#pragma once
+
+#include <c_lexer/Token.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace c_lexer {
+namespace fuzz {
+
+// A token as every way of lexing a source can report it.
+struct Tok {
+  Token token;
+  std::size_t offset;
+  std::size_t length;
+  std::uint32_t row;
+  std::uint32_t col;
+
+  bool operator==(const Tok &other) const {
+    return token == other.token && offset == other.offset &&
+           length == other.length && row == other.row && col == other.col;
+  }
+  bool operator!=(const Tok &other) const { return !(*this == other); }
+};
+
+struct Backend {
+  const char *name;
+  // Lex all of src with the Lexer flags mode into out, ending with END.
+  void (*lex)(std::string_view src, std::uint32_t mode, std::vector<Tok> &out);
+  // Lex all of src as lex does, keeping nothing, and return the number of
+  // tokens. For timing the backend alone.
+  std::size_t (*run)(std::string_view src, std::uint32_t mode);
+};
+
+// Every way of lexing a whole source that this build and CPU support. The
+// first is the reference: scan_token() with the scalar kernels, refilling
+// from a stream and copying each token's text. The others follow the fast
+// paths: zero-copy, table keywords, lazy positions, each set of SIMD
+// kernels, next_batch(), PipelinedLexer, TokenStream, scan_tokens_parallel(),
+// PackedTokens and StreamLexer.
+const std::vector<Backend> &backends();
+
+// The Lexer flags that every backend is run with in turn: plain C23, with
+// comments kept, each keyword dialect, and with RECOVER.
+const std::vector<std::uint32_t> &modes();
+std::string mode_name(std::uint32_t mode);
+
+// Where a backend first parted from the reference for one mode. When one
+// stream is a prefix of the other, the missing token is END at offset ~0.
+struct Mismatch {
+  const char *backend;
+  std::uint32_t mode;
+  std::size_t index;
+  Tok expected;
+  Tok actual;
+};
+
+// Lex src with every backend in every mode, and return the first point at
+// which each (backend, mode) disagrees with the reference. Empty when they
+// all agree.
+std::vector<Mismatch> compare(std::string_view src);
+
+// A line or two about m, quoting src around the tokens concerned.
+std::string describe(const Mismatch &m, std::string_view src);
+
+// Append the name and contents of each file in paths, and of each file
+// under each directory in paths, to corpus. Returns false when any of them
+// could not be read.
+bool read_corpus(const std::vector<std::string> &paths,
+                 std::vector<std::pair<std::string, std::string>> &corpus);
+
+} // namespace fuzz
+} // namespace c_lexer
@@ -0,0 +1,120 @@
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Lex a corpus with every backend in every mode, report each disagreement
+// with the reference, and then the throughput of each backend on all of the
+// corpus, in plain C23, relative to the reference.
+//
+//   diff_lexer [-r REPS] PATH...
+
+#include "Differential.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+using c_lexer::fuzz::Backend;
+
+namespace {
+
+int usage(const char *prog) {
+  std::cerr << "usage: " << prog << " [-r REPS] PATH...\n";
+  return 2;
+}
+
+// Seconds to lex all of corpus reps times with b, adding the tokens lexed
+// to tokens.
+double time_backend(
+    const Backend &b,
+    const std::vector<std::pair<std::string, std::string>> &corpus,
+    unsigned reps, std::size_t &tokens) {
+  const auto start = std::chrono::steady_clock::now();
+  for (unsigned r = 0; r < reps; ++r)
+    for (const auto &input : corpus)
+      tokens += b.run(input.second, 0);
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  unsigned reps = 3;
+  std::vector<std::string> paths;
+
+  for (int i = 1; i < argc; ++i) {
+    if (!std::strcmp(argv[i], "-r")) {
+      char *end = nullptr;
+      const long n = i + 1 < argc ? std::strtol(argv[++i], &end, 10) : 0;
+      if (!end || *end || n < 1)
+        return usage(argv[0]);
+      reps = static_cast<unsigned>(n);
+    } else {
+      paths.push_back(argv[i]);
+    }
+  }
+  if (paths.empty())
+    return usage(argv[0]);
+
+  std::vector<std::pair<std::string, std::string>> corpus;
+  int res = 0;
+  if (!c_lexer::fuzz::read_corpus(paths, corpus)) {
+    std::cerr << argv[0] << ": cannot read all of the inputs\n";
+    res = 1;
+  }
+
+  std::size_t bytes = 0;
+  std::size_t mismatches = 0;
+  for (const auto &[name, src] : corpus) {
+    bytes += src.size();
+    for (const auto &m : c_lexer::fuzz::compare(src)) {
+      std::cout << name << ": " << c_lexer::fuzz::describe(m, src) << '\n';
+      ++mismatches;
+    }
+  }
+  if (mismatches)
+    res = 1;
+
+  std::printf("%zu inputs, %zu bytes, %zu mismatches\n\n", corpus.size(),
+              bytes, mismatches);
+  std::printf("%-16s %10s %10s %8s\n", "backend", "MB/s", "Mtok/s", "x ref");
+
+  double reference = 0;
+  for (const Backend &b : c_lexer::fuzz::backends()) {
+    std::size_t tokens = 0;
+    const double secs = time_backend(b, corpus, reps, tokens);
+    const double rate = secs > 0 ? bytes * double(reps) / secs / 1e6 : 0;
+    if (!reference)
+      reference = rate;
+    std::printf("%-16s %10.1f %10.2f %8.2f\n", b.name, rate,
+                secs > 0 ? tokens / secs / 1e6 : 0,
+                reference ? rate / reference : 0);
+  }
+
+  return res;
+}
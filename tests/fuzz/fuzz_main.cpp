@@ -0,0 +1,55 @@
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Drive LLVMFuzzerTestOneInput() without libFuzzer: once for each file
+// named on the command line, or under a directory named there, or once for
+// stdin when there are none, as afl-fuzz runs a target.
+
+#include "Differential.h"
+
+#include <cstdint>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t *data,
+                                      std::size_t size);
+
+int main(int argc, char *argv[]) {
+  std::vector<std::pair<std::string, std::string>> corpus;
+  int res = 0;
+
+  if (argc < 2) {
+    corpus.emplace_back(
+        "-", std::string(std::istreambuf_iterator<char>(std::cin), {}));
+  } else if (!c_lexer::fuzz::read_corpus({argv + 1, argv + argc}, corpus)) {
+    std::cerr << argv[0] << ": cannot read all of the inputs\n";
+    res = 1;
+  }
+
+  for (const auto &[name, src] : corpus)
+    LLVMFuzzerTestOneInput(reinterpret_cast<const std::uint8_t *>(src.data()),
+                           src.size());
+  return res;
+}
@@ -0,0 +1,118 @@
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <c_lexer/Arena.h>
+#include <c_lexer/Lexer.h>
+#include <c_lexer/SymbolTable.h>
+
+using c_lexer::Arena;
+using c_lexer::Lexeme;
+using c_lexer::Lexer;
+using c_lexer::scan_tokens;
+using c_lexer::SymbolTable;
+using c_lexer::Token;
+
+#include "tests/tests.h"
+
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+TEST(Arena, bump_and_release) {
+  Arena arena(64);
+  char *a = static_cast<char *>(arena.allocate(3, 1));
+  void *b = arena.allocate(8, 8);
+  EXPECT_EQ(0u, reinterpret_cast<std::uintptr_t>(b) % 8);
+  EXPECT_LE(a + 3, static_cast<char *>(b));
+  EXPECT_EQ(11u, arena.used());
+
+  // Only the last allocation can shrink.
+  arena.shrink(a, 3, 1);
+  EXPECT_EQ(11u, arena.used());
+  arena.shrink(b, 8, 2);
+  EXPECT_EQ(5u, arena.used());
+  EXPECT_EQ(static_cast<char *>(b) + 2, arena.allocate(1, 1));
+
+  void *big = arena.allocate(1000, 256);
+  EXPECT_EQ(0u, reinterpret_cast<std::uintptr_t>(big) % 256);
+  EXPECT_EQ(1006u, arena.used());
+
+  arena.release();
+  EXPECT_EQ(0u, arena.used());
+  EXPECT_EQ(a, arena.allocate(1, 1));
+}
+
+TEST(Arena, memory_resource) {
+  Arena arena;
+  std::pmr::vector<int> v(&arena);
+  for (int i = 0; i < 1000; ++i)
+    v.push_back(i);
+  EXPECT_EQ(999, v.back());
+  EXPECT_LE(1000 * sizeof(int), arena.used());
+  EXPECT_TRUE(arena.is_equal(arena));
+}
+
+TEST(Arena, lexeme_text) {
+  Arena arena;
+  const std::string src = "int x\\\n1 = \"s\";";
+
+  // Copied text goes in the arena, and so is borrowed.
+  const std::vector<Lexeme> copied = scan_tokens(src, 0, &arena);
+  ASSERT_EQ(6u, copied.size());
+  const std::size_t used = arena.used();
+  EXPECT_EQ(std::string_view("intx1=\"s\";").size(), used);
+  for (const Lexeme &l : copied) {
+    EXPECT_TRUE(l.lexeme_.empty());
+    EXPECT_TRUE(l.token() == Token::END || l.borrowed());
+  }
+  EXPECT_EQ("x1", copied[1].text());
+
+  // With ZERO_COPY only a spliced token is copied.
+  const std::vector<Lexeme> zero =
+      scan_tokens(src, Lexer::ZERO_COPY, &arena);
+  EXPECT_EQ(used + 2, arena.used());
+  EXPECT_EQ(src.data(), zero[0].text().data());
+  EXPECT_EQ("x1", zero[1].text());
+
+  // From a reader that refills, too, including the token scanned before the
+  // arena was set.
+  const std::size_t before = arena.used();
+  std::istringstream in(src);
+  Lexer lexer(std::make_unique<c_lexer::SourceReader>(in));
+  lexer.set_arena(&arena);
+  EXPECT_EQ("int", lexer.eat().text());
+  EXPECT_EQ(before + 5, arena.used()); // "int" and "x1"
+}
+
+TEST(Arena, symbol_names) {
+  Arena arena;
+  SymbolTable symbols(false, &arena);
+  symbols.intern("alpha");
+  symbols.intern("beta");
+  symbols.intern("alpha");
+  EXPECT_EQ(9u, arena.used());
+  EXPECT_EQ("beta", symbols.name(1));
+}
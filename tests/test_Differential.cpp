@@ -0,0 +1,101 @@
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <c_lexer/Lexer.h>
+
+#include "Differential.h"
+
+using c_lexer::Lexer;
+using c_lexer::fuzz::compare;
+using c_lexer::fuzz::describe;
+
+#include "tests/tests.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+void expect_agree(const std::string &src) {
+  for (const auto &m : compare(src))
+    ADD_FAILURE() << describe(m, src);
+}
+
+TEST(Differential, backends) {
+  const auto &backends = c_lexer::fuzz::backends();
+  ASSERT_GE(backends.size(), 10u);
+  EXPECT_STREQ("reference", backends[0].name);
+  EXPECT_EQ("c23", c_lexer::fuzz::mode_name(0));
+  EXPECT_EQ("c89,gnu", c_lexer::fuzz::mode_name(Lexer::C89 | Lexer::GNU));
+}
+
+TEST(Differential, edge_cases) {
+  for (const std::string &src : std::vector<std::string>{
+           "",
+           "0x.p+",
+           "0x.p+1 0x1.p 1e+ .e5 0x 0b2 1'2'3 1..2",
+           "\"\\U",
+           "\"\\U0001",
+           "'\\U0001f60",
+           "\"\\u12\" '\\x' \"\\777\"",
+           "u8'",
+           "u8'a",
+           "u8'a' u8\"\" u8",
+           "L'\\",
+           "/* open",
+           "// line\\\ncontinued",
+           "in\\\nt x\\\n = 1;",
+           "\\",
+           "\"\n\"",
+           "%:%: <:: ... .. >>=",
+           "__attribute__ asm typeof __int128 inline bool _Bool",
+           std::string("a\0b \"\0\"", 7),
+           std::string("1\0 1.\0 0x1p1\0", 13),
+           "'\rb \"a\r\vb\n'\f",
+           "\"a\vb\" x '\f' y \"\r\" z\n#include <a\vb.h>\n\"\\\n\v\" w",
+           "int a;\n\xff\nint b; \"\xff\" '\xff' 1\xff /* \xff */",
+       })
+    expect_agree(src);
+}
+
+TEST(Differential, random_pieces) {
+  // Sources strung together from pieces of C that the backends could most
+  // easily disagree on, with a fixed seed so that a failure repeats.
+  const std::vector<std::string> pieces = {
+      "0x",   ".",    "p",    "+",    "e",     "1",       "u8",  "'",
+      "\"",   "\\",   "U",    "\n",   " ",     "\t",      "/*",  "*/",
+      "//",   "/",    "*",    "int",  "in",    "t",       "x_1", "__asm",
+      "asm",  "<",    ":",    "%",    ">",     "=",       "#",   "\\\n",
+      "\x80", "true", "L",    "R",    "(",     "u",       "f",   "ll",
+      "_",    "0",    "9",    "a",    "while", "typeof",  "&",   "-",
+      "\xff", "\v",   "\f",   "\r",
+  };
+  std::mt19937 rng(20241014);
+  std::uniform_int_distribution<std::size_t> piece(0, pieces.size() - 1);
+  std::uniform_int_distribution<int> length(1, 40);
+
+  for (int i = 0; i < 300; ++i) {
+    std::string src;
+    for (int n = length(rng); n; --n)
+      src += pieces[piece(rng)];
+    expect_agree(src);
+  }
+}
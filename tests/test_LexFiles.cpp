@@ -0,0 +1,313 @@
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <c_lexer/LexFiles.h>
+#include <c_lexer/Lexer.h>
+#include <c_lexer/Token.h>
+
+#include "FileReads.h"
+#include "ScanChunks.h"
+#include "WorkStealingPool.h"
+
+using c_lexer::chunk_cuts;
+using c_lexer::count_tokens;
+using c_lexer::FileBuffer;
+using c_lexer::FileTokens;
+using c_lexer::Lexeme;
+using c_lexer::lex_files;
+using c_lexer::read_files;
+using c_lexer::ReadBackend;
+using c_lexer::scan_chunks;
+using c_lexer::scan_tokens;
+using c_lexer::scan_tokens_parallel;
+using c_lexer::Token;
+using c_lexer::TokenCounts;
+using c_lexer::TokenStream;
+using c_lexer::WorkStealingPool;
+
+#include "tests/tests.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+TEST(WorkStealingPool, runs_every_task) {
+  WorkStealingPool pool(4);
+  ASSERT_EQ(4u, pool.size());
+
+  std::atomic<int> sum(0);
+  std::vector<std::atomic<int>> per_worker(pool.size());
+
+  // Uneven task costs, so that idle workers must steal.
+  for (int i = 0; i < 1000; ++i)
+    pool.submit([&, i](unsigned worker) {
+      if (i % 100 == 0)
+        usleep(1000);
+      sum += i;
+      ++per_worker[worker];
+    });
+  pool.wait();
+
+  EXPECT_EQ(999 * 1000 / 2, sum.load());
+
+  int total = 0;
+  for (const std::atomic<int> &n : per_worker)
+    total += n;
+  EXPECT_EQ(1000, total);
+
+  // The pool can be reused after wait().
+  pool.submit([&](unsigned) { sum = -1; });
+  pool.wait();
+  EXPECT_EQ(-1, sum.load());
+}
+
+class LexFilesTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    for (int i = 0; i < 25; ++i) {
+      // Some files have splices, and the last runs well past the reader's
+      // first window: neither may cut a file short.
+      std::string src;
+      if (i % 5 == 0)
+        src += "#define M(x) \\\n  (x)\n";
+      for (int j = 0; j <= (i == 24 ? 3000 : i * 10); ++j)
+        src += "int f" + std::to_string(j) + "(void) { return " +
+               std::to_string(i * j) + "; }\n";
+
+      char name[] = "lexfiles-XXXXXX";
+      const int fd = mkstemp(name);
+      ASSERT_GE(fd, 0);
+      ASSERT_EQ(static_cast<ssize_t>(src.size()),
+                write(fd, src.data(), src.size()));
+      close(fd);
+
+      paths_.push_back(name);
+      sources_.push_back(src);
+    }
+
+    paths_.push_back("lexfiles-does-not-exist");
+    sources_.push_back("");
+  }
+
+  void TearDown() override {
+    for (const std::string &p : paths_)
+      unlink(p.c_str());
+  }
+
+  std::vector<std::string> paths_;
+  std::vector<std::string> sources_;
+};
+
+TEST_F(LexFilesTest, per_file_tokens) {
+  std::mutex mutex;
+  std::vector<int> seen(paths_.size(), 0);
+
+  const std::size_t failed = lex_files(
+      paths_, 4, [&](const FileTokens &file) {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++seen[file.index];
+        EXPECT_EQ(paths_[file.index], file.path);
+
+        if (file.index == paths_.size() - 1) {
+          EXPECT_FALSE(file.ok);
+          EXPECT_TRUE(file.tokens.empty());
+          return;
+        }
+
+        ASSERT_TRUE(file.ok);
+        std::vector<Lexeme> expected = scan_tokens(sources_[file.index]);
+        ASSERT_EQ(expected.size(), file.tokens.size());
+        for (std::size_t i = 0; i < expected.size(); ++i) {
+          EXPECT_EQ(expected[i].token(), file.tokens.token(i));
+          EXPECT_EQ(expected[i].text(), file.tokens.text(i));
+        }
+      });
+
+  EXPECT_EQ(static_cast<std::size_t>(1), failed);
+  for (int n : seen)
+    EXPECT_EQ(1, n);
+}
+
+TEST_F(LexFilesTest, count_tokens) {
+  TokenCounts expected;
+  for (std::size_t i = 0; i + 1 < sources_.size(); ++i)
+    for (const Lexeme &l : scan_tokens(sources_[i]))
+      ++expected.counts[static_cast<std::size_t>(l.token())];
+
+  for (unsigned n_threads : {1u, 3u, 0u}) {
+    const TokenCounts counts = count_tokens(paths_, n_threads);
+    EXPECT_EQ(paths_.size() - 1, counts.files);
+    EXPECT_EQ(static_cast<std::size_t>(1), counts.failed);
+    EXPECT_EQ(expected.counts, counts.counts);
+    EXPECT_EQ(counts.files, counts[Token::END]);
+  }
+}
+
+TEST_F(LexFilesTest, read_files) {
+  // Also a directory, and a file that is not regular. TearDown() unlinks
+  // only paths_.
+  std::vector<std::string> paths = paths_;
+  std::vector<std::string> sources = sources_;
+  paths.push_back(".");
+  sources.push_back("");
+  paths.push_back("/dev/null");
+  sources.push_back("");
+
+  for (ReadBackend backend : {ReadBackend::IO_URING, ReadBackend::PREAD_POOL}) {
+    for (std::size_t depth : {std::size_t(1), std::size_t(4), std::size_t(64)}) {
+      std::vector<int> seen(paths.size(), 0);
+      const ReadBackend used =
+          read_files(paths, depth, [&](FileBuffer &file) {
+            ++seen[file.index];
+            const bool failed = file.index == paths.size() - 3 ||
+                                file.index == paths.size() - 2;
+            EXPECT_EQ(!failed, file.ok) << paths[file.index];
+            EXPECT_EQ(sources[file.index], file.data) << paths[file.index];
+          }, backend);
+
+      // IO_URING falls back to PREAD_POOL where it is unavailable.
+      if (backend == ReadBackend::PREAD_POOL) {
+        EXPECT_EQ(ReadBackend::PREAD_POOL, used);
+      }
+      for (int n : seen)
+        EXPECT_EQ(1, n);
+    }
+  }
+}
+
+void expect_same_stream(const TokenStream &expected,
+                        const TokenStream &actual) {
+  ASSERT_EQ(expected.size(), actual.size());
+  EXPECT_EQ(expected.kinds(), actual.kinds());
+  EXPECT_EQ(expected.offsets(), actual.offsets());
+  EXPECT_EQ(expected.lengths(), actual.lengths());
+
+  std::vector<std::uint32_t> expected_pos;
+  std::vector<std::uint32_t> actual_pos;
+  for (std::size_t i = 0; i < expected.size(); ++i) {
+    expected_pos.push_back(expected.row(i));
+    expected_pos.push_back(expected.col(i));
+    actual_pos.push_back(actual.row(i));
+    actual_pos.push_back(actual.col(i));
+  }
+  EXPECT_EQ(expected_pos, actual_pos);
+}
+
+TEST(ScanTokensParallel, matches_serial) {
+  std::string src;
+  for (int i = 0; src.size() < 2 * 1024 * 1024; ++i)
+    src += "static const char *s" + std::to_string(i) + " = \"a\\tb\";\n"
+           "\tint x = " + std::to_string(i) + " + 'c' << 0x1ful;\v\n"
+           "/* x\n * y\n */ // z\n";
+
+  TokenStream serial;
+  scan_tokens(src, serial);
+
+  for (unsigned n_threads : {2u, 5u, 0u}) {
+    TokenStream parallel;
+    EXPECT_EQ(serial.size(), scan_tokens_parallel(src, parallel, n_threads));
+    expect_same_stream(serial, parallel);
+  }
+}
+
+TEST(ScanTokensParallel, cuts_one_line_at_spaces) {
+  // Minified source, with no newline to cut after.
+  std::string src;
+  for (int i = 0; src.size() < 2 * 1024 * 1024; ++i)
+    src += "int x" + std::to_string(i) + " = \"a; b\" [0]; /* c; d */ ";
+
+  const std::vector<std::size_t> cuts = chunk_cuts(src, 256 * 1024);
+  ASSERT_LT(4u, cuts.size());
+  EXPECT_EQ(0u, cuts.front());
+  EXPECT_EQ(src.size(), cuts.back());
+  for (std::size_t i = 1; i + 1 < cuts.size(); ++i) {
+    EXPECT_EQ(' ', src[cuts[i] - 1]) << cuts[i];
+    EXPECT_LE(cuts[i - 1] + 256 * 1024, cuts[i]);
+  }
+
+  TokenStream serial;
+  scan_tokens(src, serial);
+  for (unsigned n_threads : {2u, 5u}) {
+    TokenStream parallel;
+    EXPECT_EQ(serial.size(), scan_tokens_parallel(src, parallel, n_threads));
+    expect_same_stream(serial, parallel);
+  }
+
+  // Newlines are still preferred where there are some.
+  std::replace(src.begin(), src.end(), ';', '\n');
+  for (const std::size_t cut : chunk_cuts(src, 256 * 1024))
+    EXPECT_TRUE(cut == 0 || cut == src.size() || src[cut - 1] == '\n')
+        << cut;
+}
+
+void expect_repairs_any_cut(std::uint32_t flags) {
+  const std::string src = "#define x        1\n @ #  y\n#include \"a.h\"\n"
+                          "#define M(x) \\\n  #x ## 1 /\\\r\n* y *\\\n/\n"
+                          " in\\\nt abc = \"x y\" + 'q' <<= 12.5e3;\n"
+                          "  s->f(\"\\\"\", L'\\n') ... ident_99 @ 0x7ful\n"
+                          "/* a 'b'\n \"c\" */ d // e /* f\n"
+                          "x = \"unterminated\n"
+                          "y >>= z; /* open";
+
+  // Speculative lexes that start mid-token report errors of their own.
+  std::ostringstream discard;
+  std::streambuf *cerr_save = std::cerr.rdbuf(discard.rdbuf());
+
+  TokenStream serial;
+  scan_tokens(src, serial, flags);
+
+  WorkStealingPool pool(3);
+  for (std::size_t cut = 1; cut < src.size(); ++cut) {
+    SCOPED_TRACE(cut);
+    TokenStream ts;
+    scan_chunks(src, {0, cut, src.size()}, ts, pool, flags);
+    expect_same_stream(serial, ts);
+  }
+
+  std::mt19937 gen(7);
+  std::uniform_int_distribution<std::size_t> pick(1, src.size() - 1);
+  for (int trial = 0; trial < 200; ++trial) {
+    std::vector<std::size_t> cuts{0, pick(gen), pick(gen), pick(gen),
+                                  pick(gen), src.size()};
+    std::sort(cuts.begin(), cuts.end());
+    cuts.erase(std::unique(cuts.begin(), cuts.end()), cuts.end());
+
+    TokenStream ts;
+    scan_chunks(src, cuts, ts, pool, flags);
+    expect_same_stream(serial, ts);
+  }
+
+  std::cerr.rdbuf(cerr_save);
+}
+
+TEST(ScanChunks, repairs_any_cut) {
+  expect_repairs_any_cut(0);
+  expect_repairs_any_cut(c_lexer::Lexer::KEEP_COMMENTS);
+}
@@ -20,9 +20,12 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include <c_lexer/Diagnostic.h>
 #include <c_lexer/Lexer.h>
 #include <c_lexer/Token.h>
 
+using c_lexer::Diagnostic;
+using c_lexer::diagnostic_kind_name;
 using c_lexer::Lexeme;
 using c_lexer::Lexer;
 using c_lexer::scan_tokens;
@@ -32,12 +35,18 @@ using c_lexer::ttos;
 
 #include "tests/tests.h"
 
+#include <cstdlib>
+#include <cstring>
+#include <memory>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <tuple>
 #include <utility>
 #include <vector>
 
+#include <unistd.h>
+
 using test_tup_t = std::tuple<Token, const char *, const char *>;
 
 void basic_token_test(const test_tup_t &tup) {
@@ -267,6 +276,11 @@ NegIntTest_t negative_integer[] = {
     {"0b0wj", {Token::INVALID, Token::END}},
     {"0b0Wj", {Token::INVALID, Token::END}},
 
+    {"0b0u;", {Token::INTEGER_LIT, Token::SEMI, Token::END}},
+    {"0b0U+1", {Token::INTEGER_LIT, Token::PLUS, Token::INTEGER_LIT,
+                Token::END}},
+    {"0b0w\n", {Token::INVALID, Token::END}},
+
     {"0b0uwj", {Token::INVALID, Token::IDENTIFIER, Token::END}},
     {"0b0uWj", {Token::INVALID, Token::IDENTIFIER, Token::END}},
     {"0b0Uwj", {Token::INVALID, Token::IDENTIFIER, Token::END}},
@@ -842,11 +856,16 @@ $ @
 
 #define su(x) static_cast<std::uint32_t>(x)
 
-  ASSERT_EQ(su(1), v.size());
+  ASSERT_EQ(su(2), v.size());
 
-  EXPECT_EQ(Token::END, v[0]);
-  EXPECT_EQ(su(3), v[0].row_);
-  EXPECT_EQ(su(3), v[0].col_);
+  // The '#' follows a stray character, so it does not begin a directive.
+  EXPECT_EQ(Token::HASH, v[0]);
+  EXPECT_EQ(su(1), v[0].row_);
+  EXPECT_EQ(su(2), v[0].col_);
+
+  EXPECT_EQ(Token::END, v[1]);
+  EXPECT_EQ(su(3), v[1].row_);
+  EXPECT_EQ(su(3), v[1].col_);
 
 #undef su
 }
@@ -1411,3 +1430,938 @@ TEST_P(NegStringLiteralFixture, negativestrtest) {
 
 INSTANTIATE_TEST_SUITE_P(my, NegStringLiteralFixture,
                          ::testing::ValuesIn(negative_str));
+
+TEST(NegStringLiteral, bad_escape_before_newline) {
+  // The newline that cuts an escape short is not part of the invalid token.
+  for (const char *src : {"\"\\u\nx", "'\\U0\nx", "'\\x\nx"}) {
+    SCOPED_TRACE(src);
+    std::vector<Lexeme> v = scan_tokens(src);
+    ASSERT_EQ(3u, v.size());
+    EXPECT_EQ(Token::INVALID, v[0]);
+    EXPECT_EQ(std::string_view(src).substr(0, std::strlen(src) - 2),
+              v[0].text());
+    EXPECT_EQ(Token::IDENTIFIER, v[1]);
+    EXPECT_EQ(2u, v[1].row_);
+    EXPECT_EQ(1u, v[1].col_);
+  }
+}
+
+TEST(NegStringLiteral, nul_after_literal) {
+  // A NUL byte is not a suffix or escape letter, though strchr() finds one
+  // at the end of every set of them.
+  using namespace std::string_view_literals;
+  const std::pair<std::string_view, Token> cases[] = {
+      {"1\0"sv, Token::INTEGER_LIT},
+      {"12\0"sv, Token::INTEGER_LIT},
+      {"1.\0"sv, Token::FLOAT_LIT},
+  };
+  for (const auto &[src, token] : cases) {
+    std::vector<Lexeme> v = scan_tokens(src);
+    ASSERT_EQ(2u, v.size());
+    EXPECT_EQ(token, v[0]);
+    EXPECT_EQ(src.substr(0, src.size() - 1), v[0].text());
+    EXPECT_EQ(Token::END, v[1]);
+  }
+
+  std::vector<Lexeme> v = scan_tokens("'\\\0'"sv);
+  ASSERT_FALSE(v.empty());
+  EXPECT_EQ(Token::INVALID, v[0]);
+  EXPECT_EQ(Token::END, v.back());
+}
+
+std::vector<Lexeme> lex_all(std::unique_ptr<SourceReader> &&reader) {
+  Lexer lexer(std::move(reader));
+
+  std::vector<Lexeme> v;
+  while (lexer.peek() != Token::END) {
+    v.push_back(lexer.eat());
+  }
+  v.push_back(lexer.peek()); // Add Token::END
+
+  return v;
+}
+
+void expect_same_lexemes(const std::vector<Lexeme> &expected,
+                         const std::vector<Lexeme> &actual) {
+  ASSERT_EQ(expected.size(), actual.size());
+
+  for (std::size_t i = 0; i < expected.size(); ++i) {
+    EXPECT_EQ(expected[i].token(), actual[i].token());
+    EXPECT_EQ(expected[i].text(), actual[i].text());
+    EXPECT_EQ(expected[i].row_, actual[i].row_);
+    EXPECT_EQ(expected[i].col_, actual[i].col_);
+  }
+}
+
+const char *reader_src = R"c(int main(int argc, char *argv[]) {
+  const char *s = u8"abc\n";
+  unsigned long long x = 0xbeefULL >> 3;
+  x <<= 2; x >>= 1; a...b; c..d;
+  return x ? 0x1.p-3f : 12.5e+3L;
+})c";
+
+TEST(SourceReader, stream_and_buffer_agree) {
+  std::istringstream iss(reader_src);
+
+  std::vector<Lexeme> s = lex_all(std::make_unique<SourceReader>(iss));
+  std::vector<Lexeme> b = lex_all(std::make_unique<SourceReader>(
+      std::string_view(reader_src)));
+
+  ASSERT_NO_FATAL_FAILURE(expect_same_lexemes(s, b));
+  EXPECT_EQ(Token::INT, b[0]);
+  EXPECT_EQ(Token::END, b.back());
+}
+
+TEST(SourceReader, byte_0xff_is_not_eof) {
+  // get() returns bytes as unsigned char, so a 0xff byte is skipped as an
+  // invalid character rather than ending the source, within a literal too.
+  const std::string src = "int a;\n\xff\nint b\xff; \"\xff\" '\xff'";
+  std::istringstream iss(src);
+
+  std::vector<Lexeme> s = lex_all(std::make_unique<SourceReader>(iss));
+  std::vector<Lexeme> b =
+      lex_all(std::make_unique<SourceReader>(std::string_view(src)));
+
+  ASSERT_NO_FATAL_FAILURE(expect_same_lexemes(s, b));
+  const std::vector<Token> expected = {
+      Token::INT,        Token::IDENTIFIER, Token::SEMI,
+      Token::INT,        Token::IDENTIFIER, Token::SEMI,
+      Token::STRING_LIT, Token::INTEGER_LIT, Token::END};
+  ASSERT_EQ(expected.size(), b.size());
+  for (std::size_t i = 0; i < expected.size(); ++i)
+    EXPECT_EQ(expected[i], b[i]) << i;
+  EXPECT_EQ(3u, b[3].row_);
+  EXPECT_EQ("\"\xff\"", b[6].text());
+}
+
+TEST(SourceReader, stream_block_boundaries) {
+  // Far larger than one stream block, so that tokens (and the one character
+  // of putback) straddle many refills.
+  std::string src;
+  for (int i = 0; i < 20000; ++i) {
+    src += "a.. ident_";
+    src += std::to_string(i);
+    src += " >>= 0x1p-3f;\n";
+  }
+
+  std::istringstream iss(src);
+
+  std::vector<Lexeme> s = lex_all(std::make_unique<SourceReader>(iss));
+  std::vector<Lexeme> b =
+      lex_all(std::make_unique<SourceReader>(std::string_view(src)));
+
+  ASSERT_EQ(static_cast<std::size_t>(20000 * 7 + 1), b.size());
+  ASSERT_NO_FATAL_FAILURE(expect_same_lexemes(s, b));
+}
+
+TEST(MappedSourceReader, file) {
+  char tmpfile[] = "tmpreader-XXXXXX";
+  const int fd = mkstemp(tmpfile);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(static_cast<ssize_t>(std::strlen(reader_src)),
+            write(fd, reader_src, std::strlen(reader_src)));
+  close(fd);
+
+  auto mapped = std::make_unique<c_lexer::MappedSourceReader>(tmpfile);
+  ASSERT_TRUE(mapped->is_open());
+  EXPECT_TRUE(mapped->contiguous());
+
+  std::vector<Lexeme> m = lex_all(std::move(mapped));
+  ASSERT_NO_FATAL_FAILURE(expect_same_lexemes(scan_tokens(reader_src), m));
+
+  unlink(tmpfile);
+
+  c_lexer::MappedSourceReader missing(tmpfile);
+  EXPECT_FALSE(missing.is_open());
+  EXPECT_EQ(EOF, missing.get());
+  EXPECT_TRUE(missing.eof());
+}
+
+TEST(ZeroCopy, borrows_from_source) {
+  const std::string_view src(reader_src);
+
+  std::vector<Lexeme> copied = scan_tokens(src);
+  std::vector<Lexeme> borrowed = scan_tokens(src, Lexer::ZERO_COPY);
+
+  ASSERT_NO_FATAL_FAILURE(expect_same_lexemes(copied, borrowed));
+
+  for (std::size_t i = 0; i < borrowed.size(); ++i) {
+    EXPECT_FALSE(copied[i].borrowed());
+    EXPECT_EQ(copied[i].lexeme_, copied[i].str());
+
+    const Lexeme &l = borrowed[i];
+    EXPECT_TRUE(l.borrowed());
+    EXPECT_TRUE(l.lexeme_.empty());
+    EXPECT_GE(l.text().data(), src.data());
+    EXPECT_LE(l.text().data() + l.text().length(), src.data() + src.length());
+  }
+}
+
+TEST(ZeroCopy, stream_reader_copies) {
+  std::istringstream iss("alpha beta");
+  Lexer lexer(std::make_unique<SourceReader>(iss), Lexer::ZERO_COPY);
+
+  Lexeme l = lexer.eat();
+  EXPECT_FALSE(l.borrowed());
+  EXPECT_EQ("alpha", l.text());
+}
+
+TEST(ZeroCopy, invalid_char_restarts_token) {
+  for (std::uint32_t flags :
+       {0u, static_cast<std::uint32_t>(Lexer::ZERO_COPY)}) {
+    std::vector<Lexeme> v = scan_tokens("`ab @ +", flags);
+
+    ASSERT_EQ(static_cast<std::size_t>(3), v.size());
+    EXPECT_EQ(Token::IDENTIFIER, v[0]);
+    EXPECT_EQ("ab", v[0].text());
+    EXPECT_EQ(static_cast<std::uint32_t>(2), v[0].col_);
+    EXPECT_EQ(Token::PLUS, v[1]);
+    EXPECT_EQ("+", v[1].text());
+    EXPECT_EQ(static_cast<std::uint32_t>(7), v[1].col_);
+    EXPECT_EQ(Token::END, v[2]);
+    EXPECT_EQ("", v[2].text());
+  }
+}
+
+// Count the heap allocations made while alloc_counting is set.
+static bool alloc_counting = false;
+static std::size_t alloc_count = 0;
+
+void *operator new(std::size_t n) {
+  if (alloc_counting)
+    ++alloc_count;
+  if (void *p = std::malloc(n ? n : 1))
+    return p;
+  throw std::bad_alloc();
+}
+
+// GCC pairs the builtin new with these frees once they are inlined.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+class ScanningLexer : public Lexer {
+public:
+  using Lexer::Lexer;
+  using Lexer::scan_token;
+};
+
+std::size_t punctuator_allocs(std::unique_ptr<SourceReader> &&reader,
+                              std::uint32_t flags) {
+  ScanningLexer lexer(std::move(reader), flags);
+
+  alloc_count = 0;
+  alloc_counting = true;
+
+  std::size_t tokens = 0;
+  while (lexer.scan_token() != Token::END)
+    ++tokens;
+
+  alloc_counting = false;
+
+  // The constructor already scanned the first token into the lookahead.
+  EXPECT_EQ(static_cast<std::size_t>(1000 * 24 - 1), tokens);
+  return alloc_count;
+}
+
+TEST(ScanToken, no_allocations_for_punctuators) {
+  std::string src;
+  for (int i = 0; i < 1000; ++i)
+    src += "; , ( ) { } [ ] ... -> . ? : ~ ! != + ++ += <<= >>= >= ^= &&\n";
+
+  EXPECT_EQ(static_cast<std::size_t>(0),
+            punctuator_allocs(
+                std::make_unique<SourceReader>(std::string_view(src)), 0));
+  EXPECT_EQ(static_cast<std::size_t>(0),
+            punctuator_allocs(
+                std::make_unique<SourceReader>(std::string_view(src)),
+                Lexer::ZERO_COPY));
+
+  std::istringstream iss(src);
+  EXPECT_EQ(static_cast<std::size_t>(0),
+            punctuator_allocs(std::make_unique<SourceReader>(iss), 0));
+}
+
+TEST(Lookahead, peek_k) {
+  Lexer lexer(std::make_unique<SourceReader>(std::string_view("a = b + 1;")));
+
+  EXPECT_EQ(Token::IDENTIFIER, lexer.peek(0));
+  EXPECT_EQ(Token::ASSIGN, lexer.peek(1));
+  EXPECT_EQ("b", lexer.peek(2).text());
+  EXPECT_EQ(Token::PLUS, lexer.peek(3));
+
+  // Peeking ahead does not consume.
+  EXPECT_EQ("a", lexer.peek().text());
+  EXPECT_EQ("a", lexer.eat().text());
+  EXPECT_EQ(Token::ASSIGN, lexer.peek());
+  EXPECT_EQ("b", lexer.peek(1).text());
+  EXPECT_EQ(Token::SEMI, lexer.peek(4));
+
+  // Past the end, peek(k) keeps returning END.
+  EXPECT_EQ(Token::END, lexer.peek(5));
+  EXPECT_EQ(Token::END, lexer.peek(lexer.lookahead_capacity - 1));
+
+  const Token expected[] = {Token::ASSIGN,      Token::IDENTIFIER,
+                            Token::PLUS,        Token::INTEGER_LIT,
+                            Token::SEMI,        Token::END};
+  for (Token t : expected)
+    EXPECT_EQ(t, lexer.eat());
+  EXPECT_EQ(Token::END, lexer.peek(2));
+}
+
+TEST(Lookahead, ring_wraps) {
+  std::string src;
+  for (int i = 0; i < 100; ++i)
+    src += "x" + std::to_string(i) + ' ';
+
+  Lexer lexer(std::make_unique<SourceReader>(std::string_view(src)));
+
+  // Keep the ring full while eating so that head_ wraps many times.
+  for (int i = 0; i < 100; ++i) {
+    lexer.preload(lexer.lookahead_capacity);
+    const std::size_t k = std::min<std::size_t>(
+        lexer.lookahead_capacity - 1, static_cast<std::size_t>(99 - i));
+    EXPECT_EQ("x" + std::to_string(i + k), lexer.peek(k).text());
+    // Peeking past the ring looks no further than its last slot.
+    if (k == lexer.lookahead_capacity - 1) {
+      EXPECT_EQ(&lexer.peek(k), &lexer.peek(k + 1000));
+    }
+    EXPECT_EQ("x" + std::to_string(i), lexer.eat().text());
+  }
+  EXPECT_EQ(Token::END, lexer.eat());
+}
+
+TEST(Batch, lexemes_match_eat) {
+  const std::vector<Lexeme> expected = scan_tokens(std::string_view(reader_src));
+
+  for (std::size_t max : {std::size_t(1), std::size_t(3), std::size_t(64)}) {
+    SCOPED_TRACE(max);
+    Lexer lexer(std::make_unique<SourceReader>(std::string_view(reader_src)));
+    // Batches begin with whatever the lookahead already holds.
+    lexer.preload(3);
+
+    std::vector<Lexeme> v;
+    std::vector<Lexeme> batch(max);
+    for (;;) {
+      const std::size_t n = lexer.next_batch(batch.data(), max);
+      ASSERT_GT(n, 0u);
+      v.insert(v.end(), batch.begin(), batch.begin() + n);
+      if (v.back() == Token::END)
+        break;
+      ASSERT_EQ(max, n);
+    }
+    expect_same_lexemes(expected, v);
+
+    // Past the end, batches hold just END.
+    EXPECT_EQ(1u, lexer.next_batch(batch.data(), max));
+    EXPECT_EQ(Token::END, batch[0]);
+    EXPECT_EQ(Token::END, lexer.peek());
+  }
+}
+
+TEST(Batch, tokens_and_peek) {
+  Lexer lexer(std::make_unique<SourceReader>(std::string_view("a = b + 1;")));
+  Token t[4];
+
+  EXPECT_EQ("a", lexer.peek().text());
+  ASSERT_EQ(2u, lexer.next_batch(t, 2));
+  EXPECT_EQ(Token::IDENTIFIER, t[0]);
+  EXPECT_EQ(Token::ASSIGN, t[1]);
+  EXPECT_EQ("b", lexer.peek().text());
+
+  ASSERT_EQ(4u, lexer.next_batch(t, 4));
+  EXPECT_EQ(Token::SEMI, t[3]);
+  ASSERT_EQ(1u, lexer.next_batch(t, 4));
+  EXPECT_EQ(Token::END, t[0]);
+  EXPECT_EQ(0u, lexer.next_batch(t, 0));
+}
+
+class TableKeywordFixture : public ::testing::TestWithParam<test_tup_t> {};
+
+TEST_P(TableKeywordFixture, tablekeytest) {
+  const Token tok = std::get<0>(GetParam());
+  const char *lex = std::get<2>(GetParam());
+
+  std::vector<Lexeme> v =
+      scan_tokens(std::string_view(lex), Lexer::TABLE_KEYWORDS);
+
+  ASSERT_EQ(static_cast<std::vector<Lexeme>::size_type>(2), v.size());
+  EXPECT_EQ(tok, v[0]);
+  EXPECT_EQ(lex, v[0].str());
+  EXPECT_EQ(Token::END, v[1]);
+}
+
+INSTANTIATE_TEST_SUITE_P(my, TableKeywordFixture,
+                         ::testing::ValuesIn(keywords));
+
+class TableIdentifierFixture : public ::testing::TestWithParam<const char *> {
+};
+
+TEST_P(TableIdentifierFixture, tableidenttest) {
+  const char *lex = GetParam();
+
+  std::vector<Lexeme> v =
+      scan_tokens(std::string_view(lex), Lexer::TABLE_KEYWORDS);
+
+  ASSERT_EQ(static_cast<std::vector<Lexeme>::size_type>(2), v.size());
+  EXPECT_EQ(Token::IDENTIFIER, v[0]);
+  EXPECT_EQ(lex, v[0].str());
+  EXPECT_EQ(Token::END, v[1]);
+}
+
+INSTANTIATE_TEST_SUITE_P(my, TableIdentifierFixture,
+                         ::testing::ValuesIn(identifiers));
+
+TEST(TableKeywords, matches_dfa) {
+  std::string src = reader_src;
+  for (const test_tup_t &k : keywords) {
+    const std::string kw = std::get<2>(k);
+    src += kw + ' ' + kw + "_ " + kw.substr(0, kw.size() - 1) + " x" + kw +
+           ' ' + kw + "1+" + kw + "(u8\"s\", L'c', U\"t\", u'v');\n";
+  }
+
+  std::vector<Lexeme> dfa = scan_tokens(std::string_view(src));
+  std::vector<Lexeme> table =
+      scan_tokens(std::string_view(src), Lexer::TABLE_KEYWORDS);
+  expect_same_lexemes(dfa, table);
+
+  // An identifier that straddles a refill of a stream reader.
+  const std::string stream_src =
+      std::string(64 * 1024 - 3, ' ') + "register registers " + src;
+  std::istringstream iss(stream_src);
+  Lexer lexer(std::make_unique<SourceReader>(iss), Lexer::TABLE_KEYWORDS);
+
+  std::vector<Lexeme> streamed;
+  while (lexer.peek() != Token::END)
+    streamed.push_back(lexer.eat());
+  streamed.push_back(lexer.peek());
+
+  expect_same_lexemes(scan_tokens(std::string_view(stream_src)), streamed);
+  EXPECT_EQ(Token::REGISTER, streamed[0]);
+  EXPECT_EQ(Token::IDENTIFIER, streamed[1]);
+  EXPECT_EQ("registers", streamed[1].text());
+}
+
+std::vector<Token> dialect_tokens(const char *src, std::uint32_t flags) {
+  std::vector<Token> v;
+  for (const Lexeme &l : scan_tokens(std::string_view(src), flags))
+    v.push_back(l);
+  return v;
+}
+
+TEST(Dialects, c89) {
+  const char *src = "int inline bool _Bool constexpr nullptr typeof asm "
+                    "__attribute__ restrict";
+  const std::vector<Token> c89 = {
+      Token::INT,        Token::IDENTIFIER, Token::IDENTIFIER,
+      Token::IDENTIFIER, Token::IDENTIFIER, Token::IDENTIFIER,
+      Token::IDENTIFIER, Token::IDENTIFIER, Token::IDENTIFIER,
+      Token::IDENTIFIER, Token::END};
+  const std::vector<Token> c23 = {
+      Token::INT,        Token::INLINE,     Token::BOOL,
+      Token::_BOOL,      Token::CONSTEXPR,  Token::NULLPTR,
+      Token::TYPEOF,     Token::IDENTIFIER, Token::IDENTIFIER,
+      Token::RESTRICT,   Token::END};
+
+  for (std::uint32_t table : {0u, unsigned(Lexer::TABLE_KEYWORDS)}) {
+    EXPECT_EQ(c89, dialect_tokens(src, Lexer::C89 | table));
+    EXPECT_EQ(c23, dialect_tokens(src, table));
+  }
+}
+
+TEST(Dialects, gnu) {
+  const char *src = "asm __asm__ __attribute__((packed)) __inline__ inline "
+                    "typeof __typeof__ __extension__ __int128 __label__ "
+                    "__auto_type __restrict __signed__ _Bool __foo";
+  const std::vector<Token> gnu89 = {
+      Token::ASM,        Token::ASM,        Token::ATTRIBUTE,
+      Token::LPAREN,     Token::LPAREN,     Token::IDENTIFIER,
+      Token::RPAREN,     Token::RPAREN,     Token::INLINE,
+      Token::INLINE,     Token::TYPEOF,     Token::TYPEOF,
+      Token::EXTENSION,  Token::INT128,     Token::LABEL,
+      Token::AUTO_TYPE,  Token::RESTRICT,   Token::SIGNED,
+      Token::IDENTIFIER, Token::IDENTIFIER, Token::END};
+  std::vector<Token> gnu23 = gnu89;
+  gnu23[18] = Token::_BOOL;
+
+  for (std::uint32_t table : {0u, unsigned(Lexer::TABLE_KEYWORDS)}) {
+    EXPECT_EQ(gnu89, dialect_tokens(src, Lexer::C89 | Lexer::GNU | table));
+    EXPECT_EQ(gnu23, dialect_tokens(src, Lexer::GNU | table));
+  }
+}
+
+TEST(Dialects, table_matches_dfa) {
+  std::string src = reader_src;
+  for (const test_tup_t &k : keywords) {
+    const std::string kw = std::get<2>(k);
+    src += kw + ' ' + kw + "_ __" + kw + " __" + kw + "__ " +
+           kw.substr(0, kw.size() - 1) + ";\n";
+  }
+  src += "asm asmx as __asm__ __attribute __attribute__x __int128;\n";
+
+  for (std::uint32_t dialect :
+       {0u, unsigned(Lexer::C89), unsigned(Lexer::GNU),
+        unsigned(Lexer::C89 | Lexer::GNU)}) {
+    SCOPED_TRACE(dialect);
+    expect_same_lexemes(
+        scan_tokens(std::string_view(src), dialect),
+        scan_tokens(std::string_view(src), dialect | Lexer::TABLE_KEYWORDS));
+  }
+}
+
+const char *comment_src = "a/* one\n\ttwo */b // three\r\n"
+                          "c /**/ d /*/ * / */ e/// f\n"
+                          "/* \v\f */ g//";
+
+TEST(Comments, skipped) {
+#define su(x) static_cast<std::uint32_t>(x)
+
+  std::vector<Lexeme> v = scan_tokens(comment_src);
+  ASSERT_EQ(static_cast<std::size_t>(7), v.size());
+
+  const char *texts[] = {"a", "b", "c", "d", "e", "g", ""};
+  const std::uint32_t rows[] = {1, 2, 3, 3, 3, 6, 6};
+  const std::uint32_t cols[] = {1, 8, 1, 8, 21, 5, 8};
+  for (std::size_t i = 0; i < v.size(); ++i) {
+    SCOPED_TRACE(i);
+    EXPECT_EQ(texts[i], v[i].text());
+    EXPECT_EQ(su(rows[i]), v[i].row_);
+    EXPECT_EQ(su(cols[i]), v[i].col_);
+  }
+  EXPECT_EQ(Token::END, v.back());
+
+  // '/' alone and "/=" are still operators.
+  v = scan_tokens("a / b /= c");
+  ASSERT_EQ(static_cast<std::size_t>(6), v.size());
+  EXPECT_EQ(Token::DIV, v[1]);
+  EXPECT_EQ(Token::DIV_ASSIGN, v[3]);
+
+#undef su
+}
+
+TEST(Comments, kept) {
+#define su(x) static_cast<std::uint32_t>(x)
+
+  std::vector<Lexeme> v =
+      scan_tokens(comment_src, Lexer::KEEP_COMMENTS | Lexer::ZERO_COPY);
+  ASSERT_EQ(static_cast<std::size_t>(14), v.size());
+  EXPECT_EQ(Token::END, v.back());
+  v.pop_back();
+
+  const char *texts[] = {"a",          "/* one\n\ttwo */",
+                         "b",          "// three\r",
+                         "c",          "/**/",
+                         "d",          "/*/ * / */",
+                         "e",          "/// f",
+                         "/* \v\f */", "g",
+                         "//"};
+  const std::uint32_t rows[] = {1, 1, 2, 2, 3, 3, 3, 3, 3, 3, 4, 6, 6};
+  const std::uint32_t cols[] = {1, 2, 8, 10, 1, 3, 8, 10, 21, 22, 1, 5, 6};
+  for (std::size_t i = 0; i < v.size(); ++i) {
+    SCOPED_TRACE(i);
+    EXPECT_EQ(texts[i], v[i].text());
+    EXPECT_EQ(su(rows[i]), v[i].row_);
+    EXPECT_EQ(su(cols[i]), v[i].col_);
+    EXPECT_TRUE(v[i].borrowed());
+    EXPECT_EQ(texts[i][0] == '/' ? Token::COMMENT : Token::IDENTIFIER, v[i]);
+  }
+
+#undef su
+}
+
+TEST(Comments, unterminated) {
+  std::ostringstream errors;
+  std::streambuf *cerr_save = std::cerr.rdbuf(errors.rdbuf());
+
+  std::vector<Lexeme> v = scan_tokens("x /* y\n z");
+  ASSERT_EQ(static_cast<std::size_t>(2), v.size());
+  EXPECT_EQ(Token::END, v[1]);
+  EXPECT_EQ("c_lexer[2,3]: Unterminated comment.\n", errors.str());
+
+  errors.str("");
+  v = scan_tokens("x /* y\n z", Lexer::KEEP_COMMENTS);
+  ASSERT_EQ(static_cast<std::size_t>(3), v.size());
+  EXPECT_EQ(Token::INVALID, v[1]);
+  EXPECT_EQ("/* y\n z", v[1].text());
+  EXPECT_EQ("c_lexer[2,3]: Unterminated comment.\n", errors.str());
+
+  // A source that will continue leaves the comment open quietly.
+  errors.str("");
+  v = scan_tokens("x /* y\n z", Lexer::KEEP_COMMENTS | Lexer::OPEN_ENDED);
+  ASSERT_EQ(static_cast<std::size_t>(3), v.size());
+  EXPECT_EQ(Token::INVALID, v[1]);
+  EXPECT_EQ("", errors.str());
+
+  std::cerr.rdbuf(cerr_save);
+}
+
+TEST(Comments, stream_block_boundaries) {
+  // Comments that straddle refills of a stream reader, in both modes.
+  std::string src;
+  for (int i = 0; i < 3000; ++i)
+    src += "x" + std::to_string(i) + " /* a comment **/ y // " +
+           std::string(static_cast<std::size_t>(i % 40), '*') + "\n";
+
+  for (std::uint32_t flags : {0u, unsigned(Lexer::KEEP_COMMENTS)}) {
+    std::istringstream iss(src);
+    Lexer lexer(std::make_unique<SourceReader>(iss), flags);
+
+    std::vector<Lexeme> streamed;
+    while (lexer.peek() != Token::END)
+      streamed.push_back(lexer.eat());
+    streamed.push_back(lexer.peek());
+
+    expect_same_lexemes(scan_tokens(std::string_view(src), flags), streamed);
+  }
+}
+
+TEST(Directives, tokens) {
+  const char *src = "#include <stdio.h>\n"
+                    "  # include_next \"a b.h\" // c\n"
+                    "#define CAT(a, b) a ## b /* d\n"
+                    " */ #x\n"
+                    "int y; # z <w>\n"
+                    "#if y < 2\n"
+                    "#endif";
+
+  const Token tokens[] = {
+      Token::HASH,       Token::IDENTIFIER,  Token::HEADER_NAME,
+      Token::NEWLINE,    Token::HASH,        Token::IDENTIFIER,
+      Token::HEADER_NAME, Token::NEWLINE,    Token::HASH,
+      Token::IDENTIFIER, Token::IDENTIFIER,  Token::LPAREN,
+      Token::IDENTIFIER, Token::COMMA,       Token::IDENTIFIER,
+      Token::RPAREN,     Token::IDENTIFIER,  Token::HASH_HASH,
+      Token::IDENTIFIER, Token::HASH,        Token::IDENTIFIER,
+      Token::NEWLINE,    Token::INT,         Token::IDENTIFIER,
+      Token::SEMI,       Token::HASH,        Token::IDENTIFIER,
+      Token::LESS,       Token::IDENTIFIER,  Token::GREATER,
+      Token::HASH,       Token::IF,          Token::IDENTIFIER,
+      Token::LESS,       Token::INTEGER_LIT, Token::NEWLINE,
+      Token::HASH,       Token::IDENTIFIER,  Token::END,
+  };
+
+  for (std::uint32_t flags : {0u, unsigned(Lexer::TABLE_KEYWORDS)}) {
+    std::vector<Lexeme> v = scan_tokens(src, flags);
+    ASSERT_EQ(std::size(tokens), v.size());
+    for (std::size_t i = 0; i < v.size(); ++i) {
+      SCOPED_TRACE(i);
+      EXPECT_EQ(tokens[i], v[i]);
+    }
+
+    EXPECT_EQ("<stdio.h>", v[2].text());
+    EXPECT_EQ("\"a b.h\"", v[6].text());
+
+    // A NEWLINE is the directive's newline, and comes after a comment that
+    // ends the line. A comment that spans lines does not end a directive.
+    EXPECT_EQ("\n", v[7].text());
+    EXPECT_EQ(static_cast<std::uint32_t>(2), v[7].row_);
+    EXPECT_EQ(static_cast<std::uint32_t>(30), v[7].col_);
+    EXPECT_EQ(static_cast<std::uint32_t>(4), v[21].row_);
+    EXPECT_EQ(static_cast<std::uint32_t>(7), v[21].col_);
+  }
+}
+
+TEST(Directives, unterminated_header_name) {
+  std::ostringstream errors;
+  std::streambuf *cerr_save = std::cerr.rdbuf(errors.rdbuf());
+
+  std::vector<Lexeme> v = scan_tokens("#include <a.h\nx");
+  std::cerr.rdbuf(cerr_save);
+
+  ASSERT_EQ(static_cast<std::size_t>(6), v.size());
+  EXPECT_EQ(Token::INVALID, v[2]);
+  EXPECT_EQ("<a.h", v[2].text());
+  EXPECT_EQ(Token::NEWLINE, v[3]);
+  EXPECT_EQ(Token::IDENTIFIER, v[4]);
+  EXPECT_EQ("c_lexer[1,10]: Unterminated header name.\n", errors.str());
+}
+
+TEST(Splices, join_lines) {
+  const char *src = "in\\\nt x = a\\\r\nb; // c \\\n d\n"
+                    "#define E 1 + \\\n  2\n"
+                    "f.\\\n.\\\n\\\ng /\\\n* h *\\\n/ i";
+
+  const Token tokens[] = {
+      Token::INT,  Token::IDENTIFIER,  Token::ASSIGN,     Token::IDENTIFIER,
+      Token::SEMI, Token::HASH,        Token::IDENTIFIER, Token::IDENTIFIER,
+      Token::INTEGER_LIT, Token::PLUS, Token::INTEGER_LIT, Token::NEWLINE,
+      Token::IDENTIFIER,  Token::DOT,  Token::DOT,        Token::IDENTIFIER,
+      Token::IDENTIFIER,  Token::END,
+  };
+  const char *texts[] = {"int", "x", "=", "ab", ";", "#", "define", "E",
+                         "1",   "+", "2", "\n", "f", ".", ".",      "g",
+                         "i",   ""};
+  const std::uint32_t rows[] = {1, 2, 2, 2, 3, 5, 5, 5, 5,
+                                5, 6, 6, 7, 7, 8, 10, 12, 12};
+  const std::uint32_t cols[] = {1, 3, 5, 7, 2, 1, 2, 9, 11,
+                                13, 3, 4, 1, 2, 1, 1, 3, 4};
+
+  std::istringstream iss(src);
+  const std::vector<Lexeme> streamed =
+      lex_all(std::make_unique<SourceReader>(iss));
+
+  for (std::uint32_t flags :
+       {0u, unsigned(Lexer::ZERO_COPY), unsigned(Lexer::TABLE_KEYWORDS)}) {
+    const std::vector<Lexeme> v = scan_tokens(src, flags);
+    ASSERT_EQ(std::size(tokens), v.size());
+    for (std::size_t i = 0; i < v.size(); ++i) {
+      SCOPED_TRACE(i);
+      EXPECT_EQ(tokens[i], v[i]);
+      EXPECT_EQ(texts[i], v[i].text());
+      EXPECT_EQ(rows[i], v[i].row_);
+      EXPECT_EQ(cols[i], v[i].col_);
+    }
+    expect_same_lexemes(v, streamed);
+  }
+}
+
+TEST(Splices, offset_before_splice) {
+  // A '/' that is not a comment starts where it is, not past the splice
+  // that looking for the comment stepped over.
+  for (std::uint32_t flags : {0u, unsigned(Lexer::ZERO_COPY)}) {
+    const std::vector<Lexeme> v = scan_tokens("a /\\\nb", flags);
+    ASSERT_EQ(4u, v.size());
+    EXPECT_EQ(Token::DIV, v[1]);
+    EXPECT_EQ(2u, v[1].offset_);
+    EXPECT_EQ(3u, v[1].col_);
+  }
+}
+
+TEST(Splices, stream_block_boundaries) {
+  // Splices at every offset from the refills of a stream reader, including
+  // ones that a putback has to be carried back across.
+  std::string src;
+  for (int i = 0; i < 12000; ++i) {
+    src += std::string(static_cast<std::size_t>(i % 7), ' ');
+    src += "#define y\\\n z /\\\n* w *\\\n/ ab\\\ncd ..\\\n.x -\\\r\n>\n";
+  }
+
+  std::istringstream iss(src);
+  std::vector<Lexeme> s = lex_all(std::make_unique<SourceReader>(iss));
+  std::vector<Lexeme> b =
+      lex_all(std::make_unique<SourceReader>(std::string_view(src)));
+
+  ASSERT_EQ(static_cast<std::size_t>(12000 * 9 + 1), b.size());
+  ASSERT_NO_FATAL_FAILURE(expect_same_lexemes(s, b));
+  EXPECT_EQ("abcd", b[9 * 11999 + 4].text());
+  EXPECT_EQ(Token::ARROW, b[7]);
+  EXPECT_EQ(Token::NEWLINE, b[8]);
+}
+
+// Lex all of src with RECOVER and flags, keeping its diagnostics.
+std::vector<Lexeme> recover(std::string_view src,
+                            std::vector<Diagnostic> &diagnostics,
+                            std::uint32_t flags = 0) {
+  Lexer lexer(std::make_unique<SourceReader>(src), flags | Lexer::RECOVER);
+
+  std::vector<Lexeme> v;
+  while (lexer.peek() != Token::END)
+    v.push_back(lexer.eat());
+  v.push_back(lexer.peek());
+
+  diagnostics = lexer.diagnostics();
+  return v;
+}
+
+TEST(Recover, diagnostics_not_printed) {
+  std::ostringstream errors;
+  std::streambuf *cerr_save = std::cerr.rdbuf(errors.rdbuf());
+
+  std::vector<Diagnostic> d;
+  std::vector<Lexeme> v = recover("x @@` $\n /* y", d);
+  ASSERT_EQ(2u, v.size());
+  EXPECT_EQ(Token::IDENTIFIER, v[0]);
+  EXPECT_EQ(Token::END, v[1]);
+
+  // Each run of stray characters is one error.
+  ASSERT_EQ(3u, d.size());
+  EXPECT_EQ(Diagnostic::INVALID_CHARACTER, d[0].kind);
+  EXPECT_EQ(2u, d[0].offset);
+  EXPECT_EQ(1u, d[0].row);
+  EXPECT_EQ(3u, d[0].col);
+  EXPECT_EQ(Diagnostic::INVALID_CHARACTER, d[1].kind);
+  EXPECT_EQ(6u, d[1].offset);
+  EXPECT_EQ(7u, d[1].col);
+  EXPECT_EQ(Diagnostic::UNTERMINATED_COMMENT, d[2].kind);
+  EXPECT_EQ(9u, d[2].offset);
+  EXPECT_EQ(2u, d[2].row);
+  EXPECT_EQ(2u, d[2].col);
+  EXPECT_STREQ("Unterminated comment.", d[2].message);
+  EXPECT_STREQ("UNTERMINATED_COMMENT", diagnostic_kind_name(d[2].kind));
+
+  EXPECT_EQ("", errors.str());
+  std::cerr.rdbuf(cerr_save);
+}
+
+TEST(Recover, bad_escape_takes_literal) {
+  // The rest of the literal goes with the bad escape, so that its closing
+  // quote does not open another literal.
+  const std::string_view src = "\"a\\qb\" c 'x\\9' d \"e\\u12\" f \"g\\x\nh";
+  std::vector<Diagnostic> d;
+  std::vector<Lexeme> v = recover(src, d);
+
+  const std::pair<Token, std::string_view> expected[] = {
+      {Token::INVALID, "\"a\\qb\""},   {Token::IDENTIFIER, "c"},
+      {Token::INVALID, "'x\\9'"},      {Token::IDENTIFIER, "d"},
+      {Token::INVALID, "\"e\\u12\""},  {Token::IDENTIFIER, "f"},
+      {Token::INVALID, "\"g\\x"},      {Token::IDENTIFIER, "h"},
+      {Token::END, ""},
+  };
+  ASSERT_EQ(std::size(expected), v.size());
+  for (std::size_t i = 0; i < v.size(); ++i) {
+    EXPECT_EQ(expected[i].first, v[i]) << i;
+    EXPECT_EQ(expected[i].second, v[i].text()) << i;
+  }
+  EXPECT_EQ(2u, v[7].row_);
+
+  ASSERT_EQ(4u, d.size());
+  for (std::size_t i = 0; i < d.size(); ++i) {
+    EXPECT_EQ(Diagnostic::BAD_ESCAPE, d[i].kind);
+    EXPECT_EQ(v[2 * i].offset_, d[i].offset);
+    EXPECT_EQ(v[2 * i].col_, d[i].col);
+  }
+}
+
+TEST(Recover, bad_number_takes_pp_number) {
+  const std::string_view src = "0x;0xzz+1 1e+x2 1uzz 0b2 1e5dq";
+  std::vector<Diagnostic> d;
+  std::vector<Lexeme> v = recover(src, d);
+
+  const std::pair<Token, std::string_view> expected[] = {
+      {Token::INVALID, "0x"},      {Token::SEMI, ";"},
+      {Token::INVALID, "0xzz"},    {Token::PLUS, "+"},
+      {Token::INTEGER_LIT, "1"},   {Token::INVALID, "1e+x2"},
+      {Token::INVALID, "1uzz"},    {Token::INVALID, "0b2"},
+      {Token::INVALID, "1e5dq"},   {Token::END, ""},
+  };
+  ASSERT_EQ(std::size(expected), v.size());
+  for (std::size_t i = 0; i < v.size(); ++i) {
+    EXPECT_EQ(expected[i].first, v[i]) << i;
+    EXPECT_EQ(expected[i].second, v[i].text()) << i;
+  }
+
+  const Diagnostic::Kind kinds[] = {
+      Diagnostic::BAD_NUMBER, Diagnostic::BAD_NUMBER, Diagnostic::BAD_NUMBER,
+      Diagnostic::BAD_SUFFIX, Diagnostic::BAD_NUMBER, Diagnostic::BAD_SUFFIX};
+  ASSERT_EQ(std::size(kinds), d.size());
+  for (std::size_t i = 0; i < d.size(); ++i)
+    EXPECT_EQ(kinds[i], d[i].kind) << i;
+
+  // Without RECOVER, the number ends where it went wrong.
+  std::ostringstream errors;
+  std::streambuf *cerr_save = std::cerr.rdbuf(errors.rdbuf());
+  v = scan_tokens("0xzz");
+  std::cerr.rdbuf(cerr_save);
+  ASSERT_EQ(3u, v.size());
+  EXPECT_EQ("0x", v[0].text());
+  EXPECT_EQ(Token::IDENTIFIER, v[1]);
+}
+
+TEST(Recover, lazy_positions) {
+  const std::string_view src = "a\n @";
+  std::vector<Diagnostic> d;
+  Lexer lexer(std::make_unique<SourceReader>(src),
+              Lexer::RECOVER | Lexer::ZERO_COPY | Lexer::LAZY_POSITIONS);
+  while (lexer.eat() != Token::END) {
+  }
+
+  ASSERT_EQ(1u, lexer.diagnostics().size());
+  const Diagnostic &e = lexer.diagnostics()[0];
+  EXPECT_EQ(0u, e.row);
+  EXPECT_EQ(0u, e.col);
+  EXPECT_EQ(3u, e.offset);
+  EXPECT_EQ(2u, lexer.position_of(e.offset).row);
+  EXPECT_EQ(2u, lexer.position_of(e.offset).col);
+
+  lexer.clear_diagnostics();
+  EXPECT_TRUE(lexer.diagnostics().empty());
+}
+
+TEST(Recover, garbage_is_bounded) {
+  // A long run of stray bytes is one error and no tokens.
+  std::vector<Diagnostic> d;
+  std::vector<Lexeme> v = recover(std::string(100000, '@'), d);
+  EXPECT_EQ(1u, v.size());
+  EXPECT_EQ(1u, d.size());
+
+  // Arbitrary bytes give no more tokens and errors than bytes, in order.
+  std::string src(1 << 16, '\0');
+  std::uint32_t x = 2463534242u;
+  for (char &ch : src) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    ch = static_cast<char>(x);
+  }
+  for (std::uint32_t flags : {0u, unsigned(Lexer::ZERO_COPY)}) {
+    v = recover(src, d, flags);
+    EXPECT_LE(v.size() + d.size(), src.size() + 1);
+    for (std::size_t i = 1; i < d.size(); ++i)
+      EXPECT_LT(d[i - 1].offset, d[i].offset);
+  }
+}
+
+TEST(Recover, binary_input) {
+  // A 0xff byte is a stray character like any other, not the end of input.
+  std::vector<Diagnostic> d;
+  std::vector<Lexeme> v = recover("a \xff\xff\x80 b", d);
+  ASSERT_EQ(3u, v.size());
+  EXPECT_EQ("b", v[1].text());
+  ASSERT_EQ(1u, d.size());
+  EXPECT_EQ(Diagnostic::INVALID_CHARACTER, d[0].kind);
+  EXPECT_EQ(2u, d[0].offset);
+
+  // Nor do raw bytes end it: the line after them still lexes, from either
+  // reader.
+  std::string src(1 << 16, '\0');
+  std::uint32_t x = 88172645u;
+  for (char &ch : src) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    ch = static_cast<char>(x);
+  }
+  // Close any comment or literal that the bytes left open.
+  src += " \n*/\n\"\n'\nint tail;";
+
+  const auto expect_tail = [](const std::vector<Lexeme> &v) {
+    ASSERT_GE(v.size(), 4u);
+    EXPECT_EQ(Token::INT, v[v.size() - 4]);
+    EXPECT_EQ("tail", v[v.size() - 3].text());
+    EXPECT_EQ(Token::SEMI, v[v.size() - 2]);
+    EXPECT_EQ(Token::END, v.back());
+  };
+
+  for (std::uint32_t flags :
+       {0u, unsigned(Lexer::ZERO_COPY),
+        unsigned(Lexer::ZERO_COPY | Lexer::LAZY_POSITIONS)}) {
+    SCOPED_TRACE(flags);
+    ASSERT_NO_FATAL_FAILURE(expect_tail(recover(src, d, flags)));
+    ASSERT_FALSE(d.empty());
+    EXPECT_LT(d.back().offset, src.size());
+  }
+
+  std::istringstream iss(src);
+  Lexer lexer(std::make_unique<SourceReader>(iss), Lexer::RECOVER);
+  v.clear();
+  while (lexer.peek() != Token::END)
+    v.push_back(lexer.eat());
+  v.push_back(lexer.peek());
+  ASSERT_NO_FATAL_FAILURE(expect_tail(v));
+  EXPECT_EQ(recover(src, d).size(), v.size());
+}
+
+TEST(LexerStats, only_when_enabled) {
+  Lexer lexer(std::make_unique<SourceReader>(std::string_view("a > b")));
+  while (lexer.peek() != Token::END)
+    lexer.eat();
+
+  const std::uint64_t n = lexer.stats().tokens[EnumToUnsigned(Token::GREATER)];
+  EXPECT_EQ(c_lexer::lexer_stats_enabled() ? 1u : 0u, n);
+}
@@ -0,0 +1,115 @@
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <c_lexer/Lexer.h>
+#include <c_lexer/LexerStats.h>
+
+using c_lexer::Lexer;
+using c_lexer::lexer_state_name;
+using c_lexer::lexer_stats_enabled;
+using c_lexer::LexerStats;
+using c_lexer::SourceReader;
+using c_lexer::Token;
+
+#include "tests/tests.h"
+
+#include <cstdint>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+static std::size_t index(Token t) { return static_cast<std::size_t>(t); }
+
+static std::uint32_t state(std::string_view name) {
+  for (std::uint32_t s = 0; s < LexerStats::num_states; ++s)
+    if (const char *n = lexer_state_name(s); n && name == n)
+      return s;
+  return LexerStats::num_states;
+}
+
+static void lex_all(Lexer &lexer) {
+  while (lexer.peek() != Token::END)
+    lexer.eat();
+}
+
+TEST(LexerStats, state_names) {
+  EXPECT_STREQ("START", lexer_state_name(0));
+  EXPECT_STREQ("GOT_GT", lexer_state_name(1));
+  EXPECT_STREQ("THE_END", lexer_state_name(LexerStats::num_states - 1));
+  EXPECT_EQ(nullptr, lexer_state_name(900));
+  EXPECT_EQ(nullptr, lexer_state_name(LexerStats::num_states));
+}
+
+TEST(LexerStats, counts) {
+  ASSERT_TRUE(lexer_stats_enabled());
+
+  const std::string_view src = "a >>= bc;  /* x */ d > e\n";
+  for (std::uint32_t flags : {0u, unsigned(Lexer::ZERO_COPY),
+                              unsigned(Lexer::TABLE_KEYWORDS)}) {
+    Lexer lexer(std::make_unique<SourceReader>(src), flags);
+    lex_all(lexer);
+    const LexerStats &stats = lexer.stats();
+
+    EXPECT_EQ(4u, stats.tokens[index(Token::IDENTIFIER)]);
+    EXPECT_EQ(5u, stats.bytes[index(Token::IDENTIFIER)]);
+    EXPECT_EQ(1u, stats.tokens[index(Token::RSHIFT_ASSIGN)]);
+    EXPECT_EQ(3u, stats.bytes[index(Token::RSHIFT_ASSIGN)]);
+    EXPECT_EQ(1u, stats.tokens[index(Token::GREATER)]);
+    EXPECT_EQ(1u, stats.tokens[index(Token::END)]);
+
+    // '>' is only known to be GREATER once the ' ' after it is read.
+    EXPECT_LE(1u, stats.backups);
+    EXPECT_EQ(2u, stats.states[state("GOT_GT")]);
+    EXPECT_LE(7u, stats.states[state("START")]);
+    EXPECT_EQ(1u, stats.states[state("THE_END")]);
+
+    // The spaces, the comment and the newline.
+    EXPECT_LE(13u, stats.whitespace_bytes);
+  }
+}
+
+TEST(LexerStats, stream_reader) {
+  std::istringstream in("int x = 1;\n");
+  Lexer lexer(std::make_unique<SourceReader>(in));
+  lex_all(lexer);
+  EXPECT_EQ(1u, lexer.stats().tokens[index(Token::INT)]);
+  EXPECT_EQ(3u, lexer.stats().bytes[index(Token::INT)]);
+  EXPECT_EQ(1u, lexer.stats().tokens[index(Token::INTEGER_LIT)]);
+}
+
+TEST(LexerStats, reset_and_sum) {
+  Lexer lexer(std::make_unique<SourceReader>(std::string_view("x + y")));
+  lex_all(lexer);
+
+  LexerStats total;
+  total += lexer.stats();
+  total += lexer.stats();
+  EXPECT_EQ(4u, total.tokens[index(Token::IDENTIFIER)]);
+  EXPECT_EQ(2 * lexer.stats().backups, total.backups);
+  EXPECT_EQ(2 * lexer.stats().whitespace_bytes, total.whitespace_bytes);
+
+  lexer.reset_stats();
+  EXPECT_EQ(0u, lexer.stats().tokens[index(Token::IDENTIFIER)]);
+  EXPECT_EQ(0u, lexer.stats().states[0]);
+  EXPECT_EQ(0u, lexer.stats().whitespace_ns);
+}
@@ -0,0 +1,204 @@
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <c_lexer/Lexer.h>
+#include <c_lexer/NewlineIndex.h>
+
+using c_lexer::Lexeme;
+using c_lexer::Lexer;
+using c_lexer::NewlineIndex;
+using c_lexer::scan_tokens;
+using c_lexer::SourcePosition;
+using c_lexer::SourceReader;
+using c_lexer::Token;
+
+#include "tests/tests.h"
+
+#include <cstdint>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+static const std::string_view src =
+    "#include <stdio.h>\r\n"
+    "#define M(x) \\\n  ((x) + 1)\n"
+    "int main(void) {\n"
+    "\t/* a\n   block */ int x = M(2); // c\n"
+    "\v\f  return ma\\\nin + x\t;\n"
+    "\n\n}\n";
+
+TEST(NewlineIndex, positions) {
+  const NewlineIndex index("ab\ncd\r\n\ne\vf\fg");
+  EXPECT_EQ(6u, index.lines());
+
+  const std::uint32_t expected[][2] = {
+      {1, 1}, {1, 2}, {1, 3}, {2, 1}, {2, 2}, {2, 3}, {2, 3},
+      {3, 1}, {4, 1}, {4, 2}, {5, 1}, {5, 2}, {6, 1}, {6, 2}};
+  for (std::size_t i = 0; i < std::size(expected); ++i) {
+    const SourcePosition pos = index.position_of(i);
+    EXPECT_EQ(expected[i][0], pos.row) << i;
+    EXPECT_EQ(expected[i][1], pos.col) << i;
+  }
+
+  // Offsets past the end are at the end.
+  EXPECT_EQ(6u, index.position_of(1000).row);
+  EXPECT_EQ(2u, index.position_of(1000).col);
+
+  const NewlineIndex empty("");
+  EXPECT_EQ(1u, empty.lines());
+  EXPECT_EQ(1u, empty.position_of(0).row);
+  EXPECT_EQ(1u, empty.position_of(0).col);
+}
+
+TEST(NewlineIndex, first_position) {
+  const NewlineIndex index("x y\nz", 10, 7);
+  EXPECT_EQ(10u, index.position_of(2).row);
+  EXPECT_EQ(9u, index.position_of(2).col);
+  EXPECT_EQ(11u, index.position_of(4).row);
+  EXPECT_EQ(1u, index.position_of(4).col);
+}
+
+TEST(NewlineIndex, within_token) {
+  NewlineIndex index("a\vb\\\rc\fd\re\v");
+  index.within_token(1);
+  index.within_token(4);
+  index.within_token(8);
+  EXPECT_EQ(3u, index.lines());
+
+  EXPECT_EQ(1u, index.position_of(2).row);
+  EXPECT_EQ(3u, index.position_of(2).col);
+  EXPECT_EQ(1u, index.position_of(5).row);
+  EXPECT_EQ(6u, index.position_of(5).col);
+  EXPECT_EQ(2u, index.position_of(7).row);
+  EXPECT_EQ(1u, index.position_of(7).col);
+  EXPECT_EQ(2u, index.position_of(9).row);
+  EXPECT_EQ(3u, index.position_of(9).col);
+  EXPECT_EQ(3u, index.position_of(11).row);
+}
+
+TEST(NewlineIndex, long_lines) {
+  // Lines that end at every position of a vector.
+  std::string s;
+  std::vector<std::size_t> starts;
+  for (std::size_t n = 0; n < 100; ++n) {
+    s.append(n, n % 2 ? 'x' : '\t');
+    s += "\n\v\f"[n % 3];
+    starts.push_back(s.size());
+  }
+
+  const NewlineIndex index(s);
+  EXPECT_EQ(starts.size() + 1, index.lines());
+  for (std::size_t i = 0; i < starts.size(); ++i) {
+    EXPECT_EQ(i + 2, index.position_of(starts[i]).row);
+    EXPECT_EQ(1u, index.position_of(starts[i]).col);
+    EXPECT_EQ(i + 1, index.position_of(starts[i] - 1).row);
+    EXPECT_EQ(i + 1, index.position_of(starts[i] - 1).col);
+  }
+}
+
+TEST(NewlineIndex, matches_lexer) {
+  const std::vector<Lexeme> eager = scan_tokens(src);
+  const NewlineIndex index(src);
+
+  for (const Lexeme &l : eager) {
+    const SourcePosition pos = index.position_of(l.offset_);
+    EXPECT_EQ(l.row_, pos.row) << l.text();
+    EXPECT_EQ(l.col_, pos.col) << l.text();
+  }
+}
+
+TEST(LazyPositions, same_tokens) {
+  const std::vector<Lexeme> eager = scan_tokens(src);
+
+  for (std::uint32_t flags :
+       {unsigned(Lexer::LAZY_POSITIONS),
+        unsigned(Lexer::LAZY_POSITIONS | Lexer::ZERO_COPY),
+        unsigned(Lexer::LAZY_POSITIONS | Lexer::KEEP_COMMENTS)}) {
+    Lexer lexer(std::make_unique<SourceReader>(src), flags);
+    EXPECT_TRUE(lexer.flags() & Lexer::LAZY_POSITIONS);
+
+    std::size_t i = 0;
+    for (;; lexer.eat()) {
+      const Lexeme &l = lexer.peek();
+      if (l.token() == Token::COMMENT)
+        continue;
+      ASSERT_LT(i, eager.size());
+      EXPECT_EQ(eager[i].token(), l.token()) << i;
+      EXPECT_EQ(eager[i].text(), l.text()) << i;
+      EXPECT_EQ(eager[i].offset_, l.offset_) << i;
+      EXPECT_EQ(0u, l.row_);
+      EXPECT_EQ(0u, l.col_);
+
+      const SourcePosition pos = lexer.position_of(l.offset_);
+      EXPECT_EQ(eager[i].row_, pos.row) << i;
+      EXPECT_EQ(eager[i].col_, pos.col) << i;
+      ++i;
+      if (l.token() == Token::END)
+        break;
+    }
+    EXPECT_EQ(eager.size(), i);
+  }
+}
+
+TEST(LazyPositions, breaks_within_literals) {
+  // Within a literal a raw '\v', '\f' or '\r' is one column, as the Lexer
+  // counts it, and only between tokens a line break or no column.
+  const std::string_view literals = "a \"b\vc\rd\fe\" f\n"
+                                    "'\v' g\r h\n"
+                                    "#include <x\fy.h>\n"
+                                    "u8\"\\\n\r\v\" i\v\"\f\" j\r\n";
+  const std::vector<Lexeme> eager = scan_tokens(literals);
+
+  Lexer lexer(std::make_unique<SourceReader>(literals),
+              Lexer::LAZY_POSITIONS);
+  for (const Lexeme &e : eager) {
+    const Lexeme l = lexer.eat();
+    ASSERT_EQ(e.offset_, l.offset_);
+    const SourcePosition pos = lexer.position_of(l.offset_);
+    EXPECT_EQ(e.row_, pos.row) << e.text();
+    EXPECT_EQ(e.col_, pos.col) << e.text();
+  }
+}
+
+TEST(LazyPositions, errors) {
+  testing::internal::CaptureStderr();
+  Lexer lexer(std::make_unique<SourceReader>(std::string_view("\n\n  a $ b")),
+              Lexer::LAZY_POSITIONS);
+  while (lexer.peek() != Token::END)
+    lexer.eat();
+  const std::string err = testing::internal::GetCapturedStderr();
+  EXPECT_EQ(0u, err.find("c_lexer[3,6]: Skipped invalid character")) << err;
+}
+
+TEST(LazyPositions, stream_reader) {
+  // A reader that refills keeps no text to find positions in.
+  std::istringstream in("a\n  b");
+  Lexer lexer(std::make_unique<SourceReader>(in), Lexer::LAZY_POSITIONS);
+  EXPECT_FALSE(lexer.flags() & Lexer::LAZY_POSITIONS);
+
+  lexer.eat();
+  EXPECT_EQ(2u, lexer.peek().row_);
+  EXPECT_EQ(3u, lexer.peek().col_);
+  EXPECT_EQ(0u, lexer.position_of(3).row);
+}
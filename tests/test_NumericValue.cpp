@@ -0,0 +1,208 @@
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <c_lexer/Lexer.h>
+#include <c_lexer/NumericValue.h>
+
+using c_lexer::decode_number;
+using c_lexer::Lexeme;
+using c_lexer::Lexer;
+using c_lexer::NumericValue;
+using c_lexer::scan_tokens;
+using c_lexer::Token;
+
+#include "tests/tests.h"
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+NumericValue decoded(std::string_view spelling) {
+  NumericValue value;
+  decode_number(spelling, value);
+  return value;
+}
+
+void expect_integer(std::string_view spelling, std::uint64_t integer,
+                    unsigned radix, unsigned suffix = 0) {
+  SCOPED_TRACE(spelling);
+  const NumericValue value = decoded(spelling);
+  EXPECT_EQ(NumericValue::INTEGER, value.kind);
+  EXPECT_TRUE(value.ok);
+  EXPECT_EQ(integer, value.integer);
+  EXPECT_EQ(radix, value.radix);
+  EXPECT_EQ(suffix, value.suffix);
+}
+
+void expect_floating(std::string_view spelling, double floating,
+                     unsigned radix, unsigned suffix = 0) {
+  SCOPED_TRACE(spelling);
+  const NumericValue value = decoded(spelling);
+  EXPECT_EQ(NumericValue::FLOATING, value.kind);
+  EXPECT_TRUE(value.ok);
+  EXPECT_EQ(floating, value.floating);
+  EXPECT_EQ(radix, value.radix);
+  EXPECT_EQ(suffix, value.suffix);
+}
+
+TEST(NumericValue, integers) {
+  using V = NumericValue;
+  expect_integer("0", 0, 10);
+  expect_integer("42", 42, 10);
+  expect_integer("1'000'000", 1000000, 10);
+  expect_integer("0755", 0755, 8);
+  expect_integer("0x1Fab", 0x1fab, 16);
+  expect_integer("0b1011", 11, 2);
+  expect_integer("18446744073709551615ull", 18446744073709551615ull, 10,
+                 V::SUFFIX_U | V::SUFFIX_LL);
+  expect_integer("7Lu", 7, 10, V::SUFFIX_U | V::SUFFIX_L);
+  expect_integer("0xffwbU", 255, 16, V::SUFFIX_WB | V::SUFFIX_U);
+
+  EXPECT_FALSE(decoded("18446744073709551616").ok);
+  EXPECT_FALSE(decoded("09").ok);
+  EXPECT_EQ(NumericValue::NONE, decoded("'a'").kind);
+  EXPECT_EQ(NumericValue::NONE, decoded("u8'a'").kind);
+}
+
+TEST(NumericValue, floating) {
+  using V = NumericValue;
+  expect_floating("2.5", 2.5, 10);
+  expect_floating(".5e1", 5.0, 10);
+  expect_floating("1.", 1.0, 10);
+  expect_floating("012.5", 12.5, 10);
+  expect_floating("1e3f", 1000.0, 10, V::SUFFIX_F);
+  expect_floating("1'0.2'5L", 10.25, 10, V::SUFFIX_L);
+  expect_floating("0x1.8p1", 3.0, 16);
+  expect_floating("0x.8p-1f", 0.25, 16, V::SUFFIX_F);
+  expect_floating("1.5df", 1.5, 10, V::SUFFIX_D | V::SUFFIX_F);
+  expect_floating("1.5DD", 1.5, 10, V::SUFFIX_D);
+
+  const NumericValue huge = decoded("1e999");
+  EXPECT_FALSE(huge.ok);
+  EXPECT_EQ(std::numeric_limits<double>::infinity(), huge.floating);
+}
+
+TEST(NumericValue, lexer_decodes) {
+  const std::vector<Lexeme> v =
+      scan_tokens("x = 0x10 + 2.5e1f * '\\n' - 1\\\n2;", Lexer::DECODE_NUMBERS);
+  ASSERT_EQ(11u, v.size());
+
+  EXPECT_EQ(NumericValue::NONE, v[0].number().kind);
+  EXPECT_EQ(16u, v[2].number().integer);
+  EXPECT_EQ(25.0, v[4].number().floating);
+  EXPECT_EQ(NumericValue::SUFFIX_F, v[4].number().suffix);
+  EXPECT_EQ(Token::INTEGER_LIT, v[6].token());
+  EXPECT_EQ(NumericValue::NONE, v[6].number().kind);
+  EXPECT_EQ(12u, v[8].number().integer);
+  EXPECT_EQ(10u, v[8].number().radix);
+
+  const std::vector<Lexeme> w =
+      scan_tokens("0 0x1fULL 0b101wbu 079", Lexer::DECODE_NUMBERS);
+  ASSERT_EQ(5u, w.size());
+  EXPECT_EQ(10u, w[0].number().radix);
+  EXPECT_EQ(31u, w[1].number().integer);
+  EXPECT_EQ(NumericValue::SUFFIX_U | NumericValue::SUFFIX_LL,
+            w[1].number().suffix);
+  EXPECT_EQ(5u, w[2].number().integer);
+  EXPECT_EQ(2u, w[2].number().radix);
+  EXPECT_EQ(NumericValue::SUFFIX_U | NumericValue::SUFFIX_WB,
+            w[2].number().suffix);
+  EXPECT_FALSE(w[3].number().ok);
+
+  // Not decoded unless asked for.
+  EXPECT_EQ(NumericValue::NONE, scan_tokens("1")[0].number().kind);
+}
+
+std::vector<Lexeme> lex_numbers(std::unique_ptr<c_lexer::SourceReader> &&sr) {
+  Lexer lexer(std::move(sr), Lexer::DECODE_NUMBERS);
+  std::vector<Lexeme> v;
+  while (lexer.peek() != Token::END)
+    v.push_back(lexer.eat());
+  return v;
+}
+
+// Each INTEGER_LIT the scanner decoded has the value decode_number() finds in
+// its spelling.
+void expect_decoded_as_spelled(const std::vector<Lexeme> &v) {
+  for (const Lexeme &l : v) {
+    if (l.token() != Token::INTEGER_LIT || l.text().back() == '\'')
+      continue;
+    SCOPED_TRACE(l.text());
+    const NumericValue want = decoded(l.text());
+    ASSERT_EQ(want.kind, l.number().kind);
+    EXPECT_EQ(want.ok, l.number().ok);
+    EXPECT_EQ(want.integer, l.number().integer);
+    EXPECT_EQ(want.radix, l.number().radix);
+    EXPECT_EQ(want.suffix, l.number().suffix);
+  }
+}
+
+TEST(NumericValue, scanner_decodes_as_spelled) {
+  const char *const spellings[] = {
+      "0",         "7",          "079",       "0'7",       "0u",
+      "0x0",       "0Xff'FF",    "0b1",       "0B1'0'1",   "123456789",
+      "1'000'000", "42u",        "42U",       "42l",       "42L",
+      "42ll",      "42LL",       "42ul",      "42uLL",     "42Ull",
+      "42lu",      "42LLU",      "42llu",     "42wb",      "42WB",
+      "42uwb",     "42wbu",      "42WBU",     "0x1Full",   "017l",
+      "18446744073709551615",    "18446744073709551616",
+      "0xffffffffffffffff",      "0x10000000000000000",
+      "01777777777777777777777", "02000000000000000000000",
+      "0b1111111111111111111111111111111111111111111111111111111111111111"};
+
+  std::string src;
+  for (int i = 0; i < 2000; ++i)
+    for (const char *s : spellings) {
+      src += s;
+      src += i % 3 ? " " : "+\n";
+    }
+  // Spliced, between every pair of characters.
+  for (const char *s : spellings) {
+    for (const char *p = s; *p; ++p) {
+      src += *p;
+      if (p[1])
+        src += "\\\n";
+    }
+    src += ';';
+  }
+  ASSERT_GT(src.size(), 128u * 1024); // refilled by a stream reader
+
+  std::vector<Lexeme> b =
+      lex_numbers(std::make_unique<c_lexer::SourceReader>(src));
+  ASSERT_NO_FATAL_FAILURE(expect_decoded_as_spelled(b));
+
+  std::istringstream iss(src);
+  std::vector<Lexeme> s =
+      lex_numbers(std::make_unique<c_lexer::SourceReader>(iss));
+  ASSERT_NO_FATAL_FAILURE(expect_decoded_as_spelled(s));
+  ASSERT_EQ(b.size(), s.size());
+
+  // Every spelling was scanned as one INTEGER_LIT.
+  std::size_t integers = 0;
+  for (const Lexeme &l : b)
+    integers += l.token() == Token::INTEGER_LIT;
+  EXPECT_EQ(2001 * (sizeof(spellings) / sizeof(*spellings)), integers);
+}
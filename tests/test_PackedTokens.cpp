@@ -0,0 +1,106 @@
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <c_lexer/Lexer.h>
+#include <c_lexer/PackedTokens.h>
+
+using c_lexer::Lexeme;
+using c_lexer::PackedToken;
+using c_lexer::PackedTokens;
+using c_lexer::scan_tokens;
+using c_lexer::Token;
+
+#include "tests/tests.h"
+
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+static void expect_matches_lexemes(std::string_view src) {
+  const std::vector<Lexeme> expected = scan_tokens(src);
+  PackedTokens tokens;
+  ASSERT_EQ(expected.size(), scan_tokens(src, tokens));
+  ASSERT_EQ(expected.size(), tokens.size());
+
+  std::size_t i = 0;
+  for (const Lexeme &l : tokens) {
+    const Lexeme &e = expected[i];
+    EXPECT_EQ(e.token(), l.token()) << i;
+    EXPECT_EQ(e.text(), l.text()) << i;
+    EXPECT_EQ(e.row_, l.row_) << i;
+    EXPECT_EQ(e.col_, l.col_) << i;
+    EXPECT_EQ(e.offset_, l.offset_) << i;
+
+    const Lexeme at = tokens.lexeme(i);
+    EXPECT_EQ(e.text(), at.text()) << i;
+    EXPECT_EQ(e.row_, tokens.row(i)) << i;
+    EXPECT_EQ(e.col_, tokens.col(i)) << i;
+    ++i;
+  }
+  EXPECT_EQ(expected.size(), i);
+  EXPECT_EQ(Token::END, tokens.token(tokens.size() - 1));
+}
+
+TEST(PackedTokens, trivially_copyable) {
+  PackedTokens tokens;
+  scan_tokens("int x;", tokens);
+
+  PackedToken copy[4];
+  std::memcpy(copy, tokens.data(), sizeof(copy));
+  EXPECT_EQ(Token::INT, copy[0].token());
+  EXPECT_EQ(4u, copy[1].offset);
+  EXPECT_EQ(1u, copy[1].length);
+  EXPECT_EQ(5u, copy[1].col);
+  EXPECT_EQ(Token::END, copy[3].token());
+}
+
+TEST(PackedTokens, matches_lexemes) {
+  expect_matches_lexemes("");
+  expect_matches_lexemes("#include <stdio.h>\n"
+                         "int main(int argc, char *argv[]) {\n"
+                         "  /* a\n   b */ printf(\"%d\\n\", ar\\\n"
+                         "gc); // c\n"
+                         "\n\n\f\v  return argc + 0x10 - 'a';\n"
+                         "}\n");
+
+  // Enough tokens for several recorded rows.
+  std::string src;
+  for (int i = 0; i < 500; ++i)
+    src += "x" + std::to_string(i) + (i % 3 ? " = 1;" : ";\n\n");
+  expect_matches_lexemes(src);
+}
+
+TEST(PackedTokens, long_line_delta) {
+  const std::string src = "a\n" + std::string(70000, '\n') + "b c" +
+                          std::string(200000, '\n') + "d";
+  PackedTokens tokens;
+  ASSERT_EQ(5u, scan_tokens(src, tokens));
+
+  EXPECT_EQ(1u, tokens.row(0));
+  EXPECT_EQ(PackedToken::long_delta, tokens[1].line_delta);
+  EXPECT_EQ(70001u, tokens.line_delta(1));
+  EXPECT_EQ(70002u, tokens.row(1));
+  EXPECT_EQ(70002u, tokens.row(2));
+  EXPECT_EQ(270002u, tokens.row(3));
+  expect_matches_lexemes(src);
+}
@@ -0,0 +1,114 @@
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <c_lexer/Lexer.h>
+#include <c_lexer/PerfCounters.h>
+
+using c_lexer::Lexer;
+using c_lexer::PerfCounters;
+using c_lexer::Percentiles;
+using c_lexer::SourceReader;
+using c_lexer::Token;
+
+#include "tests/tests.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+TEST(Percentiles, nearest_rank) {
+  std::vector<std::uint64_t> none;
+  const Percentiles zero = c_lexer::percentiles(none);
+  EXPECT_EQ(0u, zero.p50);
+  EXPECT_EQ(0u, zero.p999);
+
+  // 1000 down to 1, so that each percentile has a rank of its own.
+  std::vector<std::uint64_t> v;
+  for (std::uint64_t i = 1000; i; --i)
+    v.push_back(i);
+  Percentiles p = c_lexer::percentiles(v);
+  EXPECT_EQ(500u, p.p50);
+  EXPECT_EQ(990u, p.p99);
+  EXPECT_EQ(999u, p.p999);
+
+  v = {7};
+  p = c_lexer::percentiles(v);
+  EXPECT_EQ(7u, p.p50);
+  EXPECT_EQ(7u, p.p99);
+  EXPECT_EQ(7u, p.p999);
+
+  // One slow call in a hundred shows at p99 and above only.
+  v.assign(100, 10);
+  v[42] = 5000;
+  p = c_lexer::percentiles(v);
+  EXPECT_EQ(10u, p.p50);
+  EXPECT_EQ(10u, p.p99);
+  EXPECT_EQ(5000u, p.p999);
+}
+
+TEST(PerfCounters, counts_lexing) {
+  PerfCounters counters;
+  for (std::uint8_t e = 0; e < PerfCounters::num_events; ++e)
+    EXPECT_STRNE("?", PerfCounters::event_name(PerfCounters::Event(e)));
+  if (!counters.has(PerfCounters::INSTRUCTIONS))
+    GTEST_SKIP() << "perf_event_open() is not allowed here";
+
+  std::string src;
+  for (int i = 0; i < 2000; ++i)
+    src += "int f(int x) { return x * 2 + 1; } /* ok */\n";
+
+  counters.start();
+  Lexer lexer(std::make_unique<SourceReader>(src), Lexer::ZERO_COPY);
+  std::size_t tokens = 0;
+  while (lexer.eat() != Token::END)
+    ++tokens;
+  counters.stop();
+
+  // Lexing takes at least an instruction a byte, and a branch a token.
+  EXPECT_GT(counters.count(PerfCounters::INSTRUCTIONS), src.size());
+  if (counters.has(PerfCounters::BRANCHES)) {
+    EXPECT_GT(counters.count(PerfCounters::BRANCHES), tokens);
+  }
+  if (counters.has(PerfCounters::BRANCH_MISSES)) {
+    EXPECT_LT(counters.count(PerfCounters::BRANCH_MISSES),
+              counters.count(PerfCounters::BRANCHES));
+  }
+
+  // Counting restarts from zero.
+  counters.start();
+  counters.stop();
+  EXPECT_LT(counters.count(PerfCounters::INSTRUCTIONS), src.size());
+}
+
+TEST(PerfCounters, grouped_under_cycles) {
+  PerfCounters counters;
+  for (std::uint8_t e = 0; e < PerfCounters::num_events; ++e) {
+    const PerfCounters::Event event = PerfCounters::Event(e);
+    SCOPED_TRACE(PerfCounters::event_name(event));
+    // Only a counted event is in the group, and only when CYCLES leads it.
+    if (counters.grouped(event)) {
+      EXPECT_TRUE(counters.has(event));
+      EXPECT_TRUE(counters.grouped(PerfCounters::CYCLES));
+    }
+  }
+}
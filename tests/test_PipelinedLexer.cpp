@@ -0,0 +1,122 @@
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <c_lexer/Lexer.h>
+#include <c_lexer/PipelinedLexer.h>
+
+using c_lexer::Lexeme;
+using c_lexer::Lexer;
+using c_lexer::PipelinedLexer;
+using c_lexer::scan_tokens;
+using c_lexer::SourceReader;
+using c_lexer::Token;
+
+#include "tests/tests.h"
+
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+std::string pipeline_src() {
+  std::string src;
+  for (int i = 0; i < 500; ++i)
+    src += "int f" + std::to_string(i) + "(int x) { return x * " +
+           std::to_string(i) + " + 0x1fu; } // " + std::to_string(i) + '\n';
+  return src;
+}
+
+void expect_same_lexemes(const std::vector<Lexeme> &expected,
+                         const std::vector<Lexeme> &actual) {
+  ASSERT_EQ(expected.size(), actual.size());
+
+  for (std::size_t i = 0; i < expected.size(); ++i) {
+    EXPECT_EQ(expected[i].token(), actual[i].token());
+    EXPECT_EQ(expected[i].text(), actual[i].text());
+    EXPECT_EQ(expected[i].row_, actual[i].row_);
+    EXPECT_EQ(expected[i].col_, actual[i].col_);
+    EXPECT_EQ(expected[i].offset_, actual[i].offset_);
+  }
+}
+
+TEST(PipelinedLexer, matches_lexer) {
+  const std::string src = pipeline_src();
+  const std::vector<Lexeme> expected = scan_tokens(std::string_view(src));
+
+  for (std::size_t batch : {std::size_t(1), std::size_t(13), std::size_t(256)}) {
+    for (std::size_t n_batches : {std::size_t(2), std::size_t(8)}) {
+      SCOPED_TRACE(std::to_string(batch) + " x " + std::to_string(n_batches));
+      PipelinedLexer lexer(std::make_unique<SourceReader>(std::string_view(src)),
+                           Lexer::ZERO_COPY, batch, n_batches);
+      EXPECT_LE(PipelinedLexer::lookahead_capacity, lexer.batch_size());
+      EXPECT_LE(static_cast<std::size_t>(2), lexer.n_batches());
+
+      std::vector<Lexeme> v;
+      while (lexer.peek() != Token::END)
+        v.push_back(lexer.eat());
+      v.push_back(lexer.eat());
+      expect_same_lexemes(expected, v);
+
+      EXPECT_EQ(Token::END, lexer.eat());
+      EXPECT_EQ(Token::END, lexer.peek(3));
+    }
+  }
+}
+
+TEST(PipelinedLexer, peek_across_batches) {
+  const std::string src = pipeline_src();
+  const std::vector<Lexeme> expected = scan_tokens(std::string_view(src));
+
+  PipelinedLexer lexer(std::make_unique<SourceReader>(std::string_view(src)),
+                       0, PipelinedLexer::lookahead_capacity, 2);
+  for (std::size_t i = 0; i + 1 < expected.size(); ++i) {
+    const std::size_t k = i % PipelinedLexer::lookahead_capacity;
+    const std::size_t ahead = std::min(i + k, expected.size() - 1);
+    EXPECT_EQ(expected[ahead].text(), lexer.peek(k).text());
+    EXPECT_EQ(expected[i].text(), lexer.eat().text());
+  }
+  EXPECT_EQ(Token::END, lexer.eat());
+}
+
+TEST(PipelinedLexer, stream_reader) {
+  const std::string src = pipeline_src() + std::string(70000, ' ') + "x";
+  std::istringstream iss(src);
+
+  PipelinedLexer lexer(std::make_unique<SourceReader>(iss));
+  std::size_t n = 0;
+  Lexeme last;
+  while (lexer.peek() != Token::END) {
+    last = lexer.eat();
+    ++n;
+  }
+  EXPECT_EQ(scan_tokens(std::string_view(src)).size() - 1, n);
+  EXPECT_EQ("x", last.text());
+}
+
+TEST(PipelinedLexer, destroyed_early) {
+  // The producer is left waiting for room in a full ring.
+  const std::string src = pipeline_src();
+  PipelinedLexer lexer(std::make_unique<SourceReader>(std::string_view(src)),
+                       0, 8, 2);
+  EXPECT_EQ(Token::INT, lexer.eat());
+}
@@ -0,0 +1,151 @@
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <c_lexer/Lexer.h>
+#include <c_lexer/Token.h>
+
+#include "Simd.h"
+
+using c_lexer::Lexeme;
+using c_lexer::scan_tokens;
+using c_lexer::Token;
+namespace simd = c_lexer::simd;
+
+#include "tests/tests.h"
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+std::vector<const simd::Kernels *> available_kernels() {
+  std::vector<const simd::Kernels *> v;
+  for (simd::Isa isa : {simd::Isa::SCALAR, simd::Isa::SSE2, simd::Isa::AVX2,
+                        simd::Isa::NEON})
+    if (const simd::Kernels *k = simd::kernels_for(isa))
+      v.push_back(k);
+  return v;
+}
+
+std::size_t reference_run(const std::string &s, std::size_t pos,
+                          std::uint8_t cls) {
+  std::size_t n = 0;
+  while (pos + n < s.size() && simd::is_class(s[pos + n], cls))
+    ++n;
+  return n;
+}
+
+TEST(Simd, char_class) {
+  for (int c = 0; c < 256; ++c) {
+    const char ch = static_cast<char>(c);
+    const bool ascii = c < 128;
+    EXPECT_EQ(ascii && (std::isalnum(c) || c == '_'),
+              simd::is_class(ch, simd::IDENT));
+    EXPECT_EQ(ascii && (std::isalpha(c) || c == '_'),
+              simd::is_class(ch, simd::ALPHA));
+    EXPECT_EQ(ascii && std::isdigit(c) != 0, simd::is_class(ch, simd::DIGIT));
+    EXPECT_EQ(c == ' ' || c == '\t', simd::is_class(ch, simd::BLANK));
+    EXPECT_EQ(c != '*' && c != '\n' && c != '\v' && c != '\f' && c != '\r',
+              simd::is_class(ch, simd::PLAIN));
+    EXPECT_EQ(ascii && std::isspace(c) != 0, simd::is_class(ch, simd::SPACE));
+    EXPECT_EQ(c != '\n' && c != '\v' && c != '\f',
+              simd::is_class(ch, simd::LINE));
+    EXPECT_EQ(!ascii || (!std::isgraph(c) && !std::isspace(c)) || c == '$' ||
+                  c == '@' || c == '\\' || c == '`',
+              simd::is_class(ch, simd::STRAY));
+  }
+}
+
+TEST(Simd, kernels_match_scalar) {
+  // Runs drawn from a small alphabet, so that every kernel sees runs that end
+  // at every position of a vector, and bytes with the high bit set.
+  const char alphabet[] = {'a', 'Z',    '_',    '0',    '9',  ' ',
+                           '\t', '\n',   '@',    '`',    '{',  '/',
+                           ':', '\x80', '\xff', '\xc1', '*',  '\r',
+                           '\v', '\f',   '\x09', '\x0e', '\x2b',
+                           '$', '\\',   '\x7f', '\x01', '\0'};
+  std::mt19937 gen(12345);
+  std::uniform_int_distribution<int> pick(0, sizeof(alphabet) - 1);
+  std::uniform_int_distribution<int> runlen(0, 70);
+
+  std::string s;
+  while (s.size() < 20000) {
+    const char ch = alphabet[pick(gen)];
+    s.append(static_cast<std::size_t>(runlen(gen)), ch);
+    if (ch == 'a')
+      s += "bc_12";
+  }
+
+  for (const simd::Kernels *k : available_kernels()) {
+    SCOPED_TRACE(k->name);
+    for (std::size_t pos = 0; pos < s.size(); ++pos) {
+      const char *p = s.data() + pos;
+      const char *end = s.data() + s.size();
+      ASSERT_EQ(reference_run(s, pos, simd::BLANK), k->blank_run(p, end));
+      ASSERT_EQ(reference_run(s, pos, simd::IDENT), k->ident_run(p, end));
+      ASSERT_EQ(reference_run(s, pos, simd::DIGIT), k->digit_run(p, end));
+      ASSERT_EQ(reference_run(s, pos, simd::PLAIN), k->plain_run(p, end));
+      ASSERT_EQ(reference_run(s, pos, simd::SPACE), k->space_run(p, end));
+      ASSERT_EQ(reference_run(s, pos, simd::LINE), k->line_run(p, end));
+      ASSERT_EQ(reference_run(s, pos, simd::STRAY), k->stray_run(p, end));
+    }
+  }
+}
+
+TEST(Simd, kernels_stop_at_end) {
+  const std::string s(100, 'x');
+  for (const simd::Kernels *k : available_kernels()) {
+    SCOPED_TRACE(k->name);
+    for (std::size_t n = 0; n <= s.size(); ++n)
+      EXPECT_EQ(n, k->ident_run(s.data(), s.data() + n));
+  }
+}
+
+TEST(Simd, long_runs_in_lexer) {
+  const std::string ident(100, 'q');
+  const std::string digits(75, '7');
+  const std::string src = "\t  " + std::string(40, ' ') + ident + "\n" +
+                          std::string(33, '\t') + digits + "ul " + ident +
+                          "+ 123'456'789";
+
+  std::vector<Lexeme> v = scan_tokens(src);
+  ASSERT_EQ(static_cast<std::size_t>(6), v.size());
+
+  EXPECT_EQ(Token::IDENTIFIER, v[0]);
+  EXPECT_EQ(ident, v[0].text());
+  EXPECT_EQ(static_cast<std::uint32_t>(1), v[0].row_);
+  EXPECT_EQ(static_cast<std::uint32_t>(44), v[0].col_);
+
+  EXPECT_EQ(Token::INTEGER_LIT, v[1]);
+  EXPECT_EQ(digits + "ul", v[1].text());
+  EXPECT_EQ(static_cast<std::uint32_t>(2), v[1].row_);
+  EXPECT_EQ(static_cast<std::uint32_t>(34), v[1].col_);
+
+  EXPECT_EQ(Token::IDENTIFIER, v[2]);
+  EXPECT_EQ(ident, v[2].text());
+  EXPECT_EQ(static_cast<std::uint32_t>(34 + 78), v[2].col_);
+
+  EXPECT_EQ(Token::PLUS, v[3]);
+  EXPECT_EQ(Token::INTEGER_LIT, v[4]);
+  EXPECT_EQ("123'456'789", v[4].text());
+  EXPECT_EQ(Token::END, v[5]);
+}
@@ -0,0 +1,170 @@
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <c_lexer/Lexer.h>
+#include <c_lexer/StreamLexer.h>
+
+using c_lexer::Lexeme;
+using c_lexer::Lexer;
+using c_lexer::scan_tokens;
+using c_lexer::StreamLexer;
+using c_lexer::Token;
+
+#include "tests/tests.h"
+
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+const std::string_view src =
+    "#include <stdio.h>\n"
+    " # define M(x) \\\n  #x ## 1 /\\\r\n* y *\\\n/\n"
+    "int main(int argc, char *argv[]) {\n"
+    "\tconst char *s = \"a\\tb\"; /* x */\r\n"
+    "  return argc > 1 ? 0x1f : 'q' << 2.5e3 ... L\"wide\";\v\n"
+    "  x = \"unterminated\n"
+    "  @ y >>= z; /* a 'b'\n"
+    " * \"c\" */ d // e /* f\n"
+    "/**/ }/* open";
+
+struct Scan {
+  std::vector<Lexeme> tokens;
+  std::string errors;
+};
+
+// Scan src in pieces of the given sizes, the last piece taking the rest.
+Scan scan_pieces(const std::vector<std::size_t> &sizes,
+                 std::uint32_t flags = 0) {
+  Scan scan;
+  std::ostringstream errors;
+  std::streambuf *cerr_save = std::cerr.rdbuf(errors.rdbuf());
+
+  StreamLexer lexer(
+      [&scan](const Lexeme &l) {
+        scan.tokens.push_back(
+            Lexeme(l.str(), l.token(), l.row_, l.col_, l.offset_));
+      },
+      flags);
+
+  std::size_t pos = 0;
+  for (std::size_t n : sizes) {
+    n = std::min(n, src.size() - pos);
+    lexer.feed(src.data() + pos, n);
+    pos += n;
+  }
+  lexer.feed(src.data() + pos, src.size() - pos);
+  lexer.finish();
+
+  std::cerr.rdbuf(cerr_save);
+  scan.errors = errors.str();
+  return scan;
+}
+
+void expect_same_scan(const Scan &expected, const Scan &actual) {
+  ASSERT_EQ(expected.tokens.size(), actual.tokens.size());
+  for (std::size_t i = 0; i < expected.tokens.size(); ++i) {
+    const Lexeme &e = expected.tokens[i];
+    const Lexeme &a = actual.tokens[i];
+    EXPECT_EQ(e.token(), a.token()) << i;
+    EXPECT_EQ(e.text(), a.text()) << i;
+    EXPECT_EQ(e.row_, a.row_) << i;
+    EXPECT_EQ(e.col_, a.col_) << i;
+    EXPECT_EQ(e.offset_, a.offset_) << i;
+  }
+  // Tokens cut off by the end of a piece are not reported as errors.
+  EXPECT_EQ(expected.errors, actual.errors);
+}
+
+Scan scan_whole(std::uint32_t flags) {
+  Scan scan;
+  std::ostringstream errors;
+  std::streambuf *cerr_save = std::cerr.rdbuf(errors.rdbuf());
+  scan.tokens = scan_tokens(src, flags);
+  std::cerr.rdbuf(cerr_save);
+  scan.errors = errors.str();
+  return scan;
+}
+
+TEST(StreamLexer, whole_source) {
+  for (std::uint32_t flags : {0u, unsigned(Lexer::KEEP_COMMENTS)}) {
+    const Scan expected = scan_whole(flags);
+    ASSERT_EQ(Token::END, expected.tokens.back().token());
+    expect_same_scan(expected, scan_pieces({}, flags));
+  }
+}
+
+TEST(StreamLexer, any_split) {
+  for (std::uint32_t flags : {0u, unsigned(Lexer::KEEP_COMMENTS)}) {
+    SCOPED_TRACE(flags);
+    const Scan expected = scan_whole(flags);
+
+    for (std::size_t cut = 0; cut <= src.size(); ++cut) {
+      SCOPED_TRACE(cut);
+      expect_same_scan(expected, scan_pieces({cut}, flags));
+    }
+
+    for (std::size_t n : {1, 2, 3, 7}) {
+      SCOPED_TRACE(n);
+      expect_same_scan(expected, scan_pieces(std::vector<std::size_t>(
+                                                 src.size(), n),
+                                             flags));
+    }
+
+    std::mt19937 gen(3);
+    std::uniform_int_distribution<std::size_t> size(0, 12);
+    for (int trial = 0; trial < 100; ++trial) {
+      std::vector<std::size_t> sizes(20);
+      for (std::size_t &n : sizes)
+        n = size(gen);
+      expect_same_scan(expected,
+                       scan_pieces(sizes, flags | Lexer::ZERO_COPY));
+    }
+  }
+}
+
+TEST(StreamLexer, long_comment) {
+  // A comment fed a line at a time is only searched for its end, so this
+  // stays linear in the size of the comment.
+  std::vector<Lexeme> tokens;
+  StreamLexer lexer(
+      [&tokens](const Lexeme &l) {
+        tokens.push_back(Lexeme(l.str(), l.token(), l.row_, l.col_, l.offset_));
+      },
+      Lexer::KEEP_COMMENTS);
+
+  const std::string line = " * some documentation text *\n";
+  lexer.feed("x /*\n", 5);
+  for (int i = 0; i < 50000; ++i)
+    lexer.feed(line.data(), line.size());
+  lexer.feed(" */ y", 5);
+  lexer.finish();
+
+  ASSERT_EQ(static_cast<std::size_t>(4), tokens.size());
+  EXPECT_EQ(Token::COMMENT, tokens[1].token());
+  EXPECT_EQ(3 + 50000 * line.size() + 3, tokens[1].text().size());
+  EXPECT_EQ(static_cast<std::uint32_t>(50002), tokens[2].row_);
+  EXPECT_EQ(static_cast<std::uint32_t>(5), tokens[2].col_);
+  EXPECT_EQ(Token::END, tokens[3].token());
+}
@@ -0,0 +1,140 @@
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <c_lexer/Arena.h>
+#include <c_lexer/Lexer.h>
+#include <c_lexer/StringValue.h>
+
+using c_lexer::Arena;
+using c_lexer::decode_string;
+using c_lexer::Lexeme;
+using c_lexer::Lexer;
+using c_lexer::scan_tokens;
+using c_lexer::StringValue;
+using c_lexer::Token;
+
+#include "tests/tests.h"
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+StringValue decoded(std::string_view spelling, Arena &arena) {
+  StringValue value;
+  EXPECT_TRUE(decode_string(spelling, arena, value)) << spelling;
+  return value;
+}
+
+TEST(StringValue, plain_and_utf8) {
+  Arena arena;
+  EXPECT_EQ("abc", decoded("\"abc\"", arena).view<char>());
+  EXPECT_EQ("", decoded("\"\"", arena).view<char>());
+  EXPECT_EQ(std::string("a\n\t\\\"'?\a\0b", 10),
+            decoded("\"a\\n\\t\\\\\\\"\\'\\?\\a\\0b\"", arena).view<char>());
+  EXPECT_EQ("\x41\x7f\xff", decoded("\"\\101\\x7f\\377\"", arena).view<char>());
+  EXPECT_EQ("\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80",
+            decoded("\"\\u00e9\\u20AC\\U0001F600\"", arena).view<char>());
+
+  const StringValue u8 = decoded("u8\"\xc3\xa9 x\"", arena);
+  EXPECT_EQ(StringValue::UTF8, u8.encoding);
+  EXPECT_EQ("\xc3\xa9 x", u8.view<char>());
+
+  const StringValue c = decoded("'\\n'", arena);
+  EXPECT_EQ(StringValue::PLAIN, c.encoding);
+  EXPECT_EQ("\n", c.view<char>());
+}
+
+TEST(StringValue, wide) {
+  Arena arena;
+  const StringValue u = decoded("u\"a\xc3\xa9\xf0\x9f\x98\x80\\U0001F600\"",
+                                arena);
+  EXPECT_EQ(StringValue::UTF16, u.encoding);
+  EXPECT_EQ(u"a\u00e9\U0001F600\U0001F600", u.view<char16_t>());
+
+  const StringValue U = decoded("U\"a\xe2\x82\xac\\x110000\\u0041\"", arena);
+  EXPECT_EQ(StringValue::UTF32, U.encoding);
+  EXPECT_EQ(U"a\u20ac\x110000\x41", U.view<char32_t>());
+
+  const StringValue L = decoded("L'\xc3\xa9'", arena);
+  EXPECT_EQ(StringValue::WIDE, L.encoding);
+  EXPECT_EQ(L"\u00e9", L.view<wchar_t>());
+}
+
+TEST(StringValue, not_ok) {
+  Arena arena;
+  StringValue value;
+  EXPECT_FALSE(decode_string("\"\\x100\"", arena, value));
+  EXPECT_FALSE(decode_string("u\"\\x10000\"", arena, value));
+  EXPECT_FALSE(decode_string("\"\\uD800\"", arena, value));
+  EXPECT_FALSE(decode_string("U\"\xff\"", arena, value));
+  EXPECT_EQ(U"\xff", value.view<char32_t>());
+  EXPECT_FALSE(decode_string("U\"\xc0\x80\"", arena, value)); // overlong
+
+  EXPECT_TRUE(decode_string("12", arena, value));
+  EXPECT_EQ(StringValue::NONE, value.encoding);
+}
+
+TEST(StringValue, lexer_decodes) {
+  Arena arena;
+  Lexer lexer(std::make_unique<c_lexer::SourceReader>(
+                  "s = u\"x\\ny\" \"a\\\nb\" + 'q' + 12"),
+              Lexer::DECODE_STRINGS);
+  lexer.set_arena(&arena);
+
+  std::vector<Lexeme> v;
+  while (lexer.peek() != Token::END)
+    v.push_back(lexer.eat());
+  ASSERT_EQ(8u, v.size());
+
+  EXPECT_EQ(StringValue::NONE, v[0].string().encoding);
+  EXPECT_EQ(u"x\ny", v[2].string().view<char16_t>());
+  EXPECT_EQ("ab", v[3].string().view<char>());
+  EXPECT_EQ("q", v[5].string().view<char>());
+  EXPECT_EQ(StringValue::NONE, v[7].string().encoding);
+  EXPECT_LT(0u, arena.used());
+
+  // scan_tokens() decodes only into an arena that outlives it.
+  const std::uint32_t flags = Lexer::DECODE_STRINGS | Lexer::ZERO_COPY;
+  EXPECT_EQ(StringValue::NONE,
+            scan_tokens("\"abc\"", flags)[0].string().encoding);
+  EXPECT_EQ("abc",
+            scan_tokens("\"abc\"", flags, &arena)[0].string().view<char>());
+}
+
+TEST(StringValue, shares_the_payload_with_numbers) {
+  Arena arena;
+  const std::vector<Lexeme> v = scan_tokens(
+      "'q' 12 \"s\"", Lexer::DECODE_STRINGS | Lexer::DECODE_NUMBERS, &arena);
+  ASSERT_EQ(4u, v.size());
+
+  // A character constant is an INTEGER_LIT, but decoded only as a string.
+  EXPECT_EQ("q", v[0].string().view<char>());
+  EXPECT_EQ(c_lexer::NumericValue::NONE, v[0].number().kind);
+  EXPECT_EQ(12u, v[1].number().integer);
+  EXPECT_EQ(StringValue::NONE, v[1].string().encoding);
+  EXPECT_EQ("s", v[2].string().view<char>());
+  EXPECT_EQ(c_lexer::NumericValue::NONE, v[2].number().kind);
+
+  // The payload is no larger than its larger member.
+  EXPECT_EQ(sizeof(c_lexer::NumericValue), sizeof(StringValue));
+}
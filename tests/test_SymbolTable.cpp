@@ -0,0 +1,156 @@
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <c_lexer/Lexer.h>
+#include <c_lexer/SymbolTable.h>
+#include <c_lexer/TokenStream.h>
+
+using c_lexer::Edit;
+using c_lexer::Lexer;
+using c_lexer::no_symbol;
+using c_lexer::relex_tokens;
+using c_lexer::scan_tokens;
+using c_lexer::scan_tokens_parallel;
+using c_lexer::SymbolTable;
+using c_lexer::Token;
+using c_lexer::TokenStream;
+
+#include "tests/tests.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+TEST(SymbolTable, dense_ids) {
+  SymbolTable symbols;
+  EXPECT_EQ(0u, symbols.intern("x"));
+  EXPECT_EQ(1u, symbols.intern("y"));
+  EXPECT_EQ(0u, symbols.intern("x"));
+  EXPECT_EQ(2u, symbols.intern(""));
+  EXPECT_EQ(2u, symbols.intern(""));
+  EXPECT_EQ(3u, symbols.size());
+
+  EXPECT_EQ(1u, symbols.find("y"));
+  EXPECT_EQ(no_symbol, symbols.find("z"));
+  EXPECT_EQ("x", symbols.name(0));
+  EXPECT_EQ("", symbols.name(2));
+}
+
+TEST(SymbolTable, names_outlive_growth) {
+  SymbolTable symbols;
+  std::vector<std::string_view> names;
+  for (int i = 0; i < 100000; ++i) {
+    const std::string name = "name_" + std::to_string(i);
+    ASSERT_EQ(static_cast<std::uint32_t>(i), symbols.intern(name));
+    names.push_back(symbols.name(i));
+  }
+  names.push_back(symbols.name(symbols.intern(std::string(100000, 'a'))));
+
+  for (int i = 0; i < 100000; ++i) {
+    EXPECT_EQ("name_" + std::to_string(i), names[i]);
+    EXPECT_EQ(static_cast<std::uint32_t>(i),
+              symbols.find("name_" + std::to_string(i)));
+  }
+  EXPECT_EQ(std::string(100000, 'a'), names.back());
+}
+
+TEST(SymbolTable, shared) {
+  SymbolTable symbols(true);
+  std::vector<std::vector<std::uint32_t>> ids(4);
+  std::vector<std::thread> threads;
+  for (std::size_t t = 0; t < ids.size(); ++t)
+    threads.emplace_back([&, t] {
+      for (int i = 0; i < 20000; ++i)
+        ids[t].push_back(symbols.intern("s" + std::to_string(i % 5000)));
+    });
+  for (std::thread &t : threads)
+    t.join();
+
+  EXPECT_EQ(5000u, symbols.size());
+  for (std::size_t t = 0; t < ids.size(); ++t) {
+    EXPECT_EQ(ids[0], ids[t]);
+    for (int i = 0; i < 5000; ++i)
+      EXPECT_EQ("s" + std::to_string(i), symbols.name(ids[t][i]));
+  }
+}
+
+TEST(SymbolTable, lexer_interns_identifiers) {
+  SymbolTable symbols;
+  const std::string_view src = "int x = y + x;\nx\\\nx xx";
+  for (std::uint32_t flags :
+       {0u, unsigned(Lexer::ZERO_COPY), unsigned(Lexer::TABLE_KEYWORDS)}) {
+    Lexer lexer(std::make_unique<c_lexer::SourceReader>(src), flags);
+    lexer.set_symbols(&symbols);
+
+    std::vector<std::uint32_t> ids;
+    for (; lexer.peek().token() != Token::END; lexer.eat())
+      ids.push_back(lexer.peek().symbol_);
+    EXPECT_EQ((std::vector<std::uint32_t>{no_symbol, 0, no_symbol, 1,
+                                          no_symbol, 0, no_symbol, 2, 2}),
+              ids);
+  }
+  EXPECT_EQ("xx", symbols.name(2));
+}
+
+void expect_symbols_name_tokens(const TokenStream &ts,
+                                const SymbolTable &symbols) {
+  ASSERT_EQ(ts.size(), ts.symbol_ids().size());
+  for (std::size_t i = 0; i < ts.size(); ++i) {
+    if (ts.token(i) == Token::IDENTIFIER)
+      EXPECT_EQ(c_lexer::unsplice(ts.text(i)), symbols.name(ts.symbol(i)));
+    else
+      EXPECT_EQ(no_symbol, ts.symbol(i));
+  }
+}
+
+TEST(SymbolTable, token_streams) {
+  std::string src;
+  for (int i = 0; src.size() < 2 * 1024 * 1024; ++i)
+    src += "static int x" + std::to_string(i % 1000) + " = y + z" +
+           std::to_string(i) + ";\n#define m\\\n" + std::to_string(i % 7) +
+           "(a) a\n";
+
+  SymbolTable serial_symbols;
+  TokenStream serial;
+  serial.set_symbols(&serial_symbols);
+  scan_tokens(src, serial);
+  expect_symbols_name_tokens(serial, serial_symbols);
+
+  // The same ids, in source order, from any number of chunks.
+  for (unsigned n_threads : {2u, 0u}) {
+    SymbolTable symbols;
+    TokenStream parallel;
+    parallel.set_symbols(&symbols);
+    scan_tokens_parallel(src, parallel, n_threads);
+    EXPECT_EQ(serial.symbol_ids(), parallel.symbol_ids());
+    EXPECT_EQ(serial_symbols.size(), symbols.size());
+  }
+
+  for (const std::string_view inserted : {"q ", "x", ";", "\\\n", "1"}) {
+    const std::size_t at = src.size() / 3 + inserted.size();
+    src.insert(at, inserted);
+    relex_tokens(src, Edit{at, 0, inserted.size()}, serial);
+    expect_symbols_name_tokens(serial, serial_symbols);
+  }
+}
@@ -0,0 +1,253 @@
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <c_lexer/LexFiles.h>
+#include <c_lexer/Lexer.h>
+#include <c_lexer/SymbolTable.h>
+#include <c_lexer/TokenCache.h>
+#include <c_lexer/TokenStream.h>
+
+using c_lexer::check_source;
+using c_lexer::count_tokens;
+using c_lexer::deserialize_tokens;
+using c_lexer::hash_source;
+using c_lexer::Lexer;
+using c_lexer::scan_tokens;
+using c_lexer::serialize_tokens;
+using c_lexer::SymbolTable;
+using c_lexer::Token;
+using c_lexer::TokenCache;
+using c_lexer::TokenCounts;
+using c_lexer::TokenStream;
+
+#include "tests/tests.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <dirent.h>
+#include <unistd.h>
+
+static const std::string_view src = "#include <stdio.h>\n"
+                                    "int main(int argc, char *argv[]) {\n"
+                                    "  /* comment */ printf(\"%d\\n\", ar\\\n"
+                                    "gc);\n"
+                                    "  return argc + 0x10 - 'a';\n"
+                                    "}\n";
+
+static std::vector<std::string> list_files(const std::string &dir) {
+  std::vector<std::string> v;
+  DIR *d = opendir(dir.c_str());
+  if (!d)
+    return v;
+  while (const dirent *e = readdir(d))
+    if (e->d_name[0] != '.')
+      v.push_back(e->d_name);
+  closedir(d);
+  return v;
+}
+
+static void remove_dir(const std::string &dir) {
+  for (const std::string &f : list_files(dir))
+    unlink((dir + "/" + f).c_str());
+  rmdir(dir.c_str());
+}
+
+// A fresh, empty directory, removed with everything in it at the end.
+class TokenCacheTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    char name[] = "tokencache-XXXXXX";
+    ASSERT_NE(nullptr, mkdtemp(name));
+    dir_ = name;
+  }
+
+  void TearDown() override { remove_dir(dir_); }
+
+  std::vector<std::string> files() const { return list_files(dir_); }
+
+  std::string dir_;
+};
+
+static void expect_same_tokens(const TokenStream &expected,
+                               const TokenStream &actual) {
+  EXPECT_EQ(expected.kinds(), actual.kinds());
+  EXPECT_EQ(expected.offsets(), actual.offsets());
+  EXPECT_EQ(expected.lengths(), actual.lengths());
+}
+
+TEST(TokenCache, hash_source) {
+  EXPECT_EQ(hash_source(src), hash_source(std::string(src)));
+  EXPECT_NE(hash_source(""), hash_source(std::string(1, '\0')));
+  EXPECT_NE(hash_source("int x;"), hash_source("int y;"));
+  EXPECT_NE(hash_source("abcdefgh1"), hash_source("abcdefgh2"));
+
+  // The check is a different function of the same bytes.
+  EXPECT_EQ(check_source(src), check_source(std::string(src)));
+  EXPECT_NE(check_source("abcdefgh1"), check_source("abcdefgh2"));
+  EXPECT_NE(hash_source(src), check_source(src));
+}
+
+TEST(TokenCache, round_trip) {
+  for (std::uint32_t flags : {0u, unsigned(Lexer::KEEP_COMMENTS)}) {
+    TokenStream expected;
+    scan_tokens(src, expected, flags);
+    const std::string data = serialize_tokens(expected, src, flags);
+
+    TokenStream ts;
+    ASSERT_TRUE(deserialize_tokens(data, src, flags, ts));
+    expect_same_tokens(expected, ts);
+    EXPECT_EQ(src, ts.source());
+
+    // Rows and columns are still computed on demand.
+    for (std::size_t i = 0; i < ts.size(); ++i) {
+      EXPECT_EQ(expected.row(i), ts.row(i));
+      EXPECT_EQ(expected.col(i), ts.col(i));
+    }
+  }
+}
+
+TEST(TokenCache, remaps_symbols) {
+  SymbolTable scanned;
+  TokenStream expected;
+  expected.set_symbols(&scanned);
+  scan_tokens(src, expected);
+  const std::string data = serialize_tokens(expected, src, 0);
+
+  // A table that already has names gives them different ids.
+  SymbolTable symbols;
+  symbols.intern("other");
+  symbols.intern("argc");
+  TokenStream ts;
+  ts.set_symbols(&symbols);
+  ASSERT_TRUE(deserialize_tokens(data, src, 0, ts));
+  expect_same_tokens(expected, ts);
+
+  for (std::size_t i = 0; i < ts.size(); ++i) {
+    if (ts.token(i) != Token::IDENTIFIER) {
+      EXPECT_EQ(c_lexer::no_symbol, ts.symbol(i));
+      continue;
+    }
+    EXPECT_EQ(scanned.name(expected.symbol(i)), symbols.name(ts.symbol(i)));
+  }
+  EXPECT_EQ(1u, symbols.find("argc"));
+  EXPECT_NE(c_lexer::no_symbol, symbols.find("argv"));
+}
+
+TEST(TokenCache, rejects_bad_data) {
+  TokenStream expected;
+  scan_tokens(src, expected);
+  const std::string data = serialize_tokens(expected, src, 0);
+  TokenStream ts;
+
+  // Another source, other flags, or a stream with a different stamp.
+  std::string other(src);
+  other[other.size() - 2] = ';';
+  EXPECT_FALSE(deserialize_tokens(data, other, 0, ts));
+  EXPECT_FALSE(deserialize_tokens(data, src, Lexer::KEEP_COMMENTS, ts));
+  std::string stamp = data;
+  stamp[4] ^= 1;
+  EXPECT_FALSE(deserialize_tokens(stamp, src, 0, ts));
+
+  // A stream whose first hash matches is still refused when the second,
+  // which a colliding source would not share, does not.
+  std::string check = data;
+  check[4 + 8 + 8] ^= 1;
+  EXPECT_FALSE(deserialize_tokens(check, src, 0, ts));
+
+  // Every truncation, and damage to any byte that would make a token run
+  // past the source, is caught.
+  for (std::size_t n = 0; n < data.size(); ++n) {
+    EXPECT_FALSE(deserialize_tokens(data.substr(0, n), src, 0, ts)) << n;
+    EXPECT_TRUE(ts.empty());
+  }
+  EXPECT_FALSE(deserialize_tokens(data + '\0', src, 0, ts));
+
+  for (std::size_t i = 0; i < data.size(); ++i) {
+    std::string damaged = data;
+    damaged[i] = '\xff';
+    if (deserialize_tokens(damaged, src, 0, ts)) {
+      for (std::size_t k = 0; k < ts.size(); ++k)
+        EXPECT_LE(ts.offset(k) + ts.length(k), src.size());
+      EXPECT_EQ(Token::END, ts.token(ts.size() - 1));
+    }
+  }
+}
+
+TEST_F(TokenCacheTest, hit_after_miss) {
+  TokenCache cache(dir_);
+  TokenStream expected;
+  const std::size_t n = scan_tokens(src, expected);
+
+  TokenStream ts;
+  EXPECT_FALSE(cache.load(src, 0, ts));
+  EXPECT_EQ(n, cache.scan_tokens(src, ts));
+  EXPECT_EQ(1u, cache.misses());
+  EXPECT_EQ(std::vector<std::string>{cache.path(src, 0).substr(dir_.size() +
+                                                               1)},
+            files());
+
+  TokenStream loaded;
+  EXPECT_EQ(n, cache.scan_tokens(src, loaded));
+  EXPECT_EQ(1u, cache.hits());
+  expect_same_tokens(expected, loaded);
+
+  // Other flags are cached separately.
+  cache.scan_tokens(src, ts, Lexer::KEEP_COMMENTS);
+  EXPECT_EQ(2u, cache.misses());
+  EXPECT_EQ(2u, files().size());
+
+  // A damaged file is a miss and is replaced.
+  std::ofstream(cache.path(src, 0), std::ios::binary | std::ios::trunc)
+      << "CLXT";
+  EXPECT_EQ(n, cache.scan_tokens(src, loaded));
+  EXPECT_EQ(3u, cache.misses());
+  expect_same_tokens(expected, loaded);
+  EXPECT_TRUE(cache.load(src, 0, loaded));
+}
+
+TEST_F(TokenCacheTest, count_tokens) {
+  std::vector<std::string> paths;
+  for (int i = 0; i < 8; ++i) {
+    const std::string path = dir_ + "/src" + std::to_string(i) + ".c";
+    std::ofstream(path) << src << "int x" << i % 4 << ";\n";
+    paths.push_back(path);
+  }
+
+  const TokenCounts expected = count_tokens(paths, 2);
+  TokenCache cache(dir_ + "/cache");
+  for (int pass = 0; pass < 2; ++pass) {
+    const TokenCounts counts = count_tokens(paths, 2, 0, &cache);
+    EXPECT_EQ(expected.counts, counts.counts);
+    EXPECT_EQ(paths.size(), counts.files);
+  }
+  // Files with the same contents share an entry.
+  EXPECT_EQ(16u, cache.hits() + cache.misses());
+  EXPECT_GE(cache.hits(), 8u);
+  EXPECT_EQ(4u, list_files(cache.dir()).size());
+
+  remove_dir(cache.dir());
+}
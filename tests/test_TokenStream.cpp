@@ -0,0 +1,314 @@
+// MIT License
+//
+// Copyright (c) 2024 Tim Whisonant
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <c_lexer/Lexer.h>
+#include <c_lexer/Token.h>
+#include <c_lexer/TokenStream.h>
+
+using c_lexer::Edit;
+using c_lexer::Lexeme;
+using c_lexer::relex_tokens;
+using c_lexer::scan_tokens;
+using c_lexer::Token;
+using c_lexer::TokenStream;
+
+#include "tests/tests.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+void expect_matches_lexemes(std::string_view src, std::uint32_t flags = 0) {
+  const std::vector<Lexeme> expected = scan_tokens(src, flags);
+
+  TokenStream ts;
+  ASSERT_EQ(expected.size(), scan_tokens(src, ts, flags));
+  ASSERT_EQ(expected.size(), ts.size());
+
+  for (std::size_t i = 0; i < ts.size(); ++i) {
+    EXPECT_EQ(expected[i].token(), ts.token(i));
+    EXPECT_EQ(expected[i].text(), c_lexer::unsplice(ts.text(i)));
+    EXPECT_EQ(expected[i].offset_, ts.offset(i));
+    EXPECT_EQ(expected[i].row_, ts.row(i));
+    EXPECT_EQ(expected[i].col_, ts.col(i));
+  }
+}
+
+TEST(TokenStream, columns) {
+  const std::string_view src("int x = 42;");
+
+  TokenStream ts;
+  ASSERT_EQ(static_cast<std::size_t>(6), scan_tokens(src, ts));
+
+  const std::uint8_t kinds[] = {
+      static_cast<std::uint8_t>(Token::INT),
+      static_cast<std::uint8_t>(Token::IDENTIFIER),
+      static_cast<std::uint8_t>(Token::ASSIGN),
+      static_cast<std::uint8_t>(Token::INTEGER_LIT),
+      static_cast<std::uint8_t>(Token::SEMI),
+      static_cast<std::uint8_t>(Token::END),
+  };
+  EXPECT_EQ(std::vector<std::uint8_t>(std::begin(kinds), std::end(kinds)),
+            ts.kinds());
+  EXPECT_EQ(std::vector<std::uint32_t>({0, 4, 6, 8, 10, 11}), ts.offsets());
+  EXPECT_EQ(std::vector<std::uint32_t>({3, 1, 1, 2, 1, 0}), ts.lengths());
+  EXPECT_EQ("42", ts.text(3));
+  EXPECT_EQ(src.data(), ts.source().data());
+}
+
+TEST(TokenStream, positions_match_lexemes) {
+  expect_matches_lexemes("");
+  expect_matches_lexemes("\n\n   ");
+  expect_matches_lexemes("int main(int argc, char *argv[]) {\n"
+                         "\treturn argc > 1 ? 0 : 1;\n"
+                         "}\n");
+  expect_matches_lexemes("a\r\nb \v c\f\td @ e\r f");
+  expect_matches_lexemes("s = \"a\\tb\";\n  c = 'x' + L'\\n';\n`");
+
+  const char *comments = "a /* b\n\t\r c */ d // e\r\n"
+                         "/*\v*/ f /* \f */ g //";
+  expect_matches_lexemes(comments);
+  expect_matches_lexemes(comments, c_lexer::Lexer::KEEP_COMMENTS);
+
+  const char *directives = "#include <a.h>\n #define F(x) \\\n  #x ## 1\n"
+                           "i\\\r\nnt y\\\n; /\\\n* z *\\\n/ w";
+  expect_matches_lexemes(directives);
+  expect_matches_lexemes(directives, c_lexer::Lexer::KEEP_COMMENTS);
+}
+
+TEST(TokenStream, reuse) {
+  TokenStream ts;
+  scan_tokens("a b c d e f", ts);
+  EXPECT_EQ(static_cast<std::size_t>(7), ts.size());
+  EXPECT_EQ(static_cast<std::uint32_t>(11), ts.col(5));
+
+  scan_tokens("\n  x", ts);
+  ASSERT_EQ(static_cast<std::size_t>(2), ts.size());
+  EXPECT_EQ(static_cast<std::uint32_t>(2), ts.row(0));
+  EXPECT_EQ(static_cast<std::uint32_t>(3), ts.col(0));
+  EXPECT_EQ("x", ts.text(0));
+}
+
+void expect_same_stream(const TokenStream &expected,
+                        const TokenStream &actual) {
+  ASSERT_EQ(expected.size(), actual.size());
+  // Token by token, through any gap that relex_tokens() left in actual.
+  const auto tokens = [](const TokenStream &ts) {
+    std::vector<std::uint32_t> v;
+    for (std::size_t i = 0; i < ts.size(); ++i) {
+      v.push_back(static_cast<std::uint32_t>(ts.token(i)));
+      v.push_back(ts.offset(i));
+      v.push_back(ts.length(i));
+      v.push_back(ts.line_state(i));
+    }
+    return v;
+  };
+  EXPECT_EQ(tokens(expected), tokens(actual));
+
+  // Positions and columns from a copy, so that actual keeps its gap and, if
+  // they are lazy, its lazy positions.
+  const TokenStream copy = actual;
+  std::vector<std::uint32_t> expected_pos;
+  std::vector<std::uint32_t> actual_pos;
+  for (std::size_t i = 0; i < expected.size(); ++i) {
+    expected_pos.push_back(expected.row(i));
+    expected_pos.push_back(expected.col(i));
+    actual_pos.push_back(copy.row(i));
+    actual_pos.push_back(copy.col(i));
+  }
+  EXPECT_EQ(expected_pos, actual_pos);
+  EXPECT_EQ(expected.kinds(), copy.kinds());
+  EXPECT_EQ(expected.offsets(), copy.offsets());
+  EXPECT_EQ(expected.lengths(), copy.lengths());
+  EXPECT_EQ(expected.line_states(), copy.line_states());
+}
+
+TEST(TokenStream, fill_in_batches) {
+  const std::string_view src("#define N 3\nint a[N] = {1, 2, 3}; // x\n");
+  TokenStream expected;
+  scan_tokens(src, expected);
+
+  TokenStream ts;
+  ts.reset(src);
+  c_lexer::Lexer lexer(std::make_unique<c_lexer::SourceReader>(src),
+                       c_lexer::Lexer::ZERO_COPY);
+  do {
+    ASSERT_GT(lexer.fill(ts, 4), static_cast<std::size_t>(0));
+  } while (ts.token(ts.size() - 1) != Token::END);
+  expect_same_stream(expected, ts);
+
+  // Past the end, a batch holds just END.
+  EXPECT_EQ(static_cast<std::size_t>(1), lexer.fill(ts, 4));
+  EXPECT_EQ(Token::END, ts.token(ts.size() - 1));
+
+  // A TokenStream of some other copy of the source is refused.
+  const std::string copy(src);
+  TokenStream other;
+  other.reset(copy);
+  testing::internal::CaptureStderr();
+  EXPECT_EQ(static_cast<std::size_t>(0), lexer.fill(other, 4));
+  EXPECT_NE(std::string::npos,
+            testing::internal::GetCapturedStderr().find("Lexer::fill()"));
+  EXPECT_EQ(static_cast<std::size_t>(0), other.size());
+}
+
+void expect_relex_matches_scan(std::uint32_t flags) {
+  const char *fragments[] = {
+      "x", "12", ".",  "..", "e+", "\"", "'",  "\\", " ",       "\t",
+      "\n", "\v", "=",  "->", "<<", "u8", "L",  "@",  "int",     "0x",
+      "/", "*",  "/*", "*/", "//", "#",  "##", "<",  "include", "\r"};
+
+  // Edits that open a literal leave it unterminated.
+  std::ostringstream discard;
+  std::streambuf *cerr_save = std::cerr.rdbuf(discard.rdbuf());
+
+  std::mt19937 gen(11);
+  std::string src = "int main(void) {\n\tchar *s = \"a b\"; /* c\n d */\n"
+                    "  return s[0] >> 1 ... 2.5e3f; // e\n}\n";
+  // One stream leaves positions lazy, and the other follows them from the
+  // start.
+  TokenStream ts;
+  scan_tokens(src, ts, flags);
+  TokenStream tp;
+  scan_tokens(src, tp, flags);
+  tp.row(0);
+
+  for (int trial = 0; trial < 2000; ++trial) {
+    std::uniform_int_distribution<std::size_t> at(0, src.size());
+    const std::size_t offset = at(gen);
+    std::uniform_int_distribution<std::size_t> cut(
+        0, std::min<std::size_t>(3, src.size() - offset));
+    const std::string inserted =
+        std::string(fragments[gen() % std::size(fragments)]) +
+        (gen() % 2 ? fragments[gen() % std::size(fragments)] : "");
+
+    // Keep the source from growing without bound.
+    const std::size_t removed = src.size() > 200 ? 3 : cut(gen);
+    const Edit edit{offset, std::min(removed, src.size() - offset),
+                    inserted.size()};
+
+    const std::string before = src;
+    src.replace(edit.offset, edit.removed, inserted);
+    relex_tokens(src, edit, ts, flags);
+    relex_tokens(src, edit, tp, flags);
+
+    TokenStream expected;
+    scan_tokens(src, expected, flags);
+    SCOPED_TRACE("edit " + std::to_string(trial) + " of \"" + before + "\"");
+    expect_same_stream(expected, ts);
+    expect_same_stream(expected, tp);
+    if (::testing::Test::HasFailure())
+      break;
+  }
+
+  std::cerr.rdbuf(cerr_save);
+}
+
+TEST(RelexTokens, matches_full_scan) {
+  expect_relex_matches_scan(0);
+  expect_relex_matches_scan(c_lexer::Lexer::KEEP_COMMENTS);
+}
+
+TEST(RelexTokens, rescans_only_near_the_edit) {
+  std::string src;
+  for (int i = 0; src.size() < 1024 * 1024; ++i)
+    src += "x" + std::to_string(i) + " = f(y, \"s\") + 1;\n";
+
+  TokenStream ts;
+  scan_tokens(src, ts);
+
+  // Split an identifier in the middle of the buffer.
+  const std::size_t at = src.find("x5000 ");
+  src.insert(at + 3, " ");
+  EXPECT_LE(relex_tokens(src, Edit{at + 3, 0, 1}, ts), 4u);
+
+  TokenStream expected;
+  scan_tokens(src, expected);
+  expect_same_stream(expected, ts);
+
+  // Open a string literal, which swallows the rest of the line.
+  std::ostringstream discard;
+  std::streambuf *cerr_save = std::cerr.rdbuf(discard.rdbuf());
+  src.insert(at, "\"");
+  EXPECT_LE(relex_tokens(src, Edit{at, 0, 1}, ts), 16u);
+  scan_tokens(src, expected);
+  std::cerr.rdbuf(cerr_save);
+
+  expect_same_stream(expected, ts);
+}
+
+// The median time of a keystroke typed into the first or last identifier of a
+// source of about bytes, after one to open the gap there. Minified, the
+// source is all one line.
+double keystroke_ns(std::size_t bytes, bool at_end, bool minified = false) {
+  std::string src;
+  for (int i = 0; src.size() < bytes; ++i)
+    src += "x" + std::to_string(i) + " = f(y, \"s\") + 1;" +
+           (minified ? "" : "\n");
+  TokenStream ts;
+  scan_tokens(src, ts);
+
+  const std::size_t at = at_end ? src.rfind('x') + 1 : 1;
+  std::vector<double> ns;
+  for (int i = 0; i < 41; ++i) {
+    src.insert(at, "q");
+    const auto t0 = std::chrono::steady_clock::now();
+    relex_tokens(src, Edit{at, 0, 1}, ts);
+    const auto t1 = std::chrono::steady_clock::now();
+    if (i)
+      ns.push_back(std::chrono::duration<double, std::nano>(t1 - t0).count());
+  }
+
+  TokenStream expected;
+  scan_tokens(src, expected);
+  expect_same_stream(expected, ts);
+  std::nth_element(ns.begin(), ns.begin() + ns.size() / 2, ns.end());
+  return ns[ns.size() / 2];
+}
+
+TEST(RelexTokens, latency_does_not_scale_with_size) {
+  // A source 64 times the size may not take many times as long to edit. The
+  // slack covers timer noise on a small one.
+  for (bool at_end : {false, true}) {
+    SCOPED_TRACE(at_end ? "at end" : "at start");
+    const double small = keystroke_ns(256 * 1024, at_end);
+    const double large = keystroke_ns(16 * 1024 * 1024, at_end);
+    EXPECT_LT(large, 8 * small + 50000) << small << " ns against " << large;
+  }
+}
+
+TEST(RelexTokens, latency_does_not_scale_with_line_length) {
+  // The same on a source with no newlines, whose one line is all of it.
+  for (bool at_end : {false, true}) {
+    SCOPED_TRACE(at_end ? "at end" : "at start");
+    const double small = keystroke_ns(64 * 1024, at_end, true);
+    const double large = keystroke_ns(4 * 1024 * 1024, at_end, true);
+    EXPECT_LT(large, 8 * small + 50000) << small << " ns against " << large;
+  }
+}
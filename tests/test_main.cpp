@@ -20,8 +20,11 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include <c_lexer/LexerStats.h>
+
 #include <cstdlib>
 #include <cstring>
+#include <dirent.h>
 #include <fstream>
 #include <iostream>
 #include <unistd.h>
@@ -55,3 +58,180 @@ TEST(c_lexview, test) {
 
   unlink(tmpfile);
 }
+
+TEST(c_lexview, parallel) {
+  char app[] = "c_lexview";
+  char j[] = "-j";
+  char two[] = "2";
+  char file0[32];
+  char file1[32];
+  char missing[] = "tmptest-missing.c";
+
+  std::strcpy(file0, "tmptest0-XXXXXX");
+  std::strcpy(file1, "tmptest1-XXXXXX");
+  close(mkstemp(file0));
+  close(mkstemp(file1));
+
+  std::ofstream out0(file0);
+  out0 << "int x = 1;\n";
+  out0.close();
+  std::ofstream out1(file1);
+  out1 << "{ return 0; }\n";
+  out1.close();
+
+  char *argv[] = {app, j, two, file0, file1, nullptr};
+  EXPECT_EQ(0, c_lexview_main(5, argv));
+
+  // -jN form, with an unreadable file.
+  char j2[] = "-j2";
+  char *argv_missing[] = {app, j2, file0, missing, nullptr};
+  EXPECT_EQ(1, c_lexview_main(4, argv_missing));
+
+  // Several files without -j run on one thread.
+  char *argv_serial[] = {app, file0, file1, nullptr};
+  EXPECT_EQ(0, c_lexview_main(3, argv_serial));
+
+  char bad[] = "-jx";
+  char *argv_bad[] = {app, bad, file0, nullptr};
+  EXPECT_EQ(1, c_lexview_main(3, argv_bad));
+
+  unlink(file0);
+  unlink(file1);
+}
+
+TEST(c_lexview, cache_dir) {
+  char app[] = "c_lexview";
+  char flag[] = "--cache-dir";
+  char dir[] = "tmpcache-XXXXXX";
+  char file[32];
+
+  ASSERT_NE(nullptr, mkdtemp(dir));
+  std::strcpy(file, "tmptest-XXXXXX");
+  close(mkstemp(file));
+  std::ofstream out(file);
+  out << "int x = 1;\n";
+  out.close();
+
+  // The first run stores the tokens and the second loads them.
+  char *argv[] = {app, flag, dir, file, nullptr};
+  EXPECT_EQ(0, c_lexview_main(4, argv));
+  EXPECT_EQ(0, c_lexview_main(4, argv));
+
+  DIR *d = opendir(dir);
+  ASSERT_NE(nullptr, d);
+  int entries = 0;
+  while (const dirent *e = readdir(d)) {
+    if (e->d_name[0] == '.')
+      continue;
+    ++entries;
+    unlink((std::string(dir) + "/" + e->d_name).c_str());
+  }
+  closedir(d);
+  EXPECT_EQ(1, entries);
+
+  char *argv_bad[] = {app, flag, nullptr};
+  EXPECT_EQ(1, c_lexview_main(2, argv_bad));
+  char *argv_none[] = {app, flag, dir, nullptr};
+  EXPECT_EQ(1, c_lexview_main(3, argv_none));
+
+  rmdir(dir);
+  unlink(file);
+}
+
+TEST(c_lexview, stats) {
+  char app[] = "c_lexview";
+  char flag[] = "--stats";
+  char file[32];
+  char missing[] = "tmptest-missing.c";
+
+  std::strcpy(file, "tmptest-XXXXXX");
+  close(mkstemp(file));
+  std::ofstream out(file);
+  out << "int x = a > b;\n";
+  out.close();
+
+  // Only a library configured with MYPROJ_LEXER_STATS has any to report.
+  const int expected = c_lexer::lexer_stats_enabled() ? 0 : 1;
+  char *argv[] = {app, flag, file, nullptr};
+  EXPECT_EQ(expected, c_lexview_main(3, argv));
+
+  char *argv_missing[] = {app, flag, file, missing, nullptr};
+  EXPECT_EQ(1, c_lexview_main(4, argv_missing));
+
+  unlink(file);
+}
+
+TEST(c_lexview, counts) {
+  char app[] = "c_lexview";
+  char count_only[] = "--count-only";
+  char histogram[] = "--histogram";
+  char j2[] = "-j2";
+  char file0[32];
+  char file1[32];
+  char missing[] = "tmptest-missing.c";
+
+  std::strcpy(file0, "tmptest0-XXXXXX");
+  std::strcpy(file1, "tmptest1-XXXXXX");
+  close(mkstemp(file0));
+  close(mkstemp(file1));
+
+  std::ofstream out0(file0);
+  out0 << "int x = 1;\n";
+  out0.close();
+  std::ofstream out1(file1);
+  out1 << "{ return x + x; }\n";
+  out1.close();
+
+  std::istringstream iss("int main(void)");
+  std::streambuf *sb_save = std::cin.rdbuf();
+  std::cin.rdbuf(iss.rdbuf());
+  char *argv_stdin[] = {app, count_only, nullptr};
+  EXPECT_EQ(0, c_lexview_main(2, argv_stdin));
+  std::cin.rdbuf(sb_save);
+
+  char *argv_one[] = {app, histogram, file0, nullptr};
+  EXPECT_EQ(0, c_lexview_main(3, argv_one));
+
+  char *argv_many[] = {app, count_only, file0, file1, nullptr};
+  EXPECT_EQ(0, c_lexview_main(4, argv_many));
+
+  char *argv_parallel[] = {app, j2, histogram, file0, file1, nullptr};
+  EXPECT_EQ(0, c_lexview_main(5, argv_parallel));
+
+  char *argv_missing[] = {app, histogram, missing, nullptr};
+  EXPECT_EQ(1, c_lexview_main(3, argv_missing));
+  char *argv_some_missing[] = {app, count_only, file0, missing, nullptr};
+  EXPECT_EQ(1, c_lexview_main(4, argv_some_missing));
+
+  unlink(file0);
+  unlink(file1);
+}
+
+TEST(c_lexview, perf) {
+  char app[] = "c_lexview";
+  char perf[] = "--perf";
+  char file0[32];
+  char missing[] = "tmptest-missing.c";
+
+  std::strcpy(file0, "tmptest0-XXXXXX");
+  close(mkstemp(file0));
+
+  std::ofstream out0(file0);
+  out0 << "int x = 0x; /* counted whether or not the CPU lets us */\n";
+  out0.close();
+
+  std::istringstream iss("int main(void)");
+  std::streambuf *sb_save = std::cin.rdbuf();
+  std::cin.rdbuf(iss.rdbuf());
+  char *argv_stdin[] = {app, perf, nullptr};
+  EXPECT_EQ(0, c_lexview_main(2, argv_stdin));
+  std::cin.rdbuf(sb_save);
+
+  char *argv_many[] = {app, perf, file0, file0, nullptr};
+  EXPECT_EQ(0, c_lexview_main(4, argv_many));
+
+  char *argv_missing[] = {app, perf, file0, missing, nullptr};
+  EXPECT_EQ(1, c_lexview_main(4, argv_missing));
+
+  unlink(file0);
+}